@@ -67,4 +67,23 @@
 //#define MESOSPHERE_ENABLE_LARGE_PHYSICAL_ADDRESS_CAPABILITIES
 #else
 #define MESOSPHERE_ENABLE_LARGE_PHYSICAL_ADDRESS_CAPABILITIES
-#endif
\ No newline at end of file
+#endif
+
+/* NOTE: This puts per-core magazine caches in front of the shared free lists of */
+/* object slab heaps, so that most allocations and frees only touch core-local memory, */
+/* and the shared free list is touched in batches. Each core may then hold a few free */
+/* objects of each type; when a slab heap is otherwise exhausted, these are stolen back. */
+#define MESOSPHERE_ENABLE_SLAB_HEAP_MAGAZINES
+
+/* NOTE: This runs a slab heap stress benchmark on all cores during initialization, */
+/* and logs the results. It is intended for use under the qemu virt board. */
+//#define MESOSPHERE_ENABLE_SLAB_HEAP_BENCHMARK
+
+/* NOTE: This tracks which cores' scheduled queues have changed since the last scheduler update, */
+/* so that an update only recomputes the highest priority thread for those cores (and for idle */
+/* cores, which may migrate a thread), rather than for every core. */
+#define MESOSPHERE_ENABLE_SCHEDULER_DIRTY_CORE_MASK
+
+/* NOTE: This runs a context switch ping-pong benchmark between pairs of cores during initialization, */
+/* and logs the results. It is intended for use under the qemu virt board. */
+//#define MESOSPHERE_ENABLE_SCHEDULER_BENCHMARK
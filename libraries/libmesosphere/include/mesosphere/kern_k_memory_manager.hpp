@@ -50,6 +50,24 @@ namespace ams::kern {
             };
 
             static constexpr size_t MaxManagerCount = 10;
+
+            static constexpr s32 ZeroingThreadPriority         = ams::svc::LowestThreadPriority;
+            static constexpr size_t ZeroingBatchPages          = 0x10;
+            static constexpr size_t ZeroedPageWatermarkDivisor = 0x20;
+            static constexpr size_t ZeroedPageWatermarkSizeMax = 32_MB;
+
+            /* Hits and misses count allocated pages which were and weren't already zeroed when allocated. */
+            struct ZeroedPageStatistics {
+                size_t num_zeroed_pages;
+                u64 num_hits;
+                u64 num_misses;
+            };
+        private:
+            enum ZeroingState {
+                ZeroingState_Running,
+                ZeroingState_WaitingForAllocation,
+                ZeroingState_WaitingForFree,
+            };
         private:
             class Impl {
                 private:
@@ -74,7 +92,15 @@ namespace ams::kern {
 
                     KPhysicalAddress AllocateBlock(s32 index, bool random) { return m_heap.AllocateBlock(index, random); }
                     KPhysicalAddress AllocateAligned(s32 index, size_t num_pages, size_t align_pages) { return m_heap.AllocateAligned(index, num_pages, align_pages); }
-                    void Free(KPhysicalAddress addr, size_t num_pages) { m_heap.Free(addr, num_pages); }
+                    void Free(KPhysicalAddress addr, size_t num_pages) { m_heap.InvalidateZeroedPages(addr, num_pages); m_heap.Free(addr, num_pages); }
+
+                    u64 ClaimPagesToZero(KPhysicalAddress *out_address, size_t *out_num_pages, KPhysicalAddress *cursor, size_t max_pages) { return m_heap.ClaimPagesToZero(out_address, out_num_pages, cursor, max_pages); }
+                    void FinishZeroingPages(KPhysicalAddress address, size_t num_pages, u64 to_zero) { return m_heap.FinishZeroingPages(address, num_pages, to_zero); }
+                    static void ZeroClaimedPages(KPhysicalAddress address, u64 to_zero) { return KPageHeap::ZeroClaimedPages(address, to_zero); }
+                    u64 TakeZeroedPages(KPhysicalAddress addr, size_t num_pages) { return m_heap.TakeZeroedPages(addr, num_pages); }
+                    size_t GetNumZeroedPages() const { return m_heap.GetNumZeroedPages(); }
+                    u64 GetNumZeroedHits() const { return m_heap.GetNumZeroedHits(); }
+                    u64 GetNumZeroedMisses() const { return m_heap.GetNumZeroedMisses(); }
 
                     void SetInitialUsedHeapSize(size_t reserved_size) { m_heap.SetInitialUsedSize(reserved_size); }
 
@@ -86,6 +112,7 @@ namespace ams::kern {
                     bool ProcessOptimizedAllocation(KPhysicalAddress block, size_t num_pages, u8 fill_pattern);
 
                     constexpr Pool GetPool() const { return m_pool; }
+                    constexpr KPhysicalAddress GetAddress() const { return m_heap.GetAddress(); }
                     constexpr size_t GetSize() const { return m_heap.GetSize(); }
                     constexpr KPhysicalAddress GetEndAddress() const { return m_heap.GetEndAddress(); }
 
@@ -165,6 +192,8 @@ namespace ams::kern {
             u64 m_optimized_process_ids[Pool_Count];
             bool m_has_optimized_process[Pool_Count];
             s32 m_min_heap_indexes[Pool_Count];
+            size_t m_zeroed_page_watermarks[Pool_Count];
+            ZeroingState m_zeroing_states[Pool_Count];
         private:
             Impl &GetManager(KPhysicalAddress address) {
                 return m_managers[KMemoryLayout::GetPhysicalLinearRegion(address).GetAttributes()];
@@ -187,14 +216,22 @@ namespace ams::kern {
             }
 
             Result AllocatePageGroupImpl(KPageGroup *out, size_t num_pages, Pool pool, Direction dir, bool unoptimized, bool random, s32 min_heap_index);
+
+            size_t GetNumZeroedPages(Pool pool);
+            void SignalZeroingThread(Pool pool, bool freed);
+
+            static void ZeroingThreadFunction(uintptr_t arg);
+            void ZeroingThreadFunctionImpl(Pool pool);
         public:
             KMemoryManager()
-                : m_pool_locks(), m_pool_managers_head(), m_pool_managers_tail(), m_managers(), m_num_managers(), m_optimized_process_ids(), m_has_optimized_process(), m_min_heap_indexes()
+                : m_pool_locks(), m_pool_managers_head(), m_pool_managers_tail(), m_managers(), m_num_managers(), m_optimized_process_ids(), m_has_optimized_process(), m_min_heap_indexes(),
+                  m_zeroed_page_watermarks(), m_zeroing_states()
             {
                 /* ... */
             }
 
             NOINLINE void Initialize(KVirtualAddress management_region, size_t management_region_size, const u32 *min_align_shifts);
+            NOINLINE void InitializeZeroingThreads();
 
             NOINLINE Result InitializeOptimizedMemory(u64 process_id, Pool pool);
             NOINLINE void FinalizeOptimizedMemory(u64 process_id, Pool pool);
@@ -203,6 +240,8 @@ namespace ams::kern {
             NOINLINE Result AllocateAndOpen(KPageGroup *out, size_t num_pages, size_t align_pages, u32 option);
             NOINLINE Result AllocateForProcess(KPageGroup *out, size_t num_pages, u32 option, u64 process_id, u8 fill_pattern);
 
+            NOINLINE void FillAllocatedPages(const KPageGroup &pg, u8 fill_pattern);
+
             Pool GetPool(KPhysicalAddress address) const {
                 return this->GetManager(address).GetPool();
             }
@@ -248,6 +287,9 @@ namespace ams::kern {
                     {
                         KScopedLightLock lk(m_pool_locks[manager.GetPool()]);
                         manager.Close(address, cur_pages);
+
+                        /* The pages we freed may need to be zeroed. */
+                        this->SignalZeroingThread(manager.GetPool(), true);
                     }
 
                     num_pages -= cur_pages;
@@ -301,6 +343,8 @@ namespace ams::kern {
                 }
             }
 
+            ZeroedPageStatistics GetZeroedPageStatistics(Pool pool);
+
             size_t GetMinimumAlignment(Pool pool) {
                 return KPageHeap::GetBlockSize(m_min_heap_indexes[pool]);
             }
@@ -173,6 +173,27 @@ namespace ams::kern {
                 return static_cast<ssize_t>(offset);
             }
 
+            ssize_t FindNextFreeBlock(size_t offset) const {
+                /* Walk the leaf storage, starting at the desired offset. */
+                const u64 * const storage_start = m_bit_storages[this->GetHighestDepthIndex()];
+                const u64 * const storage_end   = m_end_storages[this->GetHighestDepthIndex()];
+
+                size_t ind = offset / BITSIZEOF(u64);
+                if (storage_start + ind >= storage_end) {
+                    return -1;
+                }
+
+                u64 v = storage_start[ind] & (~u64(0) << (offset % BITSIZEOF(u64)));
+                while (v == 0) {
+                    if (storage_start + (++ind) >= storage_end) {
+                        return -1;
+                    }
+                    v = storage_start[ind];
+                }
+
+                return static_cast<ssize_t>(ind * BITSIZEOF(u64) + __builtin_ctzll(v));
+            }
+
             ssize_t FindFreeRange(size_t count) {
                 /* Check that it is possible to find a range. */
                 const u64 * const storage_start = m_bit_storages[m_used_depths - 1];
@@ -212,6 +233,11 @@ namespace ams::kern {
                 return chosen_offset;
             }
 
+            bool GetBit(size_t offset) const {
+                const u64 *bits = m_bit_storages[this->GetHighestDepthIndex()];
+                return (bits[offset / BITSIZEOF(u64)] & (u64(1) << (offset % BITSIZEOF(u64)))) != 0;
+            }
+
             void SetBit(size_t offset) {
                 this->SetBit(this->GetHighestDepthIndex(), offset);
                 m_num_bits++;
@@ -114,6 +114,33 @@ namespace ams::kern {
                         m_bitmap.ClearBit(offset);
                         return m_heap_address + (offset << this->GetShift());
                     }
+
+                    bool PopBlock(KPhysicalAddress address) {
+                        /* Check that the block is free. */
+                        const size_t offset = (address - m_heap_address) >> this->GetShift();
+                        if (!m_bitmap.GetBit(offset)) {
+                            return false;
+                        }
+
+                        /* Update our tracking. */
+                        m_bitmap.ClearBit(offset);
+                        return true;
+                    }
+
+                    KPhysicalAddress FindFreeBlock(KPhysicalAddress address) const {
+                        /* Find the first free block which contains or follows the address. */
+                        const size_t offset = (address - m_heap_address) >> this->GetShift();
+                        if (offset >= m_end_offset) {
+                            return Null<KPhysicalAddress>;
+                        }
+
+                        const ssize_t soffset = m_bitmap.FindNextFreeBlock(offset);
+                        if (soffset < 0) {
+                            return Null<KPhysicalAddress>;
+                        }
+
+                        return m_heap_address + (static_cast<size_t>(soffset) << this->GetShift());
+                    }
                 public:
                     static constexpr size_t CalculateManagementOverheadSize(size_t region_size, size_t cur_block_shift, size_t next_block_shift) {
                         const size_t cur_block_size  = (u64(1) << cur_block_shift);
@@ -122,6 +149,8 @@ namespace ams::kern {
                         return KPageBitmap::CalculateManagementOverheadSize((align * 2 + util::AlignUp(region_size, align)) / cur_block_size);
                     }
             };
+        private:
+            static constexpr size_t ZeroedBlockCountMax = 0x20;
         private:
             KPhysicalAddress m_heap_address;
             size_t m_heap_size;
@@ -129,13 +158,30 @@ namespace ams::kern {
             size_t m_num_blocks;
             Block m_blocks[NumMemoryBlockPageShifts];
             KPageBitmap::RandomBitGenerator m_rng;
+            u64 *m_zeroed_bitmap;
+            u64 *m_allocated_zeroed_bitmap;
+            size_t m_num_zeroed_pages;
+            u64 m_num_zeroed_hits;
+            u64 m_num_zeroed_misses;
+            KPhysicalAddress m_zeroed_blocks[NumMemoryBlockPageShifts][ZeroedBlockCountMax];
+            size_t m_num_zeroed_blocks[NumMemoryBlockPageShifts];
         private:
             void Initialize(KPhysicalAddress heap_address, size_t heap_size, KVirtualAddress management_address, size_t management_size, const size_t *block_shifts, size_t num_block_shifts);
             size_t GetNumFreePages() const;
 
             void FreeBlock(KPhysicalAddress block, s32 index);
+
+            KPhysicalAddress FindFreeBlock(s32 *out_index, KPhysicalAddress address) const;
+            KPhysicalAddress AllocateZeroedBlock(s32 index);
+
+            bool IsZeroed(KPhysicalAddress address, size_t num_pages) const;
+            void OnAllocated(KPhysicalAddress address, size_t num_pages);
+
+            static constexpr u64 GetZeroedPageMask(size_t offset, size_t num_pages) {
+                return (num_pages < BITSIZEOF(u64) ? ((u64(1) << num_pages) - 1) : ~u64(0)) << (offset % BITSIZEOF(u64));
+            }
         public:
-            KPageHeap() : m_heap_address(Null<KPhysicalAddress>), m_heap_size(), m_initial_used_size(), m_num_blocks(), m_blocks(), m_rng() { /* ... */ }
+            KPageHeap() : m_heap_address(Null<KPhysicalAddress>), m_heap_size(), m_initial_used_size(), m_num_blocks(), m_blocks(), m_rng(), m_zeroed_bitmap(), m_allocated_zeroed_bitmap(), m_num_zeroed_pages(), m_num_zeroed_hits(), m_num_zeroed_misses(), m_zeroed_blocks(), m_num_zeroed_blocks() { /* ... */ }
 
             constexpr KPhysicalAddress GetAddress() const { return m_heap_address; }
             constexpr size_t GetSize() const { return m_heap_size; }
@@ -160,20 +206,46 @@ namespace ams::kern {
             }
 
             KPhysicalAddress AllocateBlock(s32 index, bool random) {
-                if (random) {
-                    const size_t block_pages = m_blocks[index].GetNumPages();
-                    return this->AllocateByRandom(index, block_pages, block_pages);
-                } else {
-                    return this->AllocateByLinearSearch(index);
+                const size_t block_pages = m_blocks[index].GetNumPages();
+
+                /* Prefer blocks which have already been zeroed. */
+                KPhysicalAddress block = this->AllocateZeroedBlock(index);
+                if (block == Null<KPhysicalAddress>) {
+                    if (random) {
+                        block = this->AllocateByRandom(index, block_pages, block_pages);
+                    } else {
+                        block = this->AllocateByLinearSearch(index);
+                    }
                 }
+
+                if (block != Null<KPhysicalAddress>) {
+                    this->OnAllocated(block, block_pages);
+                }
+
+                return block;
             }
 
             KPhysicalAddress AllocateAligned(s32 index, size_t num_pages, size_t align_pages) {
                 /* TODO: linear search support? */
-                return this->AllocateByRandom(index, num_pages, align_pages);
+                const KPhysicalAddress block = this->AllocateByRandom(index, num_pages, align_pages);
+                if (block != Null<KPhysicalAddress>) {
+                    this->OnAllocated(block, num_pages);
+                }
+
+                return block;
             }
 
             void Free(KPhysicalAddress addr, size_t num_pages);
+
+            constexpr size_t GetNumZeroedPages() const { return m_num_zeroed_pages; }
+            constexpr u64 GetNumZeroedHits() const { return m_num_zeroed_hits; }
+            constexpr u64 GetNumZeroedMisses() const { return m_num_zeroed_misses; }
+
+            u64 ClaimPagesToZero(KPhysicalAddress *out_address, size_t *out_num_pages, KPhysicalAddress *cursor, size_t max_pages);
+            void FinishZeroingPages(KPhysicalAddress address, size_t num_pages, u64 to_zero);
+            static void ZeroClaimedPages(KPhysicalAddress address, u64 to_zero);
+            void InvalidateZeroedPages(KPhysicalAddress addr, size_t num_pages);
+            u64 TakeZeroedPages(KPhysicalAddress addr, size_t num_pages);
         private:
             KPhysicalAddress AllocateByLinearSearch(s32 index);
             KPhysicalAddress AllocateByRandom(s32 index, size_t num_pages, size_t align_pages);
@@ -38,6 +38,8 @@ namespace ams::kern {
             static_assert(ams::svc::LowestThreadPriority  >= HighestCoreMigrationAllowedPriority);
             static_assert(ams::svc::HighestThreadPriority <= HighestCoreMigrationAllowedPriority);
 
+            static constexpr u64 AllCoresMask = (1ul << cpu::NumCores) - 1;
+
             struct SchedulingState {
                 util::Atomic<bool> needs_scheduling{false};
                 bool interrupt_task_runnable{false};
@@ -124,8 +126,30 @@ namespace ams::kern {
             static ALWAYS_INLINE bool IsSchedulerLockedByCurrentThread() { return s_scheduler_lock.IsLockedByCurrentThread(); }
 
             static ALWAYS_INLINE bool IsSchedulerUpdateNeeded() { return s_scheduler_update_needed; }
-            static ALWAYS_INLINE void SetSchedulerUpdateNeeded() { s_scheduler_update_needed = true; }
-            static ALWAYS_INLINE void ClearSchedulerUpdateNeeded() { s_scheduler_update_needed = false; }
+
+            static ALWAYS_INLINE void SetSchedulerUpdateNeeded() {
+                s_scheduler_update_needed = true;
+                s_dirty_core_mask         = AllCoresMask;
+            }
+
+            static ALWAYS_INLINE void SetSchedulerUpdateNeeded(s32 core_id) {
+                #if defined(MESOSPHERE_ENABLE_SCHEDULER_DIRTY_CORE_MASK)
+                /* NOTE: A thread without an active core only affects other cores' suggested queues, */
+                /* which are re-examined for every idle core on every update. */
+                s_scheduler_update_needed = true;
+                if (core_id >= 0) {
+                    s_dirty_core_mask |= (1ul << core_id);
+                }
+                #else
+                MESOSPHERE_UNUSED(core_id);
+                SetSchedulerUpdateNeeded();
+                #endif
+            }
+
+            static ALWAYS_INLINE void ClearSchedulerUpdateNeeded() {
+                s_scheduler_update_needed = false;
+                s_dirty_core_mask         = 0;
+            }
 
             static ALWAYS_INLINE void DisableScheduling() {
                 MESOSPHERE_ASSERT(GetCurrentThread().GetDisableDispatchCount() >= 0);
@@ -210,6 +234,7 @@ namespace ams::kern {
             using LockType = KAbstractSchedulerLock<KScheduler>;
         private:
             static bool s_scheduler_update_needed;
+            static u64 s_dirty_core_mask;
             static KSchedulerPriorityQueue s_priority_queue;
             static LockType s_scheduler_lock;
         public:
@@ -17,6 +17,9 @@
 #include <mesosphere/kern_common.hpp>
 #include <mesosphere/kern_k_typed_address.hpp>
 #include <mesosphere/kern_k_memory_layout.hpp>
+#include <mesosphere/kern_k_current_context.hpp>
+#include <mesosphere/kern_k_spin_lock.hpp>
+#include <mesosphere/kern_select_interrupt_manager.hpp>
 
 #if defined(ATMOSPHERE_ARCH_ARM64)
 
@@ -68,6 +71,160 @@ namespace ams::kern {
                 }
         };
 
+        #if defined(MESOSPHERE_ENABLE_SLAB_HEAP_MAGAZINES)
+        /* Per-core caches of free objects, which refill from and drain to a shared slab heap in batches. */
+        class KSlabHeapMagazines {
+            NON_COPYABLE(KSlabHeapMagazines);
+            NON_MOVEABLE(KSlabHeapMagazines);
+            public:
+                static constexpr size_t Capacity  = 16;
+                static constexpr size_t BatchSize = Capacity / 2;
+
+                struct Statistics {
+                    u64 num_refills;
+                    u64 num_drains;
+                    u64 num_steals;
+                    u64 num_shared_operations;
+                };
+            private:
+                using Node = KSlabHeapImpl::Node;
+
+                /* NOTE: Each magazine is only ever locked by another core when the shared heap is exhausted. */
+                struct alignas(cpu::DataCacheLineSize) Magazine {
+                    KSpinLock lock{};
+                    u32 count{};
+                    Node *head{};
+                    u64 num_refills{};
+                    u64 num_drains{};
+                    u64 num_steals{};
+                    u64 num_shared_operations{};
+                };
+                static_assert(sizeof(Magazine) == cpu::DataCacheLineSize);
+            private:
+                Magazine m_magazines[cpu::NumCores]{};
+            private:
+                static ALWAYS_INLINE void Push(Magazine &magazine, Node *node) {
+                    node->next     = magazine.head;
+                    magazine.head  = node;
+                    magazine.count++;
+                }
+
+                static ALWAYS_INLINE Node *Pop(Magazine &magazine) {
+                    Node *node     = magazine.head;
+                    magazine.head  = node->next;
+                    magazine.count--;
+                    return node;
+                }
+
+                static void Refill(Magazine &magazine, KSlabHeapImpl *shared) {
+                    /* NOTE: Consecutive pops hit the shared head's cache line while we still own it. */
+                    size_t i;
+                    for (i = 0; i < BatchSize; ++i) {
+                        Node *node = static_cast<Node *>(shared->Allocate());
+                        if (node == nullptr) {
+                            break;
+                        }
+
+                        Push(magazine, node);
+                    }
+
+                    /* Failed pops still touch the shared head, but only refills which produced objects count as refills. */
+                    magazine.num_shared_operations += std::min(i + 1, BatchSize);
+                    if (i > 0) {
+                        magazine.num_refills++;
+                    }
+                }
+
+                static void Drain(Magazine &magazine, KSlabHeapImpl *shared) {
+                    for (size_t i = 0; i < BatchSize; ++i) {
+                        shared->Free(Pop(magazine));
+                    }
+
+                    magazine.num_shared_operations += BatchSize;
+                    magazine.num_drains++;
+                }
+
+                void *Steal(s32 core_id, KSlabHeapImpl *shared) {
+                    /* Take an object cached by another core. */
+                    for (size_t i = 1; i < cpu::NumCores; ++i) {
+                        Magazine &magazine = m_magazines[(core_id + i) % cpu::NumCores];
+
+                        KScopedSpinLock lk(magazine.lock);
+
+                        if (magazine.count > 0) {
+                            m_magazines[core_id].num_steals++;
+                            return Pop(magazine);
+                        }
+                    }
+
+                    /* Objects may have been drained to the shared heap while we looked. */
+                    m_magazines[core_id].num_shared_operations++;
+                    return shared->Allocate();
+                }
+            public:
+                constexpr KSlabHeapMagazines() = default;
+
+                ALWAYS_INLINE void *Allocate(KSlabHeapImpl *shared) {
+                    /* Disable interrupts, so that we stay on the current core. */
+                    KScopedInterruptDisable di;
+
+                    const s32 core_id = GetCurrentCoreId();
+                    {
+                        Magazine &magazine = m_magazines[core_id];
+
+                        KScopedSpinLock lk(magazine.lock);
+
+                        /* If our magazine is empty, refill it from the shared heap. */
+                        if (magazine.count == 0) {
+                            Refill(magazine, shared);
+                        }
+
+                        if (AMS_LIKELY(magazine.count > 0)) {
+                            return Pop(magazine);
+                        }
+                    }
+
+                    /* The shared heap is exhausted, but other cores may still have cached objects. */
+                    return this->Steal(core_id, shared);
+                }
+
+                ALWAYS_INLINE void Free(KSlabHeapImpl *shared, void *obj) {
+                    /* Disable interrupts, so that we stay on the current core. */
+                    KScopedInterruptDisable di;
+
+                    Magazine &magazine = m_magazines[GetCurrentCoreId()];
+
+                    KScopedSpinLock lk(magazine.lock);
+
+                    /* If our magazine is full, drain half of it to the shared heap. */
+                    if (magazine.count == Capacity) {
+                        Drain(magazine, shared);
+                    }
+
+                    Push(magazine, static_cast<Node *>(obj));
+                }
+
+                size_t GetNumCached() const {
+                    size_t cached = 0;
+                    for (const auto &magazine : m_magazines) {
+                        cached += magazine.count;
+                    }
+                    return cached;
+                }
+
+                Statistics GetStatistics() const {
+                    Statistics stats = {};
+                    for (const auto &magazine : m_magazines) {
+                        stats.num_refills += magazine.num_refills;
+                        stats.num_drains  += magazine.num_drains;
+                        stats.num_steals  += magazine.num_steals;
+                        stats.num_shared_operations += magazine.num_shared_operations;
+                    }
+                    return stats;
+                }
+        };
+        #endif
+
     }
 
     template<bool SupportDynamicExpansion>
@@ -79,6 +236,9 @@ namespace ams::kern {
             uintptr_t m_peak{};
             uintptr_t m_start{};
             uintptr_t m_end{};
+            #if defined(MESOSPHERE_ENABLE_SLAB_HEAP_MAGAZINES)
+            impl::KSlabHeapMagazines m_magazines{};
+            #endif
         private:
             ALWAYS_INLINE void UpdatePeakImpl(uintptr_t obj) {
                 const util::AtomicRef<uintptr_t> peak_ref(m_peak);
@@ -132,7 +292,11 @@ namespace ams::kern {
             }
 
             ALWAYS_INLINE void *Allocate() {
+                #if defined(MESOSPHERE_ENABLE_SLAB_HEAP_MAGAZINES)
+                void *obj = m_magazines.Allocate(this);
+                #else
                 void *obj = KSlabHeapImpl::Allocate();
+                #endif
 
                 /* Track the allocated peak. */
                 #if defined(MESOSPHERE_BUILD_FOR_DEBUGGING)
@@ -162,7 +326,11 @@ namespace ams::kern {
                     MESOSPHERE_ABORT_UNLESS(contained);
                 }
 
+                #if defined(MESOSPHERE_ENABLE_SLAB_HEAP_MAGAZINES)
+                m_magazines.Free(this, obj);
+                #else
                 KSlabHeapImpl::Free(obj);
+                #endif
             }
 
             ALWAYS_INLINE size_t GetObjectIndex(const void *obj) const {
@@ -210,10 +378,21 @@ namespace ams::kern {
                         break;
                     }
                 }
+
+                /* Objects cached by each core are also free. */
+                #if defined(MESOSPHERE_ENABLE_SLAB_HEAP_MAGAZINES)
+                remaining += m_magazines.GetNumCached();
+                #endif
                 #endif
 
                 return remaining;
             }
+
+            #if defined(MESOSPHERE_ENABLE_SLAB_HEAP_MAGAZINES)
+            ALWAYS_INLINE impl::KSlabHeapMagazines::Statistics GetMagazineStatistics() const {
+                return m_magazines.GetStatistics();
+            }
+            #endif
     };
 
     template<typename T, bool SupportDynamicExpansion>
@@ -33,17 +33,17 @@ namespace ams::kern {
     class KTrace {
         public:
             enum Type {
-                Type_ThreadSwitch   =  1,
+                Type_ThreadSwitch   = ams::svc::KernelTraceRecordType_ThreadSwitch,
 
-                Type_SvcEntry0      =  3,
-                Type_SvcEntry1      =  4,
-                Type_SvcExit0       =  5,
-                Type_SvcExit1       =  6,
-                Type_Interrupt      =  7,
+                Type_SvcEntry0      = ams::svc::KernelTraceRecordType_SvcEntry0,
+                Type_SvcEntry1      = ams::svc::KernelTraceRecordType_SvcEntry1,
+                Type_SvcExit0       = ams::svc::KernelTraceRecordType_SvcExit0,
+                Type_SvcExit1       = ams::svc::KernelTraceRecordType_SvcExit1,
+                Type_Interrupt      = ams::svc::KernelTraceRecordType_Interrupt,
 
-                Type_ScheduleUpdate = 11,
+                Type_ScheduleUpdate = ams::svc::KernelTraceRecordType_ScheduleUpdate,
 
-                Type_CoreMigration  = 14,
+                Type_CoreMigration  = ams::svc::KernelTraceRecordType_CoreMigration,
             };
         private:
             static bool s_is_active;
@@ -20,4 +20,12 @@ namespace ams::kern {
 
     NORETURN void HorizonKernelMain(s32 core_id);
 
+    #if defined(MESOSPHERE_ENABLE_SLAB_HEAP_BENCHMARK)
+    void RunSlabHeapBenchmark(s32 core_id);
+    #endif
+
+    #if defined(MESOSPHERE_ENABLE_SCHEDULER_BENCHMARK)
+    void RunSchedulerBenchmark(s32 core_id);
+    #endif
+
 }
@@ -19,6 +19,8 @@ namespace ams::kern {
 
     namespace {
 
+        constinit KLightConditionVariable g_zeroing_cond_var{util::ConstantInitialize};
+
         constexpr KMemoryManager::Pool GetPoolFromMemoryRegionType(u32 type) {
             if ((type | KMemoryRegionType_DramApplicationPool) == type) {
                 return KMemoryManager::Pool_Application;
@@ -167,6 +169,136 @@ namespace ams::kern {
         }
     }
 
+    void KMemoryManager::InitializeZeroingThreads() {
+        for (size_t i = 0; i < Pool_Count; ++i) {
+            const Pool pool = static_cast<Pool>(i);
+
+            /* If the pool has no memory, it doesn't need a zeroing thread. */
+            if (m_pool_managers_head[pool] == nullptr) {
+                continue;
+            }
+
+            /* Determine how many zeroed pages the pool should keep available. */
+            {
+                KScopedLightLock lk(m_pool_locks[pool]);
+                m_zeroed_page_watermarks[pool] = std::min(this->GetSize(pool) / ZeroedPageWatermarkDivisor, ZeroedPageWatermarkSizeMax) / PageSize;
+            }
+
+            /* Reserve a thread from the system limit. */
+            MESOSPHERE_ABORT_UNLESS(Kernel::GetSystemResourceLimit().Reserve(ams::svc::LimitableResource_ThreadCountMax, 1));
+
+            /* Create a new thread. */
+            KThread *thread = KThread::Create();
+            MESOSPHERE_ABORT_UNLESS(thread != nullptr);
+
+            /* Launch the new thread. */
+            MESOSPHERE_R_ABORT_UNLESS(KThread::InitializeKernelThread(thread, ZeroingThreadFunction, static_cast<uintptr_t>(pool), ZeroingThreadPriority, cpu::NumCores - 1));
+
+            /* Register the new thread. */
+            KThread::Register(thread);
+
+            /* Run the thread. */
+            thread->Run();
+        }
+    }
+
+    KMemoryManager::ZeroedPageStatistics KMemoryManager::GetZeroedPageStatistics(Pool pool) {
+        KScopedLightLock lk(m_pool_locks[pool]);
+
+        ZeroedPageStatistics stats = {};
+        for (auto *manager = this->GetFirstManager(pool, Direction_FromFront); manager != nullptr; manager = this->GetNextManager(manager, Direction_FromFront)) {
+            stats.num_zeroed_pages += manager->GetNumZeroedPages();
+            stats.num_hits         += manager->GetNumZeroedHits();
+            stats.num_misses       += manager->GetNumZeroedMisses();
+        }
+        return stats;
+    }
+
+    size_t KMemoryManager::GetNumZeroedPages(Pool pool) {
+        MESOSPHERE_ASSERT(m_pool_locks[pool].IsLockedByCurrentThread());
+
+        size_t total = 0;
+        for (auto *manager = this->GetFirstManager(pool, Direction_FromFront); manager != nullptr; manager = this->GetNextManager(manager, Direction_FromFront)) {
+            total += manager->GetNumZeroedPages();
+        }
+        return total;
+    }
+
+    void KMemoryManager::SignalZeroingThread(Pool pool, bool freed) {
+        MESOSPHERE_ASSERT(m_pool_locks[pool].IsLockedByCurrentThread());
+
+        /* Freed pages are new work for a thread which ran out of pages to zero. */
+        /* Otherwise, the thread only has work to do if we've dropped below the watermark. */
+        const ZeroingState state = m_zeroing_states[pool];
+        if ((state == ZeroingState_WaitingForFree && freed) || (state == ZeroingState_WaitingForAllocation && this->GetNumZeroedPages(pool) < m_zeroed_page_watermarks[pool])) {
+            m_zeroing_states[pool] = ZeroingState_Running;
+            g_zeroing_cond_var.Broadcast();
+        }
+    }
+
+    void KMemoryManager::ZeroingThreadFunction(uintptr_t arg) {
+        Kernel::GetMemoryManager().ZeroingThreadFunctionImpl(static_cast<Pool>(arg));
+    }
+
+    void KMemoryManager::ZeroingThreadFunctionImpl(Pool pool) {
+        /* Lock the pool. */
+        KLightLock &lock = m_pool_locks[pool];
+        lock.Lock();
+
+        /* Zero free pages, starting from the front of the pool. */
+        Impl * const first_manager = this->GetFirstManager(pool, Direction_FromFront);
+        Impl *manager = first_manager;
+        KPhysicalAddress cursor = manager->GetAddress();
+        bool zeroed_any = false;
+
+        auto WaitForWork = [&](ZeroingState state) ALWAYS_INLINE_LAMBDA {
+            /* NOTE: The condition variable is shared by all pools, so we may be woken for another pool's work. */
+            m_zeroing_states[pool] = state;
+            while (m_zeroing_states[pool] != ZeroingState_Running) {
+                g_zeroing_cond_var.Wait(std::addressof(lock));
+            }
+        };
+
+        while (true) {
+            /* If we have enough zeroed pages, wait for some to be used. */
+            if (this->GetNumZeroedPages(pool) >= m_zeroed_page_watermarks[pool]) {
+                WaitForWork(ZeroingState_WaitingForAllocation);
+                continue;
+            }
+
+            /* Claim a batch of free pages, so that they can't be allocated while we zero them without the lock held. */
+            KPhysicalAddress address;
+            size_t num_pages;
+            if (const u64 to_zero = manager->ClaimPagesToZero(std::addressof(address), std::addressof(num_pages), std::addressof(cursor), ZeroingBatchPages); num_pages > 0) {
+                lock.Unlock();
+                Impl::ZeroClaimedPages(address, to_zero);
+                lock.Lock();
+
+                manager->FinishZeroingPages(address, num_pages, to_zero);
+                zeroed_any = true;
+            }
+
+            /* If we've reached the end of the manager, advance to the next one. */
+            if (cursor >= manager->GetEndAddress()) {
+                manager = this->GetNextManager(manager, Direction_FromFront);
+                if (manager == nullptr) {
+                    /* If we went through the whole pool without finding anything to zero, wait for pages to be freed. */
+                    if (!zeroed_any) {
+                        WaitForWork(ZeroingState_WaitingForFree);
+                    }
+
+                    manager    = first_manager;
+                    zeroed_any = false;
+                }
+                cursor = manager->GetAddress();
+            }
+
+            /* Give any waiting allocations a chance to take the lock. */
+            lock.Unlock();
+            lock.Lock();
+        }
+    }
+
     Result KMemoryManager::InitializeOptimizedMemory(u64 process_id, Pool pool) {
         /* Lock the pool. */
         KScopedLightLock lk(m_pool_locks[pool]);
@@ -244,6 +376,9 @@ namespace ams::kern {
         /* Open the first reference to the pages. */
         chosen_manager->OpenFirst(allocated_block, num_pages);
 
+        /* We may have taken the zeroing thread below its watermark. */
+        this->SignalZeroingThread(pool, false);
+
         return allocated_block;
     }
 
@@ -299,6 +434,9 @@ namespace ams::kern {
         /* Only succeed if we allocated as many pages as we wanted. */
         R_UNLESS(num_pages == 0, svc::ResultOutOfMemory());
 
+        /* We may have taken the zeroing thread below its watermark. */
+        this->SignalZeroingThread(pool, false);
+
         /* We succeeded! */
         R_SUCCEED();
     }
@@ -424,14 +562,59 @@ namespace ams::kern {
             }
         } else {
             /* Set all the allocated memory. */
-            for (const auto &block : *out) {
-                std::memset(GetVoidPointer(KMemoryLayout::GetLinearVirtualAddress(block.GetAddress())), fill_pattern, block.GetSize());
-            }
+            this->FillAllocatedPages(*out, fill_pattern);
         }
 
         R_SUCCEED();
     }
 
+    void KMemoryManager::FillAllocatedPages(const KPageGroup &pg, u8 fill_pattern) {
+        for (const auto &block : pg) {
+            KPhysicalAddress cur_address = block.GetAddress();
+            size_t remaining_pages       = block.GetNumPages();
+            while (remaining_pages > 0) {
+                /* Get the manager for the current address. */
+                auto &manager = this->GetManager(cur_address);
+                const Pool pool = manager.GetPool();
+
+                /* Process part or all of the block, taking at most one word of the manager's zeroed page bitmap at a time. */
+                const size_t cur_pages = std::min({ remaining_pages, manager.GetPageOffsetToEnd(cur_address), BITSIZEOF(u64) - (manager.GetPageOffset(cur_address) % BITSIZEOF(u64)) });
+
+                /* Take the pages which were zeroed ahead of time. */
+                u64 zeroed;
+                {
+                    KScopedLightLock lk(m_pool_locks[pool]);
+
+                    zeroed = manager.TakeZeroedPages(cur_address, cur_pages);
+                    if (fill_pattern != 0) {
+                        zeroed = 0;
+                    }
+                }
+
+                /* Fill each run of pages which weren't zeroed. */
+                size_t page = 0;
+                while (page < cur_pages) {
+                    if ((zeroed & (u64(1) << page)) != 0) {
+                        page++;
+                        continue;
+                    }
+
+                    size_t run_pages = 1;
+                    while (page + run_pages < cur_pages && (zeroed & (u64(1) << (page + run_pages))) == 0) {
+                        run_pages++;
+                    }
+
+                    std::memset(GetVoidPointer(KMemoryLayout::GetLinearVirtualAddress(cur_address + page * PageSize)), fill_pattern, run_pages * PageSize);
+                    page += run_pages;
+                }
+
+                /* Advance. */
+                cur_address     += cur_pages * PageSize;
+                remaining_pages -= cur_pages;
+            }
+        }
+    }
+
     size_t KMemoryManager::Impl::Initialize(KPhysicalAddress address, size_t size, KVirtualAddress management, KVirtualAddress management_end, Pool p) {
         /* Calculate management sizes. */
         const size_t ref_count_size      = (size / PageSize) * sizeof(u16);
@@ -37,6 +37,13 @@ namespace ams::kern {
             cur_bitmap_storage = m_blocks[i].Initialize(m_heap_address, m_heap_size, cur_block_shift, next_block_shift, cur_bitmap_storage);
         }
 
+        /* Setup the zeroed page bitmaps. */
+        const size_t zeroed_bitmap_words = util::AlignUp(m_heap_size / PageSize, BITSIZEOF(u64)) / BITSIZEOF(u64);
+        m_zeroed_bitmap            = cur_bitmap_storage;
+        m_allocated_zeroed_bitmap  = cur_bitmap_storage + zeroed_bitmap_words;
+        m_num_zeroed_pages         = 0;
+        cur_bitmap_storage        += 2 * zeroed_bitmap_words;
+
         /* Ensure we didn't overextend our bounds. */
         MESOSPHERE_ABORT_UNLESS(KVirtualAddress(cur_bitmap_storage) <= management_end);
     }
@@ -51,6 +58,169 @@ namespace ams::kern {
         return num_free;
     }
 
+    KPhysicalAddress KPageHeap::FindFreeBlock(s32 *out_index, KPhysicalAddress address) const {
+        /* Find the lowest free block which contains or follows the address. */
+        KPhysicalAddress found = Null<KPhysicalAddress>;
+        for (s32 i = 0; i < static_cast<s32>(m_num_blocks); i++) {
+            if (const KPhysicalAddress block = m_blocks[i].FindFreeBlock(address); block != Null<KPhysicalAddress> && (found == Null<KPhysicalAddress> || block < found)) {
+                found      = block;
+                *out_index = i;
+            }
+        }
+
+        return found;
+    }
+
+    KPhysicalAddress KPageHeap::AllocateZeroedBlock(s32 index) {
+        while (m_num_zeroed_blocks[index] > 0) {
+            /* Select a random zeroed block, so that we don't make allocations predictable. */
+            const size_t which = m_rng.GenerateRandom(m_num_zeroed_blocks[index]);
+            const KPhysicalAddress block = m_zeroed_blocks[index][which];
+            m_zeroed_blocks[index][which] = m_zeroed_blocks[index][--m_num_zeroed_blocks[index]];
+
+            /* The block may have been allocated, split, or coalesced since it was zeroed, so check that it's still usable. */
+            if (this->IsZeroed(block, m_blocks[index].GetNumPages()) && m_blocks[index].PopBlock(block)) {
+                return block;
+            }
+        }
+
+        return Null<KPhysicalAddress>;
+    }
+
+    bool KPageHeap::IsZeroed(KPhysicalAddress address, size_t num_pages) const {
+        size_t offset = this->GetPageOffset(address);
+        const size_t end = offset + num_pages;
+        while (offset < end) {
+            const size_t cur_pages = std::min(end - offset, BITSIZEOF(u64) - (offset % BITSIZEOF(u64)));
+            const u64 mask = GetZeroedPageMask(offset, cur_pages);
+            if ((m_zeroed_bitmap[offset / BITSIZEOF(u64)] & mask) != mask) {
+                return false;
+            }
+
+            offset += cur_pages;
+        }
+
+        return true;
+    }
+
+    void KPageHeap::OnAllocated(KPhysicalAddress address, size_t num_pages) {
+        /* Move the allocated pages out of the free zeroed pages, remembering which were zeroed for whoever fills them. */
+        size_t offset = this->GetPageOffset(address);
+        const size_t end = offset + num_pages;
+        while (offset < end) {
+            const size_t cur_pages = std::min(end - offset, BITSIZEOF(u64) - (offset % BITSIZEOF(u64)));
+            const u64 mask = GetZeroedPageMask(offset, cur_pages);
+
+            u64 &zeroed = m_zeroed_bitmap[offset / BITSIZEOF(u64)];
+            const u64 taken = zeroed & mask;
+            zeroed &= ~mask;
+            m_allocated_zeroed_bitmap[offset / BITSIZEOF(u64)] |= taken;
+
+            const size_t num_hits = util::PopCount(taken);
+            m_num_zeroed_pages  -= num_hits;
+            m_num_zeroed_hits   += num_hits;
+            m_num_zeroed_misses += cur_pages - num_hits;
+
+            offset += cur_pages;
+        }
+    }
+
+    void KPageHeap::InvalidateZeroedPages(KPhysicalAddress address, size_t num_pages) {
+        /* Pages which were allocated but never filled are no longer known to be zero once they're freed. */
+        size_t offset = this->GetPageOffset(address);
+        const size_t end = offset + num_pages;
+        while (offset < end) {
+            const size_t cur_pages = std::min(end - offset, BITSIZEOF(u64) - (offset % BITSIZEOF(u64)));
+            const u64 mask = GetZeroedPageMask(offset, cur_pages);
+
+            MESOSPHERE_ASSERT((m_zeroed_bitmap[offset / BITSIZEOF(u64)] & mask) == 0);
+            m_allocated_zeroed_bitmap[offset / BITSIZEOF(u64)] &= ~mask;
+
+            offset += cur_pages;
+        }
+    }
+
+    u64 KPageHeap::TakeZeroedPages(KPhysicalAddress address, size_t num_pages) {
+        /* Check that the pages are tracked by a single bitmap entry. */
+        const size_t offset = this->GetPageOffset(address);
+        MESOSPHERE_ASSERT((offset % BITSIZEOF(u64)) + num_pages <= BITSIZEOF(u64));
+
+        /* Take the allocated pages which were zeroed. */
+        u64 &zeroed = m_allocated_zeroed_bitmap[offset / BITSIZEOF(u64)];
+        const u64 taken = zeroed & GetZeroedPageMask(offset, num_pages);
+        zeroed &= ~taken;
+
+        return taken >> (offset % BITSIZEOF(u64));
+    }
+
+    u64 KPageHeap::ClaimPagesToZero(KPhysicalAddress *out_address, size_t *out_num_pages, KPhysicalAddress *cursor, size_t max_pages) {
+        *out_num_pages = 0;
+
+        while (*cursor < this->GetEndAddress()) {
+            /* Find the next free block. */
+            s32 index;
+            const KPhysicalAddress block = this->FindFreeBlock(std::addressof(index), *cursor);
+            if (block == Null<KPhysicalAddress>) {
+                *cursor = this->GetEndAddress();
+                break;
+            }
+
+            /* Skip any pages in the block which are already zeroed. */
+            const KPhysicalAddress block_end = std::min(block + m_blocks[index].GetSize(), this->GetEndAddress());
+            KPhysicalAddress start = std::max(block, *cursor);
+            while (start < block_end && this->IsZeroed(start, 1)) {
+                start += PageSize;
+            }
+            if (start == block_end) {
+                *cursor = block_end;
+                continue;
+            }
+
+            /* Claim a run of pages starting from the first which needs zeroing, keeping it within one word of the zeroed page bitmap. */
+            const size_t offset    = this->GetPageOffset(start);
+            const size_t num_pages = std::min({ max_pages, static_cast<size_t>((block_end - start) / PageSize), BITSIZEOF(u64) - (offset % BITSIZEOF(u64)) });
+            const u64 to_zero      = (~m_zeroed_bitmap[offset / BITSIZEOF(u64)] & GetZeroedPageMask(offset, num_pages)) >> (offset % BITSIZEOF(u64));
+
+            /* Take the whole block, and give back everything but the pages we claimed. */
+            MESOSPHERE_ABORT_UNLESS(m_blocks[index].PopBlock(block));
+            this->Free(block, (start - block) / PageSize);
+            this->Free(start + num_pages * PageSize, (block + m_blocks[index].GetSize() - start) / PageSize - num_pages);
+
+            *cursor        = start + num_pages * PageSize;
+            *out_address   = start;
+            *out_num_pages = num_pages;
+            return to_zero;
+        }
+
+        return 0;
+    }
+
+    void KPageHeap::ZeroClaimedPages(KPhysicalAddress address, u64 to_zero) {
+        /* NOTE: This is called without the pool lock held, which is safe because claimed pages can't be allocated. */
+        while (to_zero != 0) {
+            const size_t page = util::CountTrailingZeros(to_zero);
+            std::memset(GetVoidPointer(KMemoryLayout::GetLinearVirtualAddress(address + page * PageSize)), 0, PageSize);
+            to_zero &= to_zero - 1;
+        }
+    }
+
+    void KPageHeap::FinishZeroingPages(KPhysicalAddress address, size_t num_pages, u64 to_zero) {
+        /* Return the claimed pages, and note which we zeroed. */
+        this->Free(address, num_pages);
+
+        const size_t offset = this->GetPageOffset(address);
+        m_zeroed_bitmap[offset / BITSIZEOF(u64)] |= (to_zero << (offset % BITSIZEOF(u64)));
+        m_num_zeroed_pages += util::PopCount(to_zero);
+
+        /* If the free block containing the pages is now entirely zeroed, let allocations prefer it. */
+        s32 index;
+        if (const KPhysicalAddress block = this->FindFreeBlock(std::addressof(index), address); block != Null<KPhysicalAddress> && block <= address) {
+            if (m_num_zeroed_blocks[index] < ZeroedBlockCountMax && this->IsZeroed(block, m_blocks[index].GetNumPages())) {
+                m_zeroed_blocks[index][m_num_zeroed_blocks[index]++] = block;
+            }
+        }
+    }
+
     KPhysicalAddress KPageHeap::AllocateByLinearSearch(s32 index) {
         const size_t needed_size = m_blocks[index].GetSize();
 
@@ -207,6 +377,7 @@ namespace ams::kern {
             const size_t next_block_shift = (i != num_block_shifts - 1) ? block_shifts[i + 1] : 0;
             overhead_size += KPageHeap::Block::CalculateManagementOverheadSize(region_size, cur_block_shift, next_block_shift);
         }
+        overhead_size += 2 * (util::AlignUp(region_size / PageSize, BITSIZEOF(u64)) / BITSIZEOF(u64)) * sizeof(u64);
         return util::AlignUp(overhead_size, PageSize);
     }
 
@@ -233,6 +404,8 @@ namespace ams::kern {
 
             MESOSPHERE_RELEASE_LOG("    %4zu %s block x %zu\n", size, suffix, m_blocks[i].GetNumFreeBlocks());
         }
+
+        MESOSPHERE_RELEASE_LOG("    %zu zeroed pages, %lu allocated zeroed, %lu allocated unzeroed\n", m_num_zeroed_pages, m_num_zeroed_hits, m_num_zeroed_misses);
     }
 
 }
@@ -1264,9 +1264,7 @@ namespace ams::kern {
         ON_SCOPE_EXIT { pg.Close(); };
 
         /* Clear all the newly allocated pages. */
-        for (const auto &it : pg) {
-            std::memset(GetVoidPointer(GetHeapVirtualAddress(it.GetAddress())), m_heap_fill_value, it.GetSize());
-        }
+        Kernel::GetMemoryManager().FillAllocatedPages(pg, m_heap_fill_value);
 
         /* Lock the table. */
         KScopedLightLock lk(m_general_lock);
@@ -1420,9 +1418,7 @@ namespace ams::kern {
         ON_SCOPE_EXIT { pg.Close(); };
 
         /* Clear all pages. */
-        for (const auto &it : pg) {
-            std::memset(GetVoidPointer(GetHeapVirtualAddress(it.GetAddress())), m_heap_fill_value, it.GetSize());
-        }
+        Kernel::GetMemoryManager().FillAllocatedPages(pg, m_heap_fill_value);
 
         /* Map the pages. */
         R_RETURN(this->Operate(page_list, address, num_pages, pg, properties, OperationType_MapGroup, false));
@@ -1931,9 +1927,7 @@ namespace ams::kern {
         ON_SCOPE_EXIT { pg.Close(); };
 
         /* Clear all the newly allocated pages. */
-        for (const auto &it : pg) {
-            std::memset(GetVoidPointer(GetHeapVirtualAddress(it.GetAddress())), m_heap_fill_value, it.GetSize());
-        }
+        Kernel::GetMemoryManager().FillAllocatedPages(pg, m_heap_fill_value);
 
         /* Map the pages. */
         {
@@ -4829,9 +4823,7 @@ namespace ams::kern {
         ON_SCOPE_EXIT { pg.Close(); };
 
         /* Clear the new memory. */
-        for (const auto &block : pg) {
-            std::memset(GetVoidPointer(GetHeapVirtualAddress(block.GetAddress())), m_heap_fill_value, block.GetSize());
-        }
+        Kernel::GetMemoryManager().FillAllocatedPages(pg, m_heap_fill_value);
 
         /* Map the new memory. */
         {
@@ -97,6 +97,9 @@ namespace ams::kern {
                     /* Set the exception thread. */
                     *m_exception_thread = waiting_thread;
 
+                    /* The exception thread takes priority over pinned threads, on every core. */
+                    KScheduler::SetSchedulerUpdateNeeded();
+
                     /* Invoke the base end wait handler. */
                     KThreadQueue::EndWait(waiting_thread, wait_result);
                 }
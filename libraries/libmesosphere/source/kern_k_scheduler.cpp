@@ -21,6 +21,7 @@
 namespace ams::kern {
 
     bool KScheduler::s_scheduler_update_needed;
+    u64 KScheduler::s_dirty_core_mask;
     KScheduler::LockType KScheduler::s_scheduler_lock;
     KSchedulerPriorityQueue KScheduler::s_priority_queue;
 
@@ -110,7 +111,8 @@ namespace ams::kern {
     u64 KScheduler::UpdateHighestPriorityThreadsImpl() {
         MESOSPHERE_ASSERT(IsSchedulerLockedByCurrentThread());
 
-        /* Clear that we need to update. */
+        /* Clear that we need to update, noting which cores are dirty (their scheduled queues may have changed). */
+        const u64 dirty_core_mask = s_dirty_core_mask;
         ClearSchedulerUpdateNeeded();
 
         u64 cores_needing_scheduling = 0, idle_cores = 0;
@@ -119,6 +121,15 @@ namespace ams::kern {
 
         /* We want to go over all cores, finding the highest priority thread and determining if scheduling is needed for that core. */
         for (size_t core_id = 0; core_id < cpu::NumCores; core_id++) {
+            /* If nothing affecting the core's top thread has changed, the thread we chose last time is still correct. */
+            if ((dirty_core_mask & (1ul << core_id)) == 0) {
+                top_threads[core_id] = Kernel::GetScheduler(core_id).m_state.highest_priority_thread;
+                if (priority_queue.GetScheduledFront(core_id) == nullptr) {
+                    idle_cores |= (1ul << core_id);
+                }
+                continue;
+            }
+
             KThread *top_thread = priority_queue.GetScheduledFront(core_id);
             if (top_thread != nullptr) {
                 /* We need to check if the thread's process has a pinned thread. */
@@ -299,12 +310,12 @@ namespace ams::kern {
             /* If we were previously runnable, then we're not runnable now, and we should remove. */
             GetPriorityQueue().Remove(thread);
             IncrementScheduledCount(thread);
-            SetSchedulerUpdateNeeded();
+            SetSchedulerUpdateNeeded(thread->GetActiveCore());
         } else if (cur_state == KThread::ThreadState_Runnable) {
             /* If we're now runnable, then we weren't previously, and we should add. */
             GetPriorityQueue().PushBack(thread);
             IncrementScheduledCount(thread);
-            SetSchedulerUpdateNeeded();
+            SetSchedulerUpdateNeeded(thread->GetActiveCore());
         }
     }
 
@@ -315,7 +326,7 @@ namespace ams::kern {
         if (thread->GetRawState() == KThread::ThreadState_Runnable) {
             GetPriorityQueue().ChangePriority(old_priority, thread == GetCurrentThreadPointer(), thread);
             IncrementScheduledCount(thread);
-            SetSchedulerUpdateNeeded();
+            SetSchedulerUpdateNeeded(thread->GetActiveCore());
         }
     }
 
@@ -326,7 +337,8 @@ namespace ams::kern {
         if (thread->GetRawState() == KThread::ThreadState_Runnable) {
             GetPriorityQueue().ChangeAffinityMask(old_core, old_affinity, thread);
             IncrementScheduledCount(thread);
-            SetSchedulerUpdateNeeded();
+            SetSchedulerUpdateNeeded(old_core);
+            SetSchedulerUpdateNeeded(thread->GetActiveCore());
         }
     }
 
@@ -443,7 +455,7 @@ namespace ams::kern {
 
                 /* If the next thread is different, we have an update to perform. */
                 if (next_thread != std::addressof(cur_thread)) {
-                    SetSchedulerUpdateNeeded();
+                    SetSchedulerUpdateNeeded(cur_thread.GetActiveCore());
                 } else {
                     /* Otherwise, set the thread's yield count so that we won't waste work until the process is scheduled again. */
                     cur_thread.SetYieldScheduleCount(cur_process.GetScheduledCount());
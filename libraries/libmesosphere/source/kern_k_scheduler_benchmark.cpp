@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <mesosphere.hpp>
+
+#if defined(MESOSPHERE_ENABLE_SCHEDULER_BENCHMARK)
+namespace ams::kern {
+
+    namespace {
+
+        constexpr size_t RoundTripCount = 0x4000;
+        constexpr size_t NumPairs       = cpu::NumCores / 2;
+
+        /* Each pair of cores passes a turn back and forth, so that every round trip is two waits and two wakeups. */
+        struct PingPongPair {
+            KLightLock lock;
+            KLightConditionVariable cv;
+            s32 turn;
+            s64 ticks;
+
+            constexpr PingPongPair() : lock(), cv(util::ConstantInitialize), turn(0), ticks(0) { /* ... */ }
+        };
+
+        constinit PingPongPair g_pairs[NumPairs];
+
+        s64 RunPingPong(PingPongPair &pair, s32 side) {
+            const s64 start_tick = KHardwareTimer::GetTick();
+            {
+                KScopedLightLock lk(std::addressof(pair.lock));
+
+                for (size_t i = 0; i < RoundTripCount; ++i) {
+                    while (pair.turn != side) {
+                        pair.cv.Wait(std::addressof(pair.lock));
+                    }
+
+                    pair.turn = 1 - side;
+                    pair.cv.Broadcast();
+                }
+            }
+            return KHardwareTimer::GetTick() - start_tick;
+        }
+
+        void RunPhase(s32 core_id, size_t num_pairs) {
+            const size_t pair_index = core_id / 2;
+            if (pair_index < num_pairs) {
+                auto &pair = g_pairs[pair_index];
+                const s64 ticks = RunPingPong(pair, core_id % 2);
+
+                /* The side which moves first is the one whose time covers every round trip. */
+                if ((core_id % 2) == 0) {
+                    pair.ticks = ticks;
+                }
+            }
+            cpu::SynchronizeAllCores();
+        }
+
+        void LogPhase(const char *name, size_t num_pairs) {
+            s64 max_ticks = 1;
+            for (size_t i = 0; i < num_pairs; ++i) {
+                max_ticks = std::max(max_ticks, g_pairs[i].ticks);
+            }
+
+            const u64 round_trips = RoundTripCount * num_pairs;
+            MESOSPHERE_RELEASE_LOG("    %s: %lu round trips/s, %ld ns/round trip\n", name, static_cast<u64>((round_trips * ams::svc::TicksPerSecond) / max_ticks), static_cast<s64>((max_ticks * INT64_C(1000000000)) / (ams::svc::TicksPerSecond * static_cast<s64>(RoundTripCount))));
+        }
+
+    }
+
+    void RunSchedulerBenchmark(s32 core_id) {
+        cpu::SynchronizeAllCores();
+
+        /* Run a single pair, with the other cores idle. */
+        RunPhase(core_id, 1);
+        if (core_id == 0) {
+            MESOSPHERE_RELEASE_LOG("Scheduler benchmark: %zu round trips per pair\n", RoundTripCount);
+            LogPhase("1 pair ", 1);
+        }
+        cpu::SynchronizeAllCores();
+
+        /* Reset the turns, and run every pair concurrently, so that updates for unrelated cores contend. */
+        if (core_id == 0) {
+            for (auto &pair : g_pairs) {
+                pair.turn  = 0;
+                pair.ticks = 0;
+            }
+        }
+        cpu::SynchronizeAllCores();
+
+        RunPhase(core_id, NumPairs);
+        if (core_id == 0) {
+            LogPhase("All pairs", NumPairs);
+        }
+        cpu::SynchronizeAllCores();
+    }
+
+}
+#endif
@@ -50,9 +50,7 @@ namespace ams::kern {
         m_is_initialized = true;
 
         /* Clear all pages in the memory. */
-        for (const auto &block : m_page_group) {
-            std::memset(GetVoidPointer(KMemoryLayout::GetLinearVirtualAddress(block.GetAddress())), 0, block.GetSize());
-        }
+        Kernel::GetMemoryManager().FillAllocatedPages(m_page_group, 0);
 
         R_SUCCEED();
     }
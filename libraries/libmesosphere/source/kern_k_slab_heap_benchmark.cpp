@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <mesosphere.hpp>
+
+#if defined(MESOSPHERE_ENABLE_SLAB_HEAP_BENCHMARK)
+namespace ams::kern {
+
+    namespace {
+
+        constexpr size_t ObjectSize     = 0x100;
+        constexpr size_t BurstSize      = 0x20;
+        constexpr size_t IterationCount = 0x4000;
+        constexpr size_t ObjectCount    = 2 * BurstSize * cpu::NumCores;
+        constexpr u64 TotalAllocations  = IterationCount * BurstSize * cpu::NumCores;
+
+        struct BenchmarkObject {
+            u8 data[ObjectSize];
+        };
+
+        alignas(PageSize) constinit u8 g_shared_heap_memory[ObjectSize * ObjectCount];
+        alignas(PageSize) constinit u8 g_slab_heap_memory[ObjectSize * ObjectCount];
+
+        constinit impl::KSlabHeapImpl g_shared_heap;
+        constinit KSlabHeap<BenchmarkObject, false> g_slab_heap;
+
+        constinit s64 g_shared_heap_ticks[cpu::NumCores];
+        constinit s64 g_slab_heap_ticks[cpu::NumCores];
+
+        template<typename AllocateFunction, typename FreeFunction>
+        s64 RunBursts(AllocateFunction allocate, FreeFunction free) {
+            void *objects[BurstSize];
+
+            const s64 start_tick = KHardwareTimer::GetTick();
+            for (size_t i = 0; i < IterationCount; ++i) {
+                for (size_t j = 0; j < BurstSize; ++j) {
+                    objects[j] = allocate();
+                    MESOSPHERE_ABORT_UNLESS(objects[j] != nullptr);
+                }
+                for (size_t j = 0; j < BurstSize; ++j) {
+                    free(objects[j]);
+                }
+            }
+
+            return KHardwareTimer::GetTick() - start_tick;
+        }
+
+        s64 GetAllocationsPerSecond(const s64 *ticks) {
+            /* All cores run concurrently, so use the slowest core's time. */
+            const s64 max_ticks = std::max<s64>(*std::max_element(ticks, ticks + cpu::NumCores), 1);
+
+            return static_cast<s64>((TotalAllocations * ams::svc::TicksPerSecond) / max_ticks);
+        }
+
+    }
+
+    void RunSlabHeapBenchmark(s32 core_id) {
+        /* Initialize the heaps. */
+        if (core_id == 0) {
+            g_shared_heap.Initialize();
+            for (size_t i = 0; i < ObjectCount; ++i) {
+                g_shared_heap.Free(g_shared_heap_memory + ObjectSize * (ObjectCount - 1 - i));
+            }
+
+            g_slab_heap.Initialize(g_slab_heap_memory, sizeof(g_slab_heap_memory));
+        }
+        cpu::SynchronizeAllCores();
+
+        /* Run bursts against the shared free list alone. */
+        g_shared_heap_ticks[core_id] = RunBursts([]() ALWAYS_INLINE_LAMBDA { return g_shared_heap.Allocate(); }, [](void *obj) ALWAYS_INLINE_LAMBDA { g_shared_heap.Free(obj); });
+        cpu::SynchronizeAllCores();
+
+        /* Run bursts against the slab heap. */
+        g_slab_heap_ticks[core_id] = RunBursts([]() ALWAYS_INLINE_LAMBDA -> void * { return g_slab_heap.Allocate(); }, [](void *obj) ALWAYS_INLINE_LAMBDA { g_slab_heap.Free(static_cast<BenchmarkObject *>(obj)); });
+        cpu::SynchronizeAllCores();
+
+        /* Log the results. */
+        if (core_id == 0) {
+            MESOSPHERE_RELEASE_LOG("Slab heap benchmark: %zu cores, %zu object bursts\n", cpu::NumCores, BurstSize);
+            MESOSPHERE_RELEASE_LOG("    Shared free list: %ld allocations/s\n", GetAllocationsPerSecond(g_shared_heap_ticks));
+            MESOSPHERE_RELEASE_LOG("    Slab heap:        %ld allocations/s\n", GetAllocationsPerSecond(g_slab_heap_ticks));
+
+            /* Count the operations on state shared between cores: the shared free list, and other cores' magazines. */
+            /* NOTE: These are counted operations, not measured cache misses; each is only an opportunity for a remote cache line transfer. */
+            /* Without magazines, every allocation and every free is such an operation. */
+            #if defined(MESOSPHERE_ENABLE_SLAB_HEAP_MAGAZINES)
+            const auto stats = g_slab_heap.GetMagazineStatistics();
+            const u64 shared_operations = stats.num_shared_operations + stats.num_steals;
+            MESOSPHERE_RELEASE_LOG("    Magazines: %lu refills, %lu drains, %lu steals\n", stats.num_refills, stats.num_drains, stats.num_steals);
+            #else
+            const u64 shared_operations = 2 * TotalAllocations;
+            #endif
+            MESOSPHERE_RELEASE_LOG("    Shared-state operations per 1000 allocations (counted, not measured misses): %lu\n", (shared_operations * 1000) / TotalAllocations);
+        }
+        cpu::SynchronizeAllCores();
+    }
+
+}
+#endif
@@ -22,56 +22,64 @@ namespace ams::kern {
 
     namespace {
 
-        constinit KSpinLock g_ktrace_lock;
-        constinit KVirtualAddress g_ktrace_buffer_address = Null<KVirtualAddress>;
-        constinit size_t g_ktrace_buffer_size = 0;
-        constinit u64 g_type_filter = 0;
+        using KTraceHeader     = ams::svc::KernelTraceBufferHeader;
+        using KTraceRingHeader = ams::svc::KernelTraceRingHeader;
+        using KTraceRecord     = ams::svc::KernelTraceRecord;
 
-        struct KTraceHeader {
-            u32 magic;
-            u32 offset;
-            u32 index;
-            u32 count;
-
-            static constexpr u32 Magic = util::FourCC<'K','T','R','0'>::Code;
-        };
         static_assert(util::is_pod<KTraceHeader>::value);
-
-        struct KTraceRecord {
-            u8 core_id;
-            u8 type;
-            u16 process_id;
-            u32 thread_id;
-            u64 tick;
-            u64 data[6];
-        };
+        static_assert(util::is_pod<KTraceRingHeader>::value);
         static_assert(util::is_pod<KTraceRecord>::value);
         static_assert(sizeof(KTraceRecord) == 0x40);
 
+        constinit KVirtualAddress g_ktrace_buffer_address = Null<KVirtualAddress>;
+        constinit size_t g_ktrace_buffer_size = 0;
+        constinit u64 g_type_filter = 0;
+
+        /* NOTE: The trace buffer is mapped writable by userland, so the ring geometry and write counts it holds are only ever written by us, never read. */
+        constinit size_t g_ring_offset  = 0;
+        constinit size_t g_ring_size    = 0;
+        constinit u64 g_record_count    = 0;
+        constinit u64 g_write_counts[cpu::NumCores] = {};
+
         ALWAYS_INLINE bool IsTypeFiltered(u8 type) {
             return (g_type_filter & (UINT64_C(1) << (type & (BITSIZEOF(u64) - 1)))) != 0;
         }
 
+        ALWAYS_INLINE KTraceRingHeader *GetRingHeader(s32 core_id) {
+            return GetPointer<KTraceRingHeader>(g_ktrace_buffer_address + g_ring_offset + core_id * g_ring_size);
+        }
+
+        ALWAYS_INLINE KTraceRecord *GetRecord(KTraceRingHeader *ring, u32 index) {
+            return reinterpret_cast<KTraceRecord *>(ring + 1) + index;
+        }
+
     }
 
     void KTrace::Initialize(KVirtualAddress address, size_t size) {
         /* Only perform tracing when on development hardware. */
         if (KTargetSystem::IsDebugMode()) {
-            const size_t offset = util::AlignUp(sizeof(KTraceHeader), sizeof(KTraceRecord));
-            if (offset < size) {
+            /* Each core gets an equal share of the buffer, each beginning with its ring header. */
+            const size_t ring_offset  = util::AlignUp(sizeof(KTraceHeader), sizeof(KTraceRecord));
+            const size_t ring_size    = util::AlignDown((size - std::min(size, ring_offset)) / cpu::NumCores, sizeof(KTraceRecord));
+            if (ring_size > sizeof(KTraceRingHeader)) {
                 /* Clear the trace buffer. */
                 std::memset(GetVoidPointer(address), 0, size);
 
                 /* Initialize the KTrace header. */
-                KTraceHeader *header = GetPointer<KTraceHeader>(address);
-                header->magic  = KTraceHeader::Magic;
-                header->offset = offset;
-                header->index  = 0;
-                header->count  = (size - offset) / sizeof(KTraceRecord);
+                KTraceHeader *header   = GetPointer<KTraceHeader>(address);
+                header->magic          = KTraceHeader::Magic;
+                header->num_rings      = cpu::NumCores;
+                header->ring_offset    = ring_offset;
+                header->ring_size      = ring_size;
+                header->record_count   = (ring_size - sizeof(KTraceRingHeader)) / sizeof(KTraceRecord);
+                header->tick_frequency = ams::svc::TicksPerSecond;
 
                 /* Set the global data. */
                 g_ktrace_buffer_address = address;
                 g_ktrace_buffer_size    = size;
+                g_ring_offset           = ring_offset;
+                g_ring_size             = ring_size;
+                g_record_count          = header->record_count;
 
                 /* Set the filters to defaults. */
                 g_type_filter = ~(UINT64_C(0));
@@ -81,55 +89,51 @@ namespace ams::kern {
 
     void KTrace::Start() {
         if (g_ktrace_buffer_address != Null<KVirtualAddress>) {
-            /* Get exclusive access to the trace buffer. */
-            KScopedInterruptDisable di;
-            KScopedSpinLock lk(g_ktrace_lock);
-
-            /* Reset the header. */
-            KTraceHeader *header = GetPointer<KTraceHeader>(g_ktrace_buffer_address);
-            header->index = 0;
-
-            /* Reset the records. */
-            KTraceRecord *records = GetPointer<KTraceRecord>(g_ktrace_buffer_address + header->offset);
-            std::memset(records, 0, sizeof(*records) * header->count);
-
             /* Note that we're active. */
-            s_is_active = true;
+            /* NOTE: Records from before we were paused are left in place; consumers can distinguish them by their ticks. */
+            util::AtomicRef<bool>(s_is_active).Store<std::memory_order_release>(true);
         }
     }
 
     void KTrace::Stop() {
         if (g_ktrace_buffer_address != Null<KVirtualAddress>) {
-            /* Get exclusive access to the trace buffer. */
-            KScopedInterruptDisable di;
-            KScopedSpinLock lk(g_ktrace_lock);
-
             /* Note that we're paused. */
-            s_is_active = false;
+            util::AtomicRef<bool>(s_is_active).Store<std::memory_order_release>(false);
         }
     }
 
     void KTrace::PushRecord(u8 type, u64 param0, u64 param1, u64 param2, u64 param3, u64 param4, u64 param5) {
-        /* Get exclusive access to the trace buffer. */
+        /* Ensure that we're the only writer to our core's ring. */
         KScopedInterruptDisable di;
-        KScopedSpinLock lk(g_ktrace_lock);
 
         /* Check whether we should push the record to the trace buffer. */
         if (s_is_active && IsTypeFiltered(type)) {
             /* Get the current thread and process. */
             KThread &cur_thread   = GetCurrentThread();
             KProcess *cur_process = GetCurrentProcessPointer();
-
-            /* Get the current record index from the header. */
-            KTraceHeader *header = GetPointer<KTraceHeader>(g_ktrace_buffer_address);
-            u32 index = header->index;
-
-            /* Get the current record. */
-            KTraceRecord *record = GetPointer<KTraceRecord>(g_ktrace_buffer_address + header->offset + index * sizeof(KTraceRecord));
+            const s32 core_id     = GetCurrentCoreId();
+
+            /* Get our core's ring. */
+            KTraceRingHeader *ring = GetRingHeader(core_id);
+
+            /* Determine where the record should go. */
+            const u64 index = g_write_counts[core_id];
+
+            /* If a consumer is streaming from the ring, don't overwrite records it hasn't read. */
+            /* NOTE: The consumer publishes the flag after its read count, so acquiring the flag lets us see a read count at least as new. */
+            if ((util::AtomicRef<u32>(ring->flags).Load<std::memory_order_acquire>() & ams::svc::KernelTraceRingFlag_Streaming) != 0) {
+                /* Clamp the consumer's read count to the records which we have written. */
+                const u64 read_count = std::min(util::AtomicRef<u64>(ring->read_count).Load<std::memory_order_acquire>(), index);
+                if (index - read_count >= g_record_count) {
+                    const util::AtomicRef<u64> drop_count(ring->drop_count);
+                    drop_count.Store<std::memory_order_relaxed>(drop_count.Load<std::memory_order_relaxed>() + 1);
+                    return;
+                }
+            }
 
             /* Set the record's data. */
-            *record = {
-                .core_id    = static_cast<u8>(GetCurrentCoreId()),
+            *GetRecord(ring, index % g_record_count) = {
+                .core_id    = static_cast<u8>(core_id),
                 .type       = type,
                 .process_id = static_cast<u16>(cur_process != nullptr ? cur_process->GetId() : ~0),
                 .thread_id  = static_cast<u32>(cur_thread.GetId()),
@@ -137,13 +141,9 @@ namespace ams::kern {
                 .data       = { param0, param1, param2, param3, param4, param5 },
             };
 
-            /* Advance the current index. */
-            if ((++index) >= header->count) {
-                index = 0;
-            }
-
-            /* Set the next index. */
-            header->index = index;
+            /* Publish the record. */
+            g_write_counts[core_id] = index + 1;
+            util::AtomicRef<u64>(ring->write_count).Store<std::memory_order_release>(index + 1);
         }
     }
 
@@ -114,12 +114,25 @@ namespace ams::kern {
         KDpcManager::Initialize();
         cpu::SynchronizeAllCores();
 
+        #if defined(MESOSPHERE_ENABLE_SLAB_HEAP_BENCHMARK)
+        /* Stress the slab heaps on every core, and log the results. */
+        RunSlabHeapBenchmark(core_id);
+        #endif
+
+        #if defined(MESOSPHERE_ENABLE_SCHEDULER_BENCHMARK)
+        /* Ping-pong between pairs of cores, and log the context switch rate. */
+        RunSchedulerBenchmark(core_id);
+        #endif
+
         /* Perform more core-0 specific initialization. */
         if (core_id == 0) {
             /* Initialize the exit worker managers, so that threads and processes may exit cleanly. */
             Kernel::GetWorkerTaskManager(KWorkerTaskManager::WorkerType_ExitThread).Initialize(KWorkerTaskManager::ExitWorkerPriority);
             Kernel::GetWorkerTaskManager(KWorkerTaskManager::WorkerType_ExitProcess).Initialize(KWorkerTaskManager::ExitWorkerPriority);
 
+            /* Initialize the zeroing threads, so that allocations may be satisfied with pages zeroed ahead of time. */
+            Kernel::GetMemoryManager().InitializeZeroingThreads();
+
             /* Setup so that we may sleep later, and reserve memory for secure applets. */
             KSystemControl::InitializePhase2();
 
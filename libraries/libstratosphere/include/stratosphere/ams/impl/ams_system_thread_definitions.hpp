@@ -49,10 +49,12 @@ namespace ams::impl {
     /* FS. */
     AMS_DEFINE_SYSTEM_THREAD(11, sdmmc, DeviceDetector);
     AMS_DEFINE_SYSTEM_THREAD(16, fs,    WorkerThreadPool);
+    AMS_DEFINE_SYSTEM_THREAD(16, fs,    DecompressionWorker);
     AMS_DEFINE_SYSTEM_THREAD(17, fs,    Main);
     AMS_DEFINE_SYSTEM_THREAD(17, fs,    WorkerRealTimeAccess);
     AMS_DEFINE_SYSTEM_THREAD(18, fs,    WorkerNormalPriorityAccess);
     AMS_DEFINE_SYSTEM_THREAD(19, fs,    WorkerLowPriorityAccess);
+    AMS_DEFINE_SYSTEM_THREAD(19, fs,    ReadAheadWorker);
     AMS_DEFINE_SYSTEM_THREAD(30, fs,    WorkerBackgroundAccess);
     AMS_DEFINE_SYSTEM_THREAD(30, fs,    PatrolReader);
 
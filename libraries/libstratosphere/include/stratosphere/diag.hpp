@@ -27,3 +27,4 @@
 
 #include <stratosphere/diag/diag_backtrace.hpp>
 #include <stratosphere/diag/diag_symbol.hpp>
+#include <stratosphere/diag/diag_kernel_trace.hpp>
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <vapours.hpp>
+
+namespace ams::diag {
+
+    #if defined(ATMOSPHERE_OS_HORIZON)
+    /* Drains the kernel's per-core trace rings. */
+    /* The process must map the kernel trace buffer read/write, via its MapRegion capability. */
+    class KernelTraceReader {
+        NON_COPYABLE(KernelTraceReader);
+        NON_MOVEABLE(KernelTraceReader);
+        private:
+            uintptr_t m_address;
+            size_t m_size;
+            bool m_is_streaming;
+        public:
+            constexpr KernelTraceReader() : m_address(0), m_size(0), m_is_streaming(false) { /* ... */ }
+            ~KernelTraceReader() { this->Finalize(); }
+
+            Result Initialize();
+            void Finalize();
+
+            s32 GetRingCount() const;
+            u64 GetTickFrequency() const;
+
+            /* While streaming, the kernel drops new records instead of overwriting ones which haven't been read. */
+            void SetStreaming(bool en);
+
+            /* Reads up to count of the oldest unread records from a core's ring, returning the number read. */
+            size_t Read(svc::KernelTraceRecord *out, size_t count, s32 ring);
+
+            u64 GetDroppedCount(s32 ring) const;
+    };
+    #endif
+
+}
@@ -48,7 +48,9 @@
 #include <stratosphere/fssystem/fssystem_service_context.hpp>
 #include <stratosphere/fssystem/fssystem_alignment_matching_storage_impl.hpp>
 #include <stratosphere/fssystem/fssystem_alignment_matching_storage.hpp>
+#include <stratosphere/fssystem/fssystem_decompression_thread_pool.hpp>
 #include <stratosphere/fssystem/fssystem_compressed_storage.hpp>
+#include <stratosphere/fssystem/fssystem_read_ahead_storage.hpp>
 #include <stratosphere/fssystem/fssystem_buffered_storage.hpp>
 #include <stratosphere/fssystem/fssystem_hierarchical_integrity_verification_storage.hpp>
 #include <stratosphere/fssystem/fssystem_integrity_romfs_storage.hpp>
@@ -29,6 +29,9 @@ namespace ams::fssystem {
 
             static constexpr size_t NodeSizeMin = 1_KB;
             static constexpr size_t NodeSizeMax = 512_KB;
+
+            static constexpr s32 NodeCacheCountMax   = 4;
+            static constexpr size_t NodeCacheSizeMax = 256_KB;
         public:
             class Visitor;
 
@@ -173,6 +176,36 @@ namespace ams::fssystem {
                         return m_allocator;
                     }
             };
+
+            enum class CachedNodeKind : u8 {
+                OffsetNode,
+                EntrySet,
+            };
+
+            struct CachedNode {
+                NodeBuffer buffer;
+                s64 start_offset;
+                s64 end_offset;
+                s32 index;
+                u32 last_access;
+                CachedNodeKind kind;
+                bool is_valid;
+
+                CachedNode() : buffer(), start_offset(), end_offset(), index(-1), last_access(), kind(), is_valid(false) { /* ... */ }
+            };
+
+            /* Verified L2 offset nodes and entry sets, shared by every visitor of the tree so that lookups in hot regions need not read storage. */
+            /* Each tree's first slot is its own; the buffers of every other slot of every tree come out of a single budget of NodeCacheSizeMax. */
+            struct NodeCache {
+                CachedNode nodes[NodeCacheCountMax];
+                std::atomic<s32> last_entry_set_slot;
+                u32 access_count;
+                os::SdkMutex mutex;
+
+                NodeCache() : nodes(), last_entry_set_slot(-1), access_count(), mutex() { /* ... */ }
+            };
+
+            static constexpr s32 GuaranteedNodeCacheSlot = 0;
         private:
             static constexpr s32 GetEntryCount(size_t node_size, size_t entry_size) {
                 return static_cast<s32>((node_size - sizeof(NodeHeader)) / entry_size);
@@ -238,8 +271,9 @@ namespace ams::fssystem {
             s32 m_offset_count;
             s32 m_entry_set_count;
             OffsetCache m_offset_cache;
+            mutable NodeCache m_node_cache;
         public:
-            BucketTree() : m_node_storage(), m_entry_storage(), m_node_l1(), m_node_size(), m_entry_size(), m_entry_count(), m_offset_count(), m_entry_set_count(), m_offset_cache() { /* ... */ }
+            BucketTree() : m_node_storage(), m_entry_storage(), m_node_l1(), m_node_size(), m_entry_size(), m_entry_count(), m_offset_count(), m_entry_set_count(), m_offset_cache(), m_node_cache() { /* ... */ }
             ~BucketTree() { this->Finalize(); }
 
             Result Initialize(IAllocator *allocator, fs::SubStorage node_storage, fs::SubStorage entry_storage, size_t node_size, size_t entry_size, s32 entry_count);
@@ -285,6 +319,12 @@ namespace ams::fssystem {
             }
 
             Result EnsureOffsetCache();
+
+            bool HasCachedEntrySet() const { return m_node_cache.last_entry_set_slot.load(std::memory_order_relaxed) >= 0; }
+
+            s32 FindCachedNode(CachedNodeKind kind, s32 index) const;
+            void StoreCachedNode(CachedNodeKind kind, s32 index, const char *buffer) const;
+            void ClearNodeCache();
     };
 
     /* ACCURATE_TO_VERSION: Unknown */
@@ -350,6 +390,14 @@ namespace ams::fssystem {
             Result FindEntry(s64 virtual_address, s32 entry_set_index);
             Result FindEntryWithBuffer(s64 virtual_address, s32 entry_set_index, char *buffer);
             Result FindEntryWithoutBuffer(s64 virtual_address, s32 entry_set_index);
+
+            bool FindEntryInLastEntrySet(s64 virtual_address);
+            bool FindEntrySetInCache(s32 *out_index, s64 virtual_address, s32 node_index);
+            bool FindEntryInCache(s64 virtual_address, s32 entry_set_index);
+            bool FindEntryInCachedNode(s64 virtual_address, s32 slot);
+
+            bool ReadEntrySetFromCache(EntrySetHeader *out, s32 entry_set_index);
+            bool ReadEntryFromCache(s32 entry_set_index, s32 entry_index);
     };
 
 }
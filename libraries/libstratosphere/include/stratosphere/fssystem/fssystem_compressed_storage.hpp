@@ -18,11 +18,23 @@
 #include <stratosphere/fssystem/fssystem_asynchronous_access.hpp>
 #include <stratosphere/fssystem/fssystem_bucket_tree.hpp>
 #include <stratosphere/fssystem/fssystem_compression_common.hpp>
+#include <stratosphere/fssystem/fssystem_decompression_thread_pool.hpp>
 #include <stratosphere/fs/fs_i_buffer_manager.hpp>
 #include <stratosphere/fssystem/impl/fssystem_block_cache_manager.hpp>
 
 namespace ams::fssystem {
 
+    size_t GetCompressedStorageBlockCacheHitCount();
+    size_t GetCompressedStorageBlockCacheMissCount();
+
+    void ClearCompressedStorageBlockCacheCount();
+
+    namespace impl {
+
+        void CountCompressedStorageBlockCacheAccess(bool is_hit);
+
+    }
+
     /* ACCURATE_TO_VERSION: 13.4.0.0 */
     class CompressedStorage : public ::ams::fs::IStorage, public ::ams::fssystem::IAsynchronousAccessSplitter, public ::ams::fs::impl::Newable {
         NON_COPYABLE(CompressedStorage);
@@ -484,7 +496,8 @@ namespace ams::fssystem {
                         R_SUCCEED();
                     }
                 public:
-                    using ReadImplFunction = util::IFunction<Result(void *, size_t)>;
+                    /* The final argument is set when the destination remains valid until Read returns, so that decompression into it may be deferred until then. */
+                    using ReadImplFunction = util::IFunction<Result(void *, size_t, bool)>;
                     using ReadFunction     = util::IFunction<Result(size_t, const ReadImplFunction &)>;
                 public:
                     Result Read(s64 offset, s64 size, const ReadFunction &read_func) {
@@ -568,6 +581,11 @@ namespace ams::fssystem {
                                         /* Temporarily increase our thread priority, while we decompress the data. */
                                         ScopedThreadPriorityChanger cp(+1, ScopedThreadPriorityChanger::Mode::Relative);
 
+                                        /* Decompression of entries which are read straight to their destination may be spread over the decompression workers. */
+                                        const bool use_decompression_thread_pool = IsDecompressionThreadPoolEnabled();
+                                        DecompressionTask tasks[DecompressionTaskCountMax];
+                                        s32 task_count = 0;
+
                                         /* Decompress the data. */
                                         size_t buffer_offset;
                                         for (buffer_offset = 0; entry_idx < entry_count && ((static_cast<size_t>(entries[entry_idx].physical_size) + static_cast<size_t>(entries[entry_idx].gap_from_prev)) == 0 || buffer_offset < cur_read_size); buffer_offset += entries[entry_idx++].physical_size) {
@@ -582,10 +600,10 @@ namespace ams::fssystem {
                                                         AMS_ASSERT(buffer_offset + entries[entry_idx].virtual_size <= cur_read_size);
 
                                                         /* Perform no decompression. */
-                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size, bool can_defer) -> Result {
                                                             /* Check that the size is valid. */
                                                             AMS_ASSERT(dst_size == entries[entry_idx].virtual_size);
-                                                            AMS_UNUSED(dst_size);
+                                                            AMS_UNUSED(dst_size, can_defer);
 
                                                             /* We have no compression, so just copy the data out. */
                                                             std::memcpy(dst, buffer + buffer_offset, entries[entry_idx].virtual_size);
@@ -599,10 +617,10 @@ namespace ams::fssystem {
                                                         AMS_ASSERT(buffer_offset <= cur_read_size);
 
                                                         /* Zero the memory. */
-                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size, bool can_defer) -> Result {
                                                             /* Check that the size is valid. */
                                                             AMS_ASSERT(dst_size == entries[entry_idx].virtual_size);
-                                                            AMS_UNUSED(dst_size);
+                                                            AMS_UNUSED(dst_size, can_defer);
 
                                                             /* The data is zeroes, so zero the buffer. */
                                                             std::memset(dst, 0, entries[entry_idx].virtual_size);
@@ -620,11 +638,29 @@ namespace ams::fssystem {
                                                         R_UNLESS(decompressor != nullptr, fs::ResultUnexpectedInCompressedStorageB());
 
                                                         /* Decompress the data. */
-                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size, bool can_defer) -> Result {
                                                             /* Check that the size is valid. */
                                                             AMS_ASSERT(dst_size == entries[entry_idx].virtual_size);
                                                             AMS_UNUSED(dst_size);
 
+                                                            /* If we can, leave the decompression to be done alongside the other entries in the buffer. */
+                                                            if (can_defer && use_decompression_thread_pool) {
+                                                                if (task_count == DecompressionTaskCountMax) {
+                                                                    R_TRY(DecompressInParallel(tasks, task_count));
+                                                                    task_count = 0;
+                                                                }
+
+                                                                tasks[task_count++] = {
+                                                                    .dst          = dst,
+                                                                    .src          = buffer + buffer_offset,
+                                                                    .dst_size     = entries[entry_idx].virtual_size,
+                                                                    .src_size     = entries[entry_idx].physical_size,
+                                                                    .decompressor = decompressor,
+                                                                    .result       = ResultSuccess(),
+                                                                };
+                                                                R_SUCCEED();
+                                                            }
+
                                                             /* Perform the decompression. */
                                                             R_RETURN(decompressor(dst, entries[entry_idx].virtual_size, buffer + buffer_offset, entries[entry_idx].physical_size));
                                                         })));
@@ -633,6 +669,9 @@ namespace ams::fssystem {
                                             }
                                         }
 
+                                        /* Finish any decompression we deferred, before the buffer is reused. */
+                                        R_TRY(DecompressInParallel(tasks, task_count));
+
                                         /* Check that we processed the correct amount of data. */
                                         AMS_ASSERT(buffer_offset == cur_read_size);
                                     } else {
@@ -641,10 +680,10 @@ namespace ams::fssystem {
                                         required_access_physical_size   -= entries[entry_idx].gap_from_prev;
 
                                         /* We don't need the buffer (as the data is uncompressed), so just execute the read. */
-                                        R_TRY(read_func(cur_read_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                        R_TRY(read_func(cur_read_size, util::MakeIFunction([&] (void *dst, size_t dst_size, bool can_defer) -> Result {
                                             /* Check that the size is valid. */
                                             AMS_ASSERT(dst_size == cur_read_size);
-                                            AMS_UNUSED(dst_size);
+                                            AMS_UNUSED(dst_size, can_defer);
 
                                             /* Perform the read. */
                                             R_RETURN(m_data_storage.Read(required_access_physical_offset, dst, cur_read_size));
@@ -662,10 +701,10 @@ namespace ams::fssystem {
                                 R_SUCCEED();
                             } else {
                                 /* We don't need a buffer, so just execute the read. */
-                                R_TRY(read_func(total_required_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                R_TRY(read_func(total_required_size, util::MakeIFunction([&] (void *dst, size_t dst_size, bool can_defer) -> Result {
                                     /* Check that the size is valid. */
                                     AMS_ASSERT(dst_size == total_required_size);
-                                    AMS_UNUSED(dst_size);
+                                    AMS_UNUSED(dst_size, can_defer);
 
                                     /* Perform the read. */
                                     R_RETURN(m_data_storage.Read(required_access_physical_offset, dst, total_required_size));
@@ -759,10 +798,10 @@ namespace ams::fssystem {
                                     };
                                 } else {
                                     /* We have no entries, so we can just perform the read. */
-                                    R_TRY(read_func(static_cast<size_t>(read_size), util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                    R_TRY(read_func(static_cast<size_t>(read_size), util::MakeIFunction([&] (void *dst, size_t dst_size, bool can_defer) -> Result {
                                         /* Check the space we should zero is correct. */
                                         AMS_ASSERT(dst_size == static_cast<size_t>(read_size));
-                                        AMS_UNUSED(dst_size);
+                                        AMS_UNUSED(dst_size, can_defer);
 
                                         /* Zero the memory. */
                                         std::memset(dst, 0, read_size);
@@ -862,18 +901,28 @@ namespace ams::fssystem {
 
                     using BlockCacheManager = ::ams::fssystem::impl::BlockCacheManager<CacheEntry, fs::IBufferManager>;
                     using CacheIndex        = BlockCacheManager::CacheIndex;
+
+                    /* Whole decompressed blocks are registered at a buffer level of their own, so that the buffer manager keeps some of them while other caches compete for memory. */
+                    static constexpr s32 DecompressedBlockCacheBufferLevel = 15;
+                    static constexpr s32 DecompressedBlockCacheCountMax    = 32;
+                    static constexpr size_t DecompressedBlockCacheDivisor  = 4;
                 private:
                     size_t m_cache_size_unk_0;
                     size_t m_cache_size_unk_1;
                     os::SdkMutex m_mutex;
                     BlockCacheManager m_block_cache_manager;
+                    BlockCacheManager m_decompressed_block_cache_manager;
                     s64 m_storage_size = 0;
                 public:
                     CacheManager() = default;
 
                     ~CacheManager() { this->Finalize(); }
                 public:
-                    Result Initialize(fs::IBufferManager *cache_allocator, s64 storage_size, size_t cache_size_0, size_t cache_size_1, size_t max_cache_entries) {
+                    Result Initialize(fs::IBufferManager *cache_allocator, s64 storage_size, size_t cache_size_0, size_t cache_size_1, size_t max_cache_entries, size_t block_size_max) {
+                        /* Initialize our decompressed block cache manager, with room for blocks filling up to a quarter of the buffer manager. */
+                        const s32 max_block_cache_entries = static_cast<s32>(std::min<size_t>(cache_allocator->GetTotalSize() / DecompressedBlockCacheDivisor / block_size_max, DecompressedBlockCacheCountMax));
+                        R_TRY(m_decompressed_block_cache_manager.Initialize(cache_allocator, max_block_cache_entries));
+
                         /* Initialize our block cache manager. */
                         R_TRY(m_block_cache_manager.Initialize(cache_allocator, max_cache_entries));
 
@@ -891,16 +940,18 @@ namespace ams::fssystem {
                             this->Invalidate();
                         }
 
-                        /* Finalize our block cache manager. */
+                        /* Finalize our block cache managers. */
                         m_block_cache_manager.Finalize();
+                        m_decompressed_block_cache_manager.Finalize();
                     }
 
                     void Invalidate() {
-                        /* Acquire exclusive access to our manager. */
+                        /* Acquire exclusive access to our managers. */
                         std::scoped_lock lk(m_mutex);
 
                         /* Invalidate all entries. */
-                        return m_block_cache_manager.Invalidate();
+                        m_block_cache_manager.Invalidate();
+                        m_decompressed_block_cache_manager.Invalidate();
                     }
 
                     Result Read(CompressedStorageCore &core, s64 offset, void *buffer, size_t size) {
@@ -974,7 +1025,7 @@ namespace ams::fssystem {
                         char *cur_dst   = static_cast<char *>(buffer);
 
                         /* If we can use the head/tail cache, do so. */
-                        if (m_block_cache_manager.GetCount() > 0) {
+                        if (m_block_cache_manager.GetCount() > 0 || m_decompressed_block_cache_manager.GetCount() > 0) {
                             /* Read the head cache. */
                             R_TRY(this->ReadHeadCache(core, cur_offset, cur_dst, cur_size, head_range, tail_range));
 
@@ -1030,8 +1081,8 @@ namespace ams::fssystem {
                                 /* Check that the access is valid for burst reading. */
                                 AMS_ASSERT(size_buffer_required <= cur_size);
 
-                                /* Perform the read. */
-                                R_TRY(read_impl(cur_dst, size_buffer_required));
+                                /* Perform the read. We read straight into the destination, so decompression may finish later. */
+                                R_TRY(read_impl(cur_dst, size_buffer_required, true));
 
                                 /* Advance. */
                                 cur_dst    += size_buffer_required;
@@ -1057,7 +1108,7 @@ namespace ams::fssystem {
                                 pooled_buffer.Allocate(size_buffer_required, size_buffer_required);
 
                                 /* Perform read. */
-                                R_TRY(read_impl(pooled_buffer.GetBuffer(), size_buffer_required));
+                                R_TRY(read_impl(pooled_buffer.GetBuffer(), size_buffer_required, false));
 
                                 /* Copy the data we read to the destination. */
                                 const size_t skip_size = cur_offset - unaligned_range->virtual_offset;
@@ -1070,8 +1121,11 @@ namespace ams::fssystem {
                                 cur_offset += copy_size;
                                 cur_size   -= copy_size;
 
-                                /* If we should, cache what we read. */
-                                if (m_block_cache_manager.GetCount() > 0 && unaligned_range->physical_size > m_cache_size_unk_1) {
+                                /* If we should, cache what we read. The whole block is cached when we can, in place of the ranges of it. */
+                                if (m_decompressed_block_cache_manager.GetCount() > 0) {
+                                    impl::CountCompressedStorageBlockCacheAccess(false);
+                                    this->StoreDecompressedBlock(*unaligned_range, pooled_buffer.GetBuffer());
+                                } else if (m_block_cache_manager.GetCount() > 0 && unaligned_range->physical_size > m_cache_size_unk_1) {
                                     CacheEntry entry;
                                     for (s64 ofs = unaligned_range->virtual_offset; ofs < unaligned_range->GetEndVirtualOffset(); ofs += entry.range.size) {
                                         /* Find or allocate buffer. */
@@ -1106,20 +1160,20 @@ namespace ams::fssystem {
                         std::scoped_lock lk(m_mutex);
 
                         /* Find the buffer. */
-                        R_RETURN(this->FindBufferImpl(out, out_entry, offset));
+                        R_RETURN(this->FindBufferImpl(m_block_cache_manager, out, out_entry, offset));
                     }
 
-                    Result FindBufferImpl(fs::IBufferManager::MemoryRange *out, CacheEntry *out_entry, s64 offset) {
+                    Result FindBufferImpl(BlockCacheManager &manager, fs::IBufferManager::MemoryRange *out, CacheEntry *out_entry, s64 offset) {
                         /* Check pre-conditions. */
                         AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
 
                         /* Get our block cache count */
-                        const auto count = m_block_cache_manager.GetCount();
+                        const auto count = manager.GetCount();
 
                         /* Try to find the buffer. */
                         CacheIndex index;
                         for (index = 0; index < count; ++index) {
-                            if (const auto &buffer = m_block_cache_manager[index]; buffer.IsAllocated() && buffer.IsIncluded(offset)) {
+                            if (const auto &buffer = manager[index]; buffer.IsAllocated() && buffer.IsIncluded(offset)) {
                                 break;
                             }
                         }
@@ -1127,7 +1181,7 @@ namespace ams::fssystem {
                         /* Set the output. */
                         if (index != count) {
                             /* Acquire the entry. */
-                            m_block_cache_manager.AcquireCacheEntry(out_entry, out, index);
+                            manager.AcquireCacheEntry(out_entry, out, index);
                             if (out->first == 0) {
                                 *out       = {};
                                 *out_entry = {};
@@ -1150,7 +1204,7 @@ namespace ams::fssystem {
                         std::scoped_lock lk(m_mutex);
 
                         /* Try to find the buffer. */
-                        R_TRY(this->FindBufferImpl(out, out_entry, offset));
+                        R_TRY(this->FindBufferImpl(m_block_cache_manager, out, out_entry, offset));
 
                         /* Determine the range size. */
                         const size_t range_size = std::min<size_t>(max_range_size, m_cache_size_unk_0);
@@ -1191,6 +1245,21 @@ namespace ams::fssystem {
 
                             /* Determine the current access extents. */
                             s64 cur_offset = head_range.virtual_offset + util::AlignDown<s64>(access_offset - head_range.virtual_offset, m_cache_size_unk_0);
+
+                            /* If the whole head block is cached, copy what we need straight from it. */
+                            if (const size_t copy_size = std::min<size_t>(access_size, head_range.GetEndVirtualOffset() - access_offset); copy_size > 0) {
+                                bool is_block_cached = false;
+                                R_TRY(this->ReadDecompressedBlock(std::addressof(is_block_cached), access_buf, access_offset, copy_size, head_range));
+
+                                if (is_block_cached) {
+                                    access_buf    += copy_size;
+                                    access_offset += copy_size;
+                                    access_size   -= copy_size;
+
+                                    cur_offset = head_range.GetEndVirtualOffset();
+                                }
+                            }
+
                             while (cur_offset < head_range.GetEndVirtualOffset() && cur_offset < static_cast<s64>(offset + size)) {
                                 /* Find the relevant entry. */
                                 fs::IBufferManager::MemoryRange memory_range = {};
@@ -1270,6 +1339,17 @@ namespace ams::fssystem {
                             /* Loop reading, while we can. */
                             const s64 dst_end_offset = offset + size;
                             s64 cur_offset = tail_range.virtual_offset;
+
+                            /* If the whole tail block is cached, copy what we need straight from it. */
+                            if (cur_offset < dst_end_offset) {
+                                bool is_block_cached = false;
+                                R_TRY(this->ReadDecompressedBlock(std::addressof(is_block_cached), buffer + cur_offset - offset, cur_offset, std::min<s64>(dst_end_offset, tail_range.GetEndVirtualOffset()) - cur_offset, tail_range));
+
+                                if (is_block_cached) {
+                                    cur_offset = dst_end_offset;
+                                }
+                            }
+
                             while (cur_offset < dst_end_offset) {
                                 /* Find the relevant entry. */
                                 fs::IBufferManager::MemoryRange memory_range = {};
@@ -1341,21 +1421,85 @@ namespace ams::fssystem {
                         /* Check pre-conditions. */
                         AMS_ASSERT(m_block_cache_manager.GetCount() > 0);
 
+                        /* Store the buffer. */
+                        return this->StoreAssociateBufferImpl(m_block_cache_manager, memory_range, entry, fs::IBufferManager::BufferAttribute());
+                    }
+
+                    void StoreAssociateBufferImpl(BlockCacheManager &manager, const fs::IBufferManager::MemoryRange &memory_range, const CacheEntry &entry, const fs::IBufferManager::BufferAttribute &attr) {
                         /* Acquire exclusive access to our manager. */
                         std::scoped_lock lk(m_mutex);
 
                         /* Get empty cache index. */
                         CacheIndex empty_index, lru_index;
-                        m_block_cache_manager.GetEmptyCacheEntryIndex(std::addressof(empty_index), std::addressof(lru_index));
+                        manager.GetEmptyCacheEntryIndex(std::addressof(empty_index), std::addressof(lru_index));
 
                         /* If nothing is empty, invalidate the least recently used entry. */
                         if (empty_index == BlockCacheManager::InvalidCacheIndex) {
-                            m_block_cache_manager.InvalidateCacheEntry(lru_index);
+                            manager.InvalidateCacheEntry(lru_index);
                             empty_index = lru_index;
                         }
 
                         /* Set the entry. */
-                        m_block_cache_manager.SetCacheEntry(empty_index, entry, memory_range);
+                        manager.SetCacheEntry(empty_index, entry, memory_range, attr);
+                    }
+
+                    Result ReadDecompressedBlock(bool *out_cached, char *dst, s64 offset, size_t size, const AccessRange &range) {
+                        /* Check pre-conditions. */
+                        AMS_ASSERT(out_cached != nullptr);
+                        AMS_ASSERT(range.virtual_offset <= offset);
+                        AMS_ASSERT(static_cast<s64>(offset + size) <= range.GetEndVirtualOffset());
+
+                        /* Only compressed blocks are cached whole. */
+                        *out_cached = false;
+                        R_SUCCEED_IF(m_decompressed_block_cache_manager.GetCount() == 0 || !range.is_block_alignment_required);
+
+                        /* Find the block, which is keyed by its virtual offset. */
+                        fs::IBufferManager::MemoryRange memory_range = {};
+                        CacheEntry entry = {};
+                        {
+                            std::scoped_lock lk(m_mutex);
+                            R_TRY(this->FindBufferImpl(m_decompressed_block_cache_manager, std::addressof(memory_range), std::addressof(entry), range.virtual_offset));
+                        }
+
+                        /* If the block isn't cached (or the buffer manager reclaimed it), it will have to be decompressed. */
+                        R_SUCCEED_IF(!entry.is_cached);
+                        AMS_ASSERT(entry.range.offset == range.virtual_offset);
+
+                        /* Copy out the data, and return the block to the cache. */
+                        std::memcpy(dst, reinterpret_cast<const void *>(memory_range.first + (offset - range.virtual_offset)), size);
+                        this->StoreAssociateBufferImpl(m_decompressed_block_cache_manager, memory_range, entry, fs::IBufferManager::BufferAttribute(DecompressedBlockCacheBufferLevel));
+
+                        impl::CountCompressedStorageBlockCacheAccess(true);
+                        *out_cached = true;
+                        R_SUCCEED();
+                    }
+
+                    void StoreDecompressedBlock(const AccessRange &range, const void *data) {
+                        /* Check pre-conditions. */
+                        AMS_ASSERT(m_decompressed_block_cache_manager.GetCount() > 0);
+                        AMS_ASSERT(range.is_block_alignment_required);
+
+                        /* Allocate memory for the block. Caching is best-effort, so we don't wait for memory to be freed. */
+                        const fs::IBufferManager::BufferAttribute attr(DecompressedBlockCacheBufferLevel);
+                        const auto memory_range = m_decompressed_block_cache_manager.GetAllocator()->AllocateBuffer(static_cast<size_t>(range.virtual_size), attr);
+                        if (memory_range.first == 0) {
+                            return;
+                        }
+
+                        /* Copy the block into the memory. */
+                        std::memcpy(reinterpret_cast<void *>(memory_range.first), data, range.virtual_size);
+
+                        /* Cache the block. */
+                        const CacheEntry entry = {
+                            .range          = { .offset = range.virtual_offset, .size = static_cast<size_t>(range.virtual_size) },
+                            .handle         = 0,
+                            .memory_address = 0,
+                            .memory_size    = 0,
+                            .is_valid       = true,
+                            .is_cached      = true,
+                            .lru_counter    = 0,
+                        };
+                        this->StoreAssociateBufferImpl(m_decompressed_block_cache_manager, memory_range, entry, attr);
                     }
             };
         private:
@@ -1374,7 +1518,7 @@ namespace ams::fssystem {
                 R_TRY(m_core.GetSize(std::addressof(core_size)));
 
                 /* Initialize our cache manager. */
-                R_TRY(m_cache_manager.Initialize(cache_allocator, core_size, cache_size_0, cache_size_1, max_cache_entries));
+                R_TRY(m_cache_manager.Initialize(cache_allocator, core_size, cache_size_0, cache_size_1, max_cache_entries, block_size_max));
 
                 R_SUCCEED();
             }
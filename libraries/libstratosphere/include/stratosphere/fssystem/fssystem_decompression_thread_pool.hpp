@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <vapours.hpp>
+#include <stratosphere/fssystem/fssystem_compression_common.hpp>
+
+namespace ams::fssystem {
+
+    struct DecompressionTask {
+        void *dst;
+        const void *src;
+        u32 dst_size;
+        u32 src_size;
+        DecompressorFunction decompressor;
+        Result result;
+    };
+
+    constexpr inline s32 DecompressionTaskCountMax       = 0x20;
+    constexpr inline s32 DecompressionWorkerCountMax     = 4;
+    constexpr inline size_t DecompressionWorkerStackSize = 16_KB;
+
+    /* Starts one worker per DecompressionWorkerStackSize of stacks, spread over the cores available to us. */
+    /* Until this is called, decompression tasks are run by the thread which submits them. */
+    void InitializeDecompressionThreadPool(void *stacks, size_t stacks_size, s32 priority);
+
+    bool IsDecompressionThreadPoolEnabled();
+
+    /* Runs the tasks, on the calling thread and any idle workers, and returns once all have completed. */
+    /* Returns the result of the first task (in submission order) which failed. */
+    Result DecompressInParallel(DecompressionTask *tasks, s32 count);
+
+}
@@ -22,6 +22,12 @@ namespace ams::fssrv::fscreator {
 
 }
 
+namespace ams::fs {
+
+    struct MemoryReportInfo;
+
+}
+
 namespace ams::fssystem {
 
     /* TODO: This is kind of really a fs process function/tied into fs main. */
@@ -32,4 +38,13 @@ namespace ams::fssystem {
 
     const ::ams::fssrv::fscreator::FileSystemCreatorInterfaces *GetFileSystemCreatorInterfaces();
 
+    /* Statistics we keep beyond those fs::MemoryReportInfo has room for. */
+    struct MemoryReportInfoForAtmosphere {
+        u64 compressed_storage_block_cache_hit_count;
+        u64 compressed_storage_block_cache_miss_count;
+    };
+
+    void GetAndClearMemoryReportInfo(::ams::fs::MemoryReportInfo *out);
+    void GetAndClearMemoryReportInfo(::ams::fs::MemoryReportInfo *out, MemoryReportInfoForAtmosphere *out_ams);
+
 }
@@ -72,9 +72,27 @@ namespace ams::fssystem {
 
                 return this->DoGenerateHash(dst, dst_size, src, src_size);
             }
+
+            void GenerateHashForBlocks(void *dst, size_t dst_size, const void *src, size_t block_size, size_t block_count) {
+                /* Check pre-conditions. */
+                AMS_ASSERT(dst != nullptr);
+                AMS_ASSERT(src != nullptr);
+                AMS_ASSERT(dst_size >= IHash256Generator::HashSize * block_count);
+
+                return this->DoGenerateHashForBlocks(dst, dst_size, src, block_size, block_count);
+            }
         protected:
             virtual Result DoCreate(std::unique_ptr<IHash256Generator> *out) = 0;
             virtual void DoGenerateHash(void *dst, size_t dst_size, const void *src, size_t src_size) = 0;
+
+            /* NOTE: This is an extension; factories which can't hash several blocks at once hash them one at a time. */
+            virtual void DoGenerateHashForBlocks(void *dst, size_t dst_size, const void *src, size_t block_size, size_t block_count) {
+                AMS_UNUSED(dst_size);
+
+                for (size_t i = 0; i < block_count; ++i) {
+                    this->DoGenerateHash(static_cast<u8 *>(dst) + IHash256Generator::HashSize * i, IHash256Generator::HashSize, static_cast<const u8 *>(src) + block_size * i, block_size);
+                }
+            }
     };
 
     /* ACCURATE_TO_VERSION: 14.3.0.0 */
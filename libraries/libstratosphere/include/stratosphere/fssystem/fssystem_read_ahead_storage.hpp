@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <vapours.hpp>
+#include <stratosphere/os.hpp>
+#include <stratosphere/fs/fs_istorage.hpp>
+#include <stratosphere/fs/impl/fs_newable.hpp>
+
+namespace ams::fssystem {
+
+    namespace impl {
+
+        struct ReadAheadRequest : public util::IntrusiveListBaseNode<ReadAheadRequest> {
+            enum class State : u8 {
+                Idle,
+                Queued,
+                Reading,
+                Ready,
+            };
+
+            fs::IStorage *storage;
+            s64 offset;
+            size_t size;
+            void *buffer;
+            s32 order;
+            State state;
+            bool is_cancelled;
+
+            constexpr ReadAheadRequest() : storage(nullptr), offset(0), size(0), buffer(nullptr), order(0), state(State::Idle), is_cancelled(false) { /* ... */ }
+
+            constexpr s64 GetEndOffset() const { return this->offset + static_cast<s64>(this->size); }
+        };
+
+    }
+
+    constexpr inline size_t ReadAheadWorkerStackSize = 16_KB;
+    constexpr inline size_t ReadAheadBufferSize      = 512_KB;
+
+    /* Starts the worker which reads ahead for every ReadAheadStorage, into the buffer given. */
+    /* Until this is called, ReadAheadStorages pass reads straight through to their base storage. */
+    void InitializeReadAheadWorker(void *stack, size_t stack_size, void *buffer, size_t buffer_size, s32 priority);
+
+    bool IsReadAheadWorkerEnabled();
+
+    /* Detects sequential streams of reads, and reads ahead of each on the read-ahead worker into the worker's buffer. */
+    /* The window read ahead of a stream doubles with each request issued for it, and is dropped when the stream is broken by a random access. */
+    class ReadAheadStorage : public ::ams::fs::IStorage, public ::ams::fs::impl::Newable {
+        NON_COPYABLE(ReadAheadStorage);
+        NON_MOVEABLE(ReadAheadStorage);
+        public:
+            static constexpr s32 StreamCountMax          = 4;
+            static constexpr s32 RequestCountPerStream   = 2;
+            static constexpr s32 SequentialReadCountMin  = 2;
+            static constexpr size_t WindowSizeMin        = 64_KB;
+            static constexpr size_t WindowSizeMax        = 1_MB;
+            static constexpr size_t BufferDivisor        = 4;
+        private:
+            struct Stream {
+                s64 next_offset;
+                s64 read_ahead_end_offset;
+                size_t window_size;
+                s32 sequential_count;
+                u32 last_access;
+                bool is_in_use;
+                impl::ReadAheadRequest requests[RequestCountPerStream];
+            };
+        private:
+            std::shared_ptr<fs::IStorage> m_base_storage;
+            s64 m_size;
+            size_t m_window_size_max;
+            u32 m_access_count;
+            os::SdkMutex m_mutex;
+            os::SdkConditionVariable m_stream_cv;
+            Stream m_streams[StreamCountMax];
+        public:
+            ReadAheadStorage();
+            virtual ~ReadAheadStorage();
+
+            Result Initialize(std::shared_ptr<fs::IStorage> base_storage);
+            void Finalize();
+        public:
+            virtual Result Read(s64 offset, void *buffer, size_t size) override;
+            virtual Result Write(s64 offset, const void *buffer, size_t size) override;
+            virtual Result Flush() override;
+            virtual Result SetSize(s64 size) override;
+            virtual Result GetSize(s64 *out) override;
+            virtual Result OperateRange(void *dst, size_t dst_size, fs::OperationId op_id, s64 offset, s64 size, const void *src, size_t src_size) override;
+        private:
+            Stream *AcquireStream(s64 offset);
+            void ReleaseStream(Stream *stream);
+            void ResetStream(Stream *stream, s64 offset);
+            void DropStaleRequests(Stream *stream, s64 offset);
+            size_t ReadFromRequests(Stream *stream, s64 offset, void *buffer, size_t size);
+            void ReadAhead(Stream *stream);
+            void ResetAllStreams();
+    };
+
+}
@@ -67,6 +67,10 @@ namespace ams::fssystem {
                 virtual void DoGenerateHash(void *dst, size_t dst_size, const void *src, size_t src_size) override {
                     Traits::Generate(dst, dst_size, src, src_size);
                 }
+
+                virtual void DoGenerateHashForBlocks(void *dst, size_t dst_size, const void *src, size_t block_size, size_t block_count) override {
+                    Traits::GenerateForBlocks(dst, dst_size, src, block_size, block_count);
+                }
         };
 
         struct Sha256Traits {
@@ -75,6 +79,10 @@ namespace ams::fssystem {
             static ALWAYS_INLINE void Generate(void *dst, size_t dst_size, const void *src, size_t src_size) {
                 return crypto::GenerateSha256(dst, dst_size, src, src_size);
             }
+
+            static ALWAYS_INLINE void GenerateForBlocks(void *dst, size_t dst_size, const void *src, size_t block_size, size_t block_count) {
+                return crypto::GenerateSha256ForBlocks(dst, dst_size, src, block_size, block_count);
+            }
         };
 
         struct Sha3256Traits {
@@ -83,6 +91,15 @@ namespace ams::fssystem {
             static ALWAYS_INLINE void Generate(void *dst, size_t dst_size, const void *src, size_t src_size) {
                 return crypto::GenerateSha3256(dst, dst_size, src, src_size);
             }
+
+            static ALWAYS_INLINE void GenerateForBlocks(void *dst, size_t dst_size, const void *src, size_t block_size, size_t block_count) {
+                AMS_ASSERT(dst_size >= Generator::HashSize * block_count);
+                AMS_UNUSED(dst_size);
+
+                for (size_t i = 0; i < block_count; ++i) {
+                    crypto::GenerateSha3256(static_cast<u8 *>(dst) + Generator::HashSize * i, Generator::HashSize, static_cast<const u8 *>(src) + block_size * i, block_size);
+                }
+            }
         };
     }
 
@@ -30,6 +30,7 @@ namespace ams::kvdb {
             Result Read(void *dst, size_t size);
         public:
             Result ReadEntryCount(size_t *out);
+            Result ReadEntryCount(size_t *out, u32 *out_generation);
             Result GetEntrySize(size_t *out_key_size, size_t *out_value_size);
             Result ReadEntry(void *out_key, size_t key_size, void *out_value, size_t value_size);
     };
@@ -44,6 +45,7 @@ namespace ams::kvdb {
             Result Write(const void *src, size_t size);
         public:
             void WriteHeader(size_t entry_count);
+            void WriteHeader(size_t entry_count, u32 generation);
             void WriteEntry(const void *key, size_t key_size, const void *value, size_t value_size);
     };
 
@@ -60,4 +62,77 @@ namespace ams::kvdb {
             }
     };
 
+    /* Functionality for parsing/generating a journal of key value mutations. */
+    /* A journal begins with the hash and generation of the archive it applies to, followed by batches which are hashed so that a torn write can be detected. */
+    /* The generation is kept in the archive header's padding, which is otherwise always zero, and is advanced by every compaction; */
+    /* this keeps a stale journal from pairing with a new archive whose entries happen to be identical to the old one's. */
+    constexpr inline size_t JournalArchiveHashSize = crypto::Sha256Generator::HashSize;
+
+    enum JournalEntryType {
+        JournalEntryType_Set,
+        JournalEntryType_Remove,
+        JournalEntryType_Compaction,
+    };
+
+    class JournalReader {
+        private:
+            AutoBuffer &m_buffer;
+            size_t m_offset;
+            size_t m_batch_end;
+        public:
+            JournalReader(AutoBuffer &b) : m_buffer(b), m_offset(0), m_batch_end(0) { /* ... */ }
+        private:
+            Result Peek(void *dst, size_t size);
+            Result Read(void *dst, size_t size);
+        public:
+            bool HasBatch() const {
+                return m_offset < m_buffer.GetSize();
+            }
+
+            size_t GetOffset() const {
+                return m_offset;
+            }
+
+            Result ReadHeader(void *out_archive_hash, size_t hash_size, u32 *out_archive_generation);
+            Result ReadBatch(size_t *out_entry_count);
+            Result GetEntryInfo(JournalEntryType *out_type, size_t *out_key_size, size_t *out_value_size);
+            Result ReadEntry(void *out_key, size_t key_size, void *out_value, size_t value_size);
+            Result SkipEntry();
+    };
+
+    class JournalWriter {
+        private:
+            AutoBuffer &m_buffer;
+            size_t m_offset;
+            size_t m_batch_offset;
+            size_t m_entry_count;
+        public:
+            JournalWriter(AutoBuffer &b) : m_buffer(b), m_offset(0), m_batch_offset(0), m_entry_count(0) { /* ... */ }
+        private:
+            Result Write(const void *src, size_t size);
+        public:
+            void WriteHeader(const void *archive_hash, size_t hash_size, u32 archive_generation);
+            void BeginBatch();
+            void WriteSetEntry(const void *key, size_t key_size, const void *value, size_t value_size);
+            void WriteRemoveEntry(const void *key, size_t key_size);
+            void WriteCompactionEntry(const void *archive_hash, size_t hash_size);
+            void EndBatch();
+    };
+
+    class JournalSizeHelper {
+        private:
+            size_t m_size;
+        public:
+            JournalSizeHelper();
+
+            void AddHeader();
+            void AddSetEntry(size_t key_size, size_t value_size);
+            void AddRemoveEntry(size_t key_size);
+            void AddCompactionEntry();
+
+            size_t GetSize() const {
+                return m_size;
+            }
+    };
+
 }
\ No newline at end of file
@@ -254,13 +254,33 @@ namespace ams::kvdb {
             };
         private:
             using Path = kvdb::BoundedString<fs::EntryNameLengthMax>;
+
+            /* The journal is compacted into the archive once it would outgrow the archive, or this size if the archive is smaller. */
+            static constexpr size_t JournalCompactionSizeMin = 16_KB;
+            static constexpr size_t DirtyKeyCapacityDivisor  = 4;
         private:
             Index m_index;
             Path m_path;
             Path m_temp_path;
+            Path m_journal_path;
             MemoryResource *m_memory_resource;
+            Key *m_dirty_keys;
+            size_t m_dirty_count;
+            size_t m_dirty_capacity;
+            bool m_dirty_overflow;
+            size_t m_archive_size;
+            size_t m_journal_size;
+            u32 m_archive_generation;
+            u8 m_archive_hash[JournalArchiveHashSize];
         public:
-            MemoryKeyValueStore() { /* ... */ }
+            MemoryKeyValueStore() : m_memory_resource(nullptr), m_dirty_keys(nullptr), m_dirty_count(0), m_dirty_capacity(0), m_dirty_overflow(false), m_archive_size(0), m_journal_size(0), m_archive_generation(0), m_archive_hash() { /* ... */ }
+
+            ~MemoryKeyValueStore() {
+                if (m_dirty_keys != nullptr) {
+                    m_memory_resource->Deallocate(m_dirty_keys, sizeof(Key) * m_dirty_capacity);
+                    m_dirty_keys = nullptr;
+                }
+            }
 
             Result Initialize(const char *dir, size_t capacity, MemoryResource *mr) {
                 /* Ensure that the passed path is a directory. */
@@ -271,6 +291,7 @@ namespace ams::kvdb {
                 /* Set paths. */
                 m_path.AssignFormat("%s%s", dir, "/imkvdb.arc");
                 m_temp_path.AssignFormat("%s%s", dir, "/imkvdb.tmp");
+                m_journal_path.Assign("");
 
                 /* Initialize our index. */
                 R_TRY(m_index.Initialize(capacity, mr));
@@ -279,6 +300,23 @@ namespace ams::kvdb {
                 R_SUCCEED();
             }
 
+            Result InitializeWithJournal(const char *dir, size_t capacity, MemoryResource *mr) {
+                /* This initializes like a directory archive, but Save appends changed entries to a journal instead of rewriting the archive. */
+                /* The journal is replayed over the archive on Load, and folded back into it whenever it grows too large. */
+                /* NOTE: Values must only be changed through Set/Remove; writes through a value pointer are not journaled. */
+                R_TRY(this->Initialize(dir, capacity, mr));
+                m_journal_path.AssignFormat("%s%s", dir, "/imkvdb.log");
+
+                /* Allocate space to track the keys changed since the last save. */
+                /* Changing more keys than this between saves costs as much as a rewrite anyway, so we needn't track them all. */
+                const size_t dirty_capacity = std::max<size_t>(capacity / DirtyKeyCapacityDivisor, 1);
+                m_dirty_keys = reinterpret_cast<Key *>(mr->Allocate(sizeof(Key) * dirty_capacity));
+                R_UNLESS(m_dirty_keys != nullptr, kvdb::ResultAllocationFailed());
+                m_dirty_capacity = dirty_capacity;
+
+                R_SUCCEED();
+            }
+
             Result InitializeForReadOnlyArchiveFile(const char *path, size_t capacity, MemoryResource *mr) {
                 /* Ensure that the passed path is a directory. */
                 fs::DirectoryEntryType entry_type;
@@ -288,6 +326,7 @@ namespace ams::kvdb {
                 /* Set paths. */
                 m_path.Assign(path);
                 m_temp_path.Assign("");
+                m_journal_path.Assign("");
 
                 /* Initialize our index. */
                 R_TRY(m_index.Initialize(capacity, mr));
@@ -301,6 +340,7 @@ namespace ams::kvdb {
                 /* A store initialized this way cannot have its contents loaded from or flushed to disk. */
                 m_path.Assign("");
                 m_temp_path.Assign("");
+                m_journal_path.Assign("");
 
                 /* Initialize our index. */
                 R_TRY(m_index.Initialize(capacity, mr));
@@ -320,62 +360,32 @@ namespace ams::kvdb {
                 /* Reset any existing entries. */
                 m_index.ResetEntries();
 
+                /* With a journal, the archive is only a base for the journal to be replayed over. */
+                if (this->IsJournalEnabled()) {
+                    R_RETURN(this->LoadWithJournal());
+                }
+
                 /* Try to read the archive -- note, path not found is a success condition. */
                 /* This is because no archive file = no entries, so we're in the right state. */
                 AutoBuffer buffer;
-                R_TRY_CATCH(this->ReadArchiveFile(std::addressof(buffer))) {
+                R_TRY_CATCH(this->ReadArchiveFile(std::addressof(buffer), m_path.Get())) {
                     R_CONVERT(fs::ResultPathNotFound, ResultSuccess());
                 } R_END_TRY_CATCH;
 
-                /* Parse entries from the buffer. */
-                {
-                    ArchiveReader reader(buffer);
-
-                    size_t entry_count = 0;
-                    R_TRY(reader.ReadEntryCount(std::addressof(entry_count)));
-
-                    for (size_t i = 0; i < entry_count; i++) {
-                        /* Get size of key/value. */
-                        size_t key_size = 0, value_size = 0;
-                        R_TRY(reader.GetEntrySize(std::addressof(key_size), std::addressof(value_size)));
-
-                        /* Allocate memory for value. */
-                        void *new_value = m_memory_resource->Allocate(value_size);
-                        R_UNLESS(new_value != nullptr, kvdb::ResultAllocationFailed());
-
-                        /* If we fail before adding to the index, deallocate our value. */
-                        ON_RESULT_FAILURE { m_memory_resource->Deallocate(new_value, value_size); };
-
-                        /* Read key and value. */
-                        Key key;
-                        R_TRY(reader.ReadEntry(std::addressof(key), sizeof(key), new_value, value_size));
-                        R_TRY(m_index.AddUnsafe(key, new_value, value_size));
-                    }
-                }
-
-                R_SUCCEED();
+                R_RETURN(this->LoadArchive(buffer));
             }
 
             Result Save(bool destructive = false) {
-                /* Create a buffer to hold the archive. */
-                AutoBuffer buffer;
-                R_TRY(buffer.Initialize(this->GetArchiveSize()));
-
-                /* Write the archive to the buffer. */
-                {
-                    ArchiveWriter writer(buffer);
-                    writer.WriteHeader(this->GetCount());
-                    for (const auto &it : m_index) {
-                        const auto &key = it.GetKey();
-                        writer.WriteEntry(std::addressof(key), sizeof(Key), it.GetValuePointer(), it.GetValueSize());
-                    }
+                /* With a journal, only the changed entries need to be written. */
+                if (this->IsJournalEnabled()) {
+                    R_RETURN(this->SaveWithJournal(destructive));
                 }
 
-                /* Save the buffer to disk. */
-                R_RETURN(this->Commit(buffer, destructive));
+                R_RETURN(this->SaveArchive(destructive));
             }
 
             Result Set(const Key &key, const void *value, size_t value_size) {
+                this->MarkDirty(key);
                 R_RETURN(m_index.Set(key, value, value_size));
             }
 
@@ -444,6 +454,7 @@ namespace ams::kvdb {
             }
 
             Result Remove(const Key &key) {
+                this->MarkDirty(key);
                 R_RETURN(m_index.Remove(key));
             }
 
@@ -487,6 +498,63 @@ namespace ams::kvdb {
                 return m_index.find(key);
             }
         private:
+            Result LoadArchive(AutoBuffer &buffer) {
+                /* Parse entries from the buffer. */
+                {
+                    ArchiveReader reader(buffer);
+
+                    size_t entry_count = 0;
+                    u32 generation = 0;
+                    R_TRY(reader.ReadEntryCount(std::addressof(entry_count), std::addressof(generation)));
+
+                    for (size_t i = 0; i < entry_count; i++) {
+                        /* Get size of key/value. */
+                        size_t key_size = 0, value_size = 0;
+                        R_TRY(reader.GetEntrySize(std::addressof(key_size), std::addressof(value_size)));
+
+                        /* Allocate memory for value. */
+                        void *new_value = m_memory_resource->Allocate(value_size);
+                        R_UNLESS(new_value != nullptr, kvdb::ResultAllocationFailed());
+
+                        /* If we fail before adding to the index, deallocate our value. */
+                        ON_RESULT_FAILURE { m_memory_resource->Deallocate(new_value, value_size); };
+
+                        /* Read key and value. */
+                        Key key;
+                        R_TRY(reader.ReadEntry(std::addressof(key), sizeof(key), new_value, value_size));
+                        R_TRY(m_index.AddUnsafe(key, new_value, value_size));
+                    }
+
+                    m_archive_generation = generation;
+                }
+
+                R_SUCCEED();
+            }
+
+            Result MakeArchive(AutoBuffer *out, u32 generation) {
+                /* Create a buffer to hold the archive. */
+                R_TRY(out->Initialize(this->GetArchiveSize()));
+
+                /* Write the archive to the buffer. */
+                ArchiveWriter writer(*out);
+                writer.WriteHeader(this->GetCount(), generation);
+                for (const auto &it : m_index) {
+                    const auto &key = it.GetKey();
+                    writer.WriteEntry(std::addressof(key), sizeof(Key), it.GetValuePointer(), it.GetValueSize());
+                }
+
+                R_SUCCEED();
+            }
+
+            Result SaveArchive(bool destructive) {
+                /* Create the archive. */
+                AutoBuffer buffer;
+                R_TRY(this->MakeArchive(std::addressof(buffer), 0));
+
+                /* Save the buffer to disk. */
+                R_RETURN(this->Commit(buffer, destructive));
+            }
+
             Result SaveArchiveToFile(const char *path, const void *buf, size_t size) {
                 /* Try to delete the archive, but allow deletion failure. */
                 fs::DeleteFile(path);
@@ -533,10 +601,10 @@ namespace ams::kvdb {
                 return size_helper.GetSize();
             }
 
-            Result ReadArchiveFile(AutoBuffer *dst) const {
+            Result ReadArchiveFile(AutoBuffer *dst, const char *path) const {
                 /* Open the file. */
                 fs::FileHandle file;
-                R_TRY(fs::OpenFile(std::addressof(file), m_path, fs::OpenMode_Read));
+                R_TRY(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Read));
                 ON_SCOPE_EXIT { fs::CloseFile(file); };
 
                 /* Get the archive file size. */
@@ -549,6 +617,312 @@ namespace ams::kvdb {
 
                 R_SUCCEED();
             }
+
+            bool IsJournalEnabled() const {
+                return m_dirty_keys != nullptr;
+            }
+
+            void SetJournalArchive(const void *archive, size_t archive_size) {
+                m_archive_size = archive_size;
+                crypto::GenerateSha256(m_archive_hash, sizeof(m_archive_hash), archive, archive_size);
+            }
+
+            void CompactDirtyKeys() {
+                std::sort(m_dirty_keys, m_dirty_keys + m_dirty_count);
+                m_dirty_count = std::unique(m_dirty_keys, m_dirty_keys + m_dirty_count) - m_dirty_keys;
+            }
+
+            void ClearDirtyKeys() {
+                m_dirty_count = 0;
+                m_dirty_overflow = false;
+            }
+
+            void MarkDirty(const Key &key) {
+                /* Without a journal, or once we've lost track of changes, there's nothing to record. */
+                if (!this->IsJournalEnabled() || m_dirty_overflow) {
+                    return;
+                }
+
+                /* If we're out of space, drop duplicate keys. If that doesn't free anything, the next save must rewrite the archive. */
+                if (m_dirty_count == m_dirty_capacity) {
+                    this->CompactDirtyKeys();
+                    if (m_dirty_count == m_dirty_capacity) {
+                        m_dirty_overflow = true;
+                        return;
+                    }
+                }
+
+                m_dirty_keys[m_dirty_count++] = key;
+            }
+
+            Result LoadWithJournal() {
+                /* Reset our journal state. */
+                this->SetJournalArchive(nullptr, 0);
+                m_archive_generation = 0;
+                m_journal_size = 0;
+                this->ClearDirtyKeys();
+
+                /* Read the journal -- as with the archive, no journal = no changes. */
+                AutoBuffer journal;
+                R_TRY_CATCH(this->ReadArchiveFile(std::addressof(journal), m_journal_path.Get())) {
+                    R_CATCH(fs::ResultPathNotFound) { /* ... */ }
+                } R_END_TRY_CATCH;
+
+                /* Load the archive, if there is one. */
+                {
+                    AutoBuffer archive;
+                    R_TRY_CATCH(this->ReadArchiveFile(std::addressof(archive), m_path.Get())) {
+                        R_CATCH(fs::ResultPathNotFound) {
+                            /* A compaction may have been interrupted after deleting the old archive. */
+                            R_TRY(this->ReadInterruptedArchive(std::addressof(archive), journal));
+                        }
+                    } R_END_TRY_CATCH;
+
+                    if (archive.Get() != nullptr) {
+                        R_TRY(this->LoadArchive(archive));
+                        this->SetJournalArchive(archive.Get(), archive.GetSize());
+                    }
+                }
+
+                /* Replay the journal over the archive. */
+                if (journal.Get() != nullptr) {
+                    R_TRY(this->ReplayJournal(journal));
+                }
+
+                R_SUCCEED();
+            }
+
+            Result ReadInterruptedArchive(AutoBuffer *out, AutoBuffer &journal) {
+                /* Read the temporary archive, if there is one. */
+                AutoBuffer archive;
+                R_TRY_CATCH(this->ReadArchiveFile(std::addressof(archive), m_temp_path.Get())) {
+                    R_CONVERT(fs::ResultPathNotFound, ResultSuccess());
+                } R_END_TRY_CATCH;
+
+                /* It may only be used if the journal records that it was completely written. */
+                u8 archive_hash[JournalArchiveHashSize];
+                crypto::GenerateSha256(archive_hash, sizeof(archive_hash), archive.Get(), archive.GetSize());
+                R_SUCCEED_IF(!this->HasJournalCompaction(journal, archive_hash));
+
+                /* Finish the interrupted compaction, so that the next one can't overwrite our only archive. */
+                R_TRY(fs::RenameFile(m_temp_path.Get(), m_path.Get()));
+
+                *out = std::move(archive);
+                R_SUCCEED();
+            }
+
+            bool HasJournalCompaction(AutoBuffer &journal, const u8 *archive_hash) {
+                JournalReader reader(journal);
+
+                u8 journal_archive_hash[JournalArchiveHashSize];
+                u32 journal_archive_generation;
+                if (R_FAILED(reader.ReadHeader(journal_archive_hash, sizeof(journal_archive_hash), std::addressof(journal_archive_generation)))) {
+                    return false;
+                }
+
+                while (reader.HasBatch()) {
+                    size_t entry_count = 0;
+                    if (R_FAILED(reader.ReadBatch(std::addressof(entry_count)))) {
+                        return false;
+                    }
+
+                    for (size_t i = 0; i < entry_count; i++) {
+                        JournalEntryType type;
+                        size_t key_size = 0, value_size = 0;
+                        if (R_FAILED(reader.GetEntryInfo(std::addressof(type), std::addressof(key_size), std::addressof(value_size)))) {
+                            return false;
+                        }
+
+                        if (type == JournalEntryType_Compaction) {
+                            u8 compacted_hash[JournalArchiveHashSize];
+                            if (R_SUCCEEDED(reader.ReadEntry(compacted_hash, sizeof(compacted_hash), nullptr, 0)) && crypto::IsSameBytes(compacted_hash, archive_hash, sizeof(compacted_hash))) {
+                                return true;
+                            }
+                        } else if (R_FAILED(reader.SkipEntry())) {
+                            return false;
+                        }
+                    }
+                }
+
+                return false;
+            }
+
+            Result ReplayJournal(AutoBuffer &journal) {
+                JournalReader reader(journal);
+
+                /* A journal written against a different archive was left behind by a compaction, so its changes are already in our archive. */
+                u8 archive_hash[JournalArchiveHashSize];
+                u32 archive_generation;
+                if (R_FAILED(reader.ReadHeader(archive_hash, sizeof(archive_hash), std::addressof(archive_generation)))) {
+                    R_SUCCEED();
+                }
+                R_SUCCEED_IF(archive_generation != m_archive_generation || !crypto::IsSameBytes(archive_hash, m_archive_hash, sizeof(archive_hash)));
+                m_journal_size = reader.GetOffset();
+
+                while (reader.HasBatch()) {
+                    /* A batch which doesn't validate was torn by an interrupted save; it and anything after it are discarded. */
+                    size_t entry_count = 0;
+                    if (R_FAILED(reader.ReadBatch(std::addressof(entry_count)))) {
+                        break;
+                    }
+
+                    for (size_t i = 0; i < entry_count; i++) {
+                        /* Get the entry's type and sizes. */
+                        JournalEntryType type;
+                        size_t key_size = 0, value_size = 0;
+                        R_TRY(reader.GetEntryInfo(std::addressof(type), std::addressof(key_size), std::addressof(value_size)));
+
+                        /* Compactions which didn't replace our archive have nothing to replay. */
+                        if (type == JournalEntryType_Compaction) {
+                            R_TRY(reader.SkipEntry());
+                            continue;
+                        }
+
+                        Key key;
+                        R_UNLESS(key_size == sizeof(Key), kvdb::ResultInvalidKeyValue());
+
+                        if (type == JournalEntryType_Remove) {
+                            R_TRY(reader.ReadEntry(std::addressof(key), sizeof(key), nullptr, 0));
+                            R_TRY_CATCH(m_index.Remove(key)) {
+                                R_CATCH(kvdb::ResultKeyNotFound) { /* ... */ }
+                            } R_END_TRY_CATCH;
+                        } else {
+                            /* Read the value into a temporary buffer, which the index will copy. */
+                            void *value = m_memory_resource->Allocate(value_size);
+                            R_UNLESS(value != nullptr, kvdb::ResultAllocationFailed());
+                            ON_SCOPE_EXIT { m_memory_resource->Deallocate(value, value_size); };
+
+                            R_TRY(reader.ReadEntry(std::addressof(key), sizeof(key), value, value_size));
+                            R_TRY(m_index.Set(key, value, value_size));
+                        }
+                    }
+
+                    /* The journal is valid up to the end of this batch. */
+                    m_journal_size = reader.GetOffset();
+                }
+
+                R_SUCCEED();
+            }
+
+            Result SaveWithJournal(bool destructive) {
+                /* If nothing has changed, there's nothing to save. */
+                R_SUCCEED_IF(!destructive && !m_dirty_overflow && m_dirty_count == 0);
+
+                /* Determine the size of a batch containing each changed key's current state. */
+                this->CompactDirtyKeys();
+
+                JournalSizeHelper size_helper;
+                if (m_journal_size == 0) {
+                    size_helper.AddHeader();
+                }
+                for (size_t i = 0; i < m_dirty_count; i++) {
+                    if (auto it = m_index.find(m_dirty_keys[i]); it != m_index.end()) {
+                        size_helper.AddSetEntry(sizeof(Key), it->GetValueSize());
+                    } else {
+                        size_helper.AddRemoveEntry(sizeof(Key));
+                    }
+                }
+
+                /* If we've lost track of changes, or the journal would outgrow the archive, fold everything into the archive instead. */
+                if (destructive || m_dirty_overflow || m_journal_size + size_helper.GetSize() > std::max(m_archive_size, JournalCompactionSizeMin)) {
+                    R_RETURN(this->CompactJournal());
+                }
+
+                /* Write the batch to a buffer. */
+                AutoBuffer buffer;
+                R_TRY(buffer.Initialize(size_helper.GetSize()));
+                {
+                    JournalWriter writer(buffer);
+                    if (m_journal_size == 0) {
+                        writer.WriteHeader(m_archive_hash, sizeof(m_archive_hash), m_archive_generation);
+                    }
+
+                    writer.BeginBatch();
+                    for (size_t i = 0; i < m_dirty_count; i++) {
+                        const auto &key = m_dirty_keys[i];
+                        if (auto it = m_index.find(key); it != m_index.end()) {
+                            writer.WriteSetEntry(std::addressof(key), sizeof(Key), it->GetValuePointer(), it->GetValueSize());
+                        } else {
+                            writer.WriteRemoveEntry(std::addressof(key), sizeof(Key));
+                        }
+                    }
+                    writer.EndBatch();
+                }
+
+                /* Append the batch to the journal. */
+                R_TRY(this->AppendJournal(buffer));
+
+                this->ClearDirtyKeys();
+                R_SUCCEED();
+            }
+
+            Result CompactJournal() {
+                /* Write the new archive to the temporary path, as the next generation. */
+                const u32 generation = m_archive_generation + 1;
+                AutoBuffer archive;
+                R_TRY(this->MakeArchive(std::addressof(archive), generation));
+                R_TRY(this->SaveArchiveToFile(m_temp_path.Get(), archive.Get(), archive.GetSize()));
+
+                /* Record that the new archive is complete, so that it can be recovered if we're interrupted once the old one is deleted. */
+                u8 archive_hash[JournalArchiveHashSize];
+                crypto::GenerateSha256(archive_hash, sizeof(archive_hash), archive.Get(), archive.GetSize());
+                {
+                    JournalSizeHelper size_helper;
+                    if (m_journal_size == 0) {
+                        size_helper.AddHeader();
+                    }
+                    size_helper.AddCompactionEntry();
+
+                    AutoBuffer buffer;
+                    R_TRY(buffer.Initialize(size_helper.GetSize()));
+
+                    JournalWriter writer(buffer);
+                    if (m_journal_size == 0) {
+                        writer.WriteHeader(m_archive_hash, sizeof(m_archive_hash), m_archive_generation);
+                    }
+                    writer.BeginBatch();
+                    writer.WriteCompactionEntry(archive_hash, sizeof(archive_hash));
+                    writer.EndBatch();
+
+                    R_TRY(this->AppendJournal(buffer));
+                }
+
+                /* Replace the archive. */
+                fs::DeleteFile(m_path.Get());
+                R_TRY(fs::RenameFile(m_temp_path.Get(), m_path.Get()));
+
+                /* The journal names the old archive, so it will be ignored even if we fail to delete it. */
+                fs::DeleteFile(m_journal_path.Get());
+
+                std::memcpy(m_archive_hash, archive_hash, sizeof(m_archive_hash));
+                m_archive_generation = generation;
+                m_archive_size = archive.GetSize();
+                m_journal_size = 0;
+                this->ClearDirtyKeys();
+                R_SUCCEED();
+            }
+
+            Result AppendJournal(const AutoBuffer &buffer) {
+                /* Create the journal, if we're starting a new one. */
+                if (m_journal_size == 0) {
+                    R_TRY_CATCH(fs::CreateFile(m_journal_path.Get(), 0)) {
+                        R_CATCH(fs::ResultPathAlreadyExists) { /* ... */ }
+                    } R_END_TRY_CATCH;
+                }
+
+                /* Write the buffer after the valid part of the journal, discarding anything past it, such as a torn batch. */
+                {
+                    fs::FileHandle file;
+                    R_TRY(fs::OpenFile(std::addressof(file), m_journal_path.Get(), fs::OpenMode_Write));
+                    ON_SCOPE_EXIT { fs::CloseFile(file); };
+
+                    R_TRY(fs::SetFileSize(file, m_journal_size + buffer.GetSize()));
+                    R_TRY(fs::WriteFile(file, m_journal_size, buffer.Get(), buffer.GetSize(), fs::WriteOption::Flush));
+                }
+
+                m_journal_size += buffer.GetSize();
+                R_SUCCEED();
+            }
     };
 
 }
\ No newline at end of file
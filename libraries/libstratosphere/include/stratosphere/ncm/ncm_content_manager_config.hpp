@@ -22,6 +22,7 @@ namespace ams::ncm {
         bool build_system_database;
         bool import_database_from_system_on_sd;
         bool enable_integrated_system_content;
+        bool enable_content_meta_database_journal;
 
         bool HasAnyConfig() const {
             return this->ShouldBuildDatabase() || this->import_database_from_system_on_sd || this->enable_integrated_system_content;
@@ -38,6 +39,10 @@ namespace ams::ncm {
         bool IsIntegratedSystemContentEnabled() const {
             return this->enable_integrated_system_content;
         }
+
+        bool IsContentMetaDatabaseJournalEnabled() const {
+            return this->enable_content_meta_database_journal;
+        }
     };
 
 }
@@ -153,8 +153,9 @@ namespace ams::ncm {
                 sf::SharedPointer<IContentMetaDatabase> content_meta_database;
                 ContentMetaMemoryResource *memory_resource;
                 u32 max_content_metas;
+                bool use_journal;
 
-                ContentMetaDatabaseRoot() : mount_name(), path(), storage_id(), storage_config(util::nullopt), save_data_info(util::nullopt), kvs(util::nullopt), content_meta_database(), memory_resource(), max_content_metas() { /* ... */ }
+                ContentMetaDatabaseRoot() : mount_name(), path(), storage_id(), storage_config(util::nullopt), save_data_info(util::nullopt), kvs(util::nullopt), content_meta_database(), memory_resource(), max_content_metas(), use_journal() { /* ... */ }
             };
 
             struct IntegratedContentMetaDatabaseRoot {
@@ -204,6 +205,7 @@ namespace ams::ncm {
             u32 m_num_content_meta_entries{0};
             u32 m_num_integrated_configs{0};
             u32 m_num_configs{0};
+            bool m_enable_content_meta_database_journal{false};
             RightsIdCache m_rights_id_cache{};
             RegisteredHostContent m_registered_host_content{};
         public:
@@ -23,4 +23,7 @@ namespace ams::patcher {
     /* Helper for applying to code binaries. */
     void LocateAndApplyIpsPatchesToModule(const char *mount_name, const char *patch_dir, size_t protected_size, size_t offset, const ro::ModuleId *module_id, u8 *mapped_module, size_t mapped_size);
 
+    /* Forgets the indexed patches, so that edits to them are picked up by the next module load. */
+    void InvalidateIpsPatchIndex();
+
 }
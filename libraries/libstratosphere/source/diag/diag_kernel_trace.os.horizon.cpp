@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams::diag {
+
+    namespace {
+
+        ALWAYS_INLINE const svc::KernelTraceBufferHeader *GetHeader(uintptr_t address) {
+            return reinterpret_cast<const svc::KernelTraceBufferHeader *>(address);
+        }
+
+        ALWAYS_INLINE svc::KernelTraceRingHeader *GetRingHeader(uintptr_t address, s32 ring) {
+            const auto *header = GetHeader(address);
+            return reinterpret_cast<svc::KernelTraceRingHeader *>(address + header->ring_offset + ring * header->ring_size);
+        }
+
+        ALWAYS_INLINE const svc::KernelTraceRecord *GetRecords(const svc::KernelTraceRingHeader *ring) {
+            return reinterpret_cast<const svc::KernelTraceRecord *>(ring + 1);
+        }
+
+    }
+
+    Result KernelTraceReader::Initialize() {
+        /* Find where the trace buffer is mapped. */
+        svc::Address address;
+        svc::Size size;
+        R_TRY(svc::QueryMemoryMapping(std::addressof(address), std::addressof(size), svc::MemoryRegionType_KernelTraceBuffer, 0));
+
+        /* Check that the kernel has laid the buffer out as rings. */
+        const auto *header = GetHeader(address);
+        R_UNLESS(size >= sizeof(*header),                                                  svc::ResultNotFound());
+        R_UNLESS(header->magic == svc::KernelTraceBufferHeader::Magic,                     svc::ResultNotFound());
+        R_UNLESS(header->ring_offset + header->num_rings * header->ring_size <= size,       svc::ResultNotFound());
+        R_UNLESS(header->record_count * sizeof(svc::KernelTraceRecord) + sizeof(svc::KernelTraceRingHeader) <= header->ring_size, svc::ResultNotFound());
+
+        m_address = address;
+        m_size    = size;
+        R_SUCCEED();
+    }
+
+    void KernelTraceReader::Finalize() {
+        if (m_address != 0) {
+            this->SetStreaming(false);
+            m_address = 0;
+            m_size    = 0;
+        }
+    }
+
+    s32 KernelTraceReader::GetRingCount() const {
+        AMS_ASSERT(m_address != 0);
+        return GetHeader(m_address)->num_rings;
+    }
+
+    u64 KernelTraceReader::GetTickFrequency() const {
+        AMS_ASSERT(m_address != 0);
+        return GetHeader(m_address)->tick_frequency;
+    }
+
+    void KernelTraceReader::SetStreaming(bool en) {
+        AMS_ASSERT(m_address != 0);
+
+        for (s32 i = 0; i < this->GetRingCount(); ++i) {
+            auto *ring = GetRingHeader(m_address, i);
+
+            const util::AtomicRef<u32> flags(ring->flags);
+            if (en) {
+                /* Skip anything already written, as it may be torn, and only then publish the flag. */
+                /* Otherwise, the kernel could see the flag with our stale read count, and drop records it needn't. */
+                util::AtomicRef<u64>(ring->read_count).Store<std::memory_order_release>(util::AtomicRef<u64>(ring->write_count).Load<std::memory_order_acquire>());
+                flags.Store<std::memory_order_release>(flags.Load() | svc::KernelTraceRingFlag_Streaming);
+            } else {
+                flags.Store(flags.Load() & ~svc::KernelTraceRingFlag_Streaming);
+            }
+        }
+
+        m_is_streaming = en;
+    }
+
+    size_t KernelTraceReader::Read(svc::KernelTraceRecord *out, size_t count, s32 ring_index) {
+        AMS_ASSERT(m_address != 0);
+        AMS_ASSERT(0 <= ring_index && ring_index < this->GetRingCount());
+
+        auto *ring = GetRingHeader(m_address, ring_index);
+        const auto *records = GetRecords(ring);
+        const u64 record_count = GetHeader(m_address)->record_count;
+
+        const util::AtomicRef<u64> read_count(ring->read_count);
+        const util::AtomicRef<u64> write_count(ring->write_count);
+
+        /* Determine the unread records, skipping any which have been overwritten. */
+        u64 read  = read_count.Load<std::memory_order_relaxed>();
+        u64 write = write_count.Load<std::memory_order_acquire>();
+        if (write - read > record_count) {
+            read = write - record_count;
+        }
+
+        /* Copy out the records. */
+        size_t num_read = static_cast<size_t>(std::min<u64>(write - read, count));
+        for (size_t i = 0; i < num_read; ++i) {
+            out[i] = records[(read + i) % record_count];
+        }
+
+        /* If we're not streaming, the kernel may have overwritten records while we were copying them. */
+        if (!m_is_streaming) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            const u64 new_write = write_count.Load<std::memory_order_relaxed>();
+            if (new_write - read > record_count) {
+                const size_t num_torn = std::min<size_t>(new_write - read - record_count, num_read);
+                std::memmove(out, out + num_torn, (num_read - num_torn) * sizeof(*out));
+                read     += num_torn;
+                num_read -= num_torn;
+            }
+        }
+
+        /* Note that we've consumed the records. */
+        read_count.Store<std::memory_order_release>(read + num_read);
+        return num_read;
+    }
+
+    u64 KernelTraceReader::GetDroppedCount(s32 ring_index) const {
+        AMS_ASSERT(m_address != 0);
+        AMS_ASSERT(0 <= ring_index && ring_index < this->GetRingCount());
+
+        return util::AtomicRef<u64>(GetRingHeader(m_address, ring_index)->drop_count).Load<std::memory_order_relaxed>();
+    }
+
+}
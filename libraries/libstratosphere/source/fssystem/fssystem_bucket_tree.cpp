@@ -111,6 +111,23 @@ namespace ams::fssystem {
                 }
         };
 
+        constinit std::atomic<size_t> g_node_cache_size = 0;
+
+        bool ReserveNodeCacheSize(size_t size) {
+            size_t cur_size = g_node_cache_size.load();
+            do {
+                if (cur_size + size > BucketTree::NodeCacheSizeMax) {
+                    return false;
+                }
+            } while (!g_node_cache_size.compare_exchange_weak(cur_size, cur_size + size));
+
+            return true;
+        }
+
+        void ReleaseNodeCacheSize(size_t size) {
+            g_node_cache_size -= size;
+        }
+
     }
 
     void BucketTree::Header::Format(s32 entry_count) {
@@ -210,6 +227,8 @@ namespace ams::fssystem {
 
     void BucketTree::Finalize() {
         if (this->IsInitialized()) {
+            this->ClearNodeCache();
+
             m_node_storage    = fs::SubStorage();
             m_entry_storage   = fs::SubStorage();
             m_node_l1.Free(m_node_size);
@@ -247,6 +266,9 @@ namespace ams::fssystem {
         /* Invalidate the entry storage cache. */
         R_TRY(m_entry_storage.OperateRange(fs::OperationId::Invalidate, 0, std::numeric_limits<s64>::max()));
 
+        /* Drop our cached nodes. */
+        this->ClearNodeCache();
+
         /* Reset our offsets. */
         m_offset_cache.is_initialized = false;
 
@@ -288,6 +310,95 @@ namespace ams::fssystem {
         R_SUCCEED();
     }
 
+    s32 BucketTree::FindCachedNode(CachedNodeKind kind, s32 index) const {
+        AMS_ASSERT(m_node_cache.mutex.IsLockedByCurrentThread());
+
+        for (s32 i = 0; i < NodeCacheCountMax; ++i) {
+            auto &cached = m_node_cache.nodes[i];
+            if (cached.is_valid && cached.kind == kind && cached.index == index) {
+                cached.last_access = ++m_node_cache.access_count;
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    void BucketTree::StoreCachedNode(CachedNodeKind kind, s32 index, const char *buffer) const {
+        std::scoped_lock lk(m_node_cache.mutex);
+
+        /* If another visitor cached the node first, we're done. */
+        if (this->FindCachedNode(kind, index) >= 0) {
+            return;
+        }
+
+        /* Find an empty slot, and the least recently used. */
+        s32 empty_slot = -1;
+        s32 lru_slot   = -1;
+        for (s32 i = 0; i < NodeCacheCountMax; ++i) {
+            const auto &cached = m_node_cache.nodes[i];
+            if (!cached.is_valid) {
+                if (empty_slot < 0) {
+                    empty_slot = i;
+                }
+            } else if (lru_slot < 0 || static_cast<s32>(cached.last_access - m_node_cache.nodes[lru_slot].last_access) < 0) {
+                lru_slot = i;
+            }
+        }
+
+        /* Give the empty slot a buffer. Every tree may always have its first slot, so that trees opened once the budget is spent still cache their hottest node; */
+        /* further slots must fit in the budget. Caching is best-effort, so otherwise we replace the least recently used node, or don't cache. */
+        s32 slot = lru_slot;
+        if (empty_slot >= 0) {
+            const bool is_guaranteed = empty_slot == GuaranteedNodeCacheSlot;
+            if (is_guaranteed || ReserveNodeCacheSize(m_node_size)) {
+                if (m_node_cache.nodes[empty_slot].buffer.Allocate(this->GetAllocator(), m_node_size)) {
+                    slot = empty_slot;
+                } else if (!is_guaranteed) {
+                    ReleaseNodeCacheSize(m_node_size);
+                }
+            }
+        }
+        if (slot < 0) {
+            return;
+        }
+
+        /* Copy the node, and note the range it covers. */
+        auto &cached = m_node_cache.nodes[slot];
+        NodeHeader header;
+        s64 start_offset;
+        std::memcpy(cached.buffer.Get(), buffer, m_node_size);
+        std::memcpy(std::addressof(header), buffer, NodeHeaderSize);
+        std::memcpy(std::addressof(start_offset), buffer + NodeHeaderSize, sizeof(s64));
+
+        cached.start_offset = start_offset;
+        cached.end_offset   = header.offset;
+        cached.index        = index;
+        cached.last_access  = ++m_node_cache.access_count;
+        cached.kind         = kind;
+        cached.is_valid     = true;
+
+        if (kind == CachedNodeKind::EntrySet) {
+            m_node_cache.last_entry_set_slot = slot;
+        }
+    }
+
+    void BucketTree::ClearNodeCache() {
+        std::scoped_lock lk(m_node_cache.mutex);
+
+        for (s32 i = 0; i < NodeCacheCountMax; ++i) {
+            auto &cached = m_node_cache.nodes[i];
+            if (cached.buffer.Get() != nullptr) {
+                cached.buffer.Free(m_node_size);
+                if (i != GuaranteedNodeCacheSlot) {
+                    ReleaseNodeCacheSize(m_node_size);
+                }
+            }
+            cached.is_valid = false;
+        }
+        m_node_cache.last_entry_set_slot = -1;
+    }
+
     Result BucketTree::Visitor::Initialize(const BucketTree *tree, const BucketTree::Offsets &offsets) {
         AMS_ASSERT(tree != nullptr);
         AMS_ASSERT(m_tree == nullptr || m_tree == tree);
@@ -316,11 +427,13 @@ namespace ams::fssystem {
 
             const auto end = m_entry_set.info.end;
 
-            const auto entry_set_size   = m_tree->m_node_size;
-            const auto entry_set_offset = entry_set_index * static_cast<s64>(entry_set_size);
+            if (!this->ReadEntrySetFromCache(std::addressof(m_entry_set), entry_set_index)) {
+                const auto entry_set_size   = m_tree->m_node_size;
+                const auto entry_set_offset = entry_set_index * static_cast<s64>(entry_set_size);
 
-            R_TRY(m_tree->m_entry_storage.Read(entry_set_offset, std::addressof(m_entry_set), sizeof(EntrySetHeader)));
-            R_TRY(m_entry_set.header.Verify(entry_set_index, entry_set_size, m_tree->m_entry_size));
+                R_TRY(m_tree->m_entry_storage.Read(entry_set_offset, std::addressof(m_entry_set), sizeof(EntrySetHeader)));
+                R_TRY(m_entry_set.header.Verify(entry_set_index, entry_set_size, m_tree->m_entry_size));
+            }
 
             R_UNLESS(m_entry_set.info.start == end && m_entry_set.info.start < m_entry_set.info.end, fs::ResultInvalidBucketTreeEntrySetOffset());
 
@@ -330,9 +443,11 @@ namespace ams::fssystem {
         }
 
         /* Read the new entry. */
-        const auto entry_size   = m_tree->m_entry_size;
-        const auto entry_offset = impl::GetBucketTreeEntryOffset(m_entry_set.info.index, m_tree->m_node_size, entry_size, entry_index);
-        R_TRY(m_tree->m_entry_storage.Read(entry_offset, m_entry, entry_size));
+        if (!this->ReadEntryFromCache(m_entry_set.info.index, entry_index)) {
+            const auto entry_size   = m_tree->m_entry_size;
+            const auto entry_offset = impl::GetBucketTreeEntryOffset(m_entry_set.info.index, m_tree->m_node_size, entry_size, entry_index);
+            R_TRY(m_tree->m_entry_storage.Read(entry_offset, m_entry, entry_size));
+        }
 
         /* Note that we changed index. */
         m_entry_index = entry_index;
@@ -351,12 +466,14 @@ namespace ams::fssystem {
 
             const auto start = m_entry_set.info.start;
 
-            const auto entry_set_size   = m_tree->m_node_size;
-            const auto entry_set_index  = m_entry_set.info.index - 1;
-            const auto entry_set_offset = entry_set_index * static_cast<s64>(entry_set_size);
+            const auto entry_set_index = m_entry_set.info.index - 1;
+            if (!this->ReadEntrySetFromCache(std::addressof(m_entry_set), entry_set_index)) {
+                const auto entry_set_size   = m_tree->m_node_size;
+                const auto entry_set_offset = entry_set_index * static_cast<s64>(entry_set_size);
 
-            R_TRY(m_tree->m_entry_storage.Read(entry_set_offset, std::addressof(m_entry_set), sizeof(EntrySetHeader)));
-            R_TRY(m_entry_set.header.Verify(entry_set_index, entry_set_size, m_tree->m_entry_size));
+                R_TRY(m_tree->m_entry_storage.Read(entry_set_offset, std::addressof(m_entry_set), sizeof(EntrySetHeader)));
+                R_TRY(m_entry_set.header.Verify(entry_set_index, entry_set_size, m_tree->m_entry_size));
+            }
 
             R_UNLESS(m_entry_set.info.end == start && m_entry_set.info.start < m_entry_set.info.end, fs::ResultInvalidBucketTreeEntrySetOffset());
 
@@ -368,9 +485,11 @@ namespace ams::fssystem {
         --entry_index;
 
         /* Read the new entry. */
-        const auto entry_size   = m_tree->m_entry_size;
-        const auto entry_offset = impl::GetBucketTreeEntryOffset(m_entry_set.info.index, m_tree->m_node_size, entry_size, entry_index);
-        R_TRY(m_tree->m_entry_storage.Read(entry_offset, m_entry, entry_size));
+        if (!this->ReadEntryFromCache(m_entry_set.info.index, entry_index)) {
+            const auto entry_size   = m_tree->m_entry_size;
+            const auto entry_offset = impl::GetBucketTreeEntryOffset(m_entry_set.info.index, m_tree->m_node_size, entry_size, entry_index);
+            R_TRY(m_tree->m_entry_storage.Read(entry_offset, m_entry, entry_size));
+        }
 
         /* Note that we changed index. */
         m_entry_index = entry_index;
@@ -384,6 +503,12 @@ namespace ams::fssystem {
         const auto * const node = m_tree->m_node_l1.Get<Node>();
         R_UNLESS(virtual_address < node->GetEndOffset(), fs::ResultOutOfRange());
 
+        /* Lookups tend to move forward through the tree, so first try the entry set the last lookup found (or the one after it). */
+        if (this->FindEntryInLastEntrySet(virtual_address)) {
+            m_entry_set_count = m_tree->m_entry_set_count;
+            R_SUCCEED();
+        }
+
         /* Get the entry set index. */
         s32 entry_set_index = -1;
         if (m_tree->IsExistOffsetL2OnL1() && virtual_address < node->GetBeginOffset()) {
@@ -425,6 +550,9 @@ namespace ams::fssystem {
     }
 
     Result BucketTree::Visitor::FindEntrySet(s32 *out_index, s64 virtual_address, s32 node_index) {
+        /* Check if the node is cached. */
+        R_SUCCEED_IF(this->FindEntrySetInCache(out_index, virtual_address, node_index));
+
         const auto node_size = m_tree->m_node_size;
 
         PooledBuffer pool(node_size, 1);
@@ -450,6 +578,9 @@ namespace ams::fssystem {
         std::memcpy(std::addressof(header), buffer, NodeHeaderSize);
         R_TRY(header.Verify(node_index, node_size, sizeof(s64)));
 
+        /* Cache the node for later lookups. */
+        m_tree->StoreCachedNode(CachedNodeKind::OffsetNode, node_index, buffer);
+
         /* Create the node, and find. */
         StorageNode node(sizeof(s64), header.count);
         node.Find(buffer, virtual_address);
@@ -482,6 +613,9 @@ namespace ams::fssystem {
     }
 
     Result BucketTree::Visitor::FindEntry(s64 virtual_address, s32 entry_set_index) {
+        /* Check if the entry set is cached. */
+        R_SUCCEED_IF(this->FindEntryInCache(virtual_address, entry_set_index));
+
         const auto entry_set_size = m_tree->m_node_size;
 
         PooledBuffer pool(entry_set_size, 1);
@@ -508,6 +642,9 @@ namespace ams::fssystem {
         std::memcpy(std::addressof(entry_set), buffer, sizeof(EntrySetHeader));
         R_TRY(entry_set.header.Verify(entry_set_index, entry_set_size, entry_size));
 
+        /* Cache the entry set for later lookups. */
+        m_tree->StoreCachedNode(CachedNodeKind::EntrySet, entry_set_index, buffer);
+
         /* Create the node, and find. */
         StorageNode node(entry_size, entry_set.info.count);
         node.Find(buffer, virtual_address);
@@ -554,4 +691,150 @@ namespace ams::fssystem {
         R_SUCCEED();
     }
 
+    bool BucketTree::Visitor::FindEntryInLastEntrySet(s64 virtual_address) {
+        /* Don't take the cache's lock if there's nothing cached. */
+        if (!m_tree->HasCachedEntrySet()) {
+            return false;
+        }
+
+        auto &cache = m_tree->m_node_cache;
+        std::scoped_lock lk(cache.mutex);
+
+        /* Check that we have a last entry set. */
+        const s32 last_slot = cache.last_entry_set_slot;
+        if (last_slot < 0 || !cache.nodes[last_slot].is_valid || cache.nodes[last_slot].kind != CachedNodeKind::EntrySet) {
+            return false;
+        }
+
+        /* Check the last entry set, and if we've moved past it, the next. */
+        const auto &last = cache.nodes[last_slot];
+        s32 slot = -1;
+        if (last.start_offset <= virtual_address && virtual_address < last.end_offset) {
+            slot = last_slot;
+        } else if (last.end_offset <= virtual_address) {
+            slot = m_tree->FindCachedNode(CachedNodeKind::EntrySet, last.index + 1);
+            if (slot >= 0 && !(cache.nodes[slot].start_offset <= virtual_address && virtual_address < cache.nodes[slot].end_offset)) {
+                slot = -1;
+            }
+        }
+
+        return slot >= 0 && this->FindEntryInCachedNode(virtual_address, slot);
+    }
+
+    bool BucketTree::Visitor::FindEntrySetInCache(s32 *out_index, s64 virtual_address, s32 node_index) {
+        if (!m_tree->HasCachedEntrySet()) {
+            return false;
+        }
+
+        auto &cache = m_tree->m_node_cache;
+        std::scoped_lock lk(cache.mutex);
+
+        /* Find the node. */
+        const s32 slot = m_tree->FindCachedNode(CachedNodeKind::OffsetNode, node_index);
+        if (slot < 0) {
+            return false;
+        }
+
+        /* The node was verified when it was cached, so we can just find. */
+        const char *buffer = reinterpret_cast<const char *>(cache.nodes[slot].buffer.Get());
+
+        NodeHeader header;
+        std::memcpy(std::addressof(header), buffer, NodeHeaderSize);
+
+        StorageNode node(sizeof(s64), header.count);
+        node.Find(buffer, virtual_address);
+        if (node.GetIndex() < 0) {
+            return false;
+        }
+
+        *out_index = m_tree->GetEntrySetIndex(header.index, node.GetIndex());
+        return true;
+    }
+
+    bool BucketTree::Visitor::FindEntryInCache(s64 virtual_address, s32 entry_set_index) {
+        if (!m_tree->HasCachedEntrySet()) {
+            return false;
+        }
+
+        auto &cache = m_tree->m_node_cache;
+        std::scoped_lock lk(cache.mutex);
+
+        /* Find the entry set. */
+        const s32 slot = m_tree->FindCachedNode(CachedNodeKind::EntrySet, entry_set_index);
+
+        return slot >= 0 && this->FindEntryInCachedNode(virtual_address, slot);
+    }
+
+    bool BucketTree::Visitor::FindEntryInCachedNode(s64 virtual_address, s32 slot) {
+        auto &cache = m_tree->m_node_cache;
+        AMS_ASSERT(cache.mutex.IsLockedByCurrentThread());
+
+        /* The entry set was verified when it was cached, so we can just find. */
+        auto &cached = cache.nodes[slot];
+        const char *buffer = reinterpret_cast<const char *>(cached.buffer.Get());
+
+        EntrySetHeader entry_set;
+        std::memcpy(std::addressof(entry_set), buffer, sizeof(EntrySetHeader));
+
+        const auto entry_size = m_tree->m_entry_size;
+        StorageNode node(entry_size, entry_set.info.count);
+        node.Find(buffer, virtual_address);
+        if (node.GetIndex() < 0) {
+            return false;
+        }
+
+        /* Copy the data into entry. */
+        const auto entry_index  = node.GetIndex();
+        const auto entry_offset = impl::GetBucketTreeEntryOffset(0, entry_size, entry_index);
+        std::memcpy(m_entry, buffer + entry_offset, entry_size);
+
+        /* Set our entry set/index. */
+        m_entry_set   = entry_set;
+        m_entry_index = entry_index;
+
+        /* Note that the entry set is the last we found. */
+        cached.last_access        = ++cache.access_count;
+        cache.last_entry_set_slot = slot;
+
+        return true;
+    }
+
+    bool BucketTree::Visitor::ReadEntrySetFromCache(EntrySetHeader *out, s32 entry_set_index) {
+        if (!m_tree->HasCachedEntrySet()) {
+            return false;
+        }
+
+        auto &cache = m_tree->m_node_cache;
+        std::scoped_lock lk(cache.mutex);
+
+        /* Find the entry set. */
+        const s32 slot = m_tree->FindCachedNode(CachedNodeKind::EntrySet, entry_set_index);
+        if (slot < 0) {
+            return false;
+        }
+
+        std::memcpy(out, cache.nodes[slot].buffer.Get(), sizeof(EntrySetHeader));
+        return true;
+    }
+
+    bool BucketTree::Visitor::ReadEntryFromCache(s32 entry_set_index, s32 entry_index) {
+        if (!m_tree->HasCachedEntrySet()) {
+            return false;
+        }
+
+        auto &cache = m_tree->m_node_cache;
+        std::scoped_lock lk(cache.mutex);
+
+        /* Find the entry set. */
+        const s32 slot = m_tree->FindCachedNode(CachedNodeKind::EntrySet, entry_set_index);
+        if (slot < 0) {
+            return false;
+        }
+
+        const auto entry_size   = m_tree->m_entry_size;
+        const auto entry_offset = impl::GetBucketTreeEntryOffset(0, entry_size, entry_index);
+        std::memcpy(m_entry, reinterpret_cast<const char *>(cache.nodes[slot].buffer.Get()) + entry_offset, entry_size);
+        return true;
+    }
+
 }
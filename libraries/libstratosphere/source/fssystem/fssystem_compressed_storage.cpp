@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams::fssystem {
+
+    namespace {
+
+        constinit std::atomic<size_t> g_block_cache_hit_count;
+        constinit std::atomic<size_t> g_block_cache_miss_count;
+
+    }
+
+    namespace impl {
+
+        void CountCompressedStorageBlockCacheAccess(bool is_hit) {
+            if (is_hit) {
+                g_block_cache_hit_count++;
+            } else {
+                g_block_cache_miss_count++;
+            }
+        }
+
+    }
+
+    size_t GetCompressedStorageBlockCacheHitCount() {
+        return g_block_cache_hit_count;
+    }
+
+    size_t GetCompressedStorageBlockCacheMissCount() {
+        return g_block_cache_miss_count;
+    }
+
+    void ClearCompressedStorageBlockCacheCount() {
+        g_block_cache_hit_count  = 0;
+        g_block_cache_miss_count = 0;
+    }
+
+}
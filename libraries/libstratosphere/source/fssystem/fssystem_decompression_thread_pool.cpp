@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams::fssystem {
+
+    namespace {
+
+        struct DecompressionBatch : public util::IntrusiveListBaseNode<DecompressionBatch> {
+            DecompressionTask *tasks;
+            s32 count;
+            s32 next_index;
+            s32 remaining_count;
+
+            DecompressionBatch(DecompressionTask *t, s32 c) : tasks(t), count(c), next_index(0), remaining_count(c) { /* ... */ }
+        };
+
+        class DecompressionThreadPool {
+            NON_COPYABLE(DecompressionThreadPool);
+            NON_MOVEABLE(DecompressionThreadPool);
+            private:
+                using BatchList = util::IntrusiveListBaseTraits<DecompressionBatch>::ListType;
+            private:
+                os::ThreadType m_threads[DecompressionWorkerCountMax];
+                s32 m_thread_count;
+                os::SdkMutex m_mutex;
+                os::SdkConditionVariable m_work_cv;
+                os::SdkConditionVariable m_done_cv;
+                BatchList m_pending_batches;
+            public:
+                constexpr DecompressionThreadPool() : m_threads(), m_thread_count(0), m_mutex(), m_work_cv(), m_done_cv(), m_pending_batches() { /* ... */ }
+
+                void Initialize(void *stacks, size_t stacks_size, s32 priority) {
+                    /* Check pre-conditions. */
+                    AMS_ASSERT(m_thread_count == 0);
+                    AMS_ASSERT(util::IsAligned(reinterpret_cast<uintptr_t>(stacks), os::ThreadStackAlignment));
+
+                    /* Determine the cores we may use. */
+                    s32 cores[BITSIZEOF(u64)];
+                    s32 core_count = 0;
+                    for (u64 core_mask = os::GetThreadAvailableCoreMask(); core_mask != 0; core_mask &= core_mask - 1) {
+                        cores[core_count++] = util::CountTrailingZeros(core_mask);
+                    }
+                    AMS_ABORT_UNLESS(core_count > 0);
+
+                    /* Create and start our workers, one per core in turn. */
+                    const s32 thread_count = std::min<s32>(stacks_size / DecompressionWorkerStackSize, DecompressionWorkerCountMax);
+                    for (s32 i = 0; i < thread_count; ++i) {
+                        void * const stack = static_cast<u8 *>(stacks) + i * DecompressionWorkerStackSize;
+                        R_ABORT_UNLESS(os::CreateThread(std::addressof(m_threads[i]), WorkerThreadFunction, this, stack, DecompressionWorkerStackSize, priority, cores[i % core_count]));
+                        os::SetThreadNamePointer(std::addressof(m_threads[i]), AMS_GET_SYSTEM_THREAD_NAME(fs, DecompressionWorker));
+                        os::StartThread(std::addressof(m_threads[i]));
+                    }
+
+                    m_thread_count = thread_count;
+                }
+
+                bool IsEnabled() const {
+                    return m_thread_count > 0;
+                }
+
+                void Run(DecompressionTask *tasks, s32 count) {
+                    /* Submit the batch to our workers. */
+                    DecompressionBatch batch(tasks, count);
+                    {
+                        std::scoped_lock lk(m_mutex);
+                        m_pending_batches.push_back(batch);
+                        m_work_cv.Broadcast();
+                    }
+
+                    /* Take tasks from our own batch too, until every task has been taken. */
+                    while (true) {
+                        DecompressionTask *task = nullptr;
+                        {
+                            std::scoped_lock lk(m_mutex);
+                            if (batch.next_index < batch.count) {
+                                task = this->TakeTask(batch);
+                            }
+                        }
+
+                        if (task == nullptr) {
+                            break;
+                        }
+
+                        this->RunTask(batch, task);
+                    }
+
+                    /* Wait for the workers to finish the tasks they took. */
+                    std::scoped_lock lk(m_mutex);
+                    while (batch.remaining_count > 0) {
+                        m_done_cv.Wait(m_mutex);
+                    }
+                }
+            private:
+                static void WorkerThreadFunction(void *arg) {
+                    static_cast<DecompressionThreadPool *>(arg)->WorkerThreadBody();
+                }
+
+                void WorkerThreadBody() {
+                    while (true) {
+                        /* Wait for a task, taking batches in submission order. */
+                        DecompressionBatch *batch;
+                        DecompressionTask *task;
+                        {
+                            std::scoped_lock lk(m_mutex);
+                            while (m_pending_batches.empty()) {
+                                m_work_cv.Wait(m_mutex);
+                            }
+
+                            batch = std::addressof(m_pending_batches.front());
+                            task  = this->TakeTask(*batch);
+                        }
+
+                        this->RunTask(*batch, task);
+                    }
+                }
+
+                DecompressionTask *TakeTask(DecompressionBatch &batch) {
+                    /* Check pre-conditions. */
+                    AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
+                    AMS_ASSERT(batch.next_index < batch.count);
+
+                    /* Take the next task, and stop offering the batch once all its tasks are taken. */
+                    DecompressionTask *task = batch.tasks + batch.next_index++;
+                    if (batch.next_index == batch.count) {
+                        m_pending_batches.erase(m_pending_batches.iterator_to(batch));
+                    }
+
+                    return task;
+                }
+
+                void RunTask(DecompressionBatch &batch, DecompressionTask *task) {
+                    /* Decompress. */
+                    task->result = task->decompressor(task->dst, task->dst_size, task->src, task->src_size);
+
+                    /* Note that the task is done, waking the submitter if it was the last. */
+                    std::scoped_lock lk(m_mutex);
+                    if ((--batch.remaining_count) == 0) {
+                        m_done_cv.Broadcast();
+                    }
+                }
+        };
+
+        constinit DecompressionThreadPool g_decompression_thread_pool;
+
+    }
+
+    void InitializeDecompressionThreadPool(void *stacks, size_t stacks_size, s32 priority) {
+        g_decompression_thread_pool.Initialize(stacks, stacks_size, priority);
+    }
+
+    bool IsDecompressionThreadPoolEnabled() {
+        return g_decompression_thread_pool.IsEnabled();
+    }
+
+    Result DecompressInParallel(DecompressionTask *tasks, s32 count) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(tasks != nullptr || count == 0);
+        AMS_ASSERT(count >= 0);
+
+        /* Run the tasks. A single task gains nothing from the workers. */
+        if (count > 1 && g_decompression_thread_pool.IsEnabled()) {
+            g_decompression_thread_pool.Run(tasks, count);
+        } else {
+            for (s32 i = 0; i < count; ++i) {
+                tasks[i].result = tasks[i].decompressor(tasks[i].dst, tasks[i].dst_size, tasks[i].src, tasks[i].src_size);
+            }
+        }
+
+        /* Report the first failure, as decompressing the entries one at a time would have. */
+        for (s32 i = 0; i < count; ++i) {
+            R_TRY(tasks[i].result);
+        }
+
+        R_SUCCEED();
+    }
+
+}
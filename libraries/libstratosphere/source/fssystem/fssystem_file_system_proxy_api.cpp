@@ -74,6 +74,12 @@ namespace ams::fssystem {
 
         alignas(os::MemoryPageSize) constinit u8 g_buffer_pool[BufferPoolSize] = {};
 
+        constexpr size_t DecompressionWorkerCount = 3;
+        alignas(os::ThreadStackAlignment) constinit u8 g_decompression_worker_stacks[DecompressionWorkerCount * fssystem::DecompressionWorkerStackSize] = {};
+
+        alignas(os::ThreadStackAlignment) constinit u8 g_read_ahead_worker_stack[fssystem::ReadAheadWorkerStackSize] = {};
+        alignas(os::MemoryPageSize) constinit u8 g_read_ahead_buffer[fssystem::ReadAheadBufferSize] = {};
+
         constinit util::TypedStorage<mem::StandardAllocator> g_buffer_allocator = {};
         constinit util::TypedStorage<fssrv::MemoryResourceFromStandardAllocator> g_allocator = {};
 
@@ -137,6 +143,12 @@ namespace ams::fssystem {
 
         /* TODO FS-REIMPL: Create Pooled Threads/Stack Usage Reporter, fssystem::RegisterThreadPool. */
 
+        /* Start the workers which decompress compressed storage blocks in parallel. */
+        fssystem::InitializeDecompressionThreadPool(g_decompression_worker_stacks, sizeof(g_decompression_worker_stacks), AMS_GET_SYSTEM_THREAD_PRIORITY(fs, DecompressionWorker));
+
+        /* Start the worker which reads ahead of sequential reads from nca storages. */
+        fssystem::InitializeReadAheadWorker(g_read_ahead_worker_stack, sizeof(g_read_ahead_worker_stack), g_read_ahead_buffer, sizeof(g_read_ahead_buffer), AMS_GET_SYSTEM_THREAD_PRIORITY(fs, ReadAheadWorker));
+
         /* TODO FS-REIMPL: fssrv::GetFileSystemProxyServices(), some service creation. */
 
         /* Initialize fs creators. */
@@ -284,4 +296,47 @@ namespace ams::fssystem {
         return std::addressof(g_fs_creator_interfaces);
     }
 
+    void GetAndClearMemoryReportInfo(fs::MemoryReportInfo *out) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(out != nullptr);
+        AMS_ASSERT(g_exp_heap_handle != nullptr);
+
+        /* TODO FS-REIMPL: Buffer pool and patrol read statistics. */
+        *out = {};
+
+        /* Get and clear our exp heap statistics. */
+        {
+            auto scoped_lock = g_exp_allocator.GetScopedLock();
+
+            out->exp_heap_peak_free_size = g_exp_allocator.GetPeakFreeSize();
+            g_exp_allocator.ClearPeak();
+        }
+
+        /* Get and clear our pooled buffer statistics. */
+        out->pooled_buffer_peak_free_size          = fssystem::GetPooledBufferFreeSizePeak();
+        out->pooled_buffer_retried_count           = fssystem::GetPooledBufferRetriedCount();
+        out->pooled_buffer_reduce_allocation_count = fssystem::GetPooledBufferReduceAllocationCount();
+        fssystem::ClearPooledBufferPeak();
+
+        /* Get and clear our buffer manager statistics. */
+        auto &buffer_manager = GetReference(g_buffer_manager);
+        out->buffer_manager_peak_free_size              = buffer_manager.GetFreeSizePeak();
+        out->buffer_manager_retried_count               = buffer_manager.GetRetriedCount();
+        out->buffer_manager_peak_total_allocatable_size = buffer_manager.GetTotalAllocatableSizePeak();
+        buffer_manager.ClearPeak();
+    }
+
+    void GetAndClearMemoryReportInfo(fs::MemoryReportInfo *out, MemoryReportInfoForAtmosphere *out_ams) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(out_ams != nullptr);
+
+        /* Get and clear the standard statistics. */
+        GetAndClearMemoryReportInfo(out);
+
+        /* Get and clear our compressed storage block cache statistics. */
+        out_ams->compressed_storage_block_cache_hit_count  = fssystem::GetCompressedStorageBlockCacheHitCount();
+        out_ams->compressed_storage_block_cache_miss_count = fssystem::GetCompressedStorageBlockCacheMissCount();
+        fssystem::ClearCompressedStorageBlockCacheCount();
+    }
+
 }
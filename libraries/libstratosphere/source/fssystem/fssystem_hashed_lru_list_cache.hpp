@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <stratosphere.hpp>
+
+namespace ams::fssystem {
+
+    template<typename Key>
+    struct HashedLruListCacheKeyTraits {
+        static_assert(std::integral<Key>);
+
+        static constexpr ALWAYS_INLINE u64 Hash(const Key &key) {
+            /* Fibonacci hashing; callers use the high bits of the result. */
+            return static_cast<u64>(key) * UINT64_C(0x9E3779B97F4A7C15);
+        }
+
+        static constexpr ALWAYS_INLINE bool IsIndexable(const Key &key) {
+            /* Negative keys are used as placeholders for empty nodes (e.g. -1), and are never looked up. */
+            if constexpr (std::signed_integral<Key>) {
+                return key >= 0;
+            } else {
+                return true;
+            }
+        }
+    };
+
+    /* LruListCache with an intrusive open-addressing index over the node keys, giving O(1) lookup. */
+    /* Node ownership and LRU semantics are identical to LruListCache, so the two are interchangeable. */
+    template<typename Key, typename Value, typename KeyTraits = HashedLruListCacheKeyTraits<Key>>
+    class HashedLruListCache {
+        NON_COPYABLE(HashedLruListCache);
+        NON_MOVEABLE(HashedLruListCache);
+        private:
+            static constexpr size_t InvalidSlot      = std::numeric_limits<size_t>::max();
+            static constexpr size_t MinimumIndexSize = 0x10;
+        public:
+            class Node : public ::ams::fs::impl::Newable {
+                NON_COPYABLE(Node);
+                NON_MOVEABLE(Node);
+                friend class HashedLruListCache;
+                public:
+                    Key m_key;
+                    Value m_value;
+                    util::IntrusiveListNode m_mru_list_node;
+                private:
+                    size_t m_index_slot;
+                public:
+                    explicit Node(const Value &value) : m_value(value), m_index_slot(InvalidSlot) { /* ... */ }
+            };
+        private:
+            using MruList = typename util::IntrusiveListMemberTraits<&Node::m_mru_list_node>::ListType;
+            using IndexBuffer = std::unique_ptr<Node *[], ::ams::fs::impl::Deleter>;
+        private:
+            MruList m_mru_list;
+            IndexBuffer m_index;
+            size_t m_index_size;
+            s32 m_index_shift;
+            size_t m_node_count;
+            size_t m_indexed_count;
+        public:
+            HashedLruListCache() : m_mru_list(), m_index(), m_index_size(0), m_index_shift(BITSIZEOF(u64)), m_node_count(0), m_indexed_count(0) { /* ... */ }
+
+            bool FindValueAndUpdateMru(Value *out, const Key &key) {
+                /* Check that the key can be present in the index. */
+                if (!KeyTraits::IsIndexable(key) || m_index_size == 0) {
+                    return false;
+                }
+
+                /* Probe for the key. */
+                for (size_t slot = this->GetHomeSlot(key); m_index[slot] != nullptr; slot = this->GetNextSlot(slot)) {
+                    Node *node = m_index[slot];
+                    if (node->m_key == key) {
+                        *out = node->m_value;
+
+                        m_mru_list.erase(m_mru_list.iterator_to(*node));
+                        m_mru_list.push_front(*node);
+
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            std::unique_ptr<Node> PopLruNode() {
+                AMS_ABORT_UNLESS(!m_mru_list.empty());
+                Node *lru = std::addressof(*m_mru_list.rbegin());
+                m_mru_list.pop_back();
+                --m_node_count;
+
+                /* Remove the node from the index. */
+                if (lru->m_index_slot != InvalidSlot) {
+                    this->RemoveFromIndex(lru);
+                }
+
+                return std::unique_ptr<Node>(lru);
+            }
+
+            void PushMruNode(std::unique_ptr<Node> &&node, const Key &key) {
+                AMS_ASSERT(node->m_index_slot == InvalidSlot);
+
+                /* Grow the index before the node is linked, so that it isn't re-indexed twice. */
+                ++m_node_count;
+                this->EnsureIndexCapacity();
+
+                node->m_key = key;
+                m_mru_list.push_front(*node);
+
+                /* Index the node, if we can. If we can't, lookups for it will simply miss. */
+                if (KeyTraits::IsIndexable(key) && m_indexed_count + 1 < m_index_size) {
+                    this->InsertToIndex(node.get());
+                }
+
+                node.release();
+            }
+
+            void DeleteAllNodes() {
+                while (!m_mru_list.empty()) {
+                    Node *lru = std::addressof(*m_mru_list.rbegin());
+                    m_mru_list.erase(m_mru_list.iterator_to(*lru));
+                    delete lru;
+                }
+
+                m_index.reset();
+                m_index_size    = 0;
+                m_index_shift   = BITSIZEOF(u64);
+                m_node_count    = 0;
+                m_indexed_count = 0;
+            }
+
+            size_t GetSize() const {
+                return m_node_count;
+            }
+
+            bool IsEmpty() const {
+                return m_mru_list.empty();
+            }
+        private:
+            size_t GetHomeSlot(const Key &key) const {
+                return static_cast<size_t>(KeyTraits::Hash(key) >> m_index_shift);
+            }
+
+            size_t GetNextSlot(size_t slot) const {
+                return (slot + 1) & (m_index_size - 1);
+            }
+
+            void InsertToIndex(Node *node) {
+                size_t slot = this->GetHomeSlot(node->m_key);
+                while (m_index[slot] != nullptr) {
+                    slot = this->GetNextSlot(slot);
+                }
+
+                m_index[slot]      = node;
+                node->m_index_slot = slot;
+                ++m_indexed_count;
+            }
+
+            void RemoveFromIndex(Node *node) {
+                /* Clear the node's slot. */
+                size_t hole = node->m_index_slot;
+                AMS_ASSERT(m_index[hole] == node);
+                m_index[hole]      = nullptr;
+                node->m_index_slot = InvalidSlot;
+                --m_indexed_count;
+
+                /* Shift back any following entries whose probe sequence passes through the hole. */
+                for (size_t slot = this->GetNextSlot(hole); m_index[slot] != nullptr; slot = this->GetNextSlot(slot)) {
+                    Node *cur = m_index[slot];
+
+                    const size_t mask = m_index_size - 1;
+                    const size_t home = this->GetHomeSlot(cur->m_key);
+                    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+                        m_index[hole]     = cur;
+                        cur->m_index_slot = hole;
+                        m_index[slot]     = nullptr;
+                        hole              = slot;
+                    }
+                }
+            }
+
+            void EnsureIndexCapacity() {
+                /* Keep the load factor at or below one half of the total node count. */
+                if (m_node_count * 2 <= m_index_size) {
+                    return;
+                }
+
+                /* Allocate a larger index. */
+                const size_t new_size = std::max(MinimumIndexSize, util::CeilingPowerOfTwo(m_node_count * 2));
+                auto new_index = ::ams::fs::impl::MakeUnique<Node *[]>(new_size);
+                if (new_index == nullptr) {
+                    /* We'll continue to use the existing index, if any. */
+                    return;
+                }
+                std::memset(new_index.get(), 0, sizeof(Node *) * new_size);
+
+                /* Swap in the new index. */
+                m_index         = std::move(new_index);
+                m_index_size    = new_size;
+                m_index_shift   = BITSIZEOF(u64) - util::CountTrailingZeros(new_size);
+                m_indexed_count = 0;
+
+                /* Re-index all indexable nodes. */
+                for (auto &node : m_mru_list) {
+                    node.m_index_slot = InvalidSlot;
+                    if (KeyTraits::IsIndexable(node.m_key) && m_indexed_count + 1 < m_index_size) {
+                        this->InsertToIndex(std::addressof(node));
+                    }
+                }
+            }
+    };
+
+}
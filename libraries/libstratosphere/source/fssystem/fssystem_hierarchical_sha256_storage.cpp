@@ -104,19 +104,31 @@ namespace ams::fssystem {
         auto cur_offset     = offset;
         auto remaining_size = reduced_size;
         while (remaining_size > 0) {
-            /* Generate the hash of the region we're validating. */
-            u8 hash[HashSize];
-            const auto cur_size = static_cast<size_t>(std::min<s64>(m_hash_target_block_size, remaining_size));
-            m_hash_generator_factory->GenerateHash(hash, sizeof(hash), static_cast<u8 *>(buffer) + (cur_offset - offset), cur_size);
+            /* Generate the hashes of the region we're validating. */
+            /* Whole blocks are hashed several at a time, which the hash generator may do in parallel; a trailing partial block is hashed alone. */
+            u8 hashes[VerifyBlockCountMax][HashSize];
+            const auto block_size = static_cast<size_t>(m_hash_target_block_size);
+            size_t block_count, cur_size;
+            if (remaining_size >= block_size) {
+                block_count = std::min(remaining_size / block_size, VerifyBlockCountMax);
+                cur_size    = block_size * block_count;
+                m_hash_generator_factory->GenerateHashForBlocks(hashes, sizeof(hashes), static_cast<u8 *>(buffer) + (cur_offset - offset), block_size, block_count);
+            } else {
+                block_count = 1;
+                cur_size    = remaining_size;
+                m_hash_generator_factory->GenerateHash(hashes[0], sizeof(hashes[0]), static_cast<u8 *>(buffer) + (cur_offset - offset), cur_size);
+            }
 
-            AMS_ASSERT(static_cast<size_t>(cur_offset >> m_log_size_ratio) < m_hash_buffer_size);
+            AMS_ASSERT(static_cast<size_t>((cur_offset + block_size * (block_count - 1)) >> m_log_size_ratio) < m_hash_buffer_size);
 
-            /* Check the hash. */
+            /* Check the hashes. */
             {
                 std::scoped_lock lk(m_mutex);
                 auto clear_guard = SCOPE_GUARD { std::memset(buffer, 0, size); };
 
-                R_UNLESS(crypto::IsSameBytes(hash, std::addressof(m_hash_buffer[cur_offset >> m_log_size_ratio]), HashSize), fs::ResultHierarchicalSha256HashVerificationFailed());
+                for (size_t i = 0; i < block_count; ++i) {
+                    R_UNLESS(crypto::IsSameBytes(hashes[i], std::addressof(m_hash_buffer[(cur_offset + block_size * i) >> m_log_size_ratio]), HashSize), fs::ResultHierarchicalSha256HashVerificationFailed());
+                }
 
                 clear_guard.Cancel();
             }
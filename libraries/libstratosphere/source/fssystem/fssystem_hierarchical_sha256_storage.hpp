@@ -25,6 +25,7 @@ namespace ams::fssystem {
         public:
             static constexpr s32 LayerCount  = 3;
             static constexpr size_t HashSize = crypto::Sha256Generator::HashSize;
+            static constexpr size_t VerifyBlockCountMax = 8;
         private:
             BaseStorageType m_base_storage;
             s64 m_base_storage_size;
@@ -316,7 +316,7 @@ namespace ams::fssystem {
         /* Process hash/integrity layer. */
         switch (header_reader->GetHashType()) {
             case NcaFsHeader::HashType::HierarchicalSha256Hash:
-                R_TRY(this->CreateSha256Storage(std::addressof(storage), std::move(storage), header_reader->GetHashData().hierarchical_sha256_data, m_hash_generator_factory_selector->GetFactory(fssystem::HashAlgorithmType_Sha2)));
+                R_TRY(this->CreateSha256Storage(std::addressof(storage), std::move(storage), header_reader->GetHashData().hierarchical_sha256_data, header_reader->GetFsType(), m_hash_generator_factory_selector->GetFactory(fssystem::HashAlgorithmType_Sha2)));
                 break;
             case NcaFsHeader::HashType::HierarchicalIntegrityHash:
                 R_TRY(this->CreateIntegrityVerificationStorage(std::addressof(storage), std::move(storage), header_reader->GetHashData().integrity_meta_info, m_hash_generator_factory_selector->GetFactory(fssystem::HashAlgorithmType_Sha2)));
@@ -330,6 +330,11 @@ namespace ams::fssystem {
             R_TRY(this->CreateCompressedStorage(std::addressof(storage), ctx != nullptr ? std::addressof(ctx->compressed_storage) : nullptr, ctx != nullptr ? std::addressof(ctx->compressed_storage_meta_storage) : nullptr, std::move(storage), header_reader->GetCompressionInfo()));
         }
 
+        /* Process read-ahead layer, if we have a worker to read ahead on. */
+        if (fssystem::IsReadAheadWorkerEnabled()) {
+            R_TRY(this->CreateReadAheadStorage(std::addressof(storage), std::move(storage)));
+        }
+
         /* Set output storage. */
         *out = std::move(storage);
         R_SUCCEED();
@@ -1037,7 +1042,7 @@ namespace ams::fssystem {
         R_SUCCEED();
     }
 
-    Result NcaFileSystemDriver::CreateSha256Storage(std::shared_ptr<fs::IStorage> *out, std::shared_ptr<fs::IStorage> base_storage, const NcaFsHeader::HashData::HierarchicalSha256Data &hash_data, IHash256GeneratorFactory *hgf) {
+    Result NcaFileSystemDriver::CreateSha256Storage(std::shared_ptr<fs::IStorage> *out, std::shared_ptr<fs::IStorage> base_storage, const NcaFsHeader::HashData::HierarchicalSha256Data &hash_data, NcaFsHeader::FsType fs_type, IHash256GeneratorFactory *hgf) {
         /* Validate preconditions. */
         AMS_ASSERT(out != nullptr);
         AMS_ASSERT(base_storage != nullptr);
@@ -1045,6 +1050,7 @@ namespace ams::fssystem {
         /* Define storage types. */
         using VerificationStorage = HierarchicalSha256Storage<fs::SubStorage>;
         using CacheStorage        = ReadOnlyBlockCacheStorage;
+        using HashedCacheStorage  = HashedReadOnlyBlockCacheStorage;
         using AlignedStorage      = AlignmentMatchingStoragePooledBuffer<std::shared_ptr<fs::IStorage>, 1>;
 
         /* Validate the hash data. */
@@ -1056,15 +1062,32 @@ namespace ams::fssystem {
         const auto &data_region = hash_data.hash_layer_region[1];
 
         /* Determine buffer sizes. */
-        constexpr s32 CacheBlockCount = 2;
-        const auto hash_buffer_size  = static_cast<size_t>(hash_region.size);
-        const auto cache_buffer_size = CacheBlockCount * hash_data.hash_block_size;
-        const auto total_buffer_size = hash_buffer_size + cache_buffer_size;
-
-        /* Make a buffer holder storage. */
-        auto buffer_hold_storage = fssystem::AllocateShared<MemoryResourceBufferHoldStorage>(std::move(base_storage), m_allocator, total_buffer_size);
-        R_UNLESS(buffer_hold_storage != nullptr, fs::ResultAllocationMemoryFailedAllocateShared());
+        /* Code is read once and in order, so a couple of blocks suffice. RomFs is read at random by the application, so it gets as many blocks as fit in RomFsCacheBufferSize. */
+        constexpr s32 CacheBlockCount         = 2;
+        constexpr size_t RomFsCacheBufferSize = 256_KB;
+        const auto hash_buffer_size = static_cast<size_t>(hash_region.size);
+
+        s32 cache_block_count = CacheBlockCount;
+        if (fs_type == NcaFsHeader::FsType::RomFs) {
+            const s64 data_block_count = util::DivideUp(data_region.size, hash_data.hash_block_size);
+            cache_block_count = static_cast<s32>(std::max<s64>(CacheBlockCount, std::min<s64>(RomFsCacheBufferSize / hash_data.hash_block_size, data_block_count)));
+        }
+
+        /* Make a buffer holder storage. If we can't get memory for a large cache, fall back to the small one. */
+        std::shared_ptr<MemoryResourceBufferHoldStorage> buffer_hold_storage;
+        while (true) {
+            buffer_hold_storage = fssystem::AllocateShared<MemoryResourceBufferHoldStorage>(base_storage, m_allocator, hash_buffer_size + cache_block_count * hash_data.hash_block_size);
+            R_UNLESS(buffer_hold_storage != nullptr, fs::ResultAllocationMemoryFailedAllocateShared());
+
+            if (buffer_hold_storage->IsValid() || cache_block_count == CacheBlockCount) {
+                break;
+            }
+            cache_block_count = CacheBlockCount;
+        }
         R_UNLESS(buffer_hold_storage->IsValid(), fs::ResultAllocationMemoryFailedInNcaFileSystemDriverI());
+        base_storage.reset();
+
+        const auto cache_buffer_size = cache_block_count * hash_data.hash_block_size;
 
         /* Get storage size. */
         s64 base_size;
@@ -1091,8 +1114,14 @@ namespace ams::fssystem {
         /* Initialize the verification storage. */
         R_TRY(verification_storage->Initialize(layer_storages, util::size(layer_storages), hash_data.hash_block_size, buffer_hold_storage->GetBuffer(), hash_buffer_size, hgf));
 
-        /* Make the cache storage. */
-        auto cache_storage = fssystem::AllocateShared<CacheStorage>(std::move(verification_storage), hash_data.hash_block_size, static_cast<char *>(buffer_hold_storage->GetBuffer()) + hash_buffer_size, cache_buffer_size, CacheBlockCount);
+        /* Make the cache storage. Lookups in the plain cache scan every block, so large caches index their blocks by hash. */
+        char * const cache_buffer = static_cast<char *>(buffer_hold_storage->GetBuffer()) + hash_buffer_size;
+        std::shared_ptr<fs::IStorage> cache_storage;
+        if (cache_block_count > CacheBlockCount) {
+            cache_storage = fssystem::AllocateShared<HashedCacheStorage>(std::move(verification_storage), hash_data.hash_block_size, cache_buffer, cache_buffer_size, cache_block_count);
+        } else {
+            cache_storage = fssystem::AllocateShared<CacheStorage>(std::move(verification_storage), hash_data.hash_block_size, cache_buffer, cache_buffer_size, cache_block_count);
+        }
         R_UNLESS(cache_storage != nullptr, fs::ResultAllocationMemoryFailedAllocateShared());
 
         /* Make the aligned storage. */
@@ -1256,4 +1285,21 @@ namespace ams::fssystem {
         R_SUCCEED();
     }
 
+    Result NcaFileSystemDriver::CreateReadAheadStorage(std::shared_ptr<fs::IStorage> *out, std::shared_ptr<fs::IStorage> base_storage) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(out != nullptr);
+        AMS_ASSERT(base_storage != nullptr);
+
+        /* Allocate the read-ahead storage. */
+        auto read_ahead_storage = fssystem::AllocateShared<fssystem::ReadAheadStorage>();
+        R_UNLESS(read_ahead_storage != nullptr, fs::ResultAllocationMemoryFailedAllocateShared());
+
+        /* Initialize the read-ahead storage. */
+        R_TRY(read_ahead_storage->Initialize(std::move(base_storage)));
+
+        /* Set the output. */
+        *out = std::move(read_ahead_storage);
+        R_SUCCEED();
+    }
+
 }
@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams::fssystem {
+
+    namespace {
+
+        using ReadAheadRequest = impl::ReadAheadRequest;
+        using RequestState     = impl::ReadAheadRequest::State;
+
+        /* Requests are queued and read by the worker; once ready, they belong to the stream which issued them. */
+        /* Ready requests which aren't being read from may be reclaimed, oldest first, when the buffer is needed for new requests. */
+        class ReadAheadWorker {
+            NON_COPYABLE(ReadAheadWorker);
+            NON_MOVEABLE(ReadAheadWorker);
+            private:
+                using RequestList = util::IntrusiveListBaseTraits<ReadAheadRequest>::ListType;
+            private:
+                os::ThreadType m_thread;
+                bool m_is_initialized;
+                os::SdkMutex m_mutex;
+                os::SdkConditionVariable m_request_cv;
+                os::SdkConditionVariable m_done_cv;
+                RequestList m_queued_requests;
+                RequestList m_ready_requests;
+                FileSystemBuddyHeap m_buffer_heap;
+                size_t m_buffer_size;
+            public:
+                constexpr ReadAheadWorker() : m_thread(), m_is_initialized(false), m_mutex(), m_request_cv(), m_done_cv(), m_queued_requests(), m_ready_requests(), m_buffer_heap(), m_buffer_size(0) { /* ... */ }
+
+                void Initialize(void *stack, size_t stack_size, void *buffer, size_t buffer_size, s32 priority) {
+                    /* Check pre-conditions. */
+                    AMS_ASSERT(!m_is_initialized);
+                    AMS_ASSERT(util::IsAligned(reinterpret_cast<uintptr_t>(stack), os::ThreadStackAlignment));
+                    AMS_ASSERT(buffer_size >= ReadAheadStorage::WindowSizeMin);
+
+                    /* Read ahead only into our own buffer, so that reading ahead never evicts the buffer manager's caches. */
+                    R_ABORT_UNLESS(m_buffer_heap.Initialize(reinterpret_cast<uintptr_t>(buffer), buffer_size, ReadAheadStorage::WindowSizeMin));
+                    m_buffer_size = buffer_size;
+
+                    /* Create and start our thread. */
+                    R_ABORT_UNLESS(os::CreateThread(std::addressof(m_thread), WorkerThreadFunction, this, stack, stack_size, priority));
+                    os::SetThreadNamePointer(std::addressof(m_thread), AMS_GET_SYSTEM_THREAD_NAME(fs, ReadAheadWorker));
+                    os::StartThread(std::addressof(m_thread));
+
+                    m_is_initialized = true;
+                }
+
+                bool IsEnabled() const {
+                    return m_is_initialized;
+                }
+
+                size_t GetBufferSize() const {
+                    return m_buffer_size;
+                }
+
+                bool Submit(ReadAheadRequest *request) {
+                    std::scoped_lock lk(m_mutex);
+
+                    AMS_ASSERT(request->state == RequestState::Idle);
+
+                    /* Allocate memory for the request, reclaiming data which has been ready for longest if our buffer is full. */
+                    /* NOTE: This keeps streams which are abandoned without being reset from holding our buffer forever. */
+                    const s32 order = m_buffer_heap.GetOrderFromBytes(request->size);
+                    void *buffer = m_buffer_heap.AllocateByOrder(order);
+                    while (buffer == nullptr) {
+                        /* If nothing can be reclaimed, we simply don't read ahead. */
+                        if (m_ready_requests.empty()) {
+                            return false;
+                        }
+
+                        this->FreeBuffer(std::addressof(m_ready_requests.front()));
+                        buffer = m_buffer_heap.AllocateByOrder(order);
+                    }
+
+                    request->buffer       = buffer;
+                    request->order        = order;
+                    request->state        = RequestState::Queued;
+                    request->is_cancelled = false;
+                    m_queued_requests.push_back(*request);
+                    m_request_cv.Signal();
+                    return true;
+                }
+
+                void Cancel(ReadAheadRequest *request) {
+                    std::scoped_lock lk(m_mutex);
+
+                    switch (request->state) {
+                        case RequestState::Idle:
+                            break;
+                        case RequestState::Queued:
+                            {
+                                /* The request was never started, so we can simply free its memory. */
+                                m_queued_requests.erase(m_queued_requests.iterator_to(*request));
+                                this->FreeBuffer(request);
+                            }
+                            break;
+                        case RequestState::Reading:
+                            {
+                                /* The worker will free the memory once the read completes. */
+                                request->is_cancelled = true;
+                            }
+                            break;
+                        case RequestState::Ready:
+                            {
+                                /* Nobody will read the data, so free it. */
+                                this->FreeBuffer(request);
+                            }
+                            break;
+                        AMS_UNREACHABLE_DEFAULT_CASE();
+                    }
+                }
+
+                /* Waits for the request to be read, and if it was, keeps it from being reclaimed until it is retired or released. */
+                bool Wait(ReadAheadRequest *request) {
+                    std::scoped_lock lk(m_mutex);
+
+                    while (request->state == RequestState::Queued || (request->state == RequestState::Reading && !request->is_cancelled)) {
+                        m_done_cv.Wait(m_mutex);
+                    }
+
+                    if (request->state != RequestState::Ready) {
+                        return false;
+                    }
+
+                    if (request->IsLinked()) {
+                        m_ready_requests.erase(m_ready_requests.iterator_to(*request));
+                    }
+                    return true;
+                }
+
+                void Release(ReadAheadRequest *request) {
+                    std::scoped_lock lk(m_mutex);
+
+                    AMS_ASSERT(request->state == RequestState::Ready);
+                    AMS_ASSERT(!request->IsLinked());
+                    m_ready_requests.push_back(*request);
+                }
+
+                void WaitIdle(ReadAheadRequest *request) {
+                    std::scoped_lock lk(m_mutex);
+
+                    while (request->state != RequestState::Idle) {
+                        m_done_cv.Wait(m_mutex);
+                    }
+                }
+
+                void Retire(ReadAheadRequest *request) {
+                    std::scoped_lock lk(m_mutex);
+
+                    AMS_ASSERT(request->state == RequestState::Ready);
+                    this->FreeBuffer(request);
+                }
+
+                bool IsIdle(const ReadAheadRequest *request) {
+                    std::scoped_lock lk(m_mutex);
+
+                    return request->state == RequestState::Idle;
+                }
+            private:
+                void FreeBuffer(ReadAheadRequest *request) {
+                    AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
+
+                    /* Ready requests which aren't being read from are on our ready list. */
+                    if (request->state == RequestState::Ready && request->IsLinked()) {
+                        m_ready_requests.erase(m_ready_requests.iterator_to(*request));
+                    }
+
+                    m_buffer_heap.Free(request->buffer, request->order);
+                    request->buffer = nullptr;
+                    request->state  = RequestState::Idle;
+                }
+
+                static void WorkerThreadFunction(void *arg) {
+                    static_cast<ReadAheadWorker *>(arg)->WorkerThreadBody();
+                }
+
+                void WorkerThreadBody() {
+                    while (true) {
+                        /* Wait for a request. */
+                        ReadAheadRequest *request;
+                        {
+                            std::scoped_lock lk(m_mutex);
+                            while (m_queued_requests.empty()) {
+                                m_request_cv.Wait(m_mutex);
+                            }
+
+                            request = std::addressof(m_queued_requests.front());
+                            m_queued_requests.pop_front();
+                            request->state = RequestState::Reading;
+                        }
+
+                        /* Read the data. */
+                        const Result result = request->storage->Read(request->offset, request->buffer, request->size);
+
+                        /* Publish the data to the stream, or free it if nobody wants it. */
+                        std::scoped_lock lk(m_mutex);
+                        if (R_SUCCEEDED(result) && !request->is_cancelled) {
+                            request->state = RequestState::Ready;
+                            m_ready_requests.push_back(*request);
+                        } else {
+                            this->FreeBuffer(request);
+                        }
+                        request->is_cancelled = false;
+
+                        m_done_cv.Broadcast();
+                    }
+                }
+        };
+
+        constinit ReadAheadWorker g_read_ahead_worker;
+
+    }
+
+    void InitializeReadAheadWorker(void *stack, size_t stack_size, void *buffer, size_t buffer_size, s32 priority) {
+        g_read_ahead_worker.Initialize(stack, stack_size, buffer, buffer_size, priority);
+    }
+
+    bool IsReadAheadWorkerEnabled() {
+        return g_read_ahead_worker.IsEnabled();
+    }
+
+    ReadAheadStorage::ReadAheadStorage() : m_base_storage(), m_size(0), m_window_size_max(0), m_access_count(0), m_mutex(), m_stream_cv() {
+        for (auto &stream : m_streams) {
+            stream.next_offset           = -1;
+            stream.read_ahead_end_offset = -1;
+            stream.window_size           = WindowSizeMin;
+            stream.sequential_count      = 0;
+            stream.last_access           = 0;
+            stream.is_in_use             = false;
+        }
+    }
+
+    ReadAheadStorage::~ReadAheadStorage() {
+        this->Finalize();
+    }
+
+    Result ReadAheadStorage::Initialize(std::shared_ptr<fs::IStorage> base_storage) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(base_storage != nullptr);
+        AMS_ASSERT(m_base_storage == nullptr);
+
+        /* Get the base storage's size. */
+        s64 size;
+        R_TRY(base_storage->GetSize(std::addressof(size)));
+
+        /* Set members. */
+        m_base_storage = std::move(base_storage);
+        m_size         = size;
+
+        /* Let no single stream's window take more than its share of the worker's buffer. */
+        m_window_size_max = util::FloorPowerOfTwo(std::clamp(g_read_ahead_worker.GetBufferSize() / BufferDivisor, WindowSizeMin, WindowSizeMax));
+
+        R_SUCCEED();
+    }
+
+    void ReadAheadStorage::Finalize() {
+        if (m_base_storage != nullptr) {
+            /* Cancel our requests, and wait for the worker to be done with any it is reading. */
+            this->ResetAllStreams();
+            for (auto &stream : m_streams) {
+                for (auto &request : stream.requests) {
+                    g_read_ahead_worker.WaitIdle(std::addressof(request));
+                }
+            }
+
+            m_base_storage.reset();
+        }
+    }
+
+    Result ReadAheadStorage::Read(s64 offset, void *buffer, size_t size) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_base_storage != nullptr);
+
+        /* Succeed immediately on zero-sized read. */
+        R_SUCCEED_IF(size == 0);
+
+        /* Validate arguments. */
+        R_UNLESS(buffer != nullptr, fs::ResultNullptrArgument());
+
+        /* Reads at least as large as our largest window gain nothing from reading ahead. */
+        if (!g_read_ahead_worker.IsEnabled() || size >= m_window_size_max) {
+            R_RETURN(m_base_storage->Read(offset, buffer, size));
+        }
+
+        /* Get the stream the read belongs to. If every stream is busy, just read. */
+        Stream *stream = this->AcquireStream(offset);
+        if (stream == nullptr) {
+            R_RETURN(m_base_storage->Read(offset, buffer, size));
+        }
+        ON_SCOPE_EXIT { this->ReleaseStream(stream); };
+
+        /* Copy whatever we've read ahead, then read the rest. */
+        const size_t read_ahead_size = this->ReadFromRequests(stream, offset, buffer, size);
+        if (read_ahead_size < size) {
+            R_TRY(m_base_storage->Read(offset + read_ahead_size, static_cast<u8 *>(buffer) + read_ahead_size, size - read_ahead_size));
+        }
+
+        /* Advance the stream, and read ahead of it once it is sequential. */
+        stream->next_offset = offset + size;
+        if ((++stream->sequential_count) >= SequentialReadCountMin) {
+            this->ReadAhead(stream);
+        }
+
+        R_SUCCEED();
+    }
+
+    Result ReadAheadStorage::Write(s64 offset, const void *buffer, size_t size) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_base_storage != nullptr);
+
+        /* Drop anything we've read ahead, as the write may change it. */
+        this->ResetAllStreams();
+
+        R_RETURN(m_base_storage->Write(offset, buffer, size));
+    }
+
+    Result ReadAheadStorage::Flush() {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_base_storage != nullptr);
+
+        R_RETURN(m_base_storage->Flush());
+    }
+
+    Result ReadAheadStorage::SetSize(s64 size) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_base_storage != nullptr);
+
+        /* Drop anything we've read ahead, then resize. */
+        this->ResetAllStreams();
+        R_TRY(m_base_storage->SetSize(size));
+
+        /* Update our size. */
+        R_RETURN(m_base_storage->GetSize(std::addressof(m_size)));
+    }
+
+    Result ReadAheadStorage::GetSize(s64 *out) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_base_storage != nullptr);
+        AMS_ASSERT(out != nullptr);
+
+        *out = m_size;
+        R_SUCCEED();
+    }
+
+    Result ReadAheadStorage::OperateRange(void *dst, size_t dst_size, fs::OperationId op_id, s64 offset, s64 size, const void *src, size_t src_size) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_base_storage != nullptr);
+
+        /* Drop anything we've read ahead before invalidating our base. */
+        if (op_id == fs::OperationId::Invalidate) {
+            this->ResetAllStreams();
+        }
+
+        R_RETURN(m_base_storage->OperateRange(dst, dst_size, op_id, offset, size, src, src_size));
+    }
+
+    ReadAheadStorage::Stream *ReadAheadStorage::AcquireStream(s64 offset) {
+        std::scoped_lock lk(m_mutex);
+
+        /* Prefer a stream the read continues, whether exactly or by skipping into data we've read ahead. */
+        Stream *lru_stream = nullptr;
+        for (auto &stream : m_streams) {
+            if (stream.next_offset <= offset && offset <= std::max(stream.next_offset, stream.read_ahead_end_offset)) {
+                /* Only one reader may use a stream at a time. */
+                if (stream.is_in_use) {
+                    return nullptr;
+                }
+
+                stream.is_in_use   = true;
+                stream.last_access = ++m_access_count;
+                return std::addressof(stream);
+            }
+
+            if (!stream.is_in_use && (lru_stream == nullptr || static_cast<s32>(stream.last_access - lru_stream->last_access) < 0)) {
+                lru_stream = std::addressof(stream);
+            }
+        }
+
+        /* The read is random access, so start a new stream in place of the least recently used. */
+        if (lru_stream != nullptr) {
+            this->ResetStream(lru_stream, offset);
+
+            lru_stream->is_in_use   = true;
+            lru_stream->last_access = ++m_access_count;
+        }
+
+        return lru_stream;
+    }
+
+    void ReadAheadStorage::ReleaseStream(Stream *stream) {
+        std::scoped_lock lk(m_mutex);
+
+        AMS_ASSERT(stream->is_in_use);
+        stream->is_in_use = false;
+        m_stream_cv.Broadcast();
+    }
+
+    void ReadAheadStorage::ResetStream(Stream *stream, s64 offset) {
+        /* Cancel everything we've read ahead. */
+        for (auto &request : stream->requests) {
+            g_read_ahead_worker.Cancel(std::addressof(request));
+        }
+
+        /* Start over with the smallest window. */
+        stream->next_offset           = offset;
+        stream->read_ahead_end_offset = offset;
+        stream->window_size           = WindowSizeMin;
+        stream->sequential_count      = 0;
+    }
+
+    void ReadAheadStorage::ResetAllStreams() {
+        std::scoped_lock lk(m_mutex);
+
+        /* Wait for readers to be done with their streams. */
+        for (auto &stream : m_streams) {
+            while (stream.is_in_use) {
+                m_stream_cv.Wait(m_mutex);
+            }
+        }
+
+        for (auto &stream : m_streams) {
+            this->ResetStream(std::addressof(stream), -1);
+        }
+    }
+
+    void ReadAheadStorage::DropStaleRequests(Stream *stream, s64 offset) {
+        /* Cancel requests for data the stream has moved past. */
+        for (auto &request : stream->requests) {
+            if (request.GetEndOffset() <= offset) {
+                g_read_ahead_worker.Cancel(std::addressof(request));
+            }
+        }
+    }
+
+    size_t ReadAheadStorage::ReadFromRequests(Stream *stream, s64 offset, void *buffer, size_t size) {
+        /* Drop anything the read skipped over. */
+        this->DropStaleRequests(stream, offset);
+
+        /* Copy from our requests for as long as they hold the data. */
+        size_t read_size = 0;
+        while (read_size < size) {
+            const s64 cur_offset = offset + read_size;
+
+            /* Find the request holding the current offset. */
+            ReadAheadRequest *request = nullptr;
+            for (auto &r : stream->requests) {
+                if (r.offset <= cur_offset && cur_offset < r.GetEndOffset() && !g_read_ahead_worker.IsIdle(std::addressof(r))) {
+                    request = std::addressof(r);
+                    break;
+                }
+            }
+            if (request == nullptr) {
+                break;
+            }
+
+            /* Wait for the request to be read. If it failed, we'll read the data ourselves. */
+            if (!g_read_ahead_worker.Wait(request)) {
+                break;
+            }
+
+            /* Copy the data. */
+            const size_t copy_size = static_cast<size_t>(std::min<s64>(size - read_size, request->GetEndOffset() - cur_offset));
+            std::memcpy(static_cast<u8 *>(buffer) + read_size, static_cast<const u8 *>(request->buffer) + (cur_offset - request->offset), copy_size);
+            read_size += copy_size;
+
+            /* Free the request once fully consumed; until then, let it be reclaimed between our reads. */
+            if (cur_offset + static_cast<s64>(copy_size) == request->GetEndOffset()) {
+                g_read_ahead_worker.Retire(request);
+            } else {
+                g_read_ahead_worker.Release(request);
+            }
+        }
+
+        return read_size;
+    }
+
+    void ReadAheadStorage::ReadAhead(Stream *stream) {
+        /* Keep at least a window of data in flight ahead of the stream. */
+        stream->read_ahead_end_offset = std::max(stream->read_ahead_end_offset, stream->next_offset);
+        while (stream->read_ahead_end_offset < m_size && static_cast<size_t>(stream->read_ahead_end_offset - stream->next_offset) < stream->window_size) {
+            /* Find an idle request. */
+            ReadAheadRequest *request = nullptr;
+            for (auto &r : stream->requests) {
+                if (g_read_ahead_worker.IsIdle(std::addressof(r))) {
+                    request = std::addressof(r);
+                    break;
+                }
+            }
+            if (request == nullptr) {
+                break;
+            }
+
+            /* Submit the request. If the worker's buffer is full, we'll try again on the next read. */
+            const size_t request_size = static_cast<size_t>(std::min<s64>(stream->window_size, m_size - stream->read_ahead_end_offset));
+            request->storage = m_base_storage.get();
+            request->offset  = stream->read_ahead_end_offset;
+            request->size    = request_size;
+            if (!g_read_ahead_worker.Submit(request)) {
+                break;
+            }
+
+            /* Advance, growing the window for the next request. */
+            stream->read_ahead_end_offset += request_size;
+            stream->window_size = std::min(stream->window_size * 2, m_window_size_max);
+        }
+    }
+
+}
@@ -16,21 +16,23 @@
 #pragma once
 #include <stratosphere.hpp>
 #include "fssystem_lru_list_cache.hpp"
+#include "fssystem_hashed_lru_list_cache.hpp"
 
 namespace ams::fssystem {
 
-    class ReadOnlyBlockCacheStorage : public ::ams::fs::IStorage, public ::ams::fs::impl::Newable {
-        NON_COPYABLE(ReadOnlyBlockCacheStorage);
-        NON_MOVEABLE(ReadOnlyBlockCacheStorage);
+    template<typename BlockCacheType>
+    class ReadOnlyBlockCacheStorageImpl : public ::ams::fs::IStorage, public ::ams::fs::impl::Newable {
+        NON_COPYABLE(ReadOnlyBlockCacheStorageImpl);
+        NON_MOVEABLE(ReadOnlyBlockCacheStorageImpl);
         private:
-            using BlockCache = LruListCache<s64, char *>;
+            using BlockCache = BlockCacheType;
         private:
             os::SdkMutex m_mutex;
             BlockCache m_block_cache;
             std::shared_ptr<fs::IStorage> m_base_storage;
             s32 m_block_size;
         public:
-            ReadOnlyBlockCacheStorage(std::shared_ptr<fs::IStorage> bs, s32 bsz, char *buf, size_t buf_size, s32 cache_block_count) : m_mutex(), m_block_cache(), m_base_storage(std::move(bs)), m_block_size(bsz) {
+            ReadOnlyBlockCacheStorageImpl(std::shared_ptr<fs::IStorage> bs, s32 bsz, char *buf, size_t buf_size, s32 cache_block_count) : m_mutex(), m_block_cache(), m_base_storage(std::move(bs)), m_block_size(bsz) {
                 /* Validate preconditions. */
                 AMS_ASSERT(buf_size >= static_cast<size_t>(m_block_size));
                 AMS_ASSERT(util::IsPowerOfTwo(m_block_size));
@@ -40,7 +42,7 @@ namespace ams::fssystem {
 
                 /* Create a node for each cache block. */
                 for (auto i = 0; i < cache_block_count; i++) {
-                    std::unique_ptr node = std::make_unique<BlockCache::Node>(buf + m_block_size * i);
+                    std::unique_ptr node = std::make_unique<typename BlockCache::Node>(buf + m_block_size * i);
                     AMS_ASSERT(node != nullptr);
 
                     if (node != nullptr) {
@@ -49,7 +51,7 @@ namespace ams::fssystem {
                 }
             }
 
-            ~ReadOnlyBlockCacheStorage() {
+            ~ReadOnlyBlockCacheStorageImpl() {
                 m_block_cache.DeleteAllNodes();
             }
 
@@ -128,4 +130,8 @@ namespace ams::fssystem {
             }
     };
 
+    /* Small caches are best served by a linear scan of the mru list; large caches should use the hashed variant. */
+    using ReadOnlyBlockCacheStorage       = ReadOnlyBlockCacheStorageImpl<LruListCache<s64, char *>>;
+    using HashedReadOnlyBlockCacheStorage = ReadOnlyBlockCacheStorageImpl<HashedLruListCache<s64, char *>>;
+
 }
@@ -20,13 +20,17 @@ namespace ams::kvdb {
     namespace {
 
         /* Convenience definitions. */
-        constexpr u8 ArchiveHeaderMagic[4] = {'I', 'M', 'K', 'V'};
-        constexpr u8 ArchiveEntryMagic[4]  = {'I', 'M', 'E', 'N'};
+        constexpr u8 ArchiveHeaderMagic[4]  = {'I', 'M', 'K', 'V'};
+        constexpr u8 ArchiveEntryMagic[4]   = {'I', 'M', 'E', 'N'};
+        constexpr u8 JournalHeaderMagic[4]  = {'I', 'M', 'K', 'J'};
+        constexpr u8 JournalBatchMagic[4]   = {'I', 'M', 'J', 'B'};
+        constexpr u8 JournalRemoveMagic[4]  = {'I', 'M', 'R', 'M'};
+        constexpr u8 JournalCompactMagic[4] = {'I', 'M', 'C', 'P'};
 
         /* Archive types. */
         struct ArchiveHeader {
             u8 magic[sizeof(ArchiveHeaderMagic)];
-            u32 pad;
+            u32 generation; /* NOTE: Nintendo calls this padding, writing zero and never reading it. */
             u32 entry_count;
 
             Result Validate() const {
@@ -34,9 +38,10 @@ namespace ams::kvdb {
                 R_SUCCEED();
             }
 
-            static ArchiveHeader Make(size_t entry_count) {
+            static ArchiveHeader Make(size_t entry_count, u32 generation) {
                 ArchiveHeader header = {};
                 std::memcpy(header.magic, ArchiveHeaderMagic, sizeof(ArchiveHeaderMagic));
+                header.generation = generation;
                 header.entry_count = static_cast<u32>(entry_count);
                 return header;
             }
@@ -63,6 +68,63 @@ namespace ams::kvdb {
         };
         static_assert(sizeof(ArchiveEntryHeader) == 0xC && util::is_pod<ArchiveEntryHeader>::value, "ArchiveEntryHeader definition!");
 
+        /* Journal types. */
+        struct JournalHeader {
+            u8 magic[sizeof(JournalHeaderMagic)];
+            u32 archive_generation;
+            u8 archive_hash[JournalArchiveHashSize];
+
+            Result Validate() const {
+                R_UNLESS(std::memcmp(this->magic, JournalHeaderMagic, sizeof(JournalHeaderMagic)) == 0, kvdb::ResultInvalidKeyValue());
+                R_SUCCEED();
+            }
+
+            static JournalHeader Make(const void *archive_hash, u32 archive_generation) {
+                JournalHeader header = {};
+                std::memcpy(header.magic, JournalHeaderMagic, sizeof(JournalHeaderMagic));
+                header.archive_generation = archive_generation;
+                std::memcpy(header.archive_hash, archive_hash, sizeof(header.archive_hash));
+                return header;
+            }
+        };
+        static_assert(sizeof(JournalHeader) == 0x28 && util::is_pod<JournalHeader>::value, "JournalHeader definition!");
+
+        struct JournalBatchHeader {
+            u8 magic[sizeof(JournalBatchMagic)];
+            u32 entry_count;
+            u32 size;
+            u8 hash[crypto::Sha256Generator::HashSize];
+
+            Result Validate() const {
+                R_UNLESS(std::memcmp(this->magic, JournalBatchMagic, sizeof(JournalBatchMagic)) == 0, kvdb::ResultInvalidKeyValue());
+                R_SUCCEED();
+            }
+
+            static JournalBatchHeader Make(size_t entry_count, const void *data, size_t size) {
+                JournalBatchHeader header = {};
+                std::memcpy(header.magic, JournalBatchMagic, sizeof(JournalBatchMagic));
+                header.entry_count = static_cast<u32>(entry_count);
+                header.size = static_cast<u32>(size);
+                crypto::GenerateSha256(header.hash, sizeof(header.hash), data, size);
+                return header;
+            }
+        };
+        static_assert(sizeof(JournalBatchHeader) == 0x2C && util::is_pod<JournalBatchHeader>::value, "JournalBatchHeader definition!");
+
+        /* Set entries are archive entries. Other entries share their layout, with a distinct magic and no value. */
+        /* A compaction entry's key is the hash of an archive which has been completely written to the temporary path. */
+        ArchiveEntryHeader MakeJournalEntryHeader(const u8 (&magic)[4], size_t key_size) {
+            ArchiveEntryHeader header = {};
+            std::memcpy(header.magic, magic, sizeof(magic));
+            header.key_size = key_size;
+            header.value_size = 0;
+            return header;
+        }
+
+        bool IsJournalEntryHeader(const ArchiveEntryHeader &header, const u8 (&magic)[4]) {
+            return std::memcmp(header.magic, magic, sizeof(magic)) == 0 && header.value_size == 0;
+        }
+
     }
 
     /* Reader functionality. */
@@ -82,6 +144,11 @@ namespace ams::kvdb {
     }
 
     Result ArchiveReader::ReadEntryCount(size_t *out) {
+        u32 generation;
+        R_RETURN(this->ReadEntryCount(out, std::addressof(generation)));
+    }
+
+    Result ArchiveReader::ReadEntryCount(size_t *out, u32 *out_generation) {
         /* This should only be called at the start of reading stream. */
         AMS_ABORT_UNLESS(m_offset == 0);
 
@@ -91,6 +158,7 @@ namespace ams::kvdb {
         R_TRY(header.Validate());
 
         *out = header.entry_count;
+        *out_generation = header.generation;
         R_SUCCEED();
     }
 
@@ -138,10 +206,14 @@ namespace ams::kvdb {
     }
 
     void ArchiveWriter::WriteHeader(size_t entry_count) {
+        this->WriteHeader(entry_count, 0);
+    }
+
+    void ArchiveWriter::WriteHeader(size_t entry_count, u32 generation) {
         /* This should only be called at start of write. */
         AMS_ABORT_UNLESS(m_offset == 0);
 
-        ArchiveHeader header = ArchiveHeader::Make(entry_count);
+        ArchiveHeader header = ArchiveHeader::Make(entry_count, generation);
         R_ABORT_UNLESS(this->Write(std::addressof(header), sizeof(header)));
     }
 
@@ -155,6 +227,185 @@ namespace ams::kvdb {
         R_ABORT_UNLESS(this->Write(value, value_size));
     }
 
+    /* Journal reader functionality. */
+    Result JournalReader::Peek(void *dst, size_t size) {
+        /* Bounds check against the current batch. */
+        R_UNLESS(m_offset + size <= m_batch_end, kvdb::ResultInvalidKeyValue());
+        R_UNLESS(m_offset < m_offset + size,     kvdb::ResultInvalidKeyValue());
+
+        std::memcpy(dst, m_buffer.Get() + m_offset, size);
+        R_SUCCEED();
+    }
+
+    Result JournalReader::Read(void *dst, size_t size) {
+        R_TRY(this->Peek(dst, size));
+        m_offset += size;
+        R_SUCCEED();
+    }
+
+    Result JournalReader::ReadHeader(void *out_archive_hash, size_t hash_size, u32 *out_archive_generation) {
+        /* This should only be called at the start of reading stream. */
+        AMS_ABORT_UNLESS(m_offset == 0);
+        AMS_ABORT_UNLESS(hash_size == JournalArchiveHashSize);
+
+        /* Read and validate header. */
+        JournalHeader header;
+        R_UNLESS(sizeof(header) <= m_buffer.GetSize(), kvdb::ResultInvalidKeyValue());
+        std::memcpy(std::addressof(header), m_buffer.Get(), sizeof(header));
+        R_TRY(header.Validate());
+
+        /* Batches follow the header. */
+        m_offset    = sizeof(header);
+        m_batch_end = sizeof(header);
+
+        std::memcpy(out_archive_hash, header.archive_hash, hash_size);
+        *out_archive_generation = header.archive_generation;
+        R_SUCCEED();
+    }
+
+    Result JournalReader::ReadBatch(size_t *out_entry_count) {
+        /* The previous batch must have been consumed exactly. */
+        R_UNLESS(m_offset == m_batch_end, kvdb::ResultInvalidKeyValue());
+
+        /* Read and validate the batch header. */
+        JournalBatchHeader header;
+        R_UNLESS(sizeof(header) <= m_buffer.GetSize() - m_offset, kvdb::ResultInvalidKeyValue());
+        std::memcpy(std::addressof(header), m_buffer.Get() + m_offset, sizeof(header));
+        R_TRY(header.Validate());
+
+        /* A batch which was not completely written is invalid. */
+        const size_t data_offset = m_offset + sizeof(header);
+        R_UNLESS(header.size <= m_buffer.GetSize() - data_offset, kvdb::ResultInvalidKeyValue());
+
+        u8 hash[crypto::Sha256Generator::HashSize];
+        crypto::GenerateSha256(hash, sizeof(hash), m_buffer.Get() + data_offset, header.size);
+        R_UNLESS(crypto::IsSameBytes(hash, header.hash, sizeof(hash)), kvdb::ResultInvalidKeyValue());
+
+        /* Begin reading the batch's entries. */
+        m_offset    = data_offset;
+        m_batch_end = data_offset + header.size;
+
+        *out_entry_count = header.entry_count;
+        R_SUCCEED();
+    }
+
+    Result JournalReader::GetEntryInfo(JournalEntryType *out_type, size_t *out_key_size, size_t *out_value_size) {
+        /* Peek the next entry header. */
+        ArchiveEntryHeader header;
+        R_TRY(this->Peek(std::addressof(header), sizeof(header)));
+
+        if (IsJournalEntryHeader(header, JournalRemoveMagic)) {
+            *out_type = JournalEntryType_Remove;
+        } else if (IsJournalEntryHeader(header, JournalCompactMagic)) {
+            R_UNLESS(header.key_size == JournalArchiveHashSize, kvdb::ResultInvalidKeyValue());
+            *out_type = JournalEntryType_Compaction;
+        } else {
+            R_TRY(header.Validate());
+            *out_type = JournalEntryType_Set;
+        }
+
+        *out_key_size = header.key_size;
+        *out_value_size = header.value_size;
+        R_SUCCEED();
+    }
+
+    Result JournalReader::ReadEntry(void *out_key, size_t key_size, void *out_value, size_t value_size) {
+        /* Read the next entry header. */
+        ArchiveEntryHeader header;
+        R_TRY(this->Read(std::addressof(header), sizeof(header)));
+
+        /* Key size and Value size must be correct. */
+        AMS_ABORT_UNLESS(key_size == header.key_size);
+        AMS_ABORT_UNLESS(value_size == header.value_size);
+
+        R_TRY(this->Read(out_key, key_size));
+        if (value_size > 0) {
+            R_TRY(this->Read(out_value, value_size));
+        }
+        R_SUCCEED();
+    }
+
+    Result JournalReader::SkipEntry() {
+        /* Read the next entry header. */
+        ArchiveEntryHeader header;
+        R_TRY(this->Read(std::addressof(header), sizeof(header)));
+
+        /* Skip the key and value. */
+        const size_t size = static_cast<size_t>(header.key_size) + static_cast<size_t>(header.value_size);
+        R_UNLESS(size <= m_batch_end - m_offset, kvdb::ResultInvalidKeyValue());
+
+        m_offset += size;
+        R_SUCCEED();
+    }
+
+    /* Journal writer functionality. */
+    Result JournalWriter::Write(const void *src, size_t size) {
+        /* Bounds check. */
+        R_UNLESS(m_offset + size <= m_buffer.GetSize(), kvdb::ResultInvalidKeyValue());
+        R_UNLESS(m_offset < m_offset + size,            kvdb::ResultInvalidKeyValue());
+
+        std::memcpy(m_buffer.Get() + m_offset, src, size);
+        m_offset += size;
+        R_SUCCEED();
+    }
+
+    void JournalWriter::WriteHeader(const void *archive_hash, size_t hash_size, u32 archive_generation) {
+        /* This should only be called at start of write. */
+        AMS_ABORT_UNLESS(m_offset == 0);
+        AMS_ABORT_UNLESS(hash_size == JournalArchiveHashSize);
+
+        JournalHeader header = JournalHeader::Make(archive_hash, archive_generation);
+        R_ABORT_UNLESS(this->Write(std::addressof(header), sizeof(header)));
+    }
+
+    void JournalWriter::BeginBatch() {
+        /* Leave room for the batch header, which is written once the batch's contents are known. */
+        m_batch_offset = m_offset;
+        m_offset += sizeof(JournalBatchHeader);
+        m_entry_count = 0;
+    }
+
+    void JournalWriter::WriteSetEntry(const void *key, size_t key_size, const void *value, size_t value_size) {
+        /* This should only be called after beginning a batch. */
+        AMS_ABORT_UNLESS(m_offset >= m_batch_offset + sizeof(JournalBatchHeader));
+
+        ArchiveEntryHeader header = ArchiveEntryHeader::Make(key_size, value_size);
+        R_ABORT_UNLESS(this->Write(std::addressof(header), sizeof(header)));
+        R_ABORT_UNLESS(this->Write(key, key_size));
+        R_ABORT_UNLESS(this->Write(value, value_size));
+        ++m_entry_count;
+    }
+
+    void JournalWriter::WriteRemoveEntry(const void *key, size_t key_size) {
+        /* This should only be called after beginning a batch. */
+        AMS_ABORT_UNLESS(m_offset >= m_batch_offset + sizeof(JournalBatchHeader));
+
+        ArchiveEntryHeader header = MakeJournalEntryHeader(JournalRemoveMagic, key_size);
+        R_ABORT_UNLESS(this->Write(std::addressof(header), sizeof(header)));
+        R_ABORT_UNLESS(this->Write(key, key_size));
+        ++m_entry_count;
+    }
+
+    void JournalWriter::WriteCompactionEntry(const void *archive_hash, size_t hash_size) {
+        /* This should only be called after beginning a batch. */
+        AMS_ABORT_UNLESS(m_offset >= m_batch_offset + sizeof(JournalBatchHeader));
+        AMS_ABORT_UNLESS(hash_size == JournalArchiveHashSize);
+
+        ArchiveEntryHeader header = MakeJournalEntryHeader(JournalCompactMagic, hash_size);
+        R_ABORT_UNLESS(this->Write(std::addressof(header), sizeof(header)));
+        R_ABORT_UNLESS(this->Write(archive_hash, hash_size));
+        ++m_entry_count;
+    }
+
+    void JournalWriter::EndBatch() {
+        /* The batch must fill the buffer exactly. */
+        AMS_ABORT_UNLESS(m_offset == m_buffer.GetSize());
+
+        const size_t data_offset = m_batch_offset + sizeof(JournalBatchHeader);
+        JournalBatchHeader header = JournalBatchHeader::Make(m_entry_count, m_buffer.Get() + data_offset, m_offset - data_offset);
+        std::memcpy(m_buffer.Get() + m_batch_offset, std::addressof(header), sizeof(header));
+    }
+
     /* Size helper functionality. */
     ArchiveSizeHelper::ArchiveSizeHelper() : m_size(sizeof(ArchiveHeader)) {
         /* ... */
@@ -164,4 +415,24 @@ namespace ams::kvdb {
         m_size += sizeof(ArchiveEntryHeader) + key_size + value_size;
     }
 
+    JournalSizeHelper::JournalSizeHelper() : m_size(sizeof(JournalBatchHeader)) {
+        /* ... */
+    }
+
+    void JournalSizeHelper::AddHeader() {
+        m_size += sizeof(JournalHeader);
+    }
+
+    void JournalSizeHelper::AddSetEntry(size_t key_size, size_t value_size) {
+        m_size += sizeof(ArchiveEntryHeader) + key_size + value_size;
+    }
+
+    void JournalSizeHelper::AddRemoveEntry(size_t key_size) {
+        m_size += sizeof(ArchiveEntryHeader) + key_size;
+    }
+
+    void JournalSizeHelper::AddCompactionEntry() {
+        m_size += sizeof(ArchiveEntryHeader) + JournalArchiveHashSize;
+    }
+
 }
\ No newline at end of file
@@ -124,9 +124,15 @@ namespace ams::lm::srv {
 
             /* Do flush loop. */
             do {
-                if (LogBuffer::GetDefaultInstance().Flush()) {
+                /* If the sd card logger is holding buffered logs, only wait for new logs until they must be flushed. */
+                TimeSpan sd_flush_timeout;
+                const bool has_sd_flush_timeout = SdCardLogger::GetInstance().GetTimeUntilFlush(std::addressof(sd_flush_timeout));
+
+                if (has_sd_flush_timeout ? LogBuffer::GetDefaultInstance().TimedFlush(sd_flush_timeout) : LogBuffer::GetDefaultInstance().Flush()) {
                     EventLogTransmitter::GetDefaultInstance().PushLogPacketDropCountIfExists();
                 }
+
+                SdCardLogger::GetInstance().FlushIfExpired();
             } while (WaitForFlush());
 
             /* Clear connection observer. */
@@ -86,15 +86,16 @@ namespace ams::lm::srv {
     }
 
     LogBuffer &LogBuffer::GetDefaultInstance() {
-        AMS_FUNCTION_LOCAL_STATIC_CONSTINIT(u8, s_default_buffers[128_KB * 2]);
+        /* NOTE: Ring records are accessed atomically, so the buffer must be aligned to the record alignment. */
+        alignas(0x10) static constinit u8 s_default_buffers[128_KB * 2] = {};
         AMS_FUNCTION_LOCAL_STATIC_CONSTINIT(LogBuffer, s_default_log_buffer, s_default_buffers, sizeof(s_default_buffers), DefaultFlushFunction);
 
         return s_default_log_buffer;
     }
 
     void LogBuffer::CancelPush() {
-        /* Acquire exclusive access to the push buffer. */
-        std::scoped_lock lk(m_push_buffer_mutex);
+        /* Acquire exclusive access to our wait state. */
+        std::scoped_lock lk(m_wait_mutex);
 
         /* Cancel any pending pushes. */
         if (m_push_ready_wait_count > 0) {
@@ -103,9 +104,96 @@ namespace ams::lm::srv {
         }
     }
 
+    void LogBuffer::CopyToRing(u64 position, const void *src, size_t size) {
+        const size_t offset     = position % m_buffer_size;
+        const size_t first_size = std::min(size, m_buffer_size - offset);
+
+        std::memcpy(m_ring + offset, src, first_size);
+        if (first_size < size) {
+            std::memcpy(m_ring, static_cast<const u8 *>(src) + first_size, size - first_size);
+        }
+    }
+
+    void LogBuffer::CopyFromRing(void *dst, u64 position, size_t size) const {
+        const size_t offset     = position % m_buffer_size;
+        const size_t first_size = std::min(size, m_buffer_size - offset);
+
+        std::memcpy(dst, m_ring + offset, first_size);
+        if (first_size < size) {
+            std::memcpy(static_cast<u8 *>(dst) + first_size, m_ring, size - first_size);
+        }
+    }
+
+    void LogBuffer::ClearRing(u64 position, size_t size) {
+        const size_t offset     = position % m_buffer_size;
+        const size_t first_size = std::min(size, m_buffer_size - offset);
+
+        std::memset(m_ring + offset, 0, first_size);
+        if (first_size < size) {
+            std::memset(m_ring, 0, size - first_size);
+        }
+    }
+
+    bool LogBuffer::IsRecordCommitted(u64 position) const {
+        /* NOTE: Record headers never straddle the end of the ring, as records are aligned to the header size. */
+        auto *header = reinterpret_cast<RecordHeader *>(m_ring + (position % m_buffer_size));
+
+        /* A record is committed once its sequence matches its position. */
+        /* Drained space is cleared before it is released, so neither stale headers nor stale payload can match. */
+        return util::AtomicRef<u64>(header->sequence).Load() == position + 1;
+    }
+
+    bool LogBuffer::WaitForPushReady(size_t record_size) {
+        /* Acquire exclusive access to our wait state. */
+        std::scoped_lock lk(m_wait_mutex);
+
+        /* Note that we're waiting before checking for space, so that the flusher can't miss us. */
+        ++m_push_ready_wait_count;
+
+        bool ready = true;
+        while (m_tail.Load() + record_size - m_head.Load() > m_buffer_size) {
+            /* Wait for push to be ready. */
+            m_cv_push_ready.Wait(m_wait_mutex);
+
+            /* Check if push was canceled. */
+            if (m_push_canceled) {
+                ready = false;
+                break;
+            }
+        }
+
+        if ((--m_push_ready_wait_count) == 0) {
+            m_push_canceled = false;
+        }
+
+        return ready;
+    }
+
+    bool LogBuffer::Reserve(u64 *out, size_t record_size, bool blocking) {
+        u64 tail = m_tail.Load();
+        while (true) {
+            /* Wait for enough space to be available. */
+            if (tail + record_size - m_head.Load() > m_buffer_size) {
+                /* Only block if we're allowed to. */
+                if (!blocking || !this->WaitForPushReady(record_size)) {
+                    return false;
+                }
+
+                tail = m_tail.Load();
+                continue;
+            }
+
+            /* Try to claim the space. */
+            if (m_tail.CompareExchangeWeak(tail, tail + record_size)) {
+                *out = tail;
+                return true;
+            }
+        }
+    }
+
     bool LogBuffer::PushImpl(const void *data, size_t size, bool blocking) {
         /* Check pre-conditions. */
-        AMS_ASSERT(size <= m_buffer_size);
+        AMS_ASSERT(GetRecordSize(size) <= m_buffer_size);
         AMS_ASSERT(data != nullptr || size == 0);
 
         /* Check that we have data to push. */
@@ -113,95 +201,104 @@ namespace ams::lm::srv {
             return true;
         }
 
-        /* Wait to be able to push. */
-        u8 *dst;
-        {
-            /* Acquire exclusive access to the push buffer. */
-            std::scoped_lock lk(m_push_buffer_mutex);
+        /* Reserve space for our record. */
+        u64 position;
+        if (!this->Reserve(std::addressof(position), GetRecordSize(size), blocking)) {
+            return false;
+        }
 
-            /* Wait for enough space to be available. */
-            while (size > m_buffer_size - m_push_buffer->m_stored_size) {
-                /* Only block if we're allowed to. */
-                if (!blocking) {
-                    return false;
-                }
+        /* Copy the data to the ring. */
+        auto *header = reinterpret_cast<RecordHeader *>(m_ring + (position % m_buffer_size));
+        header->size = static_cast<u32>(size);
+        this->CopyToRing(position + sizeof(RecordHeader), data, size);
 
-                /* Wait for push to be ready. */
-                {
-                    ++m_push_ready_wait_count;
-                    m_cv_push_ready.Wait(m_push_buffer_mutex);
-                    --m_push_ready_wait_count;
-                }
+        /* Commit the record, and signal the flusher if it's waiting for us. */
+        util::AtomicRef<u64>(header->sequence).Store(position + 1);
+        if (m_flush_ready_waiting.Load()) {
+            std::scoped_lock lk(m_wait_mutex);
+            m_cv_flush_ready.Signal();
+        }
 
-                /* Check if push was canceled. */
-                if (m_push_canceled) {
-                    if (m_push_ready_wait_count == 0) {
-                        m_push_canceled = false;
-                    }
+        return true;
+    }
 
-                    return false;
-                }
-            }
+    bool LogBuffer::WaitForFlushReady(TimeSpan timeout) {
+        /* Acquire exclusive access to our wait state. */
+        std::scoped_lock lk(m_wait_mutex);
 
-            /* Set the destination. */
-            dst = m_push_buffer->m_head + m_push_buffer->m_stored_size;
+        /* Note that we're waiting before checking for records, so that producers can't miss us. */
+        m_flush_ready_waiting = true;
+        ON_SCOPE_EXIT { m_flush_ready_waiting = false; };
 
-            /* Advance the push buffer. */
-            m_push_buffer->m_stored_size += size;
-            ++m_push_buffer->m_reference_count;
+        while (!this->IsRecordCommitted(m_head.Load())) {
+            /* Wait for us to be ready to flush. */
+            if (timeout == TimeSpan::FromNanoSeconds(std::numeric_limits<s64>::max())) {
+                m_cv_flush_ready.Wait(m_wait_mutex);
+            } else if (!m_cv_flush_ready.TimedWait(m_wait_mutex, timeout)) {
+                return false;
+            }
         }
 
-        /* Copy the data to the push buffer. */
-        std::memcpy(dst, data, size);
+        return true;
+    }
 
-        /* Close our push buffer reference, and signal that we can flush. */
-        {
-            /* Acquire exclusive access to the push buffer. */
-            std::scoped_lock lk(m_push_buffer_mutex);
+    size_t LogBuffer::DrainRecords() {
+        /* Copy committed records to the flush buffer, in order, until we reach one which isn't committed. */
+        const u64 start = m_head.Load();
 
-            /* If there are no pending pushes, signal that we can flush. */
-            if ((--m_push_buffer->m_reference_count) == 0) {
-                m_cv_flush_ready.Signal();
+        u64 head = start;
+        while (this->IsRecordCommitted(head)) {
+            const auto *header = reinterpret_cast<const RecordHeader *>(m_ring + (head % m_buffer_size));
+            const size_t size  = header->size;
+            if (size > m_buffer_size - m_flush_stored_size) {
+                break;
             }
+
+            this->CopyFromRing(m_flush_buffer + m_flush_stored_size, head + sizeof(RecordHeader), size);
+
+            m_flush_stored_size += size;
+            head                += GetRecordSize(size);
         }
 
-        return true;
+        /* Release the space we've drained, and signal that we can push. */
+        if (head != start) {
+            /* Clear the space first, as any part of it may hold the header of a record on the next lap. */
+            this->ClearRing(start, head - start);
+            m_head.Store(head);
+
+            if (m_push_ready_wait_count.Load() > 0) {
+                std::scoped_lock lk(m_wait_mutex);
+                m_cv_push_ready.Broadcast();
+            }
+        }
+
+        return head - start;
     }
 
-    bool LogBuffer::FlushImpl(bool blocking) {
+    bool LogBuffer::FlushImpl(bool blocking, TimeSpan timeout) {
         /* Acquire exclusive access to the flush buffer. */
         std::scoped_lock lk(m_flush_buffer_mutex);
 
         /* If we don't have data to flush, wait for us to have data. */
-        if (m_flush_buffer->m_stored_size == 0) {
-            /* Acquire exclusive access to the push buffer. */
-            std::scoped_lock lk(m_push_buffer_mutex);
-
-            /* Wait for there to be pushed data. */
-            while (m_push_buffer->m_stored_size == 0 || m_push_buffer->m_reference_count != 0) {
+        if (m_flush_stored_size == 0) {
+            if (!this->IsRecordCommitted(m_head.Load())) {
                 /* Only block if we're allowed to. */
-                if (!blocking) {
+                if (!blocking || !this->WaitForFlushReady(timeout)) {
                     return false;
                 }
-
-                /* Wait for us to be ready to flush. */
-                m_cv_flush_ready.Wait(m_push_buffer_mutex);
             }
 
-            /* Swap the push buffer and the flush buffer pointers. */
-            std::swap(m_push_buffer, m_flush_buffer);
-
-            /* Signal that we can push. */
-            m_cv_push_ready.Broadcast();
+            /* Take the committed records from the ring. */
+            this->DrainRecords();
         }
 
         /* Flush any data. */
-        if (!m_flush_function(m_flush_buffer->m_head, m_flush_buffer->m_stored_size)) {
+        if (!m_flush_function(m_flush_buffer, m_flush_stored_size)) {
             return false;
         }
 
         /* Reset the flush buffer. */
-        m_flush_buffer->m_stored_size = 0;
+        m_flush_stored_size = 0;
 
         return true;
     }
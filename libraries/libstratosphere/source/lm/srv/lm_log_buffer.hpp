@@ -18,42 +18,47 @@
 
 namespace ams::lm::srv {
 
+    /* Logs are pushed to a ring by any number of producers, and drained by a single flusher. */
+    /* Producers reserve space by atomically advancing the ring's tail, so they only take a lock when they must block. */
+    /* NOTE: The ring must be zero-filled when the buffer is constructed, as a record is recognized as committed by its header. */
     class LogBuffer {
         NON_COPYABLE(LogBuffer);
         NON_MOVEABLE(LogBuffer);
         private:
-            struct BufferInfo {
-                u8 *m_head;
-                size_t m_stored_size;
-                size_t m_reference_count;
+            struct RecordHeader {
+                u64 sequence;
+                u32 size;
+                u32 reserved;
             };
+            static_assert(sizeof(RecordHeader) == 0x10);
+
+            static constexpr size_t RecordAlignment = sizeof(RecordHeader);
         public:
             using FlushFunction = bool (*)(const u8 *data, size_t size);
         private:
-            BufferInfo m_buffers[2];
-            BufferInfo *m_push_buffer;
-            BufferInfo *m_flush_buffer;
+            u8 *m_ring;
+            u8 *m_flush_buffer;
             size_t m_buffer_size;
+            size_t m_flush_stored_size;
             FlushFunction m_flush_function;
-            os::SdkMutex m_push_buffer_mutex;
+            util::Atomic<u64> m_head;
+            util::Atomic<u64> m_tail;
+            util::Atomic<u32> m_push_ready_wait_count;
+            util::Atomic<bool> m_flush_ready_waiting;
+            os::SdkMutex m_wait_mutex;
             os::SdkMutex m_flush_buffer_mutex;
             os::SdkConditionVariable m_cv_push_ready;
             os::SdkConditionVariable m_cv_flush_ready;
             bool m_push_canceled;
-            size_t m_push_ready_wait_count;
         public:
             constexpr explicit LogBuffer(u8 *buffer, size_t buffer_size, FlushFunction f)
-                : m_buffers{}, m_push_buffer(m_buffers + 0), m_flush_buffer(m_buffers + 1),
-                  m_buffer_size(buffer_size / 2), m_flush_function(f), m_push_buffer_mutex{},
-                  m_flush_buffer_mutex{}, m_cv_push_ready{}, m_cv_flush_ready{},
-                  m_push_canceled(false), m_push_ready_wait_count(0)
+                : m_ring(buffer), m_flush_buffer(buffer + (buffer_size / 2)), m_buffer_size(util::AlignDown(buffer_size / 2, RecordAlignment)),
+                  m_flush_stored_size(0), m_flush_function(f), m_head(0), m_tail(0), m_push_ready_wait_count(0), m_flush_ready_waiting(false),
+                  m_wait_mutex{}, m_flush_buffer_mutex{}, m_cv_push_ready{}, m_cv_flush_ready{}, m_push_canceled(false)
             {
                 AMS_ASSERT(buffer != nullptr);
-                AMS_ASSERT(buffer_size > 0);
+                AMS_ASSERT(buffer_size >= 2 * RecordAlignment);
                 AMS_ASSERT(f != nullptr);
-
-                m_buffers[0].m_head = buffer;
-                m_buffers[1].m_head = buffer + (buffer_size / 2);
             }
 
             static LogBuffer &GetDefaultInstance();
@@ -63,11 +68,27 @@ namespace ams::lm::srv {
 
             void CancelPush();
 
-            bool Flush() { return this->FlushImpl(true); }
-            bool TryFlush() { return this->FlushImpl(false); }
+            bool Flush() { return this->FlushImpl(true, TimeSpan::FromNanoSeconds(std::numeric_limits<s64>::max())); }
+            bool TryFlush() { return this->FlushImpl(false, TimeSpan(0)); }
+            bool TimedFlush(TimeSpan timeout) { return this->FlushImpl(true, timeout); }
         private:
             bool PushImpl(const void *data, size_t size, bool blocking);
-            bool FlushImpl(bool blocking);
+            bool FlushImpl(bool blocking, TimeSpan timeout);
+
+            bool Reserve(u64 *out, size_t record_size, bool blocking);
+            bool WaitForPushReady(size_t record_size);
+            bool WaitForFlushReady(TimeSpan timeout);
+
+            bool IsRecordCommitted(u64 position) const;
+            size_t DrainRecords();
+
+            void CopyToRing(u64 position, const void *src, size_t size);
+            void CopyFromRing(void *dst, u64 position, size_t size) const;
+            void ClearRing(u64 position, size_t size);
+
+            static constexpr size_t GetRecordSize(size_t size) {
+                return util::AlignUp(sizeof(RecordHeader) + size, RecordAlignment);
+            }
     };
 
 }
@@ -27,6 +27,11 @@ namespace ams::lm::srv {
         constexpr const char SettingName[]               = "lm";
         constexpr const char SettingKeyLoggingEnabled[]  = "enable_sd_card_logging";
         constexpr const char SettingKeyOutputDirectory[] = "sd_card_log_output_directory";
+        constexpr const char SettingKeyFlushInterval[]   = "sd_card_log_flush_interval_ms";
+        constexpr const char SettingKeyFlushThreshold[]  = "sd_card_log_flush_threshold";
+
+        constexpr inline u32 DefaultFlushIntervalMilliSeconds = 1000;
+        constexpr inline u32 DefaultFlushThreshold            = 32_KB;
 
         constexpr inline size_t LogFileHeaderSize = 8;
         constexpr inline u32 LogFileHeaderMagic   = util::ReverseFourCC<'p','h','p','h'>::Code;
@@ -107,6 +112,15 @@ namespace ams::lm::srv {
             *out_status_changed = status_changed;
         }
 
+        u32 GetSdCardLogSettingU32(const char *key, u32 default_value) {
+            u32 value;
+            if (settings::fwdbg::GetSettingsItemValue(std::addressof(value), sizeof(value), SettingName, key) != sizeof(value)) {
+                return default_value;
+            }
+
+            return value;
+        }
+
         bool GetSdCardLogOutputDirectory(char *dst, size_t size) {
             /* Get the output directory size. */
             const auto value_size = settings::fwdbg::GetSettingsItemValueSize(SettingName, SettingKeyOutputDirectory);
@@ -204,23 +218,13 @@ namespace ams::lm::srv {
             return R_SUCCEEDED(WriteLogFileHeaderImpl(path));
         }
 
-        Result WriteLogFileBodyImpl(const char *path, s64 offset, const u8 *data, size_t size) {
-            /* Open the log file. */
-            fs::FileHandle file;
-            R_TRY(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Write | fs::OpenMode_AllowAppend));
-            ON_SCOPE_EXIT { fs::CloseFile(file); };
-
-            /* Write the data. */
-            R_RETURN(fs::WriteFile(file, offset, data, size, fs::WriteOption::Flush));
-        }
-
-        bool WriteLogFileBody(const char *path, s64 offset, const u8 *data, size_t size) {
-            return R_SUCCEEDED(WriteLogFileBodyImpl(path, offset, data, size));
-        }
-
     }
 
-    SdCardLogger::SdCardLogger() : m_logging_observer_mutex(), m_is_enabled(false), m_is_sd_card_mounted(false), m_is_sd_card_status_unknown(false), m_log_file_offset(0), m_logging_observer(nullptr) {
+    SdCardLogger::SdCardLogger()
+        : m_logging_observer_mutex(), m_is_enabled(false), m_is_sd_card_mounted(false), m_is_sd_card_status_unknown(false), m_is_log_file_open(false), m_is_log_file_dirty(false),
+          m_log_file(), m_log_file_offset(0), m_buffered_size(0), m_flush_threshold(DefaultFlushThreshold), m_flush_interval(TimeSpan::FromMilliSeconds(DefaultFlushIntervalMilliSeconds)),
+          m_flush_deadline(), m_logging_observer(nullptr), m_statistics()
+    {
         /* ... */
     }
 
@@ -252,8 +256,8 @@ namespace ams::lm::srv {
     }
 
     bool SdCardLogger::Initialize() {
-        /* If we're already enabled, nothing to do. */
-        if (this->GetEnabled()) {
+        /* If our log file is already open, nothing to do. */
+        if (m_is_log_file_open) {
             return true;
         }
 
@@ -305,35 +309,146 @@ namespace ams::lm::srv {
             return false;
         }
 
-        /* Set our initial offset. */
-        m_log_file_offset = LogFileHeaderSize;
+        /* Open the log file, and keep it open for as long as we're logging to it. */
+        if (R_FAILED(fs::OpenFile(std::addressof(m_log_file), m_log_file_path, fs::OpenMode_Write | fs::OpenMode_AllowAppend))) {
+            return false;
+        }
+
+        /* Set our initial state. */
+        m_is_log_file_open  = true;
+        m_is_log_file_dirty = false;
+        m_log_file_offset   = LogFileHeaderSize;
+        m_buffered_size     = 0;
+
+        /* Get our flush policy. */
+        m_flush_threshold = std::clamp<size_t>(GetSdCardLogSettingU32(SettingKeyFlushThreshold, DefaultFlushThreshold), WriteChunkAlignment, WriteBufferSize);
+        m_flush_interval  = TimeSpan::FromMilliSeconds(GetSdCardLogSettingU32(SettingKeyFlushInterval, DefaultFlushIntervalMilliSeconds));
 
         return true;
     }
 
     void SdCardLogger::Finalize() {
+        this->CloseLogFile();
         this->SetEnabled(false);
+        this->UnmountSdCard();
+    }
+
+    void SdCardLogger::CloseLogFile() {
+        if (m_is_log_file_open) {
+            /* Try to write out anything we've buffered. */
+            /* NOTE: If the sd card has been removed, this will fail, and there's nothing more we can do. */
+            if (R_SUCCEEDED(this->WriteBufferedData(true))) {
+                this->FlushLogFile();
+            }
+
+            fs::CloseFile(m_log_file);
+            m_is_log_file_open = false;
+            m_buffered_size    = 0;
+        }
+    }
+
+    void SdCardLogger::UnmountSdCard() {
         if (m_is_sd_card_mounted) {
             fs::Unmount(SdCardMountName);
             m_is_sd_card_mounted = false;
         }
     }
 
+    void SdCardLogger::OnWriteFailure() {
+        this->CloseLogFile();
+        if (m_is_sd_card_mounted) {
+            this->UnmountSdCard();
+            m_is_sd_card_status_unknown = true;
+        }
+        this->SetEnabled(false);
+    }
+
+    Result SdCardLogger::WriteBufferedData(bool write_all) {
+        /* Determine how much we can write; unless we must write everything, we only write up to an aligned boundary. */
+        const s64 buffered_end = m_log_file_offset + static_cast<s64>(m_buffered_size);
+        const s64 write_end    = write_all ? buffered_end : util::AlignDown(buffered_end, WriteChunkAlignment);
+        if (write_end <= m_log_file_offset) {
+            R_SUCCEED();
+        }
+
+        const size_t write_size = static_cast<size_t>(write_end - m_log_file_offset);
+
+        /* Write the data. */
+        R_TRY(fs::WriteFile(m_log_file, m_log_file_offset, m_write_buffer, write_size, fs::WriteOption::None));
+
+        m_statistics.bytes_written += write_size;
+        ++m_statistics.write_count;
+
+        /* Move any remaining data to the start of our buffer. */
+        m_buffered_size -= write_size;
+        if (m_buffered_size > 0) {
+            std::memmove(m_write_buffer, m_write_buffer + write_size, m_buffered_size);
+        }
+
+        m_log_file_offset   = write_end;
+        m_is_log_file_dirty = true;
+        R_SUCCEED();
+    }
+
+    Result SdCardLogger::FlushLogFile() {
+        if (m_is_log_file_dirty) {
+            R_TRY(fs::FlushFile(m_log_file));
+
+            m_is_log_file_dirty = false;
+            ++m_statistics.flush_count;
+        }
+
+        R_SUCCEED();
+    }
+
+    bool SdCardLogger::GetTimeUntilFlush(TimeSpan *out) const {
+        /* If we have nothing pending, we don't need to flush. */
+        if (!m_is_log_file_open || (m_buffered_size == 0 && !m_is_log_file_dirty)) {
+            return false;
+        }
+
+        const auto cur_tick = os::GetSystemTick();
+        *out = cur_tick < m_flush_deadline ? (m_flush_deadline - cur_tick).ToTimeSpan() : TimeSpan(0);
+        return true;
+    }
+
+    void SdCardLogger::FlushIfExpired() {
+        if (TimeSpan time_left; this->GetTimeUntilFlush(std::addressof(time_left)) && time_left == TimeSpan(0)) {
+            if (R_FAILED(this->WriteBufferedData(true)) || R_FAILED(this->FlushLogFile())) {
+                this->OnWriteFailure();
+            }
+        }
+    }
+
+    void SdCardLogger::GetStatistics(SdCardLoggerStatistics *out) const {
+        *out = m_statistics;
+    }
+
     bool SdCardLogger::Write(const u8 *data, size_t size) {
         /* Only write if sd card logging is enabled. */
         if (!GetSdCardLoggingEnabled()) {
             return false;
         }
 
+        /* If the sd card was removed or re-inserted since we opened our log file, start over with a new one. */
+        if (m_is_log_file_open) {
+            bool inserted = false, status_changed = false;
+            GetSdCardStatus(std::addressof(inserted), std::addressof(status_changed));
+
+            if (status_changed) {
+                this->CloseLogFile();
+                this->UnmountSdCard();
+            }
+        }
+
         /* Ensure we keep our pre and post-conditions in check. */
         bool success = false;
         ON_SCOPE_EXIT {
-            if (!success && m_is_sd_card_mounted) {
-                fs::Unmount(SdCardMountName);
-                m_is_sd_card_mounted        = false;
-                m_is_sd_card_status_unknown = true;
+            if (!success) {
+                this->OnWriteFailure();
+            } else {
+                this->SetEnabled(true);
             }
-            this->SetEnabled(success);
         };
 
         /* Try to initialize. */
@@ -341,13 +456,36 @@ namespace ams::lm::srv {
             return false;
         }
 
-        /* Try to write the log file. */
-        if (!WriteLogFileBody(m_log_file_path, m_log_file_offset, data, size)) {
+        /* If we have nothing pending, our flush interval starts now. */
+        if (m_buffered_size == 0 && !m_is_log_file_dirty) {
+            m_flush_deadline = os::GetSystemTick() + os::ConvertToTick(m_flush_interval);
+        }
+
+        /* Coalesce the data into our write buffer, writing out aligned chunks as it fills. */
+        while (size > 0) {
+            const size_t cur_size = std::min(size, WriteBufferSize - m_buffered_size);
+            std::memcpy(m_write_buffer + m_buffered_size, data, cur_size);
+
+            m_buffered_size += cur_size;
+            data            += cur_size;
+            size            -= cur_size;
+
+            if (m_buffered_size == WriteBufferSize && R_FAILED(this->WriteBufferedData(false))) {
+                return false;
+            }
+        }
+
+        /* If we've buffered enough data, write it out. */
+        if (m_buffered_size >= m_flush_threshold && R_FAILED(this->WriteBufferedData(false))) {
             return false;
         }
 
-        /* Advance. */
-        m_log_file_offset += size;
+        /* If we've held data for long enough, flush it. */
+        if (os::GetSystemTick() >= m_flush_deadline) {
+            if (R_FAILED(this->WriteBufferedData(true)) || R_FAILED(this->FlushLogFile())) {
+                return false;
+            }
+        }
 
         /* We succeeded. */
         success = true;
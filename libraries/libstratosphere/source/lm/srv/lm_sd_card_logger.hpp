@@ -18,29 +18,61 @@
 
 namespace ams::lm::srv {
 
+    struct SdCardLoggerStatistics {
+        u64 bytes_written;
+        u64 write_count;
+        u64 flush_count;
+    };
+
     class SdCardLogger {
         AMS_SINGLETON_TRAITS(SdCardLogger);
         public:
             using LoggingObserver = void (*)(bool available);
+
+            static constexpr size_t WriteBufferSize     = 64_KB;
+            static constexpr size_t WriteChunkAlignment = 16_KB;
         private:
             os::SdkMutex m_logging_observer_mutex;
             bool m_is_enabled;
             bool m_is_sd_card_mounted;
             bool m_is_sd_card_status_unknown;
+            bool m_is_log_file_open;
+            bool m_is_log_file_dirty;
             char m_log_file_path[0x80];
+            fs::FileHandle m_log_file;
             s64 m_log_file_offset;
+            size_t m_buffered_size;
+            size_t m_flush_threshold;
+            TimeSpan m_flush_interval;
+            os::Tick m_flush_deadline;
             LoggingObserver m_logging_observer;
+            SdCardLoggerStatistics m_statistics;
+            u8 m_write_buffer[WriteBufferSize];
         public:
             void Finalize();
 
             void SetLoggingObserver(LoggingObserver observer);
 
             bool Write(const u8 *data, size_t size);
+
+            /* Gets how long buffered log data may be held before it must be flushed; returns false if nothing is buffered. */
+            bool GetTimeUntilFlush(TimeSpan *out) const;
+            void FlushIfExpired();
+
+            /* NOTE: Like everything else here, this must be called from the flush thread. */
+            void GetStatistics(SdCardLoggerStatistics *out) const;
         private:
             bool GetEnabled() const;
             void SetEnabled(bool enabled);
 
             bool Initialize();
+
+            void OnWriteFailure();
+            void CloseLogFile();
+            void UnmountSdCard();
+
+            Result WriteBufferedData(bool write_all);
+            Result FlushLogFile();
     };
 
 }
@@ -18,7 +18,7 @@
 
 namespace ams::lr {
 
-    class LocationRedirector::Redirection : public util::IntrusiveListBaseNode<Redirection> {
+    class LocationRedirector::Redirection : public util::IntrusiveRedBlackTreeBaseNode<Redirection> {
         NON_COPYABLE(Redirection);
         NON_MOVEABLE(Redirection);
         private:
@@ -56,14 +56,27 @@ namespace ams::lr {
             }
     };
 
+    int LocationRedirector::RedirectionCompare::Compare(const RedBlackKeyType &lhs, const Redirection &rhs) {
+        const auto rhs_id = rhs.GetProgramId();
+        if (lhs.value < rhs_id.value) {
+            return -1;
+        } else if (lhs.value > rhs_id.value) {
+            return 1;
+        } else {
+            return 0;
+        }
+    }
+
+    int LocationRedirector::RedirectionCompare::Compare(const Redirection &lhs, const Redirection &rhs) {
+        return Compare(lhs.GetProgramId(), rhs);
+    }
+
     bool LocationRedirector::FindRedirection(Path *out, RedirectionAttributes *out_attr, ncm::ProgramId program_id) const {
         /* Obtain the path of a matching redirection. */
-        for (const auto &redirection : m_redirection_list) {
-            if (redirection.GetProgramId() == program_id) {
-                redirection.GetPath(out);
-                redirection.GetAttributes(out_attr);
-                return true;
-            }
+        if (const RedirectionTree::const_iterator it = m_redirection_tree.find_key(program_id); it != m_redirection_tree.end()) {
+            it->GetPath(out);
+            it->GetAttributes(out_attr);
+            return true;
         }
         return false;
     }
@@ -76,30 +89,25 @@ namespace ams::lr {
         /* Remove any existing redirections for this program id. */
         this->EraseRedirection(program_id);
 
-        /* Insert a new redirection into the list. */
-        m_redirection_list.push_back(*(new Redirection(program_id, owner_id, path, attr, flags)));
+        /* Insert a new redirection into the tree. */
+        m_redirection_tree.insert(*(new Redirection(program_id, owner_id, path, attr, flags)));
     }
 
     void LocationRedirector::EraseRedirection(ncm::ProgramId program_id) {
-        /* Remove any redirections with a matching program id. */
-        for (auto it = m_redirection_list.begin(); it != m_redirection_list.end(); /* ... */) {
-            if (it->GetProgramId() == program_id) {
-                auto *redirection = std::addressof(*it);
-                it = m_redirection_list.erase(it);
-                delete redirection;
-                break;
-            } else {
-                ++it;
-            }
+        /* Remove the redirection with a matching program id, if there is one. */
+        if (auto it = m_redirection_tree.find_key(program_id); it != m_redirection_tree.end()) {
+            auto *redirection = std::addressof(*it);
+            m_redirection_tree.erase(it);
+            delete redirection;
         }
     }
 
     void LocationRedirector::ClearRedirections(u32 flags) {
         /* Remove any redirections with matching flags. */
-        for (auto it = m_redirection_list.begin(); it != m_redirection_list.end(); /* ... */) {
+        for (auto it = m_redirection_tree.begin(); it != m_redirection_tree.end(); /* ... */) {
             if ((it->GetFlags() & flags) == flags) {
                 auto *redirection = std::addressof(*it);
-                it = m_redirection_list.erase(it);
+                it = m_redirection_tree.erase(it);
                 delete redirection;
             } else {
                 ++it;
@@ -108,7 +116,7 @@ namespace ams::lr {
     }
 
     void LocationRedirector::ClearRedirectionsExcludingOwners(const ncm::ProgramId *excluding_ids, size_t num_ids) {
-        for (auto it = m_redirection_list.begin(); it != m_redirection_list.end();) {
+        for (auto it = m_redirection_tree.begin(); it != m_redirection_tree.end();) {
             /* Skip removal if the redirection has an excluded owner program id. */
             if (this->IsExcluded(it->GetOwnerProgramId(), excluding_ids, num_ids)) {
                 it++;
@@ -117,7 +125,7 @@ namespace ams::lr {
 
             /* Remove the redirection. */
             auto *redirection = std::addressof(*it);
-            it = m_redirection_list.erase(it);
+            it = m_redirection_tree.erase(it);
             delete redirection;
         }
     }
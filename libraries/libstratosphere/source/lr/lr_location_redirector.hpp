@@ -50,12 +50,19 @@ namespace ams::lr {
         NON_MOVEABLE(LocationRedirector);
         private:
             class Redirection;
+
+            struct RedirectionCompare {
+                using RedBlackKeyType = ncm::ProgramId;
+
+                static int Compare(const RedBlackKeyType &lhs, const Redirection &rhs);
+                static int Compare(const Redirection &lhs, const Redirection &rhs);
+            };
         private:
-            using RedirectionList = ams::util::IntrusiveListBaseTraits<Redirection>::ListType;
+            using RedirectionTree = ams::util::IntrusiveRedBlackTreeBaseTraits<Redirection>::TreeType<RedirectionCompare>;
         private:
-            RedirectionList m_redirection_list;
+            RedirectionTree m_redirection_tree;
         public:
-            LocationRedirector() : m_redirection_list() { /* ... */ }
+            LocationRedirector() : m_redirection_tree() { /* ... */ }
             ~LocationRedirector() { this->ClearRedirections(); }
 
             /* API. */
@@ -542,7 +542,11 @@ namespace ams::ncm {
             ON_RESULT_FAILURE { fs::Unmount(root.mount_name); };
 
             /* Initialize and load the key value store from the filesystem. */
-            R_TRY(root.kvs->Initialize(root.path, root.max_content_metas, root.memory_resource));
+            if (root.use_journal) {
+                R_TRY(root.kvs->InitializeWithJournal(root.path, root.max_content_metas, root.memory_resource));
+            } else {
+                R_TRY(root.kvs->Initialize(root.path, root.max_content_metas, root.memory_resource));
+            }
             R_TRY(root.kvs->Load());
 
             /* Create the content meta database. */
@@ -726,6 +730,9 @@ namespace ams::ncm {
             AMS_UNREACHABLE_DEFAULT_CASE();
         }
 
+        /* Journal changes to databases backed by save data, if we should. */
+        out->use_journal = m_enable_content_meta_database_journal && out->save_data_info.has_value();
+
         /* Clear the kvs. */
         out->kvs = util::nullopt;
 
@@ -920,6 +927,8 @@ namespace ams::ncm {
         }
         m_num_configs = num_configs;
 
+        m_enable_content_meta_database_journal = manager_config.IsContentMetaDatabaseJournalEnabled();
+
         /* Setup roots. */
         m_num_integrated_content_storage_entries = 0;
         m_num_content_storage_entries            = 0;
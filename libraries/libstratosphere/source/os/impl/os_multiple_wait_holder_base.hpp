@@ -24,6 +24,9 @@ namespace ams::os::impl {
     class MultiWaitHolderBase {
         private:
             MultiWaitImpl *m_multi_wait = nullptr;
+            #if defined(ATMOSPHERE_OS_LINUX)
+            os::NativeHandle m_registered_handle = os::InvalidNativeHandle;
+            #endif
         public:
             util::IntrusiveListNode m_multi_wait_node;
             util::IntrusiveListNode m_object_list_node;
@@ -56,6 +59,17 @@ namespace ams::os::impl {
 
             ALWAYS_INLINE bool IsLinked()    const { return m_multi_wait != nullptr; }
             ALWAYS_INLINE bool IsNotLinked() const { return m_multi_wait == nullptr; }
+
+            #if defined(ATMOSPHERE_OS_LINUX)
+            /* Interface with the multi wait target, which records the handle it registered for us. */
+            ALWAYS_INLINE void SetRegisteredHandle(os::NativeHandle handle) {
+                m_registered_handle = handle;
+            }
+
+            ALWAYS_INLINE os::NativeHandle GetRegisteredHandle() const {
+                return m_registered_handle;
+            }
+            #endif
     };
 
     class MultiWaitHolderOfUserWaitObject : public MultiWaitHolderBase {
@@ -58,7 +58,12 @@ namespace ams::os::impl {
                     ON_RESULT_FAILURE { signaled_holder = nullptr; };
 
                     s32 index;
+                    #if defined(AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET)
+                    MultiWaitHolderBase *native_holder = nullptr;
+                    R_TRY(m_target_impl.TimedReplyAndReceive(std::addressof(index), std::addressof(native_holder), reply_target, TimeSpan::FromNanoSeconds(0)));
+                    #else
                     R_TRY(m_target_impl.TimedReplyAndReceive(std::addressof(index), nullptr, 0, 0, reply_target, TimeSpan::FromNanoSeconds(0)));
+                    #endif
                 }
             }
         } else {
@@ -71,11 +76,16 @@ namespace ams::os::impl {
 
     template<bool AllowReply>
     Result MultiWaitImpl::InternalWaitAnyImpl(MultiWaitHolderBase **out, bool infinite, TimeSpan timeout, NativeHandle reply_target) {
+        #if defined(AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET)
+        /* Our native handles are registered with the target as they're linked, so there's no array to build. */
+        MultiWaitHolderBase *native_holder = nullptr;
+        #else
         /* Build the objects array. */
         NativeHandle object_handles[MaximumHandleCount];
         MultiWaitHolderBase *objects[MaximumHandleCount];
 
         const s32 count = this->ConstructObjectsArray(object_handles, objects, MaximumHandleCount);
+        #endif
 
         /* Determine the appropriate end time for our wait. */
         const TimeSpan end_time = infinite ? TimeSpan::FromNanoSeconds(std::numeric_limits<s64>::max()) : os::impl::GetCurrentTick().ToTimeSpan() + timeout;
@@ -92,6 +102,23 @@ namespace ams::os::impl {
             /* Perform the wait using native apis. */
             s32 index         = WaitInvalid;
             Result wait_result = ResultSuccess();
+            #if defined(AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET)
+            if (infinite && min_timeout_object == nullptr) {
+                /* If we're performing an infinite wait, just do the appropriate wait or reply/receive. */
+                if constexpr (AllowReply) {
+                    wait_result = m_target_impl.ReplyAndReceive(std::addressof(index), std::addressof(native_holder), reply_target);
+                } else {
+                    wait_result = m_target_impl.WaitAny(std::addressof(index), std::addressof(native_holder));
+                }
+            } else {
+                /* We need to do our wait with a timeout. */
+                if constexpr (AllowReply) {
+                    wait_result = m_target_impl.TimedReplyAndReceive(std::addressof(index), std::addressof(native_holder), reply_target, min_timeout);
+                } else {
+                    wait_result = m_target_impl.TimedWaitAny(std::addressof(index), std::addressof(native_holder), min_timeout);
+                }
+            }
+            #else
             if (infinite && min_timeout_object == nullptr) {
                 /* If we're performing an infinite wait, just do the appropriate wait or reply/receive. */
                 if constexpr (AllowReply) {
@@ -111,6 +138,7 @@ namespace ams::os::impl {
                     }
                 }
             }
+            #endif
 
             /* Process the result of our wait. */
             switch (index) {
@@ -155,14 +183,21 @@ namespace ams::os::impl {
                     break;
                 default: /* 0 - 0x3F, valid. */
                     {
+                        #if defined(AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET)
+                        /* The target tells us which of our holders was signaled. */
+                        AMS_ASSERT(native_holder != nullptr);
+                        MultiWaitHolderBase *signaled_object = native_holder;
+                        #else
                         /* Sanity check that the returned index is within the range of our objects array. */
                         AMS_ASSERT(0 <= index && index < count);
+                        MultiWaitHolderBase *signaled_object = objects[index];
+                        #endif
 
                         std::scoped_lock lk(m_cs_wait);
 
                         /* Set our signaled holder (and the output) as the newly signaled object. */
-                        m_signaled_holder = objects[index];
-                        *out              = objects[index];
+                        m_signaled_holder = signaled_object;
+                        *out              = signaled_object;
                         R_RETURN(wait_result);
                     }
                     break;
@@ -189,6 +224,7 @@ namespace ams::os::impl {
         R_RETURN(this->WaitAnyImpl<true>(out, true, TimeSpan::FromNanoSeconds(std::numeric_limits<s64>::max()), reply_target));
     }
 
+    #if !defined(AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET)
     s32 MultiWaitImpl::ConstructObjectsArray(NativeHandle out_handles[], MultiWaitHolderBase *out_objects[], s32 num) {
         /* Add all objects with a native handle to the output array. */
         s32 count = 0;
@@ -207,6 +243,7 @@ namespace ams::os::impl {
 
         return count;
     }
+    #endif
 
     MultiWaitHolderBase *MultiWaitImpl::AddToEachObjectListAndCheckObjectState() {
         /* Add each holder to the current object list, checking for the first signaled object. */
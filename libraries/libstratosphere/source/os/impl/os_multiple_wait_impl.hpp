@@ -32,7 +32,9 @@ namespace ams::os::impl {
 
     class MultiWaitImpl {
         public:
+            #if !defined(AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET)
             static constexpr size_t MaximumHandleCount = MultiWaitTargetImpl::MaximumHandleCount;
+            #endif
             static constexpr s32 WaitInvalid   = -3;
             static constexpr s32 WaitCancelled = -2;
             static constexpr s32 WaitTimedOut  = -1;
@@ -50,7 +52,9 @@ namespace ams::os::impl {
             template<bool AllowReply>
             Result InternalWaitAnyImpl(MultiWaitHolderBase **out, bool infinite, TimeSpan timeout, NativeHandle reply_target);
 
+            #if !defined(AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET)
             s32 ConstructObjectsArray(NativeHandle out_handles[], MultiWaitHolderBase *out_objects[], s32 num);
+            #endif
 
             MultiWaitHolderBase *AddToEachObjectListAndCheckObjectState();
             void                 RemoveFromEachObjectList();
@@ -85,14 +89,17 @@ namespace ams::os::impl {
 
             void PushBackToList(MultiWaitHolderBase &holder_base) {
                 m_multi_wait_list.push_back(holder_base);
+                this->RegisterToTarget(holder_base);
             }
 
             void EraseFromList(MultiWaitHolderBase &holder_base) {
+                this->UnregisterFromTarget(holder_base);
                 m_multi_wait_list.erase(m_multi_wait_list.iterator_to(holder_base));
             }
 
             void EraseAllFromList() {
                 while (!m_multi_wait_list.empty()) {
+                    this->UnregisterFromTarget(m_multi_wait_list.front());
                     m_multi_wait_list.front().SetMultiWait(nullptr);
                     m_multi_wait_list.pop_front();
                 }
@@ -101,6 +108,8 @@ namespace ams::os::impl {
             void MoveAllFromOther(MultiWaitImpl &other) {
                 /* Set ourselves as multi wait for all of the other's holders. */
                 for (auto &w : other.m_multi_wait_list) {
+                    other.UnregisterFromTarget(w);
+                    this->RegisterToTarget(w);
                     w.SetMultiWait(this);
                 }
 
@@ -113,6 +122,22 @@ namespace ams::os::impl {
             }
 
             void NotifyAndWakeupThread(MultiWaitHolderBase *holder_base);
+        private:
+            ALWAYS_INLINE void RegisterToTarget(MultiWaitHolderBase &holder_base) {
+                #if defined(AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET)
+                m_target_impl.RegisterHolder(holder_base);
+                #else
+                AMS_UNUSED(holder_base);
+                #endif
+            }
+
+            ALWAYS_INLINE void UnregisterFromTarget(MultiWaitHolderBase &holder_base) {
+                #if defined(AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET)
+                m_target_impl.UnregisterHolder(holder_base);
+                #else
+                AMS_UNUSED(holder_base);
+                #endif
+            }
     };
 
 }
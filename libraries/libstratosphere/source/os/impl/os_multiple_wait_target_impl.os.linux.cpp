@@ -19,17 +19,83 @@
 #include "os_timeout_helper.hpp"
 #include "os_inter_process_event_impl.os.linux.hpp"
 
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <fcntl.h>
 
 namespace ams::os::impl {
 
+    namespace {
+
+        constexpr inline s64 NanoSecondsPerMilliSecond = TimeSpan::FromMilliSeconds(1).GetNanoSeconds();
+        constexpr inline s64 NanoSecondsPerSecond      = TimeSpan::FromSeconds(1).GetNanoSeconds();
+
+        bool IsEpollTimeoutExact(s64 ns) {
+            /* epoll_wait's timeout has millisecond granularity. */
+            return ns <= 0 || (ns % NanoSecondsPerMilliSecond) == 0;
+        }
+
+        s32 ConvertToEpollTimeout(s64 ns) {
+            /* Infinite waits have negative timeout. */
+            if (ns < 0) {
+                return -1;
+            }
+
+            const s64 ms = ns / NanoSecondsPerMilliSecond;
+            return static_cast<s32>(std::min<s64>(ms, std::numeric_limits<s32>::max()));
+        }
+
+        void SetTimer(NativeHandle timer, s64 ns) {
+            /* A zero expiration disarms the timer, and clears any expiration which has not been read. */
+            struct itimerspec spec = {};
+            spec.it_value.tv_sec  = ns / NanoSecondsPerSecond;
+            spec.it_value.tv_nsec = ns % NanoSecondsPerSecond;
+
+            AMS_ABORT_UNLESS(::timerfd_settime(timer, 0, std::addressof(spec), nullptr) == 0);
+        }
+
+        NativeHandle DuplicateHandle(NativeHandle handle) {
+            NativeHandle dup;
+            do {
+                dup = ::fcntl(handle, F_DUPFD_CLOEXEC, 0);
+            } while (dup < 0 && errno == EINTR);
+
+            return dup;
+        }
+
+    }
+
     MultiWaitLinuxImpl::MultiWaitLinuxImpl() {
         R_ABORT_UNLESS(InterProcessEventLinuxImpl::CreateSingle(std::addressof(m_cancel_event)));
+
+        /* Create our epoll instance. */
+        do {
+            m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        } while (m_epoll < 0 && errno == EINTR);
+        AMS_ABORT_UNLESS(m_epoll >= 0);
+
+        /* Create the timer used for timeouts which epoll can't express in milliseconds. */
+        m_timer = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        AMS_ABORT_UNLESS(m_timer >= 0);
+
+        /* Register our cancel event. */
+        /* NOTE: The cancel event is cleared whenever it is reported, so it only needs edge notification. */
+        struct epoll_event cancel_ev = { .events = EPOLLIN | EPOLLET, .data = { .ptr = nullptr } };
+        AMS_ABORT_UNLESS(::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_cancel_event, std::addressof(cancel_ev)) == 0);
+
+        /* Register our timer. */
+        /* NOTE: The timer is disarmed after every wait which arms it, which also clears its readiness. */
+        struct epoll_event timer_ev = { .events = EPOLLIN, .data = { .ptr = std::addressof(m_timer) } };
+        AMS_ABORT_UNLESS(::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_timer, std::addressof(timer_ev)) == 0);
     }
 
     MultiWaitLinuxImpl::~MultiWaitLinuxImpl() {
+        InterProcessEventLinuxImpl::Close(m_epoll);
+        InterProcessEventLinuxImpl::Close(m_timer);
         InterProcessEventLinuxImpl::Close(m_cancel_event);
 
+        m_epoll        = InvalidNativeHandle;
+        m_timer        = InvalidNativeHandle;
         m_cancel_event = InvalidNativeHandle;
     }
 
@@ -37,64 +103,99 @@ namespace ams::os::impl {
         InterProcessEventLinuxImpl::Signal(m_cancel_event);
     }
 
-    Result MultiWaitLinuxImpl::PollNativeHandlesImpl(s32 *out_index, s32 num, NativeHandle arr[], s32 array_size, s64 ns) {
-        /* Check that we can add our cancel handle to the wait. */
-        AMS_ABORT_UNLESS(array_size <= static_cast<s32>(MaximumHandleCount));
-        AMS_UNUSED(array_size);
-
-        /* Create poll fds. */
-        struct pollfd pfds[MaximumHandleCount + 1];
-        for (auto i = 0; i < num; ++i) {
-            pfds[i].fd      = arr[i];
-            pfds[i].events  = POLLIN;
-            pfds[i].revents = 0;
+    void MultiWaitLinuxImpl::RegisterHolder(MultiWaitHolderBase &holder_base) {
+        /* Only holders with native handles are waited on by us. */
+        os::NativeHandle handle = os::InvalidNativeHandle;
+        if (!holder_base.GetNativeHandle(std::addressof(handle))) {
+            return;
         }
 
-        pfds[num].fd      = m_cancel_event;
-        pfds[num].events  = POLLIN;
-        pfds[num].revents = 0;
-
-        /* Determine timeout. */
-        constexpr s64 NanoSecondsPerSecond = TimeSpan::FromSeconds(1).GetNanoSeconds();
-        struct timespec ts = { .tv_sec = (ns / NanoSecondsPerSecond), .tv_nsec = ns % NanoSecondsPerSecond };
+        /* NOTE: Holders must remain signaled until their signal is consumed, so they are level-triggered. */
+        struct epoll_event ev = { .events = EPOLLIN, .data = { .ptr = std::addressof(holder_base) } };
+        if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, handle, std::addressof(ev)) == 0) {
+            holder_base.SetRegisteredHandle(handle);
+            return;
+        }
+        int error = errno;
 
-        /* Wait. */
-        while (true) {
-            const auto ret = ::ppoll(pfds, num + 1, ns >= 0 ? std::addressof(ts) : nullptr, nullptr);
-            if (ret < 0) {
-                /* Treat EINTR like a cancellation event; this will lead to a re-poll if nothing is signaled. */
-                AMS_ABORT_UNLESS(errno == EINTR);
+        /* If another holder already waits on the same handle, epoll won't accept it twice; register a duplicate of the handle instead. */
+        if (error == EEXIST) {
+            const NativeHandle dup = DuplicateHandle(handle);
+            AMS_ABORT_UNLESS(dup >= 0);
 
-                *out_index = MultiWaitImpl::WaitCancelled;
-                R_SUCCEED();
+            if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, dup, std::addressof(ev)) == 0) {
+                holder_base.SetRegisteredHandle(dup);
+                return;
             }
+            error = errno;
+
+            InterProcessEventLinuxImpl::Close(dup);
+        }
+
+        /* Otherwise, the handle isn't one we can wait on (e.g. it has already been closed), and so the holder can never be signaled. */
+        AMS_ABORT_UNLESS(error == EBADF || error == EPERM);
+        holder_base.SetRegisteredHandle(os::InvalidNativeHandle);
+    }
 
-            /* Determine what event was polled. */
-            if (ret == 0) {
-                *out_index = MultiWaitImpl::WaitTimedOut;
-                R_SUCCEED();
-            } else if (pfds[num].revents != 0) {
-                *out_index = MultiWaitImpl::WaitCancelled;
-
-                /* Reset our cancel event. */
-                InterProcessEventLinuxImpl::Clear(m_cancel_event);
-
-                R_SUCCEED();
-            } else {
-                for (auto i = 0; i < num; ++i) {
-                    if (pfds[i].revents != 0) {
-                        *out_index = i;
-                        R_SUCCEED();
-                    }
-                }
-
-                AMS_ABORT("This should be impossible?");
+    void MultiWaitLinuxImpl::UnregisterHolder(MultiWaitHolderBase &holder_base) {
+        const os::NativeHandle registered = holder_base.GetRegisteredHandle();
+        if (registered == os::InvalidNativeHandle) {
+            return;
+        }
+        holder_base.SetRegisteredHandle(os::InvalidNativeHandle);
+
+        /* Remove the handle from our epoll instance. */
+        /* NOTE: epoll only drops a registration once every handle to the file is closed, so this is needed even for duplicates. */
+        AMS_ABORT_UNLESS(::epoll_ctl(m_epoll, EPOLL_CTL_DEL, registered, nullptr) == 0);
+
+        /* If the handle was duplicated for us, close the duplicate. */
+        os::NativeHandle handle = os::InvalidNativeHandle;
+        if (holder_base.GetNativeHandle(std::addressof(handle)) && handle != registered) {
+            InterProcessEventLinuxImpl::Close(registered);
+        }
+    }
+
+    Result MultiWaitLinuxImpl::WaitRegisteredImpl(s32 *out_index, MultiWaitHolderBase **out, s64 ns) {
+        /* If epoll can't express our timeout exactly, arm our timer with it and wait for the timer instead. */
+        const bool use_timer = !IsEpollTimeoutExact(ns);
+        if (use_timer) {
+            SetTimer(m_timer, ns);
+        }
+        ON_SCOPE_EXIT {
+            if (use_timer) {
+                SetTimer(m_timer, 0);
             }
+        };
+
+        /* Wait for a single event; level-triggered holders which remain signaled are moved to the back of the ready list, so this is fair. */
+        struct epoll_event ev;
+        const auto ret = ::epoll_wait(m_epoll, std::addressof(ev), 1, use_timer ? -1 : ConvertToEpollTimeout(ns));
+        if (ret < 0) {
+            /* Treat EINTR like a cancellation event; this will lead to a re-poll if nothing is signaled. */
+            AMS_ABORT_UNLESS(errno == EINTR);
+
+            *out_index = MultiWaitImpl::WaitCancelled;
+            R_SUCCEED();
+        }
+
+        /* Determine what event was polled. */
+        if (ret == 0 || ev.data.ptr == std::addressof(m_timer)) {
+            *out_index = MultiWaitImpl::WaitTimedOut;
+        } else if (ev.data.ptr == nullptr) {
+            *out_index = MultiWaitImpl::WaitCancelled;
+
+            /* Reset our cancel event. */
+            InterProcessEventLinuxImpl::Clear(m_cancel_event);
+        } else {
+            *out_index = 0;
+            *out       = static_cast<MultiWaitHolderBase *>(ev.data.ptr);
         }
+
+        R_SUCCEED();
     }
 
-    Result MultiWaitLinuxImpl::ReplyAndReceiveImpl(s32 *out_index, s32 num, NativeHandle arr[], s32 array_size, s64 ns, NativeHandle reply_target) {
-        AMS_UNUSED(out_index, num, arr, array_size, ns, reply_target);
+    Result MultiWaitLinuxImpl::ReplyAndReceiveImpl(s32 *out_index, MultiWaitHolderBase **out, s64 ns, NativeHandle reply_target) {
+        AMS_UNUSED(out_index, out, ns, reply_target);
         R_ABORT_UNLESS(os::ResultNotImplemented());
     }
 
@@ -17,41 +17,48 @@
 #include <stratosphere.hpp>
 #include "os_thread_manager.hpp"
 
+/* Native handles are registered with the target as holders are linked, rather than being collected for each wait. */
+#define AMS_OS_IMPL_USE_REGISTERED_MULTI_WAIT_TARGET
+
 namespace ams::os::impl {
 
+    class MultiWaitHolderBase;
+
     class MultiWaitLinuxImpl {
-        public:
-            /* TODO: This can potentially be higher. */
-            static constexpr size_t MaximumHandleCount = 64;
         private:
             NativeHandle m_cancel_event;
+            NativeHandle m_timer;
+            NativeHandle m_epoll;
         private:
-            Result PollNativeHandlesImpl(s32 *out_index, s32 num, NativeHandle arr[], s32 array_size, s64 ns);
-            Result ReplyAndReceiveImpl(s32 *out_index, s32 num, NativeHandle arr[], s32 array_size, s64 ns, NativeHandle reply_target);
+            Result WaitRegisteredImpl(s32 *out_index, MultiWaitHolderBase **out, s64 ns);
+            Result ReplyAndReceiveImpl(s32 *out_index, MultiWaitHolderBase **out, s64 ns, NativeHandle reply_target);
         public:
             MultiWaitLinuxImpl();
             ~MultiWaitLinuxImpl();
 
             void CancelWait();
 
-            Result WaitAny(s32 *out_index, NativeHandle arr[], s32 array_size, s32 num) {
-                R_RETURN(this->PollNativeHandlesImpl(out_index, num, arr, array_size, static_cast<s64>(-1)));
+            void RegisterHolder(MultiWaitHolderBase &holder_base);
+            void UnregisterHolder(MultiWaitHolderBase &holder_base);
+
+            Result WaitAny(s32 *out_index, MultiWaitHolderBase **out) {
+                R_RETURN(this->WaitRegisteredImpl(out_index, out, static_cast<s64>(-1)));
             }
 
-            Result TryWaitAny(s32 *out_index, NativeHandle arr[], s32 array_size, s32 num) {
-                R_RETURN(this->PollNativeHandlesImpl(out_index, num, arr, array_size, 0));
+            Result TryWaitAny(s32 *out_index, MultiWaitHolderBase **out) {
+                R_RETURN(this->WaitRegisteredImpl(out_index, out, 0));
             }
 
-            Result TimedWaitAny(s32 *out_index, NativeHandle arr[], s32 array_size, s32 num, TimeSpan ts) {
-                R_RETURN(this->PollNativeHandlesImpl(out_index, num, arr, array_size, ts.GetNanoSeconds()));
+            Result TimedWaitAny(s32 *out_index, MultiWaitHolderBase **out, TimeSpan ts) {
+                R_RETURN(this->WaitRegisteredImpl(out_index, out, ts.GetNanoSeconds()));
             }
 
-            Result ReplyAndReceive(s32 *out_index, NativeHandle arr[], s32 array_size, s32 num, NativeHandle reply_target) {
-                R_RETURN(this->ReplyAndReceiveImpl(out_index, num, arr, array_size, std::numeric_limits<s64>::max(), reply_target));
+            Result ReplyAndReceive(s32 *out_index, MultiWaitHolderBase **out, NativeHandle reply_target) {
+                R_RETURN(this->ReplyAndReceiveImpl(out_index, out, std::numeric_limits<s64>::max(), reply_target));
             }
 
-            Result TimedReplyAndReceive(s32 *out_index, NativeHandle arr[], s32 array_size, s32 num, NativeHandle reply_target, TimeSpan ts) {
-                R_RETURN(this->ReplyAndReceiveImpl(out_index, num, arr, array_size, ts.GetNanoSeconds(), reply_target));
+            Result TimedReplyAndReceive(s32 *out_index, MultiWaitHolderBase **out, NativeHandle reply_target, TimeSpan ts) {
+                R_RETURN(this->ReplyAndReceiveImpl(out_index, out, ts.GetNanoSeconds(), reply_target));
             }
 
             void SetCurrentThreadHandleForCancelWait() {
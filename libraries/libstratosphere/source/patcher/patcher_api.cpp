@@ -30,9 +30,60 @@ namespace ams::patcher {
         constexpr size_t IpsFileExtensionLength = util::Strlen(IpsFileExtension);
         constexpr size_t ModuleIpsPatchLength = 2 * sizeof(ro::ModuleId) + IpsFileExtensionLength;
 
+        /* NOTE: Patches are indexed, so that a module load doesn't need to re-walk the patch directory and re-parse every patch for the module. */
+        /* The index is rebuilt whenever the set of patch directories changes, or when it is explicitly invalidated; */
+        /* if it runs out of room, we fall back to walking the directory and parsing patches as we apply them. */
+        /* The index lives in loader/ro's bss, so it is sized for typical patch sets rather than for every possible one. */
+        constexpr size_t IpsReadBufferSize         = os::MemoryPageSize;
+        constexpr size_t PatchDirectoryEntryCount  = 4;
+        constexpr size_t PatchFileEntryCount       = 8;
+        constexpr size_t PatchFileCountMax         = 0x40;
+        constexpr size_t IpsRecordCountMax         = 0x400;
+        constexpr size_t PatchPathBufferSize       = 4_KB;
+
+        struct IpsRecord {
+            u32 patch_offset;
+            u32 data_offset;
+            u16 size;
+            bool is_rle;
+            u8 rle_value;
+        };
+        static_assert(sizeof(IpsRecord) == 0xC);
+
+        enum PatchFileState : u8 {
+            PatchFileState_Unparsed,
+            PatchFileState_Indexed,
+            PatchFileState_Unindexed,
+            PatchFileState_Invalid,
+        };
+
+        struct PatchFile {
+            ro::ModuleId module_id;
+            u32 path_offset;
+            u32 record_index;
+            u32 record_count;
+            PatchFileState state;
+        };
+
+        struct PatchIndex {
+            char patches_dir_path[fs::EntryNameLengthMax + 1];
+            u8 signature[crypto::Sha256Generator::HashSize];
+            bool is_built;
+            bool is_complete;
+            size_t num_files;
+            size_t num_records;
+            size_t paths_size;
+            PatchFile files[PatchFileCountMax];
+            IpsRecord records[IpsRecordCountMax];
+            char paths[PatchPathBufferSize];
+        };
+
         /* Global data. */
         constinit os::SdkMutex g_apply_patch_lock;
-        constinit u8 g_patch_read_buffer[os::MemoryPageSize];
+        constinit u8 g_patch_read_buffer[IpsReadBufferSize];
+        constinit fs::DirectoryEntry g_patch_directory_entries[PatchDirectoryEntryCount];
+        constinit fs::DirectoryEntry g_patch_file_entries[PatchFileEntryCount];
+        constinit PatchIndex g_patch_index = {};
 
         /* Helpers. */
         inline u8 ConvertHexNybble(const char nybble) {
@@ -63,17 +114,7 @@ namespace ams::patcher {
             return true;
         }
 
-        bool MatchesModuleId(const char *name, size_t name_len, size_t extension_len, const ro::ModuleId *module_id) {
-            /* Get module id. */
-            ro::ModuleId module_id_from_name;
-            if (!ParseModuleIdFromPath(std::addressof(module_id_from_name), name, name_len, extension_len)) {
-                return false;
-            }
-
-            return std::memcmp(std::addressof(module_id_from_name), module_id, sizeof(*module_id)) == 0;
-        }
-
-        bool IsIpsFileForModule(const char *name, const ro::ModuleId *module_id) {
+        bool ParseIpsFileName(ro::ModuleId *out_module_id, const char *name) {
             const size_t name_len = std::strlen(name);
 
             /* The path must be correct size for a module id (with trailing zeroes optionally trimmed) + ".ips". */
@@ -91,8 +132,18 @@ namespace ams::patcher {
                 return false;
             }
 
-            /* The path needs to match the module id. */
-            return MatchesModuleId(name, name_len, IpsFileExtensionLength, module_id);
+            /* The path needs to be a module id. */
+            return ParseModuleIdFromPath(out_module_id, name, name_len, IpsFileExtensionLength);
+        }
+
+        bool IsIpsFileForModule(const char *name, const ro::ModuleId *module_id) {
+            /* Get module id. */
+            ro::ModuleId module_id_from_name;
+            if (!ParseIpsFileName(std::addressof(module_id_from_name), name)) {
+                return false;
+            }
+
+            return std::memcmp(std::addressof(module_id_from_name), module_id, sizeof(*module_id)) == 0;
         }
 
         inline bool IsIpsTail(bool is_ips32, u8 *buffer) {
@@ -116,102 +167,336 @@ namespace ams::patcher {
             return (buffer[0] << 8) | (buffer[1]);
         }
 
-        void ApplyIpsPatch(u8 *mapped_module, size_t mapped_size, size_t protected_size, size_t offset, bool is_ips32, fs::FileHandle file) {
-            /* Validate offset/protected size. */
-            AMS_ABORT_UNLESS(offset <= protected_size);
+        /* Reads a patch file through the patch read buffer, so that small reads (record headers) don't each go to the filesystem. */
+        class IpsReader {
+            NON_COPYABLE(IpsReader);
+            NON_MOVEABLE(IpsReader);
+            private:
+                fs::FileHandle m_file;
+                s64 m_file_size;
+                s64 m_offset;
+                s64 m_buffer_offset;
+                size_t m_buffer_size;
+            public:
+                IpsReader(fs::FileHandle file, s64 file_size) : m_file(file), m_file_size(file_size), m_offset(0), m_buffer_offset(0), m_buffer_size(0) { /* ... */ }
+
+                s64 GetOffset() const { return m_offset; }
+                void Seek(s64 offset) { m_offset = offset; }
+
+                Result Read(void *dst, size_t size) {
+                    u8 *dst_u8 = static_cast<u8 *>(dst);
+                    while (size > 0) {
+                        /* Fill the buffer, if the data we want isn't in it. */
+                        if (!(m_buffer_offset <= m_offset && m_offset < m_buffer_offset + static_cast<s64>(m_buffer_size))) {
+                            R_UNLESS(m_offset < m_file_size, fs::ResultOutOfRange());
+
+                            const size_t read_size = static_cast<size_t>(std::min<s64>(sizeof(g_patch_read_buffer), m_file_size - m_offset));
+                            m_buffer_size = 0;
+                            R_TRY(fs::ReadFile(m_file, m_offset, g_patch_read_buffer, read_size));
+
+                            m_buffer_offset = m_offset;
+                            m_buffer_size   = read_size;
+                        }
+
+                        /* Copy out of the buffer. */
+                        const size_t buffer_ofs = static_cast<size_t>(m_offset - m_buffer_offset);
+                        const size_t cur_size   = std::min(size, m_buffer_size - buffer_ofs);
+                        std::memcpy(dst_u8, g_patch_read_buffer + buffer_ofs, cur_size);
+
+                        dst_u8   += cur_size;
+                        m_offset += cur_size;
+                        size     -= cur_size;
+                    }
+
+                    R_SUCCEED();
+                }
+        };
 
-            s64 file_offset = sizeof(IpsHeadMagic);
-            auto ReadData = [&](void *dst, size_t size) ALWAYS_INLINE_LAMBDA {
-                R_ABORT_UNLESS(fs::ReadFile(file, file_offset, dst, size));
-                file_offset += size;
-            };
+        template<typename F>
+        void ForEachIpsRecord(IpsReader &reader, bool is_ips32, F f) {
+            reader.Seek(sizeof(IpsHeadMagic));
 
             u8 buffer[sizeof(Ips32TailMagic)];
             while (true) {
-                ReadData(buffer, is_ips32 ? sizeof(Ips32TailMagic) : sizeof(IpsTailMagic));
+                R_ABORT_UNLESS(reader.Read(buffer, is_ips32 ? sizeof(Ips32TailMagic) : sizeof(IpsTailMagic)));
 
                 if (IsIpsTail(is_ips32, buffer)) {
                     break;
                 }
 
                 /* Offset of patch. */
-                u32 patch_offset = GetIpsPatchOffset(is_ips32, buffer);
+                IpsRecord record = {};
+                record.patch_offset = GetIpsPatchOffset(is_ips32, buffer);
 
                 /* Size of patch. */
-                ReadData(buffer, 2);
-                u32 patch_size = GetIpsPatchSize(is_ips32, buffer);
+                R_ABORT_UNLESS(reader.Read(buffer, 2));
+                record.size = GetIpsPatchSize(is_ips32, buffer);
 
                 /* Check for RLE encoding. */
-                if (patch_size == 0) {
+                if (record.size == 0) {
                     /* Size of RLE. */
-                    ReadData(buffer, 2);
-
-                    u32 rle_size = (buffer[0] << 8) | (buffer[1]);
+                    R_ABORT_UNLESS(reader.Read(buffer, 2));
+                    record.size = (buffer[0] << 8) | (buffer[1]);
 
                     /* Value for RLE. */
-                    ReadData(buffer, 1);
-
-                    /* Ensure we don't write to protected region. */
-                    if (patch_offset < protected_size) {
-                        if (patch_offset + rle_size > protected_size) {
-                            const u32 diff = protected_size - patch_offset;
-                            patch_offset += diff;
-                            rle_size -= diff;
-                        } else {
-                            continue;
-                        }
-                    }
+                    R_ABORT_UNLESS(reader.Read(buffer, 1));
+                    record.is_rle    = true;
+                    record.rle_value = buffer[0];
+                }
+                record.data_offset = static_cast<u32>(reader.GetOffset());
 
-                    /* Adjust offset, if relevant. */
-                    patch_offset -= offset;
+                /* Let our caller handle the record, then move on to the next one. */
+                const s64 next_offset = record.data_offset + (record.is_rle ? 0 : record.size);
+                f(record);
+                reader.Seek(next_offset);
+            }
+        }
 
-                    /* Apply patch. */
-                    if (patch_offset + rle_size > mapped_size) {
-                        AMS_ABORT_UNLESS(patch_offset <= mapped_size);
-                        rle_size = mapped_size - patch_offset;
+        void ApplyIpsRecord(u8 *mapped_module, size_t mapped_size, size_t protected_size, size_t offset, IpsReader &reader, const IpsRecord &record) {
+            u32 patch_offset = record.patch_offset;
+            u32 patch_size   = record.size;
+            s64 data_offset  = record.data_offset;
+
+            /* Ensure we don't write to protected region. */
+            if (patch_offset < protected_size) {
+                if (patch_offset + patch_size > protected_size) {
+                    const u32 diff = protected_size - patch_offset;
+                    patch_offset += diff;
+                    patch_size   -= diff;
+                    if (!record.is_rle) {
+                        data_offset += diff;
                     }
-                    std::memset(mapped_module + patch_offset, buffer[0], rle_size);
                 } else {
-                    /* Ensure we don't write to protected region. */
-                    if (patch_offset < protected_size) {
-                        if (patch_offset + patch_size > protected_size) {
-                            const u32 diff = protected_size - patch_offset;
-                            patch_offset += diff;
-                            patch_size -= diff;
-                            file_offset += diff;
-                        } else {
-                            file_offset += patch_size;
-                            continue;
-                        }
+                    return;
+                }
+            }
+
+            /* Adjust offset, if relevant. */
+            patch_offset -= offset;
+
+            /* Apply patch. */
+            if (patch_offset + patch_size > mapped_size) {
+                AMS_ABORT_UNLESS(patch_offset <= mapped_size);
+                patch_size = mapped_size - patch_offset;
+            }
+            if (record.is_rle) {
+                std::memset(mapped_module + patch_offset, record.rle_value, patch_size);
+            } else {
+                reader.Seek(data_offset);
+                R_ABORT_UNLESS(reader.Read(mapped_module + patch_offset, patch_size));
+            }
+        }
+
+        bool ReadIpsHeader(bool *out_is_ips32, bool *out_is_valid, IpsReader &reader) {
+            /* Read the header. */
+            u8 header[sizeof(IpsHeadMagic)];
+            reader.Seek(0);
+            if (R_FAILED(reader.Read(header, sizeof(header)))) {
+                return false;
+            }
+
+            *out_is_ips32 = std::memcmp(header, Ips32HeadMagic, sizeof(header)) == 0;
+            *out_is_valid = *out_is_ips32 || std::memcmp(header, IpsHeadMagic, sizeof(header)) == 0;
+            return true;
+        }
+
+        void ApplyIpsPatchFile(u8 *mapped_module, size_t mapped_size, size_t protected_size, size_t offset, const char *path, PatchFile *patch_file) {
+            /* Validate offset/protected size. */
+            AMS_ABORT_UNLESS(offset <= protected_size);
+
+            /* Skip patches we already know to be invalid. */
+            if (patch_file != nullptr && patch_file->state == PatchFileState_Invalid) {
+                return;
+            }
+
+            /* Open the file. */
+            fs::FileHandle file;
+            if (R_FAILED(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Read))) {
+                return;
+            }
+            ON_SCOPE_EXIT { fs::CloseFile(file); };
+
+            s64 file_size;
+            if (R_FAILED(fs::GetFileSize(std::addressof(file_size), file))) {
+                return;
+            }
+
+            /* Records hold 32-bit data offsets; no sensible patch is anywhere near this large. */
+            if (file_size > static_cast<s64>(std::numeric_limits<u32>::max())) {
+                return;
+            }
+
+            IpsReader reader(file, file_size);
+
+            /* If we've indexed the patch's records, we only need to apply them. */
+            if (patch_file != nullptr && patch_file->state == PatchFileState_Indexed) {
+                for (size_t i = 0; i < patch_file->record_count; ++i) {
+                    ApplyIpsRecord(mapped_module, mapped_size, protected_size, offset, reader, g_patch_index.records[patch_file->record_index + i]);
+                }
+                return;
+            }
+
+            /* Otherwise, read the header. */
+            bool is_ips32, is_valid;
+            if (!ReadIpsHeader(std::addressof(is_ips32), std::addressof(is_valid), reader)) {
+                return;
+            }
+            if (!is_valid) {
+                if (patch_file != nullptr) {
+                    patch_file->state = PatchFileState_Invalid;
+                }
+                return;
+            }
+
+            /* Apply the patch's records, indexing them if this is the first time we've seen the patch. */
+            const bool should_index   = patch_file != nullptr && patch_file->state == PatchFileState_Unparsed;
+            const size_t record_index = g_patch_index.num_records;
+            size_t record_count       = 0;
+            bool fits                 = true;
+            ForEachIpsRecord(reader, is_ips32, [&](const IpsRecord &record) ALWAYS_INLINE_LAMBDA {
+                if (should_index) {
+                    if (record_index + record_count < IpsRecordCountMax) {
+                        g_patch_index.records[record_index + record_count++] = record;
+                    } else {
+                        fits = false;
                     }
+                }
+
+                ApplyIpsRecord(mapped_module, mapped_size, protected_size, offset, reader, record);
+            });
+
+            if (should_index) {
+                if (fits) {
+                    patch_file->state        = PatchFileState_Indexed;
+                    patch_file->record_index = record_index;
+                    patch_file->record_count = record_count;
+                    g_patch_index.num_records += record_count;
+                } else {
+                    patch_file->state = PatchFileState_Unindexed;
+                }
+            }
+        }
+
+        template<typename F>
+        void ForEachPatchFile(char *path, size_t path_size, size_t patches_dir_path_len, F f) {
+            /* Open the patch directory. */
+            path[patches_dir_path_len] = '\x00';
+
+            fs::DirectoryHandle patches_dir;
+            if (R_FAILED(fs::OpenDirectory(std::addressof(patches_dir), path, fs::OpenDirectoryMode_Directory))) {
+                return;
+            }
+            ON_SCOPE_EXIT { fs::CloseDirectory(patches_dir); };
+
+            /* Iterate over the patches directory to find patch subdirectories. */
+            while (true) {
+                /* Read the next entries. */
+                s64 num_dirs;
+                if (R_FAILED(fs::ReadDirectory(std::addressof(num_dirs), g_patch_directory_entries, patches_dir, util::size(g_patch_directory_entries))) || num_dirs == 0) {
+                    break;
+                }
 
-                    /* Adjust offset, if relevant. */
-                    patch_offset -= offset;
+                for (s64 i = 0; i < num_dirs; ++i) {
+                    /* Print the path for this directory. */
+                    const auto &dir_entry = g_patch_directory_entries[i];
+                    util::SNPrintf(path + patches_dir_path_len, path_size - patches_dir_path_len, "/%s", dir_entry.name);
+                    const size_t patch_dir_path_len = patches_dir_path_len + 1 + std::strlen(dir_entry.name);
 
-                    /* Apply patch. */
-                    u32 read_size = patch_size;
-                    if (patch_offset + read_size > mapped_size) {
-                        AMS_ABORT_UNLESS(patch_offset <= mapped_size);
-                        read_size = mapped_size - patch_offset;
+                    /* Open the patch directory. */
+                    fs::DirectoryHandle patch_dir;
+                    if (R_FAILED(fs::OpenDirectory(std::addressof(patch_dir), path, fs::OpenDirectoryMode_File))) {
+                        continue;
                     }
-                    {
-                        size_t remaining   = read_size;
-                        size_t copy_offset = patch_offset;
-                        while (remaining > 0) {
-                            const size_t cur_read = std::min(remaining, sizeof(g_patch_read_buffer));
-                            ReadData(g_patch_read_buffer, cur_read);
-                            std::memcpy(mapped_module + copy_offset, g_patch_read_buffer, cur_read);
-                            remaining   -= cur_read;
-                            copy_offset += cur_read;
+                    ON_SCOPE_EXIT { fs::CloseDirectory(patch_dir); };
+
+                    /* Iterate over files in the patch directory. */
+                    while (true) {
+                        s64 num_files;
+                        if (R_FAILED(fs::ReadDirectory(std::addressof(num_files), g_patch_file_entries, patch_dir, util::size(g_patch_file_entries))) || num_files == 0) {
+                            break;
                         }
+
+                        for (s64 j = 0; j < num_files; ++j) {
+                            f(patch_dir_path_len, g_patch_file_entries[j]);
+                        }
+                    }
+                }
+            }
+        }
+
+        void ComputePatchDirectorySignature(u8 *dst, size_t dst_size, const char *path, size_t patches_dir_path_len) {
+            crypto::Sha256Generator sha256;
+            sha256.Initialize();
+
+            /* Hash the directory's path, and the name of every patch directory within it. */
+            /* NOTE: Changes within a patch directory aren't detected here; the index must be invalidated to pick those up. */
+            sha256.Update(path, patches_dir_path_len);
+
+            fs::DirectoryHandle patches_dir;
+            if (R_SUCCEEDED(fs::OpenDirectory(std::addressof(patches_dir), path, fs::OpenDirectoryMode_Directory))) {
+                ON_SCOPE_EXIT { fs::CloseDirectory(patches_dir); };
+
+                while (true) {
+                    s64 num_dirs;
+                    if (R_FAILED(fs::ReadDirectory(std::addressof(num_dirs), g_patch_directory_entries, patches_dir, util::size(g_patch_directory_entries))) || num_dirs == 0) {
+                        break;
                     }
-                    if (patch_size > read_size) {
-                        file_offset += patch_size - read_size;
+
+                    for (s64 i = 0; i < num_dirs; ++i) {
+                        sha256.Update(g_patch_directory_entries[i].name, std::strlen(g_patch_directory_entries[i].name) + 1);
                     }
                 }
             }
+
+            sha256.GetHash(dst, dst_size);
         }
 
+        void BuildPatchIndex(char *path, size_t path_size, size_t patches_dir_path_len, const u8 *signature) {
+            /* Reset the index. */
+            util::Strlcpy(g_patch_index.patches_dir_path, path, sizeof(g_patch_index.patches_dir_path));
+            std::memcpy(g_patch_index.signature, signature, sizeof(g_patch_index.signature));
+            g_patch_index.is_built    = true;
+            g_patch_index.is_complete = true;
+            g_patch_index.num_files   = 0;
+            g_patch_index.num_records = 0;
+            g_patch_index.paths_size  = 0;
+
+            /* Add every patch file to the index, in the order we'd find them. */
+            ForEachPatchFile(path, path_size, patches_dir_path_len, [&](size_t patch_dir_path_len, const fs::DirectoryEntry &entry) ALWAYS_INLINE_LAMBDA {
+                /* Check if this file is an ips. */
+                ro::ModuleId module_id;
+                if (!ParseIpsFileName(std::addressof(module_id), entry.name)) {
+                    return;
+                }
+
+                /* Check that we have room for the file. */
+                const size_t sub_path_len = patch_dir_path_len - patches_dir_path_len + 1 + std::strlen(entry.name);
+                if (g_patch_index.num_files >= PatchFileCountMax || g_patch_index.paths_size + sub_path_len + 1 > sizeof(g_patch_index.paths)) {
+                    g_patch_index.is_complete = false;
+                    return;
+                }
+
+                /* Add the file. */
+                auto &patch_file = g_patch_index.files[g_patch_index.num_files++];
+                patch_file = {
+                    .module_id    = module_id,
+                    .path_offset  = static_cast<u32>(g_patch_index.paths_size),
+                    .record_index = 0,
+                    .record_count = 0,
+                    .state        = PatchFileState_Unparsed,
+                };
+
+                util::SNPrintf(g_patch_index.paths + g_patch_index.paths_size, sub_path_len + 1, "%s/%s", path + patches_dir_path_len, entry.name);
+                g_patch_index.paths_size += sub_path_len + 1;
+            });
+        }
+
+    }
+
+    void InvalidateIpsPatchIndex() {
+        std::scoped_lock lk(g_apply_patch_lock);
+
+        g_patch_index.is_built = false;
     }
 
     void LocateAndApplyIpsPatchesToModule(const char *mount_name, const char *patch_dir_name, size_t protected_size, size_t offset, const ro::ModuleId *module_id, u8 *mapped_module, size_t mapped_size) {
@@ -223,65 +508,42 @@ namespace ams::patcher {
         util::SNPrintf(path, sizeof(path), "%s:/atmosphere/%s", mount_name, patch_dir_name);
         const size_t patches_dir_path_len = std::strlen(path);
 
-        /* Open the patch directory. */
-        fs::DirectoryHandle patches_dir;
-        if (R_FAILED(fs::OpenDirectory(std::addressof(patches_dir), path, fs::OpenDirectoryMode_Directory))) {
-            return;
-        }
-        ON_SCOPE_EXIT { fs::CloseDirectory(patches_dir); };
-
-        /* Iterate over the patches directory to find patch subdirectories. */
-        while (true) {
-            /* Read the next entry. */
-            s64 count;
-            fs::DirectoryEntry entry;
-            if (R_FAILED(fs::ReadDirectory(std::addressof(count), std::addressof(entry), patches_dir, 1)) || count == 0) {
-                break;
-            }
-
-            /* Print the path for this directory. */
-            util::SNPrintf(path + patches_dir_path_len, sizeof(path) - patches_dir_path_len, "/%s", entry.name);
-            const size_t patch_dir_path_len = patches_dir_path_len + 1 + std::strlen(entry.name);
-
-            /* Open the patch directory. */
-            fs::DirectoryHandle patch_dir;
-            if (R_FAILED(fs::OpenDirectory(std::addressof(patch_dir), path, fs::OpenDirectoryMode_File))) {
-                continue;
-            }
-            ON_SCOPE_EXIT { fs::CloseDirectory(patch_dir); };
+        /* Rebuild our index, if the patch directory has changed since we built it. */
+        u8 signature[crypto::Sha256Generator::HashSize];
+        ComputePatchDirectorySignature(signature, sizeof(signature), path, patches_dir_path_len);
 
-            /* Iterate over files in the patch directory. */
-            while (true) {
-                if (R_FAILED(fs::ReadDirectory(std::addressof(count), std::addressof(entry), patch_dir, 1)) || count == 0) {
-                    break;
-                }
+        if (!g_patch_index.is_built || std::strcmp(g_patch_index.patches_dir_path, path) != 0 || std::memcmp(g_patch_index.signature, signature, sizeof(signature)) != 0) {
+            BuildPatchIndex(path, sizeof(path), patches_dir_path_len, signature);
+        }
 
-                /* Check if this file is an ips. */
-                if (!IsIpsFileForModule(entry.name, module_id)) {
+        /* If the index holds every patch, apply the module's patches from it. */
+        if (g_patch_index.is_complete) {
+            for (size_t i = 0; i < g_patch_index.num_files; ++i) {
+                auto &patch_file = g_patch_index.files[i];
+                if (std::memcmp(std::addressof(patch_file.module_id), module_id, sizeof(*module_id)) != 0) {
                     continue;
                 }
 
                 /* Print the path for this file. */
-                util::SNPrintf(path + patch_dir_path_len, sizeof(path) - patch_dir_path_len, "/%s", entry.name);
+                util::SNPrintf(path + patches_dir_path_len, sizeof(path) - patches_dir_path_len, "%s", g_patch_index.paths + patch_file.path_offset);
 
-                /* Open the file. */
-                fs::FileHandle file;
-                if (R_FAILED(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Read))) {
-                    continue;
-                }
-                ON_SCOPE_EXIT { fs::CloseFile(file); };
-
-                /* Read the header. */
-                u8 header[sizeof(IpsHeadMagic)];
-                if (R_SUCCEEDED(fs::ReadFile(file, 0, header, sizeof(header)))) {
-                    if (std::memcmp(header, IpsHeadMagic, sizeof(header)) == 0) {
-                        ApplyIpsPatch(mapped_module, mapped_size, protected_size, offset, false, file);
-                    } else if (std::memcmp(header, Ips32HeadMagic, sizeof(header)) == 0) {
-                        ApplyIpsPatch(mapped_module, mapped_size, protected_size, offset, true, file);
-                    }
-                }
+                ApplyIpsPatchFile(mapped_module, mapped_size, protected_size, offset, path, std::addressof(patch_file));
             }
+            return;
         }
+
+        /* Otherwise, search the patch directory for the module's patches. */
+        ForEachPatchFile(path, sizeof(path), patches_dir_path_len, [&](size_t patch_dir_path_len, const fs::DirectoryEntry &entry) ALWAYS_INLINE_LAMBDA {
+            /* Check if this file is an ips. */
+            if (!IsIpsFileForModule(entry.name, module_id)) {
+                return;
+            }
+
+            /* Print the path for this file. */
+            util::SNPrintf(path + patch_dir_path_len, sizeof(path) - patch_dir_path_len, "/%s", entry.name);
+
+            ApplyIpsPatchFile(mapped_module, mapped_size, protected_size, offset, path, nullptr);
+        });
     }
 
 }
@@ -82,6 +82,9 @@ namespace ams::crypto {
 
     void GenerateSha256(void *dst, size_t dst_size, const void *src, size_t src_size);
 
+    /* Generates the hashes of block_count contiguous blocks of block_size bytes each, which may be done in parallel. */
+    void GenerateSha256ForBlocks(void *dst, size_t dst_size, const void *src, size_t block_size, size_t block_count);
+
     ALWAYS_INLINE void GenerateSha256Hash(void *dst, size_t dst_size, const void *src, size_t src_size) {
         return GenerateSha256(dst, dst_size, src, src_size);
     }
@@ -101,6 +101,9 @@ namespace ams::crypto::impl {
 
             void InitializeHashKey();
             void ComputeMac(bool encrypt);
+
+            size_t UpdateMessage(void *dst, const void *src, size_t size, bool encrypt);
+            void   CryptMessage(u8 *dst, const u8 *src, size_t size, u32 offset);
     };
 
 }
@@ -74,4 +74,6 @@ namespace ams::crypto::impl {
 
     static_assert(HashFunction<Sha256Impl>);
 
+    void GenerateSha256ForBlocks(void *dst, const void *src, size_t block_size, size_t block_count);
+
 }
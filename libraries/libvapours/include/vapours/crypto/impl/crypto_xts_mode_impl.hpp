@@ -74,6 +74,11 @@ namespace ams::crypto::impl {
             }
 
             void ProcessBlock(u8 *dst, const u8 *src);
+
+            #if defined(ATMOSPHERE_ARCH_X64)
+            template<typename BlockCipher, bool IsEncrypt>
+            size_t ProcessBlocksAesNi(u8 *dst, const u8 *src, size_t num_blocks);
+            #endif
         public:
             template<typename BlockCipher1, typename BlockCipher2>
             void InitializeEncryption(const BlockCipher1 *cipher1, const BlockCipher2 *cipher2, const void *tweak, size_t tweak_size) {
@@ -125,7 +130,7 @@ namespace ams::crypto::impl {
             size_t ProcessRemainingData(u8 *dst, const u8 *src, size_t size);
     };
 
-    #if defined(ATMOSPHERE_ARCH_ARM64)
+    #if defined(ATMOSPHERE_ARCH_ARM64) || defined(ATMOSPHERE_ARCH_X64)
     template<> size_t XtsModeImpl::Update<AesEncryptor128>(void *dst, size_t dst_size, const void *src, size_t src_size);
     template<> size_t XtsModeImpl::Update<AesEncryptor192>(void *dst, size_t dst_size, const void *src, size_t src_size);
     template<> size_t XtsModeImpl::Update<AesEncryptor256>(void *dst, size_t dst_size, const void *src, size_t src_size);
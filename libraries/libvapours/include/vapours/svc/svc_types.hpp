@@ -22,5 +22,6 @@
 #include <vapours/svc/svc_types_base.hpp>
 #include <vapours/svc/svc_types_dd.hpp>
 #include <vapours/svc/svc_types_dmnt.hpp>
+#include <vapours/svc/svc_types_kernel_trace.hpp>
 #include <vapours/svc/svc_types_priv.hpp>
 #include <vapours/svc/svc_select_io_pool_type.hpp>
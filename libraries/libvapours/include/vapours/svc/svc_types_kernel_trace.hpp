@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <vapours/util/util_fourcc.hpp>
+#include <vapours/svc/svc_types_common.hpp>
+
+namespace ams::svc {
+
+    /* NOTE: The kernel trace buffer (MemoryRegionType_KernelTraceBuffer) is laid out as a header, followed by one ring per core. */
+    /* Each ring is written only by its own core. A consumer which has mapped the buffer read/write may drain a ring by */
+    /* advancing its read count; while a ring is streaming, the kernel drops records rather than overwriting unread ones. */
+
+    enum KernelTraceRecordType : u8 {
+        KernelTraceRecordType_ThreadSwitch   =  1,
+
+        KernelTraceRecordType_SvcEntry0      =  3,
+        KernelTraceRecordType_SvcEntry1      =  4,
+        KernelTraceRecordType_SvcExit0       =  5,
+        KernelTraceRecordType_SvcExit1       =  6,
+        KernelTraceRecordType_Interrupt      =  7,
+
+        KernelTraceRecordType_ScheduleUpdate = 11,
+
+        KernelTraceRecordType_CoreMigration  = 14,
+    };
+
+    enum KernelTraceRingFlag : u32 {
+        KernelTraceRingFlag_None      = (0u << 0),
+        KernelTraceRingFlag_Streaming = (1u << 0),
+    };
+
+    struct KernelTraceRecord {
+        u8 core_id;
+        u8 type;
+        u16 process_id;
+        u32 thread_id;
+        u64 tick;
+        u64 data[6];
+    };
+    static_assert(sizeof(KernelTraceRecord) == 0x40);
+
+    struct KernelTraceRingHeader {
+        u64 write_count;
+        u64 read_count;
+        u64 drop_count;
+        u32 flags;
+        u32 reserved[9];
+    };
+    static_assert(sizeof(KernelTraceRingHeader) == sizeof(KernelTraceRecord));
+
+    struct KernelTraceBufferHeader {
+        u32 magic;
+        u32 num_rings;
+        u32 ring_offset;
+        u32 ring_size;
+        u32 record_count;
+        u32 reserved0;
+        u64 tick_frequency;
+        u64 reserved1[4];
+
+        static constexpr u32 Magic = util::FourCC<'K','T','R','1'>::Code;
+    };
+    static_assert(sizeof(KernelTraceBufferHeader) == sizeof(KernelTraceRecord));
+
+}
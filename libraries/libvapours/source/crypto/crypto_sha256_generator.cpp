@@ -25,4 +25,11 @@ namespace ams::crypto {
         gen.GetHash(dst, dst_size);
     }
 
+    void GenerateSha256ForBlocks(void *dst, size_t dst_size, const void *src, size_t block_size, size_t block_count) {
+        AMS_ASSERT(dst_size >= Sha256Generator::HashSize * block_count);
+        AMS_UNUSED(dst_size);
+
+        impl::GenerateSha256ForBlocks(dst, src, block_size, block_count);
+    }
+
 }
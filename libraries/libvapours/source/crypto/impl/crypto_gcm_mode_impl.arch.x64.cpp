@@ -0,0 +1,633 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <vapours.hpp>
+#include "crypto_aes_impl.arch.x64.hpp"
+
+namespace ams::crypto::impl {
+
+    namespace {
+
+        constexpr size_t HashBlockSize = 0x10;
+
+        /* Number of blocks whose products we accumulate before each reduction. */
+        constexpr size_t AggregatedBlockCount = 4;
+
+        /* Size of the chunks in which we interleave encryption and hashing, to keep data cached between the two. */
+        constexpr size_t MessageChunkSize = 4_KB;
+
+        constexpr u64 GetMultiplyFactor(u8 value) {
+            constexpr size_t Shift = BITSIZEOF(u8) - 1;
+            constexpr u8     Mask  = (1u << Shift);
+            return (value & Mask) >> Shift;
+        }
+
+        constexpr void GaloisShiftLeft(u64 *block) {
+            /* Shift the block left by one. */
+            block[1] <<= 1;
+            block[1] |= (block[0] & (static_cast<u64>(1) << (BITSIZEOF(u64) - 1))) >> (BITSIZEOF(u64) - 1);
+            block[0] <<= 1;
+        }
+
+        constexpr u8 GaloisShiftRight(u64 *block) {
+            /* Determine the mask to return. */
+            constexpr u8 GaloisFieldMask = 0xE1;
+            const u8 mask = (block[0] & 1) * GaloisFieldMask;
+
+            /* Shift the block right by one. */
+            block[0] >>= 1;
+            block[0] |= (block[1] & 1) << (BITSIZEOF(u64) - 1);
+            block[1] >>= 1;
+
+            /* Return the mask. */
+            return mask;
+        }
+
+        /* Multiply two 128-bit numbers X, Y in the GF(128) Galois Field. */
+        void GaloisFieldMult(void *dst, const void *x, const void *y) {
+            /* Our block size is 16 bytes (for a 128-bit integer). */
+            constexpr size_t BlockSize = HashBlockSize;
+            constexpr size_t FieldSize = 128;
+
+            /* Declare work blocks for us to store temporary values. */
+            u8 x_block[BlockSize];
+            u8 y_block[BlockSize];
+            u8 out[BlockSize];
+
+            /* Declare 64-bit pointers for our convenience. */
+            u64 *x_64   = static_cast<u64 *>(static_cast<void *>(x_block));
+            u64 *y_64   = static_cast<u64 *>(static_cast<void *>(y_block));
+            u64 *out_64 = static_cast<u64 *>(static_cast<void *>(out));
+
+            /* Initialize our work blocks. */
+            for (size_t i = 0; i < BlockSize; ++i) {
+                x_block[i] = static_cast<const u8 *>(x)[BlockSize - 1 - i];
+                y_block[i] = static_cast<const u8 *>(y)[BlockSize - 1 - i];
+                out[i]     = 0;
+            }
+
+            /* Perform multiplication on each bit in y. */
+            for (size_t i = 0; i < FieldSize; ++i) {
+                /* Get the multiply factor for this bit. */
+                const auto y_mult = GetMultiplyFactor(y_block[BlockSize - 1]);
+
+                /* Multiply x by the factor. */
+                out_64[0] ^= x_64[0] * y_mult;
+                out_64[1] ^= x_64[1] * y_mult;
+
+                /* Shift left y by one. */
+                GaloisShiftLeft(y_64);
+
+                /* Shift right x by one, and mask appropriately. */
+                const u8 x_mask = GaloisShiftRight(x_64);
+                x_block[BlockSize - 1] ^= x_mask;
+            }
+
+            /* Copy out our result. */
+            for (size_t i = 0; i < BlockSize; ++i) {
+                static_cast<u8 *>(dst)[i] = out[BlockSize - 1 - i];
+            }
+        }
+
+        #if defined(__PCLMUL__) && defined(__SSSE3__)
+        bool GetPclmulAvailabilityImpl() {
+            /* Call cpu id. */
+            int a = 0, b = 0, c = 0, d = 0;
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(1), "2"(0) : "memory");
+
+            /* Check for PCLMULQDQ, and for SSSE3, which we use to byte-reflect blocks. */
+            return (c & (1 << 1)) && (c & (1 << 9));
+        }
+
+        const bool g_is_pclmul_available = GetPclmulAvailabilityImpl();
+
+        ALWAYS_INLINE __m128i ReverseBytes(const __m128i block) {
+            return _mm_shuffle_epi8(block, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+        }
+
+        /* Accumulate the unreduced 256-bit carry-less product of a and b into lo:hi. */
+        ALWAYS_INLINE void MultiplyAccumulate(__m128i &lo, __m128i &hi, const __m128i a, const __m128i b) {
+            const __m128i mid = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+
+            lo = _mm_xor_si128(lo, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x00), _mm_slli_si128(mid, 8)));
+            hi = _mm_xor_si128(hi, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x11), _mm_srli_si128(mid, 8)));
+        }
+
+        /* Reduce a 256-bit product of byte-reflected operands modulo the GCM polynomial. */
+        ALWAYS_INLINE __m128i Reduce(__m128i lo, __m128i hi) {
+            /* The operands are bit-reflected, so shift the product left by one to re-align it. */
+            const __m128i lo_carry = _mm_srli_epi32(lo, 31);
+            const __m128i hi_carry = _mm_srli_epi32(hi, 31);
+
+            lo = _mm_or_si128(_mm_slli_epi32(lo, 1), _mm_slli_si128(lo_carry, 4));
+            hi = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(hi, 1), _mm_slli_si128(hi_carry, 4)), _mm_srli_si128(lo_carry, 12));
+
+            /* Fold the low half in by x^127 + x^126 + x^121, in two phases. */
+            __m128i t = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)), _mm_slli_epi32(lo, 25));
+            const __m128i t_carry = _mm_srli_si128(t, 4);
+            lo = _mm_xor_si128(lo, _mm_slli_si128(t, 12));
+
+            t = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)), _mm_srli_epi32(lo, 7));
+            t = _mm_xor_si128(t, t_carry);
+
+            return _mm_xor_si128(hi, _mm_xor_si128(lo, t));
+        }
+
+        ALWAYS_INLINE __m128i GaloisFieldMultPclmul(const __m128i a, const __m128i b) {
+            __m128i lo = _mm_setzero_si128();
+            __m128i hi = _mm_setzero_si128();
+            MultiplyAccumulate(lo, hi, a, b);
+            return Reduce(lo, hi);
+        }
+
+        /* NOTE: h_powers holds byte-reflected H^1, H^2, H^3, H^4. */
+        void ProcessGhashBlocksPclmul(void *x, const void *h_powers, const u8 *src, size_t num_blocks) {
+            /* Load the hash key powers. */
+            const __m128i h1 = _mm_loadu_si128(static_cast<const __m128i *>(h_powers) + 0);
+            const __m128i h2 = _mm_loadu_si128(static_cast<const __m128i *>(h_powers) + 1);
+            const __m128i h3 = _mm_loadu_si128(static_cast<const __m128i *>(h_powers) + 2);
+            const __m128i h4 = _mm_loadu_si128(static_cast<const __m128i *>(h_powers) + 3);
+
+            /* Load the current hash. */
+            __m128i hash = ReverseBytes(_mm_loadu_si128(static_cast<const __m128i *>(x)));
+
+            /* Process four blocks at a time, computing (X + B0)*H^4 + B1*H^3 + B2*H^2 + B3*H with a single reduction. */
+            while (num_blocks >= AggregatedBlockCount) {
+                const __m128i b0 = _mm_xor_si128(ReverseBytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 0))), hash);
+                const __m128i b1 = ReverseBytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 1)));
+                const __m128i b2 = ReverseBytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 2)));
+                const __m128i b3 = ReverseBytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 3)));
+
+                __m128i lo = _mm_setzero_si128();
+                __m128i hi = _mm_setzero_si128();
+                MultiplyAccumulate(lo, hi, b0, h4);
+                MultiplyAccumulate(lo, hi, b1, h3);
+                MultiplyAccumulate(lo, hi, b2, h2);
+                MultiplyAccumulate(lo, hi, b3, h1);
+                hash = Reduce(lo, hi);
+
+                src        += HashBlockSize * AggregatedBlockCount;
+                num_blocks -= AggregatedBlockCount;
+            }
+
+            /* Process blocks one at a time. */
+            while (num_blocks > 0) {
+                hash = GaloisFieldMultPclmul(_mm_xor_si128(ReverseBytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src))), hash), h1);
+
+                src        += HashBlockSize;
+                num_blocks -= 1;
+            }
+
+            /* Store the updated hash. */
+            _mm_storeu_si128(static_cast<__m128i *>(x), ReverseBytes(hash));
+        }
+
+        /* NOTE: The counter block holds the last counter used; each block uses the next (32-bit big endian) counter. */
+        template<size_t RoundKeyCount>
+        void CryptCounterBlocksAesNi(u8 *dst, const u8 *src, size_t num_blocks, void *counter_block, const u8 *raw_round_keys) {
+            /* Load all keys into sse2 registers. */
+            __m128i round_keys[RoundKeyCount];
+            for (size_t i = 0; i < RoundKeyCount; ++i) {
+                round_keys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(raw_round_keys + HashBlockSize * i));
+            }
+
+            /* Load the counter, byte-reflected so that its low word is the 32-bit counter. */
+            __m128i counter = ReverseBytes(_mm_loadu_si128(static_cast<const __m128i *>(counter_block)));
+
+            /* Process eight blocks at a time, while we can. */
+            constexpr size_t UnrolledBlockCount = 8;
+
+            while (num_blocks >= UnrolledBlockCount) {
+                /* Generate the counter blocks, xored with the first round key. */
+                __m128i key = round_keys[0];
+                __m128i b0 = _mm_xor_si128(ReverseBytes(_mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 1))), key);
+                __m128i b1 = _mm_xor_si128(ReverseBytes(_mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 2))), key);
+                __m128i b2 = _mm_xor_si128(ReverseBytes(_mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 3))), key);
+                __m128i b3 = _mm_xor_si128(ReverseBytes(_mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 4))), key);
+                __m128i b4 = _mm_xor_si128(ReverseBytes(_mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 5))), key);
+                __m128i b5 = _mm_xor_si128(ReverseBytes(_mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 6))), key);
+                __m128i b6 = _mm_xor_si128(ReverseBytes(_mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 7))), key);
+                __m128i b7 = _mm_xor_si128(ReverseBytes(_mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 8))), key);
+                counter = _mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, UnrolledBlockCount));
+
+                /* Do the middle rounds. */
+                for (size_t i = 1; i < RoundKeyCount - 1; ++i) {
+                    key = round_keys[i];
+                    b0 = _mm_aesenc_si128(b0, key);
+                    b1 = _mm_aesenc_si128(b1, key);
+                    b2 = _mm_aesenc_si128(b2, key);
+                    b3 = _mm_aesenc_si128(b3, key);
+                    b4 = _mm_aesenc_si128(b4, key);
+                    b5 = _mm_aesenc_si128(b5, key);
+                    b6 = _mm_aesenc_si128(b6, key);
+                    b7 = _mm_aesenc_si128(b7, key);
+                }
+
+                /* Do the final round. */
+                key = round_keys[RoundKeyCount - 1];
+                b0 = _mm_aesenclast_si128(b0, key);
+                b1 = _mm_aesenclast_si128(b1, key);
+                b2 = _mm_aesenclast_si128(b2, key);
+                b3 = _mm_aesenclast_si128(b3, key);
+                b4 = _mm_aesenclast_si128(b4, key);
+                b5 = _mm_aesenclast_si128(b5, key);
+                b6 = _mm_aesenclast_si128(b6, key);
+                b7 = _mm_aesenclast_si128(b7, key);
+
+                /* Write the blocks. */
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + HashBlockSize * 0), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 0)), b0));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + HashBlockSize * 1), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 1)), b1));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + HashBlockSize * 2), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 2)), b2));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + HashBlockSize * 3), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 3)), b3));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + HashBlockSize * 4), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 4)), b4));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + HashBlockSize * 5), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 5)), b5));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + HashBlockSize * 6), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 6)), b6));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + HashBlockSize * 7), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + HashBlockSize * 7)), b7));
+
+                src        += HashBlockSize * UnrolledBlockCount;
+                dst        += HashBlockSize * UnrolledBlockCount;
+                num_blocks -= UnrolledBlockCount;
+            }
+
+            /* Process blocks one at a time. */
+            while (num_blocks > 0) {
+                counter = _mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 1));
+
+                /* Do aes rounds. */
+                __m128i b = _mm_xor_si128(ReverseBytes(counter), round_keys[0]);
+                for (size_t i = 1; i < RoundKeyCount - 1; ++i) {
+                    b = _mm_aesenc_si128(b, round_keys[i]);
+                }
+                b = _mm_aesenclast_si128(b, round_keys[RoundKeyCount - 1]);
+
+                /* Write the block. */
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)), b));
+
+                src        += HashBlockSize;
+                dst        += HashBlockSize;
+                num_blocks -= 1;
+            }
+
+            /* Store the updated counter. */
+            _mm_storeu_si128(static_cast<__m128i *>(counter_block), ReverseBytes(counter));
+        }
+        #else
+        constexpr bool g_is_pclmul_available = false;
+        #endif
+
+        ALWAYS_INLINE bool IsPclmulAvailable() {
+            return g_is_pclmul_available;
+        }
+
+        /* NOTE: h_mult_blocks[0] holds H; when PCLMULQDQ is available, h_mult_blocks[1...4] hold its byte-reflected powers. */
+        void InitializeHashKeyPowers(void *h_mult_blocks) {
+            #if defined(__PCLMUL__) && defined(__SSSE3__)
+            if (IsPclmulAvailable()) {
+                __m128i *blocks = static_cast<__m128i *>(h_mult_blocks);
+
+                const __m128i h = ReverseBytes(_mm_loadu_si128(blocks));
+
+                __m128i power = h;
+                for (size_t i = 1; i <= AggregatedBlockCount; ++i) {
+                    _mm_storeu_si128(blocks + i, power);
+                    power = GaloisFieldMultPclmul(power, h);
+                }
+            }
+            #else
+            AMS_UNUSED(h_mult_blocks);
+            #endif
+        }
+
+        void ProcessGhashBlocks(void *x, const void *h_mult_blocks, const u8 *src, size_t num_blocks) {
+            #if defined(__PCLMUL__) && defined(__SSSE3__)
+            if (IsPclmulAvailable()) {
+                return ProcessGhashBlocksPclmul(x, static_cast<const u8 *>(h_mult_blocks) + HashBlockSize, src, num_blocks);
+            }
+            #endif
+
+            /* Fall back to the default implementation. */
+            u8 *x_8 = static_cast<u8 *>(x);
+            while (num_blocks--) {
+                for (size_t i = 0; i < HashBlockSize; ++i) {
+                    x_8[i] ^= src[i];
+                }
+                GaloisFieldMult(x, x, h_mult_blocks);
+
+                src += HashBlockSize;
+            }
+        }
+
+        void MultiplyHashKey(void *x, const void *h_mult_blocks) {
+            constexpr const u8 EmptyBlock[HashBlockSize] = {};
+            ProcessGhashBlocks(x, h_mult_blocks, EmptyBlock, 1);
+        }
+
+        /* Xor data into the hash, tracking a trailing partial block in *remaining. */
+        void UpdateGhash(void *x, const void *h_mult_blocks, u32 *remaining, const u8 *src, size_t size) {
+            u8 *x_8 = static_cast<u8 *>(x);
+
+            /* Complete any partial block from a previous invocation. */
+            if (*remaining > 0) {
+                const size_t cur_size = std::min<size_t>(HashBlockSize - *remaining, size);
+                for (size_t i = 0; i < cur_size; ++i) {
+                    x_8[*remaining + i] ^= src[i];
+                }
+
+                *remaining += cur_size;
+                src        += cur_size;
+                size       -= cur_size;
+
+                if (*remaining < HashBlockSize) {
+                    return;
+                }
+
+                MultiplyHashKey(x, h_mult_blocks);
+                *remaining = 0;
+            }
+
+            /* Process as many blocks as we can. */
+            if (const size_t num_blocks = size / HashBlockSize; num_blocks > 0) {
+                ProcessGhashBlocks(x, h_mult_blocks, src, num_blocks);
+
+                src  += num_blocks * HashBlockSize;
+                size -= num_blocks * HashBlockSize;
+            }
+
+            /* Xor in whatever is left over. */
+            for (size_t i = 0; i < size; ++i) {
+                x_8[i] ^= src[i];
+            }
+            *remaining = size;
+        }
+
+        void IncrementCounter(void *counter_block) {
+            u32 *counter = static_cast<u32 *>(counter_block) + 3;
+            util::StoreBigEndian(counter, util::LoadBigEndian(counter) + 1);
+        }
+
+    }
+
+    template<class BlockCipher>
+    void GcmModeImpl<BlockCipher>::Initialize(const BlockCipher *block_cipher) {
+        /* Set member variables. */
+        m_block_cipher = block_cipher;
+        m_cipher_func  = std::addressof(GcmModeImpl<BlockCipher>::ProcessBlock);
+
+        /* Pre-calculate values to speed up galois field multiplications later. */
+        this->InitializeHashKey();
+
+        /* Note that we're initialized. */
+        m_state = State_Initialized;
+    }
+
+    template<class BlockCipher>
+    void GcmModeImpl<BlockCipher>::Reset(const void *iv, size_t iv_size) {
+        /* Validate pre-conditions. */
+        AMS_ASSERT(m_state >= State_Initialized);
+
+        /* Reset blocks. */
+        m_block_x.block_128.Clear();
+        m_block_tmp.block_128.Clear();
+
+        /* Clear sizes. */
+        m_aad_size      = 0;
+        m_msg_size      = 0;
+        m_aad_remaining = 0;
+        m_msg_remaining = 0;
+
+        /* Update our state. */
+        m_state = State_ProcessingAad;
+
+        /* Set our iv. */
+        if (iv_size == 12) {
+            /* If our iv is the correct size, simply copy in the iv, and set the magic bit. */
+            std::memcpy(std::addressof(m_block_ek0), iv, iv_size);
+            util::StoreBigEndian(m_block_ek0.block_32 + 3, static_cast<u32>(1));
+        } else {
+            /* Clear our ek0 block. */
+            m_block_ek0.block_128.Clear();
+
+            /* Update using the iv as aad. */
+            this->UpdateAad(iv, iv_size);
+
+            /* Treat the iv as fake msg for the mac that will become our iv. */
+            m_msg_size = m_aad_size;
+            m_aad_size = 0;
+
+            /* Compute a non-final mac. */
+            this->ComputeMac(false);
+
+            /* Set our ek0 block to our calculated mac block. */
+            m_block_ek0 = m_block_x;
+
+            /* Clear our calculated mac block. */
+            m_block_x.block_128.Clear();
+
+            /* Reset our state. */
+            m_msg_size      = 0;
+            m_aad_size      = 0;
+            m_msg_remaining = 0;
+            m_aad_remaining = 0;
+        }
+
+        /* Set the working block to the iv. */
+        m_block_ek = m_block_ek0;
+    }
+
+    template<class BlockCipher>
+    void GcmModeImpl<BlockCipher>::UpdateAad(const void *aad, size_t aad_size) {
+        /* Validate pre-conditions. */
+        AMS_ASSERT(m_state    == State_ProcessingAad);
+        AMS_ASSERT(m_msg_size == 0);
+
+        /* Update our aad size. */
+        m_aad_size += aad_size;
+
+        /* Hash the aad. */
+        UpdateGhash(std::addressof(m_block_x), m_h_mult_blocks, std::addressof(m_aad_remaining), static_cast<const u8 *>(aad), aad_size);
+    }
+
+    template<class BlockCipher>
+    size_t GcmModeImpl<BlockCipher>::UpdateEncrypt(void *dst, size_t dst_size, const void *src, size_t src_size) {
+        /* Validate pre-conditions. */
+        AMS_ASSERT(m_state == State_ProcessingAad || m_state == State_Encrypting);
+        AMS_ASSERT(dst_size >= src_size);
+        AMS_UNUSED(dst_size);
+
+        return this->UpdateMessage(dst, src, src_size, true);
+    }
+
+    template<class BlockCipher>
+    size_t GcmModeImpl<BlockCipher>::UpdateDecrypt(void *dst, size_t dst_size, const void *src, size_t src_size) {
+        /* Validate pre-conditions. */
+        AMS_ASSERT(m_state == State_ProcessingAad || m_state == State_Decrypting);
+        AMS_ASSERT(dst_size >= src_size);
+        AMS_UNUSED(dst_size);
+
+        return this->UpdateMessage(dst, src, src_size, false);
+    }
+
+    template<class BlockCipher>
+    void GcmModeImpl<BlockCipher>::GetMac(void *dst, size_t dst_size) {
+        /* Validate pre-conditions. */
+        AMS_ASSERT(State_ProcessingAad <= m_state && m_state <= State_Done);
+        AMS_ASSERT(dst != nullptr);
+        AMS_ASSERT(dst_size >= MacSize);
+        AMS_UNUSED(dst_size);
+
+        /* If we haven't already done so, compute the final mac. */
+        if (m_state != State_Done) {
+            this->ComputeMac(true);
+            m_state = State_Done;
+        }
+
+        static_assert(sizeof(m_block_x) == MacSize);
+        std::memcpy(dst, std::addressof(m_block_x), MacSize);
+    }
+
+    template<class BlockCipher>
+    void GcmModeImpl<BlockCipher>::InitializeHashKey() {
+        /* We want to encrypt an empty block to use for intermediate calculations. */
+        constexpr const Block EmptyBlock = {};
+
+        this->ProcessBlock(std::addressof(m_h_mult_blocks[0]), std::addressof(EmptyBlock), m_block_cipher);
+
+        /* Pre-calculate the powers of our hash key, so that we can aggregate reductions. */
+        static_assert(sizeof(m_h_mult_blocks) / sizeof(m_h_mult_blocks[0]) > AggregatedBlockCount);
+        InitializeHashKeyPowers(m_h_mult_blocks);
+    }
+
+    template<class BlockCipher>
+    void GcmModeImpl<BlockCipher>::ComputeMac(bool encrypt) {
+        /* If we have leftover data, process it. */
+        if (m_aad_remaining > 0 || m_msg_remaining > 0) {
+            MultiplyHashKey(std::addressof(m_block_x), m_h_mult_blocks);
+        }
+
+        /* Setup the last block, holding the bit lengths of our aad and message. */
+        Block last_block;
+        util::StoreBigEndian(std::addressof(last_block.block_128.hi), static_cast<u64>(m_aad_size) * BITSIZEOF(u8));
+        util::StoreBigEndian(std::addressof(last_block.block_128.lo), static_cast<u64>(m_msg_size) * BITSIZEOF(u8));
+
+        /* Perform the final multiplication. */
+        ProcessGhashBlocks(std::addressof(m_block_x), m_h_mult_blocks, last_block.block_8, 1);
+
+        /* If we need to do an encryption, do so. */
+        if (encrypt) {
+            /* Encrypt the iv. */
+            u8 enc_result[BlockSize];
+            this->ProcessBlock(enc_result, std::addressof(m_block_ek0), m_block_cipher);
+
+            /* Xor the iv in. */
+            for (size_t i = 0; i < BlockSize; ++i) {
+                m_block_x.block_8[i] ^= enc_result[i];
+            }
+        }
+    }
+
+    template<class BlockCipher>
+    size_t GcmModeImpl<BlockCipher>::UpdateMessage(void *dst, const void *src, size_t size, bool encrypt) {
+        /* If this is the start of our message, finish processing our aad. */
+        if (m_state == State_ProcessingAad) {
+            if (m_aad_remaining > 0) {
+                MultiplyHashKey(std::addressof(m_block_x), m_h_mult_blocks);
+                m_aad_remaining = 0;
+            }
+
+            m_state = encrypt ? State_Encrypting : State_Decrypting;
+        }
+
+        /* Update our message size. */
+        m_msg_size += size;
+
+        /* Process the message in chunks, hashing the ciphertext while it's still cached. */
+        u8 *cur_dst       = static_cast<u8 *>(dst);
+        const u8 *cur_src = static_cast<const u8 *>(src);
+        size_t remaining  = size;
+        while (remaining > 0) {
+            const size_t cur_size = std::min(remaining, MessageChunkSize);
+            const u32 offset      = m_msg_remaining;
+
+            /* NOTE: When decrypting, we must hash the ciphertext before we (potentially) overwrite it in place. */
+            if (encrypt) {
+                this->CryptMessage(cur_dst, cur_src, cur_size, offset);
+                UpdateGhash(std::addressof(m_block_x), m_h_mult_blocks, std::addressof(m_msg_remaining), cur_dst, cur_size);
+            } else {
+                UpdateGhash(std::addressof(m_block_x), m_h_mult_blocks, std::addressof(m_msg_remaining), cur_src, cur_size);
+                this->CryptMessage(cur_dst, cur_src, cur_size, offset);
+            }
+
+            cur_dst   += cur_size;
+            cur_src   += cur_size;
+            remaining -= cur_size;
+        }
+
+        return size;
+    }
+
+    template<class BlockCipher>
+    void GcmModeImpl<BlockCipher>::CryptMessage(u8 *dst, const u8 *src, size_t size, u32 offset) {
+        /* Use any leftover keystream from a previous partial block. */
+        if (offset > 0) {
+            const size_t cur_size = std::min<size_t>(BlockSize - offset, size);
+            for (size_t i = 0; i < cur_size; ++i) {
+                dst[i] = src[i] ^ m_block_tmp.block_8[offset + i];
+            }
+
+            dst  += cur_size;
+            src  += cur_size;
+            size -= cur_size;
+        }
+
+        /* Process as many blocks as we can. */
+        if (const size_t num_blocks = size / BlockSize; num_blocks > 0) {
+            #if defined(__PCLMUL__) && defined(__SSSE3__)
+            if (IsAesNiAvailable() && IsPclmulAvailable()) {
+                CryptCounterBlocksAesNi<BlockCipher::RoundKeySize / BlockSize>(dst, src, num_blocks, std::addressof(m_block_ek), m_block_cipher->GetRoundKey());
+            } else
+            #endif
+            {
+                for (size_t i = 0; i < num_blocks; ++i) {
+                    IncrementCounter(std::addressof(m_block_ek));
+                    this->ProcessBlock(std::addressof(m_block_tmp), std::addressof(m_block_ek), m_block_cipher);
+
+                    for (size_t j = 0; j < BlockSize; ++j) {
+                        dst[i * BlockSize + j] = src[i * BlockSize + j] ^ m_block_tmp.block_8[j];
+                    }
+                }
+            }
+
+            dst  += num_blocks * BlockSize;
+            src  += num_blocks * BlockSize;
+            size -= num_blocks * BlockSize;
+        }
+
+        /* Generate keystream for a trailing partial block, and save it for later. */
+        if (size > 0) {
+            IncrementCounter(std::addressof(m_block_ek));
+            this->ProcessBlock(std::addressof(m_block_tmp), std::addressof(m_block_ek), m_block_cipher);
+
+            for (size_t i = 0; i < size; ++i) {
+                dst[i] = src[i] ^ m_block_tmp.block_8[i];
+            }
+        }
+    }
+
+    /* Explicitly instantiate the valid template classes. */
+    template class GcmModeImpl<AesEncryptor128>;
+    template class GcmModeImpl<AesEncryptor192>;
+    template class GcmModeImpl<AesEncryptor256>;
+
+}
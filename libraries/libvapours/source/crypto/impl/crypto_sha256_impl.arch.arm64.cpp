@@ -323,5 +323,20 @@ namespace ams::crypto::impl {
         this->ProcessBlock(m_buffer);
     }
 
+    void GenerateSha256ForBlocks(void *dst, const void *src, size_t block_size, size_t block_count) {
+        u8 *dst8 = static_cast<u8 *>(dst);
+        const u8 *src8 = static_cast<const u8 *>(src);
+
+        while (block_count-- > 0) {
+            Sha256Impl impl;
+            impl.Initialize();
+            impl.Update(src8, block_size);
+            impl.GetHash(dst8, Sha256Impl::HashSize);
+
+            dst8 += Sha256Impl::HashSize;
+            src8 += block_size;
+        }
+    }
+
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,596 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <vapours.hpp>
+#include <x86intrin.h>
+
+namespace ams::crypto::impl {
+
+    namespace {
+
+        alignas(Sha256Impl::BlockSize) constexpr const u32 RoundConstants[0x40] = {
+            0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+            0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+            0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+            0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+            0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+            0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+            0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+            0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+            0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+            0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+            0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+            0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+            0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+            0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+            0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+            0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+        };
+
+        constexpr ALWAYS_INLINE u32 Choose(u32 x, u32 y, u32 z) {
+            return (x & y) ^ ((~x) & z);
+        }
+
+        constexpr ALWAYS_INLINE u32 Majority(u32 x, u32 y, u32 z) {
+            return (x & y) ^ (x & z) ^ (y & z);
+        }
+
+        constexpr ALWAYS_INLINE u32 LargeSigma0(u32 x) {
+            return util::RotateRight<u32>(x, 2) ^ util::RotateRight<u32>(x, 13) ^ util::RotateRight<u32>(x, 22);
+        }
+
+        constexpr ALWAYS_INLINE u32 LargeSigma1(u32 x) {
+            return util::RotateRight<u32>(x, 6) ^ util::RotateRight<u32>(x, 11) ^ util::RotateRight<u32>(x, 25);
+        }
+
+        constexpr ALWAYS_INLINE u32 SmallSigma0(u32 x) {
+            return util::RotateRight<u32>(x, 7) ^ util::RotateRight<u32>(x, 18) ^ (x >> 3);
+        }
+
+        constexpr ALWAYS_INLINE u32 SmallSigma1(u32 x) {
+            return util::RotateRight<u32>(x, 17) ^ util::RotateRight<u32>(x, 19) ^ (x >> 10);
+        }
+
+        bool GetShaNiAvailabilityImpl() {
+            /* Call cpu id. */
+            int a = 0, b = 0, c = 0, d = 0;
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(1), "2"(0) : "memory");
+
+            /* Check for SSSE3 and SSE4.1, which we use to shuffle state. */
+            if (!((c & (1 << 9)) && (c & (1 << 19)))) {
+                return false;
+            }
+
+            /* Check for the SHA extensions. */
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(7), "2"(0) : "memory");
+            return (b & (1 << 29));
+        }
+
+        const bool g_is_sha_ni_available = GetShaNiAvailabilityImpl();
+
+        bool GetAvx2AvailabilityImpl() {
+            /* Call cpu id. */
+            int a = 0, b = 0, c = 0, d = 0;
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(1), "2"(0) : "memory");
+
+            /* Check for OSXSAVE and AVX. */
+            if (!((c & (1 << 27)) && (c & (1 << 28)))) {
+                return false;
+            }
+
+            /* Check that the OS saves ymm state. */
+            u32 xcr0_lo = 0, xcr0_hi = 0;
+            __asm__ __volatile__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            if ((xcr0_lo & 0x6) != 0x6) {
+                return false;
+            }
+
+            /* Check for AVX2. */
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(7), "2"(0) : "memory");
+            return (b & (1 << 5));
+        }
+
+        const bool g_is_avx2_available = GetAvx2AvailabilityImpl();
+
+        ALWAYS_INLINE bool IsShaNiAvailable() {
+            return g_is_sha_ni_available;
+        }
+
+        ALWAYS_INLINE bool IsAvx2Available() {
+            return g_is_avx2_available;
+        }
+
+        /* NOTE: The sha extension paths are compiled for the sha extensions regardless of our target, and only called when cpuid reports them. */
+        #define AMS_CRYPTO_SHA256_TARGET_SHA_NI __attribute__((target("sha,sse4.1")))
+
+        AMS_CRYPTO_SHA256_TARGET_SHA_NI ALWAYS_INLINE __m128i ScheduleMessageShaNi(__m128i w0, __m128i w1, __m128i w2, __m128i w3) {
+            /* Calculate the next four message words from the previous sixteen. */
+            return _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4)), w3);
+        }
+
+        AMS_CRYPTO_SHA256_TARGET_SHA_NI ALWAYS_INLINE void DoRoundsShaNi(__m128i &state0, __m128i &state1, __m128i msg, size_t round) {
+            /* Perform four rounds. */
+            msg    = _mm_add_epi32(msg, _mm_load_si128(reinterpret_cast<const __m128i *>(RoundConstants + round)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+        }
+
+        AMS_CRYPTO_SHA256_TARGET_SHA_NI void ProcessBlocksShaNi(u32 *intermediate_hash, const u8 *data, size_t block_count) {
+            /* Declare constant for converting message words from big endian. */
+            const __m128i ByteSwapMask = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+            /* Load the hash, and convert it to the ABEF/CDGH layout the sha extensions expect. */
+            const __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(intermediate_hash + 0)), 0xB1);
+            const __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(intermediate_hash + 4)), 0x1B);
+
+            __m128i state0 = _mm_alignr_epi8(dcba, efgh, 8);
+            __m128i state1 = _mm_blend_epi16(efgh, dcba, 0xF0);
+
+            while (block_count-- > 0) {
+                /* Save the current state. */
+                const __m128i prev_state0 = state0;
+                const __m128i prev_state1 = state1;
+
+                /* Load the message, and perform the first sixteen rounds. */
+                __m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x00)), ByteSwapMask);
+                __m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x10)), ByteSwapMask);
+                __m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x20)), ByteSwapMask);
+                __m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x30)), ByteSwapMask);
+
+                DoRoundsShaNi(state0, state1, w0, 0x00);
+                DoRoundsShaNi(state0, state1, w1, 0x04);
+                DoRoundsShaNi(state0, state1, w2, 0x08);
+                DoRoundsShaNi(state0, state1, w3, 0x0C);
+
+                /* Perform the remaining rounds, extending the message as we go. */
+                for (size_t round = 0x10; round < util::size(RoundConstants); round += 0x10) {
+                    w0 = ScheduleMessageShaNi(w0, w1, w2, w3);
+                    DoRoundsShaNi(state0, state1, w0, round + 0x00);
+                    w1 = ScheduleMessageShaNi(w1, w2, w3, w0);
+                    DoRoundsShaNi(state0, state1, w1, round + 0x04);
+                    w2 = ScheduleMessageShaNi(w2, w3, w0, w1);
+                    DoRoundsShaNi(state0, state1, w2, round + 0x08);
+                    w3 = ScheduleMessageShaNi(w3, w0, w1, w2);
+                    DoRoundsShaNi(state0, state1, w3, round + 0x0C);
+                }
+
+                /* Update the state. */
+                state0 = _mm_add_epi32(state0, prev_state0);
+                state1 = _mm_add_epi32(state1, prev_state1);
+
+                data += Sha256Impl::BlockSize;
+            }
+
+            /* Convert the state back to DCBA/HGFE, and store it. */
+            const __m128i feba = _mm_shuffle_epi32(state0, 0x1B);
+            const __m128i dchg = _mm_shuffle_epi32(state1, 0xB1);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(intermediate_hash + 0), _mm_blend_epi16(feba, dchg, 0xF0));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(intermediate_hash + 4), _mm_alignr_epi8(dchg, feba, 8));
+        }
+
+        #undef AMS_CRYPTO_SHA256_TARGET_SHA_NI
+
+        /* NOTE: Likewise, the multi-buffer path is compiled for avx2 regardless of our target, and only called when cpuid reports it. */
+        #define AMS_CRYPTO_SHA256_TARGET_AVX2 __attribute__((target("avx2")))
+
+        constexpr size_t MultiBufferLaneCount = 8;
+
+        AMS_CRYPTO_SHA256_TARGET_AVX2 ALWAYS_INLINE __m256i RotateRight(__m256i x, int n) {
+            return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, BITSIZEOF(u32) - n));
+        }
+
+        AMS_CRYPTO_SHA256_TARGET_AVX2 ALWAYS_INLINE void Transpose(__m256i *rows) {
+            /* Transpose an 8x8 matrix of words, so that row i holds word i of every lane (or vice versa). */
+            const __m256i t0 = _mm256_unpacklo_epi32(rows[0], rows[1]);
+            const __m256i t1 = _mm256_unpackhi_epi32(rows[0], rows[1]);
+            const __m256i t2 = _mm256_unpacklo_epi32(rows[2], rows[3]);
+            const __m256i t3 = _mm256_unpackhi_epi32(rows[2], rows[3]);
+            const __m256i t4 = _mm256_unpacklo_epi32(rows[4], rows[5]);
+            const __m256i t5 = _mm256_unpackhi_epi32(rows[4], rows[5]);
+            const __m256i t6 = _mm256_unpacklo_epi32(rows[6], rows[7]);
+            const __m256i t7 = _mm256_unpackhi_epi32(rows[6], rows[7]);
+
+            const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+            const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+            const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+            const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+            const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+            const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+            const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+            const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+            rows[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+            rows[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+            rows[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+            rows[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+            rows[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+            rows[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+            rows[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+            rows[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+        }
+
+        AMS_CRYPTO_SHA256_TARGET_AVX2 void ProcessBlockMultiBuffer(__m256i *state, const u8 * const *blocks) {
+            /* Declare constant for converting message words from big endian. */
+            const __m256i ByteSwapMask = _mm256_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL, 0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+            /* Load the message, transposing so that each vector holds one word of every lane. */
+            __m256i w[16];
+            for (size_t half = 0; half < 2; ++half) {
+                __m256i *rows = w + half * MultiBufferLaneCount;
+                for (size_t lane = 0; lane < MultiBufferLaneCount; ++lane) {
+                    rows[lane] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(blocks[lane] + half * sizeof(__m256i)));
+                }
+
+                Transpose(rows);
+
+                for (size_t i = 0; i < MultiBufferLaneCount; ++i) {
+                    rows[i] = _mm256_shuffle_epi8(rows[i], ByteSwapMask);
+                }
+            }
+
+            /* Load work variables. */
+            __m256i a = state[0];
+            __m256i b = state[1];
+            __m256i c = state[2];
+            __m256i d = state[3];
+            __m256i e = state[4];
+            __m256i f = state[5];
+            __m256i g = state[6];
+            __m256i h = state[7];
+
+            /* Perform rounds. */
+            for (size_t i = 0; i < util::size(RoundConstants); ++i) {
+                /* Extend the message, if we need to. */
+                __m256i &cur_w = w[i % 16];
+                if (i >= 16) {
+                    const __m256i w15 = w[(i - 15) % 16];
+                    const __m256i w2  = w[(i -  2) % 16];
+                    const __m256i s0  = _mm256_xor_si256(_mm256_xor_si256(RotateRight(w15,  7), RotateRight(w15, 18)), _mm256_srli_epi32(w15,  3));
+                    const __m256i s1  = _mm256_xor_si256(_mm256_xor_si256(RotateRight(w2,  17), RotateRight(w2,  19)), _mm256_srli_epi32(w2,  10));
+
+                    cur_w = _mm256_add_epi32(_mm256_add_epi32(cur_w, s0), _mm256_add_epi32(w[(i - 7) % 16], s1));
+                }
+
+                const __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(RotateRight(e, 6), RotateRight(e, 11)), RotateRight(e, 25));
+                const __m256i choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+                const __m256i tmp0   = _mm256_add_epi32(_mm256_add_epi32(h, sigma1), _mm256_add_epi32(choose, _mm256_add_epi32(_mm256_set1_epi32(RoundConstants[i]), cur_w)));
+
+                const __m256i sigma0   = _mm256_xor_si256(_mm256_xor_si256(RotateRight(a, 2), RotateRight(a, 13)), RotateRight(a, 22));
+                const __m256i majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+                const __m256i tmp1     = _mm256_add_epi32(sigma0, majority);
+
+                h = g;
+                g = f;
+                f = e;
+                e = _mm256_add_epi32(d, tmp0);
+                d = c;
+                c = b;
+                b = a;
+                a = _mm256_add_epi32(tmp0, tmp1);
+            }
+
+            /* Update intermediate hash. */
+            state[0] = _mm256_add_epi32(state[0], a);
+            state[1] = _mm256_add_epi32(state[1], b);
+            state[2] = _mm256_add_epi32(state[2], c);
+            state[3] = _mm256_add_epi32(state[3], d);
+            state[4] = _mm256_add_epi32(state[4], e);
+            state[5] = _mm256_add_epi32(state[5], f);
+            state[6] = _mm256_add_epi32(state[6], g);
+            state[7] = _mm256_add_epi32(state[7], h);
+        }
+
+        AMS_CRYPTO_SHA256_TARGET_AVX2 void GenerateSha256MultiBuffer(u8 *dst, const u8 *src, size_t message_size) {
+            constexpr size_t BlockSize                 = Sha256Impl::BlockSize;
+            constexpr size_t BlockSizeWithoutSizeField = BlockSize - sizeof(u64);
+
+            /* Set the initial hash for every lane. */
+            __m256i state[8] = {
+                _mm256_set1_epi32(0x6A09E667), _mm256_set1_epi32(0xBB67AE85), _mm256_set1_epi32(0x3C6EF372), _mm256_set1_epi32(0xA54FF53A),
+                _mm256_set1_epi32(0x510E527F), _mm256_set1_epi32(0x9B05688C), _mm256_set1_epi32(0x1F83D9AB), _mm256_set1_epi32(0x5BE0CD19),
+            };
+
+            /* Process all full blocks. As every message is the same size, the lanes stay in lockstep. */
+            const u8 *blocks[MultiBufferLaneCount];
+            for (size_t lane = 0; lane < MultiBufferLaneCount; ++lane) {
+                blocks[lane] = src + message_size * lane;
+            }
+
+            for (size_t i = 0; i < message_size / BlockSize; ++i) {
+                ProcessBlockMultiBuffer(state, blocks);
+
+                for (size_t lane = 0; lane < MultiBufferLaneCount; ++lane) {
+                    blocks[lane] += BlockSize;
+                }
+            }
+
+            /* Set up the padded final block(s) for every lane. */
+            const size_t remaining   = message_size % BlockSize;
+            const size_t last_blocks = (remaining < BlockSizeWithoutSizeField) ? 1 : 2;
+
+            u8 last_block_buffer[MultiBufferLaneCount][BlockSize * 2];
+            for (size_t lane = 0; lane < MultiBufferLaneCount; ++lane) {
+                u8 *last = last_block_buffer[lane];
+
+                std::memcpy(last, blocks[lane], remaining);
+                last[remaining] = 0x80;
+                std::memset(last + remaining + 1, 0, BlockSize * last_blocks - sizeof(u64) - (remaining + 1));
+                util::StoreBigEndian<u64>(reinterpret_cast<u64 *>(last + BlockSize * last_blocks - sizeof(u64)), static_cast<u64>(message_size) * BITSIZEOF(u8));
+
+                blocks[lane] = last;
+            }
+
+            for (size_t i = 0; i < last_blocks; ++i) {
+                ProcessBlockMultiBuffer(state, blocks);
+
+                for (size_t lane = 0; lane < MultiBufferLaneCount; ++lane) {
+                    blocks[lane] += BlockSize;
+                }
+            }
+
+            /* Transpose the state so that each vector holds one lane's hash, and store it. */
+            const __m256i ByteSwapMask = _mm256_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL, 0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+            Transpose(state);
+            for (size_t lane = 0; lane < MultiBufferLaneCount; ++lane) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + Sha256Impl::HashSize * lane), _mm256_shuffle_epi8(state[lane], ByteSwapMask));
+            }
+        }
+
+        #undef AMS_CRYPTO_SHA256_TARGET_AVX2
+
+        void ProcessBlockGeneric(u32 *intermediate_hash, const void *data) {
+            /* Load work variables. */
+            u32 a = intermediate_hash[0];
+            u32 b = intermediate_hash[1];
+            u32 c = intermediate_hash[2];
+            u32 d = intermediate_hash[3];
+            u32 e = intermediate_hash[4];
+            u32 f = intermediate_hash[5];
+            u32 g = intermediate_hash[6];
+            u32 h = intermediate_hash[7];
+            u32 tmp[2];
+            size_t i;
+
+            /* Copy the input. */
+            u32 w[64];
+            if constexpr (util::IsLittleEndian()) {
+                static_assert(Sha256Impl::BlockSize % sizeof(u32) == 0);
+
+                const u32 *src_32 = static_cast<const u32 *>(data);
+                for (size_t i = 0; i < Sha256Impl::BlockSize / sizeof(u32); ++i) {
+                    w[i] = util::LoadBigEndian<u32>(src_32 + i);
+                }
+            } else {
+                std::memcpy(w, data, Sha256Impl::BlockSize);
+            }
+
+            /* Initialize the rest of w. */
+            for (i = Sha256Impl::BlockSize / sizeof(u32); i < util::size(w); ++i) {
+                const u32 *prev = w + (i - Sha256Impl::BlockSize / sizeof(u32));
+                w[i] = prev[0] + SmallSigma0(prev[1]) + prev[9] + SmallSigma1(prev[14]);
+            }
+
+            /* Perform rounds. */
+            for (i = 0; i < 64; ++i) {
+                tmp[0] = h + LargeSigma1(e) + Choose(e, f, g) + RoundConstants[i] + w[i];
+                tmp[1] = LargeSigma0(a) + Majority(a, b, c);
+
+                h = g;
+                g = f;
+                f = e;
+                e = d + tmp[0];
+                d = c;
+                c = b;
+                b = a;
+                a = tmp[0] + tmp[1];
+            }
+
+            /* Update intermediate hash. */
+            intermediate_hash[0] += a;
+            intermediate_hash[1] += b;
+            intermediate_hash[2] += c;
+            intermediate_hash[3] += d;
+            intermediate_hash[4] += e;
+            intermediate_hash[5] += f;
+            intermediate_hash[6] += g;
+            intermediate_hash[7] += h;
+        }
+
+    }
+
+    void Sha256Impl::Initialize() {
+        /* Reset buffered bytes/bits. */
+        m_buffered_bytes = 0;
+        m_bits_consumed  = 0;
+
+        /* Set intermediate hash. */
+        m_intermediate_hash[0] = 0x6A09E667;
+        m_intermediate_hash[1] = 0xBB67AE85;
+        m_intermediate_hash[2] = 0x3C6EF372;
+        m_intermediate_hash[3] = 0xA54FF53A;
+        m_intermediate_hash[4] = 0x510E527F;
+        m_intermediate_hash[5] = 0x9B05688C;
+        m_intermediate_hash[6] = 0x1F83D9AB;
+        m_intermediate_hash[7] = 0x5BE0CD19;
+
+        /* Set state. */
+        m_state = State_Initialized;
+    }
+
+    void Sha256Impl::Update(const void *data, size_t size) {
+        /* Verify we're in a state to update. */
+        AMS_ASSERT(m_state == State_Initialized);
+
+        /* Advance our input bit count. */
+        m_bits_consumed += BITSIZEOF(u8) * (((m_buffered_bytes + size) / BlockSize) * BlockSize);
+
+        /* Process anything we have buffered. */
+        const u8 *data8 = static_cast<const u8 *>(data);
+        size_t remaining = size;
+
+        if (m_buffered_bytes > 0) {
+            const size_t copy_size = std::min(BlockSize - m_buffered_bytes, remaining);
+            std::memcpy(m_buffer + m_buffered_bytes, data8, copy_size);
+
+            data8            += copy_size;
+            remaining        -= copy_size;
+            m_buffered_bytes += copy_size;
+
+            /* Process a block, if we filled one. */
+            if (m_buffered_bytes == BlockSize) {
+                this->ProcessBlock(m_buffer);
+                m_buffered_bytes = 0;
+            }
+        }
+
+        /* Process blocks, if we have any. */
+        if (remaining >= BlockSize) {
+            const size_t blocks = remaining / BlockSize;
+
+            this->ProcessBlocks(data8, blocks);
+            data8     += BlockSize * blocks;
+            remaining -= BlockSize * blocks;
+        }
+
+        /* Copy any leftover data to our buffer. */
+        if (remaining > 0) {
+            m_buffered_bytes = remaining;
+            std::memcpy(m_buffer, data8, remaining);
+        }
+    }
+
+    void Sha256Impl::GetHash(void *dst, size_t size) {
+        /* Verify we're in a state to get hash. */
+        AMS_ASSERT(m_state == State_Initialized || m_state == State_Done);
+        AMS_ASSERT(size >= HashSize);
+        AMS_UNUSED(size);
+
+        /* If we need to, process the last block. */
+        if (m_state == State_Initialized) {
+            this->ProcessLastBlock();
+            m_state = State_Done;
+        }
+
+        /* Copy the output hash. */
+        if constexpr (util::IsLittleEndian()) {
+            static_assert(HashSize % sizeof(u32) == 0);
+
+            u32 *dst_32 = static_cast<u32 *>(dst);
+            for (size_t i = 0; i < HashSize / sizeof(u32); ++i) {
+                dst_32[i] = util::LoadBigEndian<u32>(m_intermediate_hash + i);
+            }
+        } else {
+            std::memcpy(dst, m_intermediate_hash, HashSize);
+        }
+    }
+
+    void Sha256Impl::InitializeWithContext(const Sha256Context *context) {
+        /* Copy state in from the context. */
+        std::memcpy(m_intermediate_hash, context->intermediate_hash, sizeof(m_intermediate_hash));
+        m_bits_consumed = context->bits_consumed;
+
+        /* Reset other fields. */
+        m_buffered_bytes = 0;
+        m_state = State_Initialized;
+    }
+
+    size_t Sha256Impl::GetContext(Sha256Context *context) const {
+        /* Check our state. */
+        AMS_ASSERT(m_state == State_Initialized);
+
+        /* Copy out the context. */
+        std::memcpy(context->intermediate_hash, m_intermediate_hash, sizeof(context->intermediate_hash));
+        context->bits_consumed = m_bits_consumed;
+
+        return m_buffered_bytes;
+    }
+
+    void Sha256Impl::ProcessBlock(const void *data) {
+        return this->ProcessBlocks(static_cast<const u8 *>(data), 1);
+    }
+
+    void Sha256Impl::ProcessBlocks(const u8 *data, size_t block_count) {
+        /* If we have the sha extensions, use an optimized impl. */
+        if (IsShaNiAvailable()) {
+            return ProcessBlocksShaNi(m_intermediate_hash, data, block_count);
+        }
+
+        /* Fall back to the default implementation. */
+        while (block_count-- > 0) {
+            ProcessBlockGeneric(m_intermediate_hash, data);
+            data += BlockSize;
+        }
+    }
+
+    void Sha256Impl::ProcessLastBlock() {
+        /* Setup the final block. */
+        constexpr const auto BlockSizeWithoutSizeField = BlockSize - sizeof(u64);
+
+        /* Increment our bits consumed. */
+        m_bits_consumed += BITSIZEOF(u8) * m_buffered_bytes;
+
+        /* Add 0x80 terminator. */
+        m_buffer[m_buffered_bytes++] = 0x80;
+
+        /* If we can process the size field directly, do so, otherwise set up to process it. */
+        if (m_buffered_bytes <= BlockSizeWithoutSizeField) {
+            /* Clear up to size field. */
+            std::memset(m_buffer + m_buffered_bytes, 0, BlockSizeWithoutSizeField - m_buffered_bytes);
+        } else {
+            /* Consume full block */
+            std::memset(m_buffer + m_buffered_bytes, 0, BlockSize - m_buffered_bytes);
+            this->ProcessBlock(m_buffer);
+
+            /* Clear up to size field. */
+            std::memset(m_buffer, 0, BlockSizeWithoutSizeField);
+        }
+
+        /* Store the size field. */
+        util::StoreBigEndian<u64>(reinterpret_cast<u64 *>(m_buffer + BlockSizeWithoutSizeField), m_bits_consumed);
+
+        /* Process the final block. */
+        this->ProcessBlock(m_buffer);
+    }
+
+    void GenerateSha256ForBlocks(void *dst, const void *src, size_t block_size, size_t block_count) {
+        u8 *dst8 = static_cast<u8 *>(dst);
+        const u8 *src8 = static_cast<const u8 *>(src);
+
+        /* The sha extensions are faster than hashing several blocks at once, so only use multi-buffer hashing without them. */
+        if (!IsShaNiAvailable() && IsAvx2Available()) {
+            while (block_count >= MultiBufferLaneCount) {
+                GenerateSha256MultiBuffer(dst8, src8, block_size);
+
+                dst8        += Sha256Impl::HashSize * MultiBufferLaneCount;
+                src8        += block_size * MultiBufferLaneCount;
+                block_count -= MultiBufferLaneCount;
+            }
+        }
+
+        /* Hash any remaining blocks one at a time. */
+        while (block_count-- > 0) {
+            Sha256Impl impl;
+            impl.Initialize();
+            impl.Update(src8, block_size);
+            impl.GetHash(dst8, Sha256Impl::HashSize);
+
+            dst8 += Sha256Impl::HashSize;
+            src8 += block_size;
+        }
+    }
+
+}
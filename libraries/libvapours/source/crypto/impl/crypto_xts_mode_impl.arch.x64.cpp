@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <vapours.hpp>
+#include "crypto_update_impl.hpp"
+#include "crypto_aes_impl.arch.x64.hpp"
+
+namespace ams::crypto::impl {
+
+    namespace {
+
+        /* TODO: Support non-Nintendo Endianness */
+
+        ALWAYS_INLINE __m128i MultiplyTweak(const __m128i tweak) {
+            /* Gather the carries out of each half: the low half's carries into the high half, and the high half's is reduced by 0x87. */
+            const __m128i carries = _mm_and_si128(_mm_shuffle_epi32(_mm_srai_epi32(tweak, 31), 0x13), _mm_set_epi32(0, 1, 0, 0x87));
+
+            /* Shift both halves left by one, and apply the carries. */
+            return _mm_xor_si128(_mm_add_epi64(tweak, tweak), carries);
+        }
+
+        template<bool IsEncrypt>
+        ALWAYS_INLINE __m128i AesRound(const __m128i block, const __m128i key) {
+            if constexpr (IsEncrypt) {
+                return _mm_aesenc_si128(block, key);
+            } else {
+                return _mm_aesdec_si128(block, key);
+            }
+        }
+
+        template<bool IsEncrypt>
+        ALWAYS_INLINE __m128i AesLastRound(const __m128i block, const __m128i key) {
+            if constexpr (IsEncrypt) {
+                return _mm_aesenclast_si128(block, key);
+            } else {
+                return _mm_aesdeclast_si128(block, key);
+            }
+        }
+
+        template<size_t RoundKeyCount, bool IsEncrypt>
+        void CryptBlocksAesNi(u8 *dst, const u8 *src, size_t num_blocks, u8 *tweak_storage, const u8 *raw_round_keys) {
+            /* Load all keys into sse2 registers, in the order we'll use them. */
+            /* NOTE: Decryption round keys are stored in encryption order, so we reverse them. */
+            __m128i round_keys[RoundKeyCount];
+            for (size_t i = 0; i < RoundKeyCount; ++i) {
+                const size_t key_index = IsEncrypt ? i : (RoundKeyCount - 1 - i);
+                round_keys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(raw_round_keys + XtsModeImpl::BlockSize * key_index));
+            }
+
+            /* Load the tweak. */
+            __m128i tweak = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tweak_storage));
+
+            /* Process eight blocks at a time, while we can. */
+            constexpr size_t UnrolledBlockCount = 8;
+            constexpr size_t BlockSize          = XtsModeImpl::BlockSize;
+
+            while (num_blocks >= UnrolledBlockCount) {
+                /* Calculate the tweaks for each block. */
+                const __m128i t0 = tweak;
+                const __m128i t1 = MultiplyTweak(t0);
+                const __m128i t2 = MultiplyTweak(t1);
+                const __m128i t3 = MultiplyTweak(t2);
+                const __m128i t4 = MultiplyTweak(t3);
+                const __m128i t5 = MultiplyTweak(t4);
+                const __m128i t6 = MultiplyTweak(t5);
+                const __m128i t7 = MultiplyTweak(t6);
+
+                /* Read blocks in, xor with the tweaks and the first round key. */
+                __m128i key = round_keys[0];
+                __m128i b0 = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + BlockSize * 0)), t0), key);
+                __m128i b1 = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + BlockSize * 1)), t1), key);
+                __m128i b2 = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + BlockSize * 2)), t2), key);
+                __m128i b3 = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + BlockSize * 3)), t3), key);
+                __m128i b4 = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + BlockSize * 4)), t4), key);
+                __m128i b5 = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + BlockSize * 5)), t5), key);
+                __m128i b6 = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + BlockSize * 6)), t6), key);
+                __m128i b7 = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + BlockSize * 7)), t7), key);
+
+                /* Do the middle rounds. */
+                for (size_t i = 1; i < RoundKeyCount - 1; ++i) {
+                    key = round_keys[i];
+                    b0 = AesRound<IsEncrypt>(b0, key);
+                    b1 = AesRound<IsEncrypt>(b1, key);
+                    b2 = AesRound<IsEncrypt>(b2, key);
+                    b3 = AesRound<IsEncrypt>(b3, key);
+                    b4 = AesRound<IsEncrypt>(b4, key);
+                    b5 = AesRound<IsEncrypt>(b5, key);
+                    b6 = AesRound<IsEncrypt>(b6, key);
+                    b7 = AesRound<IsEncrypt>(b7, key);
+                }
+
+                /* Do the final round. */
+                key = round_keys[RoundKeyCount - 1];
+                b0 = AesLastRound<IsEncrypt>(b0, key);
+                b1 = AesLastRound<IsEncrypt>(b1, key);
+                b2 = AesLastRound<IsEncrypt>(b2, key);
+                b3 = AesLastRound<IsEncrypt>(b3, key);
+                b4 = AesLastRound<IsEncrypt>(b4, key);
+                b5 = AesLastRound<IsEncrypt>(b5, key);
+                b6 = AesLastRound<IsEncrypt>(b6, key);
+                b7 = AesLastRound<IsEncrypt>(b7, key);
+
+                /* Xor with the tweaks, and write the blocks. */
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + BlockSize * 0), _mm_xor_si128(b0, t0));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + BlockSize * 1), _mm_xor_si128(b1, t1));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + BlockSize * 2), _mm_xor_si128(b2, t2));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + BlockSize * 3), _mm_xor_si128(b3, t3));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + BlockSize * 4), _mm_xor_si128(b4, t4));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + BlockSize * 5), _mm_xor_si128(b5, t5));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + BlockSize * 6), _mm_xor_si128(b6, t6));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + BlockSize * 7), _mm_xor_si128(b7, t7));
+
+                /* Advance. */
+                tweak = MultiplyTweak(t7);
+
+                src        += BlockSize * UnrolledBlockCount;
+                dst        += BlockSize * UnrolledBlockCount;
+                num_blocks -= UnrolledBlockCount;
+            }
+
+            /* Process blocks one at a time. */
+            while (num_blocks > 0) {
+                /* Read the block in, xor with the tweak and the first round key. */
+                __m128i b = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)), tweak), round_keys[0]);
+
+                /* Do aes rounds. */
+                for (size_t i = 1; i < RoundKeyCount - 1; ++i) {
+                    b = AesRound<IsEncrypt>(b, round_keys[i]);
+                }
+                b = AesLastRound<IsEncrypt>(b, round_keys[RoundKeyCount - 1]);
+
+                /* Xor with the tweak, and write the block. */
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_xor_si128(b, tweak));
+
+                /* Advance. */
+                tweak = MultiplyTweak(tweak);
+
+                src        += BlockSize;
+                dst        += BlockSize;
+                num_blocks -= 1;
+            }
+
+            /* Store the updated tweak. */
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(tweak_storage), tweak);
+        }
+
+    }
+
+    size_t XtsModeImpl::UpdateGeneric(void *dst, size_t dst_size, const void *src, size_t src_size) {
+        AMS_ASSERT(m_state == State_Initialized || m_state == State_Processing);
+
+        return UpdateImpl<void>(this, dst, dst_size, src, src_size);
+    }
+
+    size_t XtsModeImpl::ProcessBlocksGeneric(u8 *dst, const u8 *src, size_t num_blocks) {
+        size_t processed = BlockSize * (num_blocks - 1);
+
+        if (m_state == State_Processing) {
+            this->ProcessBlock(dst, m_last_block);
+            dst       += BlockSize;
+            processed += BlockSize;
+        }
+
+        while ((--num_blocks) > 0) {
+            this->ProcessBlock(dst, src);
+            dst += BlockSize;
+            src += BlockSize;
+        }
+
+        std::memcpy(m_last_block, src, BlockSize);
+
+        m_state = State_Processing;
+
+        return processed;
+    }
+
+    template<typename BlockCipher, bool IsEncrypt>
+    size_t XtsModeImpl::ProcessBlocksAesNi(u8 *dst, const u8 *src, size_t num_blocks) {
+        /* If we don't have aes-ni, fall back to the default implementation. */
+        if (!IsAesNiAvailable()) {
+            return this->ProcessBlocksGeneric(dst, src, num_blocks);
+        }
+
+        /* Handle last buffered block. */
+        size_t processed = BlockSize * (num_blocks - 1);
+
+        if (m_state == State_Processing) {
+            this->ProcessBlock(dst, m_last_block);
+            dst       += BlockSize;
+            processed += BlockSize;
+        }
+
+        /* Process all but the last block, which we hold back in case we need to steal ciphertext from it. */
+        CryptBlocksAesNi<BlockCipher::RoundKeySize / BlockSize, IsEncrypt>(dst, src, num_blocks - 1, m_tweak, static_cast<const BlockCipher *>(m_cipher_ctx)->GetRoundKey());
+        src += BlockSize * (num_blocks - 1);
+
+        std::memcpy(m_last_block, src, BlockSize);
+
+        m_state = State_Processing;
+
+        return processed;
+    }
+
+    template<> size_t XtsModeImpl::ProcessBlocks<AesEncryptor128>(u8 *dst, const u8 *src, size_t num_blocks) { return this->ProcessBlocksAesNi<AesEncryptor128, true>(dst, src, num_blocks); }
+    template<> size_t XtsModeImpl::ProcessBlocks<AesEncryptor192>(u8 *dst, const u8 *src, size_t num_blocks) { return this->ProcessBlocksAesNi<AesEncryptor192, true>(dst, src, num_blocks); }
+    template<> size_t XtsModeImpl::ProcessBlocks<AesEncryptor256>(u8 *dst, const u8 *src, size_t num_blocks) { return this->ProcessBlocksAesNi<AesEncryptor256, true>(dst, src, num_blocks); }
+
+    template<> size_t XtsModeImpl::ProcessBlocks<AesDecryptor128>(u8 *dst, const u8 *src, size_t num_blocks) { return this->ProcessBlocksAesNi<AesDecryptor128, false>(dst, src, num_blocks); }
+    template<> size_t XtsModeImpl::ProcessBlocks<AesDecryptor192>(u8 *dst, const u8 *src, size_t num_blocks) { return this->ProcessBlocksAesNi<AesDecryptor192, false>(dst, src, num_blocks); }
+    template<> size_t XtsModeImpl::ProcessBlocks<AesDecryptor256>(u8 *dst, const u8 *src, size_t num_blocks) { return this->ProcessBlocksAesNi<AesDecryptor256, false>(dst, src, num_blocks); }
+
+    template<> size_t XtsModeImpl::Update<AesEncryptor128>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesEncryptor128>(this, dst, dst_size, src, src_size); }
+    template<> size_t XtsModeImpl::Update<AesEncryptor192>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesEncryptor192>(this, dst, dst_size, src, src_size); }
+    template<> size_t XtsModeImpl::Update<AesEncryptor256>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesEncryptor256>(this, dst, dst_size, src, src_size); }
+
+    template<> size_t XtsModeImpl::Update<AesDecryptor128>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesDecryptor128>(this, dst, dst_size, src, src_size); }
+    template<> size_t XtsModeImpl::Update<AesDecryptor192>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesDecryptor192>(this, dst, dst_size, src, src_size); }
+    template<> size_t XtsModeImpl::Update<AesDecryptor256>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesDecryptor256>(this, dst, dst_size, src, src_size); }
+
+}
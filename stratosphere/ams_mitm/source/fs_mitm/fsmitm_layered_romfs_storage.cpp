@@ -17,6 +17,7 @@
 #include "../amsmitm_initialization.hpp"
 #include "../amsmitm_fs_utils.hpp"
 #include "fsmitm_layered_romfs_storage.hpp"
+#include "fsmitm_romfs_build_cache.hpp"
 
 namespace ams::mitm::fs {
 
@@ -273,8 +274,9 @@ namespace ams::mitm::fs {
         }
     }
 
-    LayeredRomfsStorageImpl::LayeredRomfsStorageImpl(std::unique_ptr<IStorage> s_r, std::unique_ptr<IStorage> f_r, ncm::ProgramId pr_id) : m_storage_romfs(std::move(s_r)), m_file_romfs(std::move(f_r)), m_initialize_event(os::EventClearMode_ManualClear), m_program_id(std::move(pr_id)), m_is_initialized(false), m_started_initialize(false) {
-        /* ... */
+    LayeredRomfsStorageImpl::LayeredRomfsStorageImpl(std::unique_ptr<IStorage> s_r, std::unique_ptr<IStorage> f_r, ncm::ProgramId pr_id) : m_storage_romfs(std::move(s_r)), m_file_romfs(std::move(f_r)), m_loose_file_cache(), m_initialize_event(os::EventClearMode_ManualClear), m_program_id(std::move(pr_id)), m_is_initialized(false), m_started_initialize(false) {
+        /* Set up our loose file handle cache. */
+        m_loose_file_cache.Initialize(GetLooseFileHandleCacheCount());
     }
 
     LayeredRomfsStorageImpl::~LayeredRomfsStorageImpl() {
@@ -293,17 +295,28 @@ namespace ams::mitm::fs {
         /* Build new virtual romfs. */
         romfs::Builder builder(m_program_id);
 
-        if (mitm::IsInitialized()) {
-            builder.AddSdFiles();
-        }
-        if (m_file_romfs) {
-            builder.AddStorageFiles(m_file_romfs.get(), romfs::DataSourceType::File);
-        }
-        if (m_storage_romfs) {
-            builder.AddStorageFiles(m_storage_romfs.get(), romfs::DataSourceType::Storage);
-        }
+        /* If nothing has changed since the last time we built this romfs, re-use the previous build. */
+        romfs::BuildCacheKey cache_key;
+        romfs::CalculateBuildCacheKey(std::addressof(cache_key), m_program_id, mitm::IsInitialized(), m_file_romfs.get(), m_storage_romfs.get());
+
+        if (!romfs::LoadBuildCache(std::addressof(m_source_infos), m_program_id, cache_key)) {
+            /* The previous build's metadata is about to be overwritten, so invalidate it. */
+            romfs::InvalidateBuildCache(m_program_id);
+
+            if (mitm::IsInitialized()) {
+                builder.AddSdFiles();
+            }
+            if (m_file_romfs) {
+                builder.AddStorageFiles(m_file_romfs.get(), romfs::DataSourceType::File);
+            }
+            if (m_storage_romfs) {
+                builder.AddStorageFiles(m_storage_romfs.get(), romfs::DataSourceType::Storage);
+            }
 
-        builder.Build(std::addressof(m_source_infos));
+            builder.Build(std::addressof(m_source_infos));
+
+            romfs::SaveBuildCache(m_program_id, cache_key, m_source_infos);
+        }
 
         m_is_initialized = true;
         m_initialize_event.Signal();
@@ -350,12 +363,11 @@ namespace ams::mitm::fs {
                         break;
                     case romfs::DataSourceType::LooseSdFile:
                         {
-                            FsFile file;
-                            R_ABORT_UNLESS(mitm::fs::OpenAtmosphereSdRomfsFile(std::addressof(file), m_program_id, cur_source.loose_source_info.path, OpenMode_Read));
-                            ON_SCOPE_EXIT { fsFileClose(std::addressof(file)); };
+                            LooseFileHandleCache::Accessor file;
+                            R_ABORT_UNLESS(m_loose_file_cache.Open(std::addressof(file), m_program_id, static_cast<size_t>(it - m_source_infos.begin()), cur_source.loose_source_info.path));
 
                             u64 out_read = 0;
-                            R_ABORT_UNLESS(fsFileRead(std::addressof(file), offset_within_source, cur_dst, cur_read_size, FsReadOption_None, std::addressof(out_read)));
+                            R_ABORT_UNLESS(fsFileRead(file.Get(), offset_within_source, cur_dst, cur_read_size, FsReadOption_None, std::addressof(out_read)));
                             AMS_ABORT_UNLESS(out_read == cur_read_size);
                         }
                         break;
@@ -17,6 +17,7 @@
 #pragma once
 #include <stratosphere.hpp>
 #include "fsmitm_romfs.hpp"
+#include "fsmitm_loose_file_handle_cache.hpp"
 
 namespace ams::mitm::fs {
 
@@ -25,6 +26,7 @@ namespace ams::mitm::fs {
             romfs::Builder::SourceInfoVector m_source_infos;
             std::unique_ptr<ams::fs::IStorage> m_storage_romfs;
             std::unique_ptr<ams::fs::IStorage> m_file_romfs;
+            LooseFileHandleCache m_loose_file_cache;
             os::Event m_initialize_event;
             ncm::ProgramId m_program_id;
             bool m_is_initialized;
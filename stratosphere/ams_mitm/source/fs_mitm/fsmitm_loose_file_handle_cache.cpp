@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "../amsmitm_fs_utils.hpp"
+#include "fsmitm_loose_file_handle_cache.hpp"
+
+namespace ams::mitm::fs {
+
+    namespace {
+
+        constexpr size_t DefaultLooseFileHandleCacheCount = 0x10;
+
+        size_t GetLooseFileHandleCacheCountImpl() {
+            u32 count = 0;
+            if (settings::fwdbg::GetSettingsItemValue(std::addressof(count), sizeof(count), "atmosphere", "fsmitm_romfs_file_handle_cache_count") != sizeof(count)) {
+                count = DefaultLooseFileHandleCacheCount;
+            }
+
+            return std::min<size_t>(count, LooseFileHandleCache::MaxHandleCountLimit);
+        }
+
+    }
+
+    size_t GetLooseFileHandleCacheCount() {
+        AMS_FUNCTION_LOCAL_STATIC(size_t, s_count, GetLooseFileHandleCacheCountImpl());
+        return s_count;
+    }
+
+    LooseFileHandleCache::Accessor::~Accessor() {
+        if (m_entry != nullptr) {
+            m_cache->Release(m_entry);
+        } else if (m_has_uncached_file) {
+            fsFileClose(std::addressof(m_uncached_file));
+        }
+    }
+
+    LooseFileHandleCache::LooseFileHandleCache() : m_mutex(), m_entries(nullptr), m_max_count(0), m_mru_list(), m_free_list() {
+        /* ... */
+    }
+
+    LooseFileHandleCache::~LooseFileHandleCache() {
+        /* All accessors must be gone by the time we are destroyed. */
+        for (auto &entry : m_mru_list) {
+            AMS_ABORT_UNLESS(entry.reference_count == 0);
+            fsFileClose(std::addressof(entry.file));
+        }
+
+        m_mru_list.clear();
+        m_free_list.clear();
+
+        delete[] m_entries;
+    }
+
+    void LooseFileHandleCache::Initialize(size_t max_count) {
+        AMS_ABORT_UNLESS(m_entries == nullptr);
+        AMS_ABORT_UNLESS(max_count <= MaxHandleCountLimit);
+
+        /* A zero-sized cache means every read opens and closes its own handle. */
+        if (max_count == 0) {
+            return;
+        }
+
+        m_entries   = new Entry[max_count];
+        m_max_count = max_count;
+
+        for (size_t i = 0; i < m_max_count; ++i) {
+            m_free_list.push_back(m_entries[i]);
+        }
+    }
+
+    bool LooseFileHandleCache::FindAndReference(Accessor *out, size_t source_index) {
+        AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
+
+        for (auto &entry : m_mru_list) {
+            if (entry.source_index == source_index) {
+                ++entry.reference_count;
+
+                m_mru_list.erase(m_mru_list.iterator_to(entry));
+                m_mru_list.push_front(entry);
+
+                out->m_cache = this;
+                out->m_entry = std::addressof(entry);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    Result LooseFileHandleCache::Open(Accessor *out, ncm::ProgramId program_id, size_t source_index, const char *path) {
+        AMS_ASSERT(out->m_entry == nullptr);
+        AMS_ASSERT(!out->m_has_uncached_file);
+
+        /* Check if we already have the file open. */
+        {
+            std::scoped_lock lk(m_mutex);
+            R_SUCCEED_IF(this->FindAndReference(out, source_index));
+        }
+
+        /* Open the file without holding our lock, so that opens of other files aren't serialized behind the ipc. */
+        ::FsFile file;
+        R_TRY(mitm::fs::OpenAtmosphereSdRomfsFile(std::addressof(file), program_id, path, ams::fs::OpenMode_Read));
+
+        /* Handles we no longer need are closed after we drop our lock. */
+        ::FsFile file_to_close;
+        bool has_file_to_close = false;
+        ON_SCOPE_EXIT {
+            if (has_file_to_close) {
+                fsFileClose(std::addressof(file_to_close));
+            }
+        };
+
+        {
+            std::scoped_lock lk(m_mutex);
+
+            /* Check again, in case another thread cached the file while we were opening it. */
+            if (this->FindAndReference(out, source_index)) {
+                file_to_close     = file;
+                has_file_to_close = true;
+                R_SUCCEED();
+            }
+
+            /* Find an entry to use, evicting the least recently used idle handle if we need to. */
+            Entry *entry = nullptr;
+            if (!m_free_list.empty()) {
+                entry = std::addressof(m_free_list.front());
+                m_free_list.pop_front();
+            } else {
+                for (auto it = m_mru_list.rbegin(); it != m_mru_list.rend(); ++it) {
+                    if (it->reference_count == 0) {
+                        entry = std::addressof(*it);
+                        break;
+                    }
+                }
+
+                if (entry != nullptr) {
+                    m_mru_list.erase(m_mru_list.iterator_to(*entry));
+                    file_to_close     = entry->file;
+                    has_file_to_close = true;
+                }
+            }
+
+            if (entry != nullptr) {
+                /* Cache our handle in the entry. */
+                entry->file            = file;
+                entry->source_index    = source_index;
+                entry->reference_count = 1;
+                m_mru_list.push_front(*entry);
+
+                out->m_cache = this;
+                out->m_entry = entry;
+                R_SUCCEED();
+            }
+        }
+
+        /* All cached handles are in use, so keep our handle private. */
+        out->m_uncached_file     = file;
+        out->m_has_uncached_file = true;
+        R_SUCCEED();
+    }
+
+    void LooseFileHandleCache::Release(Entry *entry) {
+        std::scoped_lock lk(m_mutex);
+
+        AMS_ABORT_UNLESS(entry->reference_count > 0);
+        --entry->reference_count;
+    }
+
+}
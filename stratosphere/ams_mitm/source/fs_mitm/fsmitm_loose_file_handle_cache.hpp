@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stratosphere.hpp>
+
+namespace ams::mitm::fs {
+
+    class LooseFileHandleCache {
+        NON_COPYABLE(LooseFileHandleCache);
+        NON_MOVEABLE(LooseFileHandleCache);
+        public:
+            static constexpr size_t MaxHandleCountLimit = 0x40;
+        private:
+            struct Entry : public util::IntrusiveListBaseNode<Entry> {
+                ::FsFile file;
+                size_t source_index;
+                u32 reference_count;
+            };
+
+            using EntryList = typename util::IntrusiveListBaseTraits<Entry>::ListType;
+        public:
+            class Accessor {
+                NON_COPYABLE(Accessor);
+                NON_MOVEABLE(Accessor);
+                private:
+                    LooseFileHandleCache *m_cache;
+                    Entry *m_entry;
+                    ::FsFile m_uncached_file;
+                    bool m_has_uncached_file;
+                public:
+                    constexpr Accessor() : m_cache(nullptr), m_entry(nullptr), m_uncached_file(), m_has_uncached_file(false) { /* ... */ }
+                    ~Accessor();
+
+                    ::FsFile *Get() { return m_entry != nullptr ? std::addressof(m_entry->file) : std::addressof(m_uncached_file); }
+
+                    friend class LooseFileHandleCache;
+            };
+        private:
+            os::SdkMutex m_mutex;
+            Entry *m_entries;
+            size_t m_max_count;
+            EntryList m_mru_list;
+            EntryList m_free_list;
+        public:
+            LooseFileHandleCache();
+            ~LooseFileHandleCache();
+
+            void Initialize(size_t max_count);
+
+            /* Opens the file for a source, sharing a cached handle if one is available. */
+            /* If every cached handle is in use, the accessor holds a private handle which is closed on destruction. */
+            Result Open(Accessor *out, ncm::ProgramId program_id, size_t source_index, const char *path);
+        private:
+            bool FindAndReference(Accessor *out, size_t source_index);
+            void Release(Entry *entry);
+    };
+
+    size_t GetLooseFileHandleCacheCount();
+
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stratosphere.hpp>
+#include "fsmitm_romfs.hpp"
+
+namespace ams::mitm::fs::romfs {
+
+    class IoBuffer {
+        NON_COPYABLE(IoBuffer);
+        NON_MOVEABLE(IoBuffer);
+        public:
+            static constexpr size_t Size = 16_KB;
+        private:
+            u8 *m_buffer;
+        public:
+            IoBuffer() : m_buffer(static_cast<u8 *>(AllocateTracked(AllocationType_TableCache, Size))) { /* ... */ }
+
+            ~IoBuffer() {
+                if (m_buffer != nullptr) {
+                    FreeTracked(AllocationType_TableCache, m_buffer, Size);
+                }
+            }
+
+            bool IsValid() const { return m_buffer != nullptr; }
+            u8 *Get() const { return m_buffer; }
+    };
+
+    class BufferedFileReader {
+        NON_COPYABLE(BufferedFileReader);
+        NON_MOVEABLE(BufferedFileReader);
+        private:
+            ::FsFile *m_file;
+            IoBuffer m_buffer;
+            s64 m_file_offset;
+            size_t m_buffered_offset;
+            size_t m_buffered_size;
+        public:
+            BufferedFileReader(::FsFile *f, s64 offset) : m_file(f), m_buffer(), m_file_offset(offset), m_buffered_offset(0), m_buffered_size(0) { /* ... */ }
+
+            bool IsValid() const { return m_buffer.IsValid(); }
+
+            s64 GetOffset() const { return m_file_offset - static_cast<s64>(m_buffered_size - m_buffered_offset); }
+
+            void Seek(s64 offset) {
+                /* Re-use our buffer, if the offset is within it. */
+                const s64 buffer_start = m_file_offset - static_cast<s64>(m_buffered_size);
+                if (buffer_start <= offset && offset <= m_file_offset) {
+                    m_buffered_offset = static_cast<size_t>(offset - buffer_start);
+                } else {
+                    m_file_offset     = offset;
+                    m_buffered_offset = 0;
+                    m_buffered_size   = 0;
+                }
+            }
+
+            bool Read(void *dst, size_t size) {
+                u8 *cur_dst = static_cast<u8 *>(dst);
+                while (size > 0) {
+                    /* Refill the buffer, if we need to. */
+                    if (m_buffered_offset == m_buffered_size) {
+                        u64 read_size = 0;
+                        if (R_FAILED(fsFileRead(m_file, m_file_offset, m_buffer.Get(), IoBuffer::Size, FsReadOption_None, std::addressof(read_size))) || read_size == 0) {
+                            return false;
+                        }
+
+                        m_file_offset    += read_size;
+                        m_buffered_offset = 0;
+                        m_buffered_size   = read_size;
+                    }
+
+                    const size_t cur_size = std::min(size, m_buffered_size - m_buffered_offset);
+                    std::memcpy(cur_dst, m_buffer.Get() + m_buffered_offset, cur_size);
+
+                    m_buffered_offset += cur_size;
+                    cur_dst           += cur_size;
+                    size              -= cur_size;
+                }
+
+                return true;
+            }
+    };
+
+    class BufferedFileWriter {
+        NON_COPYABLE(BufferedFileWriter);
+        NON_MOVEABLE(BufferedFileWriter);
+        private:
+            ::FsFile *m_file;
+            IoBuffer m_buffer;
+            s64 m_file_offset;
+            size_t m_buffered_size;
+            bool m_failed;
+        public:
+            BufferedFileWriter(::FsFile *f, s64 offset) : m_file(f), m_buffer(), m_file_offset(offset), m_buffered_size(0), m_failed(!m_buffer.IsValid()) { /* ... */ }
+
+            bool IsFailed() const { return m_failed; }
+            void SetFailed() { m_failed = true; }
+
+            s64 GetOffset() const { return m_file_offset + m_buffered_size; }
+
+            void Write(const void *src, size_t size) {
+                const u8 *cur_src = static_cast<const u8 *>(src);
+                while (size > 0 && !m_failed) {
+                    const size_t cur_size = std::min(size, IoBuffer::Size - m_buffered_size);
+                    std::memcpy(m_buffer.Get() + m_buffered_size, cur_src, cur_size);
+
+                    m_buffered_size += cur_size;
+                    cur_src         += cur_size;
+                    size            -= cur_size;
+
+                    if (m_buffered_size == IoBuffer::Size) {
+                        this->Flush();
+                    }
+                }
+            }
+
+            bool Flush() {
+                if (!m_failed && m_buffered_size > 0) {
+                    if (R_FAILED(fsFileWrite(m_file, m_file_offset, m_buffer.Get(), m_buffered_size, FsWriteOption_None))) {
+                        m_failed = true;
+                    }
+
+                    m_file_offset  += m_buffered_size;
+                    m_buffered_size = 0;
+                }
+
+                return !m_failed;
+            }
+    };
+
+}
@@ -0,0 +1,529 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "../amsmitm_fs_utils.hpp"
+#include "fsmitm_romfs_build_cache.hpp"
+#include "fsmitm_romfs_buffered_file.hpp"
+
+namespace ams::mitm::fs::romfs {
+
+    using namespace ams::fs;
+
+    namespace {
+
+        constexpr inline u32 BuildCacheMagic   = util::FourCC<'A','R','B','C'>::Code;
+        constexpr inline u32 BuildCacheVersion = 2;
+
+        constexpr inline const char BuildCacheFileName[] = "romfs_metadata_cache.bin";
+        constexpr inline const char MetadataFileName[]   = "romfs_metadata.bin";
+
+        constexpr inline size_t DirectoryEntryBatchCount = 8;
+
+        struct BuildCacheHeader {
+            u32 magic;
+            u32 version;
+            u8 key[crypto::Sha256Generator::HashSize];
+            u32 source_info_count;
+            u32 reserved;
+            s64 metadata_size;
+            s64 body_size;
+            u8 metadata_hash[crypto::Sha256Generator::HashSize];
+        };
+        static_assert(util::is_pod<BuildCacheHeader>::value && sizeof(BuildCacheHeader) == 0x60);
+
+        struct BuildCacheSourceInfo {
+            s64 virtual_offset;
+            s64 size;
+            s64 value;
+            DataSourceType source_type;
+            u8 reserved[7];
+        };
+        static_assert(util::is_pod<BuildCacheSourceInfo>::value && sizeof(BuildCacheSourceInfo) == 0x20);
+
+        class OverrideTreeHasher {
+            NON_COPYABLE(OverrideTreeHasher);
+            NON_MOVEABLE(OverrideTreeHasher);
+            private:
+                FsFileSystem *m_fs;
+                ncm::ProgramId m_program_id;
+                crypto::Sha256Generator *m_generator;
+                ::FsDirectoryEntry *m_entries;
+                char m_path[ams::fs::EntryNameLengthMax + 1];
+            public:
+                OverrideTreeHasher(FsFileSystem *fs, ncm::ProgramId program_id, crypto::Sha256Generator *generator) : m_fs(fs), m_program_id(program_id), m_generator(generator) {
+                    m_entries = static_cast<::FsDirectoryEntry *>(AllocateTracked(AllocationType_DirPointerArray, sizeof(::FsDirectoryEntry) * DirectoryEntryBatchCount));
+                    m_path[0] = '\x00';
+                }
+
+                ~OverrideTreeHasher() {
+                    if (m_entries != nullptr) {
+                        FreeTracked(AllocationType_DirPointerArray, m_entries, sizeof(::FsDirectoryEntry) * DirectoryEntryBatchCount);
+                    }
+                }
+
+                bool Hash() {
+                    if (m_entries == nullptr) {
+                        return false;
+                    }
+
+                    /* If there is no romfs folder on the SD, there's nothing to hash. */
+                    {
+                        FsDir dir;
+                        if (R_FAILED(mitm::fs::OpenAtmosphereRomfsDirectory(std::addressof(dir), m_program_id, m_path, OpenDirectoryMode_Directory, m_fs))) {
+                            return true;
+                        }
+                        fsDirClose(std::addressof(dir));
+                    }
+
+                    return this->VisitDirectory(0);
+                }
+            private:
+                bool VisitDirectory(size_t path_len) {
+                    /* Hash every entry in the directory, reading several at a time. */
+                    {
+                        FsDir dir;
+                        if (R_FAILED(mitm::fs::OpenAtmosphereRomfsDirectory(std::addressof(dir), m_program_id, m_path, OpenDirectoryMode_All, m_fs))) {
+                            return false;
+                        }
+                        ON_SCOPE_EXIT { fsDirClose(std::addressof(dir)); };
+
+                        while (true) {
+                            s64 read_entries = 0;
+                            if (R_FAILED(fsDirRead(std::addressof(dir), std::addressof(read_entries), DirectoryEntryBatchCount, m_entries))) {
+                                return false;
+                            }
+                            if (read_entries == 0) {
+                                break;
+                            }
+
+                            for (s64 i = 0; i < read_entries; ++i) {
+                                const auto &entry = m_entries[i];
+                                const u8 type     = entry.type;
+                                const s64 size    = entry.type == FsDirEntryType_File ? entry.file_size : 0;
+                                m_generator->Update(std::addressof(type), sizeof(type));
+                                m_generator->Update(std::addressof(size), sizeof(size));
+                                m_generator->Update(entry.name, std::strlen(entry.name) + 1);
+                            }
+                        }
+                    }
+
+                    /* Mark the end of the directory, so that moving files between directories changes the hash. */
+                    {
+                        constexpr u8 EndOfDirectory = 0xFF;
+                        m_generator->Update(std::addressof(EndOfDirectory), sizeof(EndOfDirectory));
+                    }
+
+                    /* Visit all child directories. */
+                    {
+                        FsDir dir;
+                        if (R_FAILED(mitm::fs::OpenAtmosphereRomfsDirectory(std::addressof(dir), m_program_id, m_path, OpenDirectoryMode_Directory, m_fs))) {
+                            return false;
+                        }
+                        ON_SCOPE_EXIT { fsDirClose(std::addressof(dir)); };
+
+                        while (true) {
+                            s64 read_entries = 0;
+                            if (R_FAILED(fsDirRead(std::addressof(dir), std::addressof(read_entries), 1, m_entries))) {
+                                return false;
+                            }
+                            if (read_entries == 0) {
+                                break;
+                            }
+
+                            /* Append the child's name to our path. */
+                            const size_t name_len = std::strlen(m_entries[0].name);
+                            if (path_len + 1 + name_len >= sizeof(m_path)) {
+                                return false;
+                            }
+
+                            m_path[path_len] = '/';
+                            std::memcpy(m_path + path_len + 1, m_entries[0].name, name_len + 1);
+
+                            const bool success = this->VisitDirectory(path_len + 1 + name_len);
+                            m_path[path_len] = '\x00';
+
+                            if (!success) {
+                                return false;
+                            }
+                        }
+                    }
+
+                    return true;
+                }
+        };
+
+        bool HashRomfsTables(crypto::Sha256Generator *generator, ams::fs::IStorage *storage) {
+            /* Read and hash the header. */
+            ams::fs::RomFileSystemInformation header;
+            if (R_FAILED(storage->Read(0, std::addressof(header), sizeof(header)))) {
+                return false;
+            }
+            generator->Update(std::addressof(header), sizeof(header));
+
+            IoBuffer buffer;
+            if (!buffer.IsValid()) {
+                return false;
+            }
+
+            /* The built metadata only depends on the directory and file tables. */
+            const std::pair<s64, s64> tables[] = {
+                { header.directory_entry_offset, header.directory_entry_size },
+                { header.file_entry_offset,      header.file_entry_size      },
+            };
+
+            for (const auto &[offset, size] : tables) {
+                for (s64 cur = 0; cur < size; cur += IoBuffer::Size) {
+                    const size_t cur_size = static_cast<size_t>(std::min<s64>(size - cur, IoBuffer::Size));
+                    if (R_FAILED(storage->Read(offset + cur, buffer.Get(), cur_size))) {
+                        return false;
+                    }
+
+                    generator->Update(buffer.Get(), cur_size);
+                }
+            }
+
+            return true;
+        }
+
+        bool HashMetadata(u8 *out, size_t out_size, ams::fs::fsa::IFile *file, s64 size) {
+            IoBuffer buffer;
+            if (!buffer.IsValid()) {
+                return false;
+            }
+
+            crypto::Sha256Generator generator;
+            generator.Initialize();
+
+            for (s64 cur = 0; cur < size; cur += IoBuffer::Size) {
+                const size_t cur_size = static_cast<size_t>(std::min<s64>(size - cur, IoBuffer::Size));
+
+                size_t read_size = 0;
+                if (R_FAILED(file->Read(std::addressof(read_size), cur, buffer.Get(), cur_size)) || read_size != cur_size) {
+                    return false;
+                }
+
+                generator.Update(buffer.Get(), cur_size);
+            }
+
+            generator.GetHash(out, out_size);
+            return true;
+        }
+
+        void FormatBuildCachePath(char *dst, size_t dst_size, ncm::ProgramId program_id) {
+            util::SNPrintf(dst, dst_size, "contents/%016lx/%s", static_cast<u64>(program_id), BuildCacheFileName);
+        }
+
+        void CleanupSourceInfos(Builder::SourceInfoVector *infos) {
+            for (auto &info : *infos) {
+                info.Cleanup();
+            }
+            infos->clear();
+        }
+
+        bool LoadSourceInfos(Builder::SourceInfoVector *out_infos, ncm::ProgramId program_id, ::FsFile *cache_file, const BuildCacheHeader &header) {
+            BufferedFileReader reader(cache_file, sizeof(header));
+            if (!reader.IsValid()) {
+                return false;
+            }
+
+            /* Everything we read must lie within the body, whose size has been checked against the file's. */
+            const s64 body_end = static_cast<s64>(sizeof(header)) + header.body_size;
+            auto IsInBody = [&](s64 size) -> bool {
+                return 0 <= size && size <= body_end - reader.GetOffset();
+            };
+
+            if (header.source_info_count > static_cast<u64>(header.body_size) / sizeof(BuildCacheSourceInfo)) {
+                return false;
+            }
+
+            out_infos->reserve(header.source_info_count);
+            for (u32 i = 0; i < header.source_info_count; ++i) {
+                BuildCacheSourceInfo info;
+                if (!IsInBody(sizeof(info)) || !reader.Read(std::addressof(info), sizeof(info))) {
+                    return false;
+                }
+
+                switch (info.source_type) {
+                    case DataSourceType::Storage:
+                    case DataSourceType::File:
+                        out_infos->emplace_back(info.virtual_offset, info.size, info.source_type, info.value);
+                        break;
+                    case DataSourceType::LooseSdFile:
+                        {
+                            const size_t path_size = static_cast<size_t>(info.value);
+                            if (path_size == 0 || path_size > ams::fs::EntryNameLengthMax + 1 || !IsInBody(path_size)) {
+                                return false;
+                            }
+
+                            char *path = static_cast<char *>(AllocateTracked(AllocationType_FullPath, path_size));
+                            if (path == nullptr) {
+                                return false;
+                            }
+                            if (!reader.Read(path, path_size) || path[path_size - 1] != '\x00') {
+                                FreeTracked(AllocationType_FullPath, path, path_size);
+                                return false;
+                            }
+
+                            out_infos->emplace_back(info.virtual_offset, info.size, info.source_type, path);
+                        }
+                        break;
+                    case DataSourceType::Memory:
+                        {
+                            if (info.size <= 0 || !IsInBody(info.size)) {
+                                return false;
+                            }
+
+                            u8 *data = static_cast<u8 *>(AllocateTracked(AllocationType_Memory, info.size));
+                            if (data == nullptr) {
+                                return false;
+                            }
+                            if (!reader.Read(data, info.size)) {
+                                FreeTracked(AllocationType_Memory, data, info.size);
+                                return false;
+                            }
+
+                            out_infos->emplace_back(info.virtual_offset, info.size, info.source_type, data);
+                        }
+                        break;
+                    case DataSourceType::Metadata:
+                        {
+                            /* The metadata must be the final source, and must match what we built. */
+                            if (i + 1 != header.source_info_count || info.size != header.metadata_size) {
+                                return false;
+                            }
+
+                            ::FsFile metadata_file;
+                            if (R_FAILED(mitm::fs::OpenAtmosphereSdFile(std::addressof(metadata_file), program_id, MetadataFileName, OpenMode_Read))) {
+                                return false;
+                            }
+
+                            std::unique_ptr<RemoteFile> metadata(new RemoteFile(metadata_file));
+                            if (metadata == nullptr) {
+                                fsFileClose(std::addressof(metadata_file));
+                                return false;
+                            }
+
+                            /* Check that the metadata is exactly what we built, and not merely the same size. */
+                            s64 metadata_size = 0;
+                            if (R_FAILED(metadata->GetSize(std::addressof(metadata_size))) || metadata_size != header.metadata_size) {
+                                return false;
+                            }
+
+                            u8 metadata_hash[crypto::Sha256Generator::HashSize];
+                            if (!HashMetadata(metadata_hash, sizeof(metadata_hash), metadata.get(), metadata_size) || !crypto::IsSameBytes(metadata_hash, header.metadata_hash, sizeof(metadata_hash))) {
+                                return false;
+                            }
+
+                            out_infos->emplace_back(info.virtual_offset, info.size, info.source_type, metadata.release());
+                        }
+                        break;
+                    default:
+                        return false;
+                }
+            }
+
+            /* The build must end with its metadata. */
+            return !out_infos->empty() && out_infos->back().source_type == DataSourceType::Metadata;
+        }
+
+    }
+
+    void CalculateBuildCacheKey(BuildCacheKey *out, ncm::ProgramId program_id, bool has_sd_files, ams::fs::IStorage *file_romfs, ams::fs::IStorage *storage_romfs) {
+        /* Default to an invalid key. */
+        out->is_valid = false;
+
+        /* We can only cache when the sd card is available. */
+        if (!has_sd_files) {
+            return;
+        }
+
+        crypto::Sha256Generator generator;
+        generator.Initialize();
+
+        /* Hash the format version and program id. */
+        generator.Update(std::addressof(BuildCacheVersion), sizeof(BuildCacheVersion));
+        generator.Update(std::addressof(program_id), sizeof(program_id));
+
+        /* Hash the override tree. */
+        {
+            FsFileSystem sd_filesystem;
+            if (R_FAILED(fsOpenSdCardFileSystem(std::addressof(sd_filesystem)))) {
+                return;
+            }
+            ON_SCOPE_EXIT { fsFsClose(std::addressof(sd_filesystem)); };
+
+            OverrideTreeHasher hasher(std::addressof(sd_filesystem), program_id, std::addressof(generator));
+            if (!hasher.Hash()) {
+                return;
+            }
+        }
+
+        /* Hash the base romfs tables, in the order the builder adds them. */
+        for (auto *storage : { file_romfs, storage_romfs }) {
+            const u8 present = storage != nullptr;
+            generator.Update(std::addressof(present), sizeof(present));
+
+            if (storage != nullptr && !HashRomfsTables(std::addressof(generator), storage)) {
+                return;
+            }
+        }
+
+        generator.GetHash(out->hash, sizeof(out->hash));
+        out->is_valid = true;
+    }
+
+    bool LoadBuildCache(Builder::SourceInfoVector *out_infos, ncm::ProgramId program_id, const BuildCacheKey &key) {
+        /* Check that we can use the cache. */
+        if (!key.is_valid) {
+            return false;
+        }
+
+        /* Open the cache file. */
+        ::FsFile cache_file;
+        if (R_FAILED(mitm::fs::OpenAtmosphereSdFile(std::addressof(cache_file), program_id, BuildCacheFileName, OpenMode_Read))) {
+            return false;
+        }
+        ON_SCOPE_EXIT { fsFileClose(std::addressof(cache_file)); };
+
+        /* Read and validate the header. */
+        BuildCacheHeader header;
+        {
+            u64 read_size = 0;
+            if (R_FAILED(fsFileRead(std::addressof(cache_file), 0, std::addressof(header), sizeof(header), FsReadOption_None, std::addressof(read_size))) || read_size != sizeof(header)) {
+                return false;
+            }
+        }
+
+        if (header.magic != BuildCacheMagic || header.version != BuildCacheVersion || !crypto::IsSameBytes(header.key, key.hash, sizeof(header.key))) {
+            return false;
+        }
+
+        /* Check that the cache was completely written. */
+        {
+            s64 file_size = 0;
+            if (R_FAILED(fsFileGetSize(std::addressof(cache_file), std::addressof(file_size))) || file_size != static_cast<s64>(sizeof(header)) + header.body_size) {
+                return false;
+            }
+        }
+
+        /* Load the source infos. */
+        out_infos->clear();
+        if (!LoadSourceInfos(out_infos, program_id, std::addressof(cache_file), header)) {
+            CleanupSourceInfos(out_infos);
+            return false;
+        }
+
+        return true;
+    }
+
+    void SaveBuildCache(ncm::ProgramId program_id, const BuildCacheKey &key, const Builder::SourceInfoVector &infos) {
+        /* Check that we can use the cache. */
+        if (!key.is_valid || infos.empty() || infos.back().source_type != DataSourceType::Metadata) {
+            return;
+        }
+
+        /* Determine the size of the cache body. */
+        s64 body_size = 0;
+        for (const auto &info : infos) {
+            body_size += sizeof(BuildCacheSourceInfo);
+
+            switch (info.source_type) {
+                case DataSourceType::LooseSdFile:
+                    body_size += std::strlen(info.loose_source_info.path) + 1;
+                    break;
+                case DataSourceType::Memory:
+                    body_size += info.size;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        /* Create the cache file. */
+        ::FsFile cache_file;
+        if (R_FAILED(mitm::fs::CreateAndOpenAtmosphereSdFile(std::addressof(cache_file), program_id, BuildCacheFileName, sizeof(BuildCacheHeader) + body_size))) {
+            return;
+        }
+        ON_SCOPE_EXIT { fsFileClose(std::addressof(cache_file)); };
+
+        /* Write the source infos. The header is written last, so that a partially written cache is never considered valid. */
+        BufferedFileWriter writer(std::addressof(cache_file), sizeof(BuildCacheHeader));
+        for (const auto &info : infos) {
+            BuildCacheSourceInfo cache_info = { .virtual_offset = info.virtual_offset, .size = info.size, .value = 0, .source_type = info.source_type, .reserved = {} };
+
+            switch (info.source_type) {
+                case DataSourceType::Storage:
+                    cache_info.value = info.storage_source_info.offset;
+                    writer.Write(std::addressof(cache_info), sizeof(cache_info));
+                    break;
+                case DataSourceType::File:
+                    cache_info.value = info.file_source_info.offset;
+                    writer.Write(std::addressof(cache_info), sizeof(cache_info));
+                    break;
+                case DataSourceType::LooseSdFile:
+                    cache_info.value = std::strlen(info.loose_source_info.path) + 1;
+                    writer.Write(std::addressof(cache_info), sizeof(cache_info));
+                    writer.Write(info.loose_source_info.path, cache_info.value);
+                    break;
+                case DataSourceType::Memory:
+                    writer.Write(std::addressof(cache_info), sizeof(cache_info));
+                    writer.Write(info.memory_source_info.data, info.size);
+                    break;
+                case DataSourceType::Metadata:
+                    writer.Write(std::addressof(cache_info), sizeof(cache_info));
+                    break;
+                AMS_UNREACHABLE_DEFAULT_CASE();
+            }
+        }
+
+        if (!writer.Flush() || writer.GetOffset() != static_cast<s64>(sizeof(BuildCacheHeader)) + body_size) {
+            return;
+        }
+
+        /* Hash the metadata, so that a metadata file which has since been changed is never used. */
+        u8 metadata_hash[crypto::Sha256Generator::HashSize];
+        if (!HashMetadata(metadata_hash, sizeof(metadata_hash), infos.back().metadata_source_info.file, infos.back().size)) {
+            return;
+        }
+
+        /* Write the header. */
+        BuildCacheHeader header = {
+            .magic             = BuildCacheMagic,
+            .version           = BuildCacheVersion,
+            .key               = {},
+            .source_info_count = static_cast<u32>(infos.size()),
+            .reserved          = 0,
+            .metadata_size     = infos.back().size,
+            .body_size         = body_size,
+            .metadata_hash     = {},
+        };
+        std::memcpy(header.key, key.hash, sizeof(header.key));
+        std::memcpy(header.metadata_hash, metadata_hash, sizeof(header.metadata_hash));
+
+        if (R_FAILED(fsFileWrite(std::addressof(cache_file), 0, std::addressof(header), sizeof(header), FsWriteOption_Flush))) {
+            InvalidateBuildCache(program_id);
+        }
+    }
+
+    void InvalidateBuildCache(ncm::ProgramId program_id) {
+        char path[ams::fs::EntryNameLengthMax + 1];
+        FormatBuildCachePath(path, sizeof(path), program_id);
+
+        /* NOTE: The cache not existing is fine. */
+        mitm::fs::DeleteAtmosphereSdFile(path);
+    }
+
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stratosphere.hpp>
+#include "fsmitm_romfs.hpp"
+
+namespace ams::mitm::fs::romfs {
+
+    /* Identifies the inputs to a layered romfs build: the base romfs tables, and the names/sizes of the override files. */
+    /* File contents are not part of the key, as loose files are read from the sd card directly and don't affect metadata. */
+    struct BuildCacheKey {
+        u8 hash[crypto::Sha256Generator::HashSize];
+        bool is_valid;
+    };
+
+    void CalculateBuildCacheKey(BuildCacheKey *out, ncm::ProgramId program_id, bool has_sd_files, ams::fs::IStorage *file_romfs, ams::fs::IStorage *storage_romfs);
+
+    bool LoadBuildCache(Builder::SourceInfoVector *out_infos, ncm::ProgramId program_id, const BuildCacheKey &key);
+    void SaveBuildCache(ncm::ProgramId program_id, const BuildCacheKey &key, const Builder::SourceInfoVector &infos);
+    void InvalidateBuildCache(ncm::ProgramId program_id);
+
+}
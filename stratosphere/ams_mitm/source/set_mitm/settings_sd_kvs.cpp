@@ -325,6 +325,14 @@ namespace ams::settings::fwdbg {
             /* Note that this setting does nothing when log manager is not enabled/sd card logging is not enabled. */
             R_ABORT_UNLESS(ParseSettingsItemValue("lm", "sd_card_log_output_directory", "str!atmosphere/binlogs"));
 
+            /* Control how long lm may hold SD card logs before flushing them, in milliseconds. */
+            /* Note that this setting does nothing when log manager is not enabled/sd card logging is not enabled. */
+            R_ABORT_UNLESS(ParseSettingsItemValue("lm", "sd_card_log_flush_interval_ms", "u32!0x3E8"));
+
+            /* Control how many bytes of SD card logs lm may buffer before writing them out. */
+            /* Note that this setting does nothing when log manager is not enabled/sd card logging is not enabled. */
+            R_ABORT_UNLESS(ParseSettingsItemValue("lm", "sd_card_log_flush_threshold", "u32!0x8000"));
+
             /* Control whether erpt reports should always be preserved, instead of automatically cleaning periodically. */
             /* 0 = Disabled, 1 = Enabled */
             R_ABORT_UNLESS(ParseSettingsItemValue("erpt", "disable_automatic_report_cleanup", "u8!0x0"));
@@ -359,6 +367,11 @@ namespace ams::settings::fwdbg {
             /* If you do not know what you are doing, do not touch this yet. */
             R_ABORT_UNLESS(ParseSettingsItemValue("atmosphere", "fsmitm_redirect_saves_to_sd", "u8!0x0"));
 
+            /* Controls how many loose layeredfs file handles fs.mitm keeps open per romfs, */
+            /* to avoid re-opening files on every read. 0 = Do not keep handles open. */
+            /* Values above 0x40 are treated as 0x40. */
+            R_ABORT_UNLESS(ParseSettingsItemValue("atmosphere", "fsmitm_romfs_file_handle_cache_count", "u32!0x10"));
+
             /* Controls whether am sees system settings "DebugModeFlag" as */
             /* enabled or disabled. */
             /* 0 = Disabled (not debug mode), 1 = Enabled (debug mode) */
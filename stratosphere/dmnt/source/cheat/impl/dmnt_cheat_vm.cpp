@@ -19,6 +19,157 @@
 
 namespace ams::dmnt::cheat::impl {
 
+    namespace {
+
+        /* Operands are stored in a CompiledOpcode by slot; slots below OperandSlot_RelAddress are nybbles of its operands field. */
+        enum OperandSlot : size_t {
+            OperandSlot_RelAddress = 8,
+            OperandSlot_Value      = 9,
+        };
+
+        /* Calls f(slot, operand) for every operand of an opcode, so that compiling and expanding opcodes share one layout. */
+        template<typename Opcode, typename F>
+        void ForEachOperand(Opcode &opcode, F f) {
+            switch (opcode.opcode) {
+                case CheatVmOpcodeType_StoreStatic:
+                    f(0, opcode.store_static.bit_width);
+                    f(1, opcode.store_static.mem_type);
+                    f(2, opcode.store_static.offset_register);
+                    f(OperandSlot_RelAddress, opcode.store_static.rel_address);
+                    f(OperandSlot_Value, opcode.store_static.value);
+                    break;
+                case CheatVmOpcodeType_BeginConditionalBlock:
+                    f(0, opcode.begin_cond.bit_width);
+                    f(1, opcode.begin_cond.mem_type);
+                    f(2, opcode.begin_cond.cond_type);
+                    f(OperandSlot_RelAddress, opcode.begin_cond.rel_address);
+                    f(OperandSlot_Value, opcode.begin_cond.value);
+                    break;
+                case CheatVmOpcodeType_EndConditionalBlock:
+                    f(0, opcode.end_cond.is_else);
+                    break;
+                case CheatVmOpcodeType_ControlLoop:
+                    f(0, opcode.ctrl_loop.start_loop);
+                    f(1, opcode.ctrl_loop.reg_index);
+                    f(OperandSlot_Value, opcode.ctrl_loop.num_iters);
+                    break;
+                case CheatVmOpcodeType_LoadRegisterStatic:
+                    f(0, opcode.ldr_static.reg_index);
+                    f(OperandSlot_Value, opcode.ldr_static.value);
+                    break;
+                case CheatVmOpcodeType_LoadRegisterMemory:
+                    f(0, opcode.ldr_memory.bit_width);
+                    f(1, opcode.ldr_memory.mem_type);
+                    f(2, opcode.ldr_memory.reg_index);
+                    f(3, opcode.ldr_memory.load_from_reg);
+                    f(OperandSlot_RelAddress, opcode.ldr_memory.rel_address);
+                    break;
+                case CheatVmOpcodeType_StoreStaticToAddress:
+                    f(0, opcode.str_static.bit_width);
+                    f(1, opcode.str_static.reg_index);
+                    f(2, opcode.str_static.increment_reg);
+                    f(3, opcode.str_static.add_offset_reg);
+                    f(4, opcode.str_static.offset_reg_index);
+                    f(OperandSlot_Value, opcode.str_static.value);
+                    break;
+                case CheatVmOpcodeType_PerformArithmeticStatic:
+                    f(0, opcode.perform_math_static.bit_width);
+                    f(1, opcode.perform_math_static.reg_index);
+                    f(2, opcode.perform_math_static.math_type);
+                    f(OperandSlot_Value, opcode.perform_math_static.value);
+                    break;
+                case CheatVmOpcodeType_BeginKeypressConditionalBlock:
+                    f(OperandSlot_Value, opcode.begin_keypress_cond.key_mask);
+                    break;
+                case CheatVmOpcodeType_PerformArithmeticRegister:
+                    f(0, opcode.perform_math_reg.bit_width);
+                    f(1, opcode.perform_math_reg.math_type);
+                    f(2, opcode.perform_math_reg.dst_reg_index);
+                    f(3, opcode.perform_math_reg.src_reg_1_index);
+                    f(4, opcode.perform_math_reg.src_reg_2_index);
+                    f(5, opcode.perform_math_reg.has_immediate);
+                    f(OperandSlot_Value, opcode.perform_math_reg.value);
+                    break;
+                case CheatVmOpcodeType_StoreRegisterToAddress:
+                    f(0, opcode.str_register.bit_width);
+                    f(1, opcode.str_register.str_reg_index);
+                    f(2, opcode.str_register.addr_reg_index);
+                    f(3, opcode.str_register.increment_reg);
+                    f(4, opcode.str_register.ofs_type);
+                    f(5, opcode.str_register.mem_type);
+                    f(6, opcode.str_register.ofs_reg_index);
+                    f(OperandSlot_RelAddress, opcode.str_register.rel_address);
+                    break;
+                case CheatVmOpcodeType_BeginRegisterConditionalBlock:
+                    f(0, opcode.begin_reg_cond.bit_width);
+                    f(1, opcode.begin_reg_cond.cond_type);
+                    f(2, opcode.begin_reg_cond.val_reg_index);
+                    f(3, opcode.begin_reg_cond.comp_type);
+                    f(4, opcode.begin_reg_cond.mem_type);
+                    f(5, opcode.begin_reg_cond.addr_reg_index);
+                    f(6, opcode.begin_reg_cond.other_reg_index);
+                    f(7, opcode.begin_reg_cond.ofs_reg_index);
+                    f(OperandSlot_RelAddress, opcode.begin_reg_cond.rel_address);
+                    f(OperandSlot_Value, opcode.begin_reg_cond.value);
+                    break;
+                case CheatVmOpcodeType_SaveRestoreRegister:
+                    f(0, opcode.save_restore_reg.dst_index);
+                    f(1, opcode.save_restore_reg.src_index);
+                    f(2, opcode.save_restore_reg.op_type);
+                    break;
+                case CheatVmOpcodeType_SaveRestoreRegisterMask:
+                    f(0, opcode.save_restore_regmask.op_type);
+                    f(OperandSlot_Value, opcode.save_restore_regmask.should_operate);
+                    break;
+                case CheatVmOpcodeType_ReadWriteStaticRegister:
+                    f(0, opcode.rw_static_reg.idx);
+                    f(OperandSlot_Value, opcode.rw_static_reg.static_idx);
+                    break;
+                case CheatVmOpcodeType_DebugLog:
+                    f(0, opcode.debug_log.bit_width);
+                    f(1, opcode.debug_log.log_id);
+                    f(2, opcode.debug_log.val_type);
+                    f(3, opcode.debug_log.mem_type);
+                    f(4, opcode.debug_log.addr_reg_index);
+                    f(5, opcode.debug_log.val_reg_index);
+                    f(6, opcode.debug_log.ofs_reg_index);
+                    f(OperandSlot_RelAddress, opcode.debug_log.rel_address);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        template<typename T>
+        constexpr u64 EncodeOperand(const T &operand) {
+            if constexpr (std::is_same<T, VmInt>::value) {
+                return std::bit_cast<u64>(operand);
+            } else if constexpr (std::is_array<T>::value) {
+                u64 mask = 0;
+                for (size_t i = 0; i < util::size(operand); i++) {
+                    mask |= static_cast<u64>(operand[i]) << i;
+                }
+                return mask;
+            } else {
+                return static_cast<u64>(operand);
+            }
+        }
+
+        template<typename T>
+        constexpr void DecodeOperand(T &operand, u64 encoded) {
+            if constexpr (std::is_same<T, VmInt>::value) {
+                operand = std::bit_cast<VmInt>(encoded);
+            } else if constexpr (std::is_array<T>::value) {
+                for (size_t i = 0; i < util::size(operand); i++) {
+                    operand[i] = ((encoded >> i) & 1) != 0;
+                }
+            } else {
+                operand = static_cast<T>(encoded);
+            }
+        }
+
+    }
+
     void CheatVirtualMachine::DebugLog(u32 log_id, u64 value) {
         /* Just unconditionally try to create the log folder. */
         fs::EnsureDirectory("sdmc:/atmosphere/cheat_vm_logs");
@@ -674,31 +825,117 @@ namespace ams::dmnt::cheat::impl {
         return valid;
     }
 
-    void CheatVirtualMachine::SkipConditionalBlock(bool is_if) {
-        if (m_condition_depth > 0) {
-            /* We want to continue until we're out of the current block. */
-            const size_t desired_depth = m_condition_depth - 1;
-
-            CheatVmOpcode skip_opcode;
-            while (m_condition_depth > desired_depth && this->DecodeNextOpcode(std::addressof(skip_opcode))) {
-                /* Decode instructions until we see end of the current conditional block. */
-                /* NOTE: This is broken in gateway's implementation. */
-                /* Gateway currently checks for "0x2" instead of "0x20000000" */
-                /* In addition, they do a linear scan instead of correctly decoding opcodes. */
-                /* This causes issues if "0x2" appears as an immediate in the conditional block... */
-
-                /* We also support nesting of conditional blocks, and Gateway does not. */
-                if (skip_opcode.begin_conditional_block) {
-                    m_condition_depth++;
-                } else if (skip_opcode.opcode == CheatVmOpcodeType_EndConditionalBlock) {
-                    if (!skip_opcode.end_cond.is_else) {
-                        m_condition_depth--;
-                    } else if (is_if && m_condition_depth - 1 == desired_depth) {
-                        /* An if will continue to an else at the same depth. */
-                        break;
+    CompiledOpcode CheatVirtualMachine::CompileOpcode(const CheatVmOpcode &opcode) {
+        CompiledOpcode compiled = { .opcode = static_cast<u16>(opcode.opcode) };
+
+        ForEachOperand(opcode, [&](size_t slot, const auto &operand) ALWAYS_INLINE_LAMBDA {
+            const u64 encoded = EncodeOperand(operand);
+            if (slot == OperandSlot_RelAddress) {
+                compiled.rel_address = encoded;
+            } else if (slot == OperandSlot_Value) {
+                compiled.value = encoded;
+            } else {
+                /* Nybble operands are all parsed from four bits of an instruction, and so always fit. */
+                compiled.operands |= static_cast<u32>(encoded & 0xF) << (4 * slot);
+            }
+        });
+
+        return compiled;
+    }
+
+    void CheatVirtualMachine::ExpandOpcode(CheatVmOpcode *out, const CompiledOpcode &compiled) {
+        *out = {};
+        out->opcode = static_cast<CheatVmOpcodeType>(compiled.opcode);
+
+        /* detect condition start. */
+        switch (out->opcode) {
+            case CheatVmOpcodeType_BeginConditionalBlock:
+            case CheatVmOpcodeType_BeginKeypressConditionalBlock:
+            case CheatVmOpcodeType_BeginRegisterConditionalBlock:
+                out->begin_conditional_block = true;
+                break;
+            default:
+                out->begin_conditional_block = false;
+                break;
+        }
+
+        ForEachOperand(*out, [&](size_t slot, auto &operand) ALWAYS_INLINE_LAMBDA {
+            if (slot == OperandSlot_RelAddress) {
+                DecodeOperand(operand, compiled.rel_address);
+            } else if (slot == OperandSlot_Value) {
+                DecodeOperand(operand, compiled.value);
+            } else {
+                DecodeOperand(operand, (compiled.operands >> (4 * slot)) & 0xF);
+            }
+        });
+    }
+
+    void CheatVirtualMachine::CompileProgram() {
+        /* Decode the program once, so that execution needn't decode it every tick. */
+        /* As in execution, decoding stops at the first opcode which fails to decode. */
+        m_instruction_ptr = 0;
+        m_decode_success = true;
+        m_num_compiled_opcodes = 0;
+
+        CheatVmOpcode opcode;
+        while (this->DecodeNextOpcode(std::addressof(opcode))) {
+            m_compiled_opcodes[m_num_compiled_opcodes++] = CompileOpcode(opcode);
+        }
+
+        /* Find where each if and else continues when its block is skipped, so that skipping a block is a jump. */
+        for (size_t i = 0; i < m_num_compiled_opcodes; i++) {
+            ExpandOpcode(std::addressof(opcode), m_compiled_opcodes[i]);
+
+            const bool is_if   = opcode.begin_conditional_block;
+            const bool is_else = opcode.opcode == CheatVmOpcodeType_EndConditionalBlock && opcode.end_cond.is_else;
+            if (is_if || is_else) {
+                m_compiled_opcodes[i].skip_target = this->FindConditionalBlockEnd(i + 1, is_if);
+            }
+        }
+    }
+
+    u16 CheatVirtualMachine::FindConditionalBlockEnd(size_t index, bool is_if) const {
+        /* We want to continue until we're out of the current block. */
+        size_t depth = 1;
+
+        CheatVmOpcode skip_opcode;
+        while (index < m_num_compiled_opcodes) {
+            /* Walk opcodes until we see end of the current conditional block. */
+            /* NOTE: This is broken in gateway's implementation. */
+            /* Gateway currently checks for "0x2" instead of "0x20000000" */
+            /* In addition, they do a linear scan instead of correctly decoding opcodes. */
+            /* This causes issues if "0x2" appears as an immediate in the conditional block... */
+            ExpandOpcode(std::addressof(skip_opcode), m_compiled_opcodes[index++]);
+
+            /* We also support nesting of conditional blocks, and Gateway does not. */
+            if (skip_opcode.begin_conditional_block) {
+                depth++;
+            } else if (skip_opcode.opcode == CheatVmOpcodeType_EndConditionalBlock) {
+                if (!skip_opcode.end_cond.is_else) {
+                    if ((--depth) == 0) {
+                        return static_cast<u16>(index);
                     }
+                } else if (is_if && depth == 1) {
+                    /* An if will continue to an else at the same depth, and so remain in the block. */
+                    return static_cast<u16>(index) | SkipTargetElseFlag;
                 }
             }
+        }
+
+        /* Execution stops at the end of the program, so an unterminated block skips to it. */
+        return static_cast<u16>(m_num_compiled_opcodes);
+    }
+
+    void CheatVirtualMachine::SkipConditionalBlock() {
+        if (m_condition_depth > 0) {
+            /* Continue past the block, from the opcode we're currently executing. */
+            const u16 target = m_compiled_opcodes[m_instruction_ptr - 1].skip_target;
+            m_instruction_ptr = target & ~SkipTargetElseFlag;
+
+            /* An if which continued to an else is still inside the block; otherwise, we've left it. */
+            if ((target & SkipTargetElseFlag) == 0) {
+                m_condition_depth--;
+            }
         } else {
             /* Skipping, but m_condition_depth = 0. */
             /* This is an error condition. */
@@ -757,6 +994,7 @@ namespace ams::dmnt::cheat::impl {
                 /* Bounds check. */
                 if (cheats[i].definition.num_opcodes + m_num_opcodes > MaximumProgramOpcodeCount) {
                     m_num_opcodes = 0;
+                    m_num_compiled_opcodes = 0;
                     return false;
                 }
 
@@ -766,6 +1004,9 @@ namespace ams::dmnt::cheat::impl {
             }
         }
 
+        /* Decode the program ahead of execution. */
+        this->CompileProgram();
+
         return true;
     }
 
@@ -788,7 +1029,9 @@ namespace ams::dmnt::cheat::impl {
         this->ResetState();
 
         /* Loop until program finishes. */
-        while (this->DecodeNextOpcode(std::addressof(cur_opcode))) {
+        while (m_instruction_ptr < m_num_compiled_opcodes) {
+            ExpandOpcode(std::addressof(cur_opcode), m_compiled_opcodes[m_instruction_ptr++]);
+
             this->LogToDebugFile("Instruction Ptr: %04x\n", (u32)m_instruction_ptr);
 
             for (size_t i = 0; i < NumRegisters; i++) {
@@ -859,14 +1102,14 @@ namespace ams::dmnt::cheat::impl {
                         }
                         /* Skip conditional block if condition not met. */
                         if (!cond_met) {
-                            this->SkipConditionalBlock(true);
+                            this->SkipConditionalBlock();
                         }
                     }
                     break;
                 case CheatVmOpcodeType_EndConditionalBlock:
                     if (cur_opcode.end_cond.is_else) {
                         /* Skip to the end of the conditional block. */
-                        this->SkipConditionalBlock(false);
+                        this->SkipConditionalBlock();
                     } else {
                         /* Decrement the condition depth. */
                         /* We will assume, graciously, that mismatched conditional block ends are a nop. */
@@ -979,7 +1222,7 @@ namespace ams::dmnt::cheat::impl {
                     /* Check for keypress. */
                     if ((cur_opcode.begin_keypress_cond.key_mask & kHeld) != cur_opcode.begin_keypress_cond.key_mask) {
                         /* Keys not pressed. Skip conditional block. */
-                        this->SkipConditionalBlock(true);
+                        this->SkipConditionalBlock();
                     }
                     break;
                 case CheatVmOpcodeType_PerformArithmeticRegister:
@@ -1178,7 +1421,7 @@ namespace ams::dmnt::cheat::impl {
 
                         /* Skip conditional block if condition not met. */
                         if (!cond_met) {
-                            this->SkipConditionalBlock(true);
+                            this->SkipConditionalBlock();
                         }
                     }
                     break;
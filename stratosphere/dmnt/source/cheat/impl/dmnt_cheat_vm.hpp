@@ -269,6 +269,17 @@ namespace ams::dmnt::cheat::impl {
         };
     };
 
+    /* A decoded opcode, packed so that a whole program stays small. */
+    /* Operands which fit in a nybble are packed into operands; wider ones use rel_address and value. */
+    struct CompiledOpcode {
+        u16 opcode;
+        u16 skip_target;
+        u32 operands;
+        u64 rel_address;
+        u64 value;
+    };
+    static_assert(sizeof(CompiledOpcode) == 0x18);
+
     class CheatVirtualMachine {
         public:
             constexpr static size_t MaximumProgramOpcodeCount = 0x400;
@@ -276,19 +287,25 @@ namespace ams::dmnt::cheat::impl {
             constexpr static size_t NumReadableStaticRegisters = 0x80;
             constexpr static size_t NumWritableStaticRegisters = 0x80;
             constexpr static size_t NumStaticRegisters = NumReadableStaticRegisters + NumWritableStaticRegisters;
+            constexpr static u16 SkipTargetElseFlag = 0x8000;
+            static_assert(MaximumProgramOpcodeCount < SkipTargetElseFlag);
         private:
             size_t m_num_opcodes = 0;
             size_t m_instruction_ptr = 0;
             size_t m_condition_depth = 0;
             bool m_decode_success = false;
+            size_t m_num_compiled_opcodes = 0;
             u32 m_program[MaximumProgramOpcodeCount] = {0};
+            CompiledOpcode m_compiled_opcodes[MaximumProgramOpcodeCount] = {};
             u64 m_registers[NumRegisters] = {0};
             u64 m_saved_values[NumRegisters] = {0};
             u64 m_static_registers[NumStaticRegisters] = {0};
             size_t m_loop_tops[NumRegisters] = {0};
         private:
             bool DecodeNextOpcode(CheatVmOpcode *out);
-            void SkipConditionalBlock(bool is_if);
+            void CompileProgram();
+            u16 FindConditionalBlockEnd(size_t index, bool is_if) const;
+            void SkipConditionalBlock();
             void ResetState();
 
             /* For implementing the DebugLog opcode. */
@@ -300,6 +317,8 @@ namespace ams::dmnt::cheat::impl {
             void LogToDebugFile(const char *format, ...);
             void LogOpcode(const CheatVmOpcode *opcode);
 
+            static CompiledOpcode CompileOpcode(const CheatVmOpcode &opcode);
+            static void ExpandOpcode(CheatVmOpcode *out, const CompiledOpcode &compiled);
             static u64 GetVmInt(VmInt value, u32 bit_width);
             static u64 GetCheatProcessAddress(const CheatProcessMetadata* metadata, MemoryAccessType mem_type, u64 rel_address);
         public:
@@ -124,6 +124,10 @@ namespace ams::ldr {
         ams::patcher::LocateAndApplyIpsPatchesToModule(LoaderSdMountName, NsoPatchesDirectory, NsoPatchesProtectedSize, NsoPatchesProtectedOffset, std::addressof(module_id), reinterpret_cast<u8 *>(mapped_nso), mapped_size);
     }
 
+    void InvalidateIpsPatches() {
+        ams::patcher::InvalidateIpsPatchIndex();
+    }
+
     /* Apply embedded patches. */
     void ApplyEmbeddedPatchesToModule(const u8 *module_id_data, uintptr_t mapped_nso, size_t mapped_size) {
         /* Make module id. */
@@ -20,6 +20,7 @@ namespace ams::ldr {
 
     /* Apply IPS patches. */
     void LocateAndApplyIpsPatchesToModule(const u8 *module_id_data, uintptr_t mapped_nso, size_t mapped_size);
+    void InvalidateIpsPatches();
 
     /* Apply embedded patches. */
     void ApplyEmbeddedPatchesToModule(const u8 *module_id_data, uintptr_t mapped_nso, size_t mapped_size);
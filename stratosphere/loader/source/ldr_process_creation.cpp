@@ -682,6 +682,11 @@ namespace ams::ldr {
         R_TRY(LoadAutoLoadHeaders(g_nso_headers, g_has_nso));
         R_TRY(CheckAutoLoad(g_nso_headers, g_has_nso));
 
+        /* If we're launching an application, pick up any patches which were edited since we last looked. */
+        if (IsApplication(std::addressof(meta))) {
+            InvalidateIpsPatches();
+        }
+
         /* Actually create the process and load NSOs into process memory. */
         ProcessInfo info;
         R_TRY(CreateProcessAndLoadAutoLoadModules(std::addressof(info), std::addressof(meta), g_nso_headers, g_has_nso, argument, flags, resource_limit));
@@ -154,9 +154,15 @@ namespace ams {
             constexpr inline bool ImportSystemDatabaseFromSignedSystemPartitionOnSdCard = false;
         #endif
 
+        #ifdef NCM_BUILD_WITH_DATABASE_JOURNAL
+            constexpr inline bool EnableContentMetaDatabaseJournal = true;
+        #else
+            constexpr inline bool EnableContentMetaDatabaseJournal = false;
+        #endif
+
             static_assert(!(BuildSystemDatabase && ImportSystemDatabaseFromSignedSystemPartitionOnSdCard), "Invalid NCM build configuration!");
 
-            constexpr inline ncm::ContentManagerConfig ManagerConfig = { BuildSystemDatabase, ImportSystemDatabaseFromSignedSystemPartitionOnSdCard };
+            constexpr inline ncm::ContentManagerConfig ManagerConfig = { BuildSystemDatabase, ImportSystemDatabaseFromSignedSystemPartitionOnSdCard, false, EnableContentMetaDatabaseJournal };
 
         }
 
@@ -236,52 +236,75 @@ namespace ams::ro::impl {
         R_RETURN(os::UnmapProcessCodeMemory(process_handle, mapped_code_address, std::addressof(region), 1));
     }
 
-    bool ValidateNrrHashTableEntry(const void *signed_area, size_t signed_area_size, size_t hashes_offset, size_t num_hashes, const void *nrr_hash, const u8 *hash_table, const void *desired_hash) {
-        crypto::Sha256Generator sha256;
-        sha256.Initialize();
+    namespace {
 
-        /* Hash data before the hash table. */
-        const size_t pre_hash_table_size = hashes_offset - NrrHeader::GetSignedAreaOffset();
-        sha256.Update(signed_area, pre_hash_table_size);
+        template<typename F>
+        bool ValidateNrrHashTable(const void *signed_area, size_t signed_area_size, size_t hashes_offset, size_t num_hashes, const void *nrr_hash, const u8 *hash_table, F on_hash) {
+            crypto::Sha256Generator sha256;
+            sha256.Initialize();
 
-        /* Hash the hash table, checking if the desired hash exists inside it. */
-        size_t remaining_size = signed_area_size - pre_hash_table_size;
-        bool found_hash = false;
-        for (size_t i = 0; i < num_hashes; i++) {
-            /* Get the current hash. */
-            u8 cur_hash[crypto::Sha256Generator::HashSize];
-            std::memcpy(cur_hash, hash_table, sizeof(cur_hash));
+            /* Hash data before the hash table. */
+            const size_t pre_hash_table_size = hashes_offset - NrrHeader::GetSignedAreaOffset();
+            sha256.Update(signed_area, pre_hash_table_size);
 
-            /* Hash the current hash. */
-            sha256.Update(cur_hash, sizeof(cur_hash));
+            /* Hash the hash table, letting our caller examine each hash. */
+            size_t remaining_size = signed_area_size - pre_hash_table_size;
+            for (size_t i = 0; i < num_hashes; i++) {
+                /* Get the current hash. */
+                u8 cur_hash[crypto::Sha256Generator::HashSize];
+                std::memcpy(cur_hash, hash_table, sizeof(cur_hash));
 
-            /* Check if the current hash is our target. */
-            found_hash |= std::memcmp(cur_hash, desired_hash, sizeof(cur_hash)) == 0;
+                /* Hash the current hash. */
+                sha256.Update(cur_hash, sizeof(cur_hash));
 
-            /* Advance our pointers. */
-            hash_table     += sizeof(cur_hash);
-            remaining_size -= sizeof(cur_hash);
-        }
+                /* Let our caller examine the hash that we hashed. */
+                on_hash(i, cur_hash);
 
-        /* Data after the hash table should be all zeroes. */
-        u8 work_buf[crypto::Sha256Generator::HashSize];
-        {
-            crypto::ClearMemory(work_buf, sizeof(work_buf));
-            while (remaining_size > 0) {
-                const size_t cur_size = std::min(remaining_size, sizeof(work_buf));
-                sha256.Update(work_buf, cur_size);
-                remaining_size -= cur_size;
+                /* Advance our pointers. */
+                hash_table     += sizeof(cur_hash);
+                remaining_size -= sizeof(cur_hash);
+            }
+
+            /* Data after the hash table should be all zeroes. */
+            u8 work_buf[crypto::Sha256Generator::HashSize];
+            {
+                crypto::ClearMemory(work_buf, sizeof(work_buf));
+                while (remaining_size > 0) {
+                    const size_t cur_size = std::min(remaining_size, sizeof(work_buf));
+                    sha256.Update(work_buf, cur_size);
+                    remaining_size -= cur_size;
+                }
             }
+
+            /* Validate the final hash. */
+            sha256.GetHash(work_buf, sizeof(work_buf));
+            return std::memcmp(work_buf, nrr_hash, sizeof(work_buf)) == 0;
         }
 
-        /* Validate the final hash. */
-        sha256.GetHash(work_buf, sizeof(work_buf));
+    }
+
+    bool ValidateNrrHashTableEntry(const void *signed_area, size_t signed_area_size, size_t hashes_offset, size_t num_hashes, const void *nrr_hash, const u8 *hash_table, const void *desired_hash) {
+        /* Hash the hash table, checking if the desired hash exists inside it. */
+        bool found_hash = false;
+        const bool is_table_valid = ValidateNrrHashTable(signed_area, signed_area_size, hashes_offset, num_hashes, nrr_hash, hash_table, [&](size_t, const u8 *cur_hash) ALWAYS_INLINE_LAMBDA {
+            found_hash |= std::memcmp(cur_hash, desired_hash, crypto::Sha256Generator::HashSize) == 0;
+        });
 
         /* Use & operator to avoid short circuiting. */
-        const bool is_valid = found_hash & (std::memcmp(work_buf, nrr_hash, sizeof(work_buf)) == 0);
+        const bool is_valid = found_hash & is_table_valid;
 
         /* Return result. */
         return is_valid;
     }
 
+    bool CopyAndValidateNrrHashTable(void *dst, size_t dst_size, const void *signed_area, size_t signed_area_size, size_t hashes_offset, size_t num_hashes, const void *nrr_hash, const u8 *hash_table) {
+        AMS_ABORT_UNLESS(dst_size >= num_hashes * crypto::Sha256Generator::HashSize);
+
+        /* Copy each hash as we hash it, so that what we've verified is exactly what we keep. */
+        u8 *dst_hashes = static_cast<u8 *>(dst);
+        return ValidateNrrHashTable(signed_area, signed_area_size, hashes_offset, num_hashes, nrr_hash, hash_table, [&](size_t index, const u8 *cur_hash) ALWAYS_INLINE_LAMBDA {
+            std::memcpy(dst_hashes + index * crypto::Sha256Generator::HashSize, cur_hash, crypto::Sha256Generator::HashSize);
+        });
+    }
+
 }
@@ -34,4 +34,8 @@ namespace ams::ro::impl {
         ams::patcher::LocateAndApplyIpsPatchesToModule("sdmc", NroPatchesDirectory, NroPatchesProtectedSize, NroPatchesProtectedOffset, module_id, mapped_nro, mapped_size);
     }
 
+    void InvalidateIpsPatches() {
+        ams::patcher::InvalidateIpsPatchIndex();
+    }
+
 }
\ No newline at end of file
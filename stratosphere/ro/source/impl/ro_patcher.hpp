@@ -21,5 +21,6 @@ namespace ams::ro::impl {
 
     /* Apply IPS patches. */
     void LocateAndApplyIpsPatchesToModule(const ModuleId *module_id, u8 *mapped_nro, size_t mapped_size);
+    void InvalidateIpsPatches();
 
 }
\ No newline at end of file
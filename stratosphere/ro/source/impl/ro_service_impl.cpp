@@ -29,6 +29,8 @@ namespace ams::ro::impl {
         constexpr size_t MaxNrrInfos = 0x40;
         constexpr size_t MaxNroInfos = 0x40;
 
+        constexpr size_t VerifiedHashHeapSize = 128_KB;
+
         /* Types. */
         struct Sha256Hash {
             u8 hash[crypto::Sha256Generator::HashSize];
@@ -71,8 +73,58 @@ namespace ams::ro::impl {
             u32 cached_num_hashes;
             u8  cached_signed_area[sizeof(NrrHeader) - NrrHeader::GetSignedAreaOffset()];
             Sha256Hash signed_area_hash;
+
+            /* A sorted private copy of the hash table, verified against signed_area_hash, if we had room for one. */
+            Sha256Hash *verified_hashes;
         };
 
+        /* NOTE: Validating an NRO against an NRR re-hashes the NRR's whole hash table, which adds up for titles that load many NROs. */
+        /* We instead verify a private copy of each NRR's hash table once, when it's registered, and look NRO hashes up in that copy. */
+        /* NRRs whose tables don't fit in the heap fall back to being re-hashed on every load. */
+        alignas(os::MemoryPageSize) constinit u8 g_verified_hash_heap_buffer[VerifiedHashHeapSize];
+        constinit lmem::HeapHandle g_verified_hash_heap = nullptr;
+
+        Sha256Hash *AllocateVerifiedHashes(size_t num_hashes) {
+            /* Create the heap, if we haven't already. */
+            if (g_verified_hash_heap == nullptr) {
+                g_verified_hash_heap = lmem::CreateExpHeap(g_verified_hash_heap_buffer, sizeof(g_verified_hash_heap_buffer), lmem::CreateOption_None);
+                AMS_ABORT_UNLESS(g_verified_hash_heap != nullptr);
+            }
+
+            return static_cast<Sha256Hash *>(lmem::AllocateFromExpHeap(g_verified_hash_heap, num_hashes * sizeof(Sha256Hash)));
+        }
+
+        void FreeVerifiedHashes(Sha256Hash *hashes) {
+            if (hashes != nullptr) {
+                lmem::FreeToExpHeap(g_verified_hash_heap, hashes);
+            }
+        }
+
+        void BuildVerifiedHashes(NrrInfo *nrr_info) {
+            /* Allocate space for the copy, if we can. */
+            const size_t num_hashes = nrr_info->cached_num_hashes;
+            if (num_hashes == 0) {
+                return;
+            }
+
+            Sha256Hash *hashes = AllocateVerifiedHashes(num_hashes);
+            if (hashes == nullptr) {
+                return;
+            }
+
+            /* Copy the hash table, checking that the copy matches the signed area hash that we verified. */
+            const u8 *hash_table = reinterpret_cast<const u8 *>(nrr_info->mapped_header->GetHashes());
+            if (!CopyAndValidateNrrHashTable(hashes, num_hashes * sizeof(Sha256Hash), nrr_info->cached_signed_area, nrr_info->cached_signed_area_size, nrr_info->cached_hashes_offset, num_hashes, std::addressof(nrr_info->signed_area_hash), hash_table)) {
+                FreeVerifiedHashes(hashes);
+                return;
+            }
+
+            /* Sort the copy, so that lookups don't depend on the table's order. */
+            std::sort(hashes, hashes + num_hashes);
+
+            nrr_info->verified_hashes = hashes;
+        }
+
         struct ProcessContext {
             private:
                 bool m_nro_in_use[MaxNroInfos]{};
@@ -104,6 +156,7 @@ namespace ams::ro::impl {
                     if (m_process_handle != os::InvalidNativeHandle) {
                         for (size_t i = 0; i < MaxNrrInfos; i++) {
                             if (m_nrr_in_use[i]) {
+                                FreeVerifiedHashes(m_nrr_infos[i].verified_hashes);
                                 UnmapNrr(m_process_handle, m_nrr_infos[i].mapped_header, m_nrr_infos[i].nrr_heap_address, m_nrr_infos[i].nrr_heap_size, m_nrr_infos[i].mapped_code_address);
                             }
                         }
@@ -213,6 +266,14 @@ namespace ams::ro::impl {
                             continue;
                         }
 
+                        /* If we have a verified copy of the NRR's hashes, we only need to look the hash up. */
+                        if (const Sha256Hash *verified_hashes = m_nrr_infos[i].verified_hashes; verified_hashes != nullptr) {
+                            if (std::binary_search(verified_hashes, verified_hashes + m_nrr_infos[i].cached_num_hashes, hash)) {
+                                R_SUCCEED();
+                            }
+                            continue;
+                        }
+
                         /* Get the mapped header, ensure that it has hashes. */
                         const NrrHeader *mapped_nrr_header = m_nrr_infos[i].mapped_header;
                         const size_t mapped_num_hashes = mapped_nrr_header->GetNumHashes();
@@ -453,6 +514,9 @@ namespace ams::ro::impl {
         *out_context_id = AllocateContext(process_handle.GetOsHandle(), process_id);
         process_handle.Detach();
 
+        /* Pick up any patches which were edited since the last process registered. */
+        InvalidateIpsPatches();
+
         R_SUCCEED();
     }
 
@@ -506,6 +570,10 @@ namespace ams::ro::impl {
         std::memcpy(nrr_info->cached_signed_area, header->GetSignedArea(), std::min(sizeof(nrr_info->cached_signed_area), header->GetHashesOffset() - header->GetSignedAreaOffset()));
         std::memcpy(std::addressof(nrr_info->signed_area_hash), std::addressof(signed_area_hash), sizeof(signed_area_hash));
 
+        /* Verify a private copy of the NRR's hashes, for fast NRO validation. */
+        nrr_info->verified_hashes = nullptr;
+        BuildVerifiedHashes(nrr_info);
+
         R_SUCCEED();
     }
 
@@ -527,6 +595,9 @@ namespace ams::ro::impl {
             /* Nintendo does this unconditionally, whether or not the actual unmap succeeds. */
             context->SetNrrInfoInUse(nrr_info, false);
             std::memset(nrr_info, 0, sizeof(*nrr_info));
+
+            /* Invalidate our verified copy of the NRR's hashes. */
+            FreeVerifiedHashes(nrr_backup.verified_hashes);
         }
         R_RETURN(UnmapNrr(context->GetProcessHandle(), nrr_backup.mapped_header, nrr_backup.nrr_heap_address, nrr_backup.nrr_heap_size, nrr_backup.mapped_code_address));
     }
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <stratosphere.hpp>
+
+namespace ams::sm::impl {
+
+    /* Maps 64-bit keys to indices into a fixed-size array of infos, and allocates those indices. */
+    /* Keys are stored in an open-addressed table with linear probing, kept at most half full. */
+    template<typename Key, size_t Count>
+    class IndexTable {
+        NON_COPYABLE(IndexTable);
+        NON_MOVEABLE(IndexTable);
+        static_assert(sizeof(Key) == sizeof(u64));
+        static_assert(std::is_trivially_copyable<Key>::value);
+        static_assert(Count < std::numeric_limits<u16>::max());
+        public:
+            static constexpr u16 InvalidIndex = std::numeric_limits<u16>::max();
+        private:
+            static constexpr size_t BucketCount = util::CeilingPowerOfTwo(2 * Count);
+
+            struct Bucket {
+                u64 key;
+                u16 index;
+            };
+        private:
+            Bucket m_buckets[BucketCount];
+            u16 m_free_indices[Count];
+            size_t m_num_free;
+        private:
+            static constexpr ALWAYS_INLINE u64 GetKey(const Key &key) {
+                return std::bit_cast<u64>(key);
+            }
+
+            static constexpr ALWAYS_INLINE size_t GetHomeBucket(u64 key) {
+                /* Service names are ascii and process ids are small, so mix every bit of the key into the top bits we use. */
+                key ^= key >> 33;
+                key *= UINT64_C(0xFF51AFD7ED558CCD);
+                key ^= key >> 33;
+                return static_cast<size_t>(key >> (BITSIZEOF(u64) - util::CountTrailingZeros(BucketCount)));
+            }
+
+            static constexpr ALWAYS_INLINE size_t GetNextBucket(size_t bucket) {
+                return (bucket + 1) & (BucketCount - 1);
+            }
+
+            constexpr size_t FindBucket(u64 key) const {
+                size_t bucket = GetHomeBucket(key);
+                while (m_buckets[bucket].index != InvalidIndex && m_buckets[bucket].key != key) {
+                    bucket = GetNextBucket(bucket);
+                }
+                return bucket;
+            }
+        public:
+            constexpr IndexTable() : m_buckets(), m_free_indices(), m_num_free(Count) {
+                for (auto &bucket : m_buckets) {
+                    bucket = { 0, InvalidIndex };
+                }
+
+                /* Hand out low indices first, as a linear scan for a free info would. */
+                for (size_t i = 0; i < Count; ++i) {
+                    m_free_indices[i] = static_cast<u16>(Count - 1 - i);
+                }
+            }
+
+            constexpr bool IsFull() const { return m_num_free == 0; }
+
+            constexpr u16 Find(const Key &key) const {
+                return m_buckets[this->FindBucket(GetKey(key))].index;
+            }
+
+            constexpr bool Contains(const Key &key) const {
+                return this->Find(key) != InvalidIndex;
+            }
+
+            constexpr u16 Insert(const Key &key) {
+                /* Check that we have a free index. */
+                if (this->IsFull()) {
+                    return InvalidIndex;
+                }
+
+                /* Check that the key isn't already present. */
+                const u64 raw_key = GetKey(key);
+                Bucket &bucket = m_buckets[this->FindBucket(raw_key)];
+                if (bucket.index != InvalidIndex) {
+                    return InvalidIndex;
+                }
+
+                /* Take a free index, and record it. */
+                bucket = { raw_key, m_free_indices[--m_num_free] };
+                return bucket.index;
+            }
+
+            constexpr void Remove(const Key &key) {
+                /* Find the key's bucket. */
+                size_t bucket = this->FindBucket(GetKey(key));
+                if (m_buckets[bucket].index == InvalidIndex) {
+                    return;
+                }
+
+                /* Free the key's index. */
+                m_free_indices[m_num_free++] = m_buckets[bucket].index;
+
+                /* Shift back any later entries whose probe sequence passed through the bucket, so that no tombstones are needed. */
+                size_t next = bucket;
+                while (true) {
+                    next = GetNextBucket(next);
+                    if (m_buckets[next].index == InvalidIndex) {
+                        break;
+                    }
+
+                    /* An entry may move to the hole only if the hole lies between its home bucket and where it is now. */
+                    const size_t home = GetHomeBucket(m_buckets[next].key);
+                    if (((next - home) & (BucketCount - 1)) >= ((next - bucket) & (BucketCount - 1))) {
+                        m_buckets[bucket] = m_buckets[next];
+                        bucket = next;
+                    }
+                }
+
+                m_buckets[bucket].index = InvalidIndex;
+            }
+    };
+
+}
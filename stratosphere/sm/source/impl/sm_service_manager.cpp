@@ -15,6 +15,7 @@
  */
 #include <stratosphere.hpp>
 #include "sm_service_manager.hpp"
+#include "sm_index_table.hpp"
 #include "../sm_wait_list.hpp"
 
 namespace ams::hos {
@@ -184,17 +185,6 @@ namespace ams::sm::impl {
             return list;
         }();
 
-        constinit std::array<ServiceName, MitmCountMax> g_future_mitm_list = [] {
-            std::array<ServiceName, MitmCountMax> list = {};
-
-            /* Initialize each info. */
-            for (auto &name : list) {
-                name = InvalidServiceName;
-            }
-
-            return list;
-        }();
-
         constinit std::array<MitmInfo, MitmCountMax> g_mitm_list = [] {
             std::array<MitmInfo, MitmCountMax> list = {};
 
@@ -206,6 +196,12 @@ namespace ams::sm::impl {
             return list;
         }();
 
+        /* NOTE: Lookups by process id and by service name happen on every request, and arrive in bursts during boot. */
+        /* We index the lists by their keys, rather than scanning them. */
+        constinit IndexTable<os::ProcessId, ProcessCountMax> g_process_index;
+        constinit IndexTable<ServiceName, ServiceCountMax> g_service_index;
+        constinit IndexTable<ServiceName, MitmCountMax> g_future_mitm_index;
+
         constinit bool g_ended_initial_defers = false;
 
         const InitialProcessIdLimits g_initial_process_id_limits;
@@ -291,17 +287,24 @@ namespace ams::sm::impl {
 
         ProcessInfo *GetProcessInfo(os::ProcessId process_id) {
             /* Find a process info with a matching id. */
-            for (auto &process_info : g_process_list) {
-                if (process_info.process_id == process_id) {
-                    return std::addressof(process_info);
-                }
+            if (const auto index = g_process_index.Find(process_id); index != g_process_index.InvalidIndex) {
+                return std::addressof(g_process_list[index]);
             }
 
             return nullptr;
         }
 
-        ProcessInfo *GetFreeProcessInfo() {
-            return GetProcessInfo(os::InvalidProcessId);
+        ProcessInfo *AllocateProcessInfo(os::ProcessId process_id) {
+            if (const auto index = g_process_index.Insert(process_id); index != g_process_index.InvalidIndex) {
+                return std::addressof(g_process_list[index]);
+            }
+
+            return nullptr;
+        }
+
+        void FreeProcessInfo(ProcessInfo *process_info) {
+            g_process_index.Remove(process_info->process_id);
+            *process_info = InvalidProcessInfo;
         }
 
         bool HasProcessInfo(os::ProcessId process_id) {
@@ -310,17 +313,24 @@ namespace ams::sm::impl {
 
         ServiceInfo *GetServiceInfo(ServiceName service_name) {
             /* Find a service with a matching name. */
-            for (auto &service_info : g_service_list) {
-                if (service_info.name == service_name) {
-                    return std::addressof(service_info);
-                }
+            if (const auto index = g_service_index.Find(service_name); index != g_service_index.InvalidIndex) {
+                return std::addressof(g_service_list[index]);
+            }
+
+            return nullptr;
+        }
+
+        ServiceInfo *AllocateServiceInfo(ServiceName service_name) {
+            if (const auto index = g_service_index.Insert(service_name); index != g_service_index.InvalidIndex) {
+                return std::addressof(g_service_list[index]);
             }
 
             return nullptr;
         }
 
-        ServiceInfo *GetFreeServiceInfo() {
-            return GetServiceInfo(InvalidServiceName);
+        void FreeServiceInfo(ServiceName service_name, ServiceInfo *service_info) {
+            g_service_index.Remove(service_name);
+            *service_info = InvalidServiceInfo;
         }
 
         bool HasServiceInfo(ServiceName service) {
@@ -352,32 +362,16 @@ namespace ams::sm::impl {
         }
 
         Result AddFutureMitmDeclaration(ServiceName service) {
-            for (auto &future_mitm : g_future_mitm_list) {
-                if (future_mitm == InvalidServiceName) {
-                    future_mitm = service;
-                    R_SUCCEED();
-                }
-            }
-
-            R_THROW(sm::ResultOutOfServices());
+            R_UNLESS(g_future_mitm_index.Insert(service) != g_future_mitm_index.InvalidIndex, sm::ResultOutOfServices());
+            R_SUCCEED();
         }
 
         bool HasFutureMitmDeclaration(ServiceName service) {
-            for (const auto &future_mitm : g_future_mitm_list){
-                if (future_mitm == service) {
-                    return true;
-                }
-            }
-
-            return false;
+            return g_future_mitm_index.Contains(service);
         }
 
         void ClearFutureMitmDeclaration(ServiceName service) {
-            for (auto &future_mitm : g_future_mitm_list) {
-                if (future_mitm == service) {
-                    future_mitm = InvalidServiceName;
-                }
-            }
+            g_future_mitm_index.Remove(service);
 
             /* This might undefer some requests. */
             TriggerResume(service);
@@ -486,9 +480,12 @@ namespace ams::sm::impl {
             R_UNLESS(!HasServiceInfo(service), sm::ResultAlreadyRegistered());
 
             /* Get free service. */
-            ServiceInfo *free_service = GetFreeServiceInfo();
+            ServiceInfo *free_service = AllocateServiceInfo(service);
             R_UNLESS(free_service != nullptr, sm::ResultOutOfServices());
 
+            /* If we fail to create the service, release the info. */
+            ON_RESULT_FAILURE { FreeServiceInfo(service, free_service); };
+
             /* Create the new service. */
             R_TRY(CreatePortImpl(out, std::addressof(free_service->port_h), max_sessions, is_light, free_service->name));
 
@@ -512,7 +509,7 @@ namespace ams::sm::impl {
             os::CloseNativeHandle(service_info->port_h);
 
             /* Reset the info's state. */
-            *service_info = InvalidServiceInfo;
+            FreeServiceInfo(service_info->name, service_info);
 
             /* Reset the mitm info, if necessary. */
             if (mitm_info != nullptr) {
@@ -552,14 +549,20 @@ namespace ams::sm::impl {
         /* Check that access control will fit in the ServiceInfo. */
         R_UNLESS(aci_sac_size <= AccessControlSizeMax, sm::ResultTooLargeAccessControl());
 
-        /* Get free process. */
-        ProcessInfo *proc = GetFreeProcessInfo();
-        R_UNLESS(proc != nullptr, sm::ResultOutOfProcesses());
+        /* Check that the process isn't already registered. */
+        R_UNLESS(!HasProcessInfo(process_id), sm::ResultAlreadyRegistered());
+
+        /* Check that we have a free process. */
+        R_UNLESS(!g_process_index.IsFull(), sm::ResultOutOfProcesses());
 
         /* Validate restrictions. */
         R_UNLESS(aci_sac_size != 0, sm::ResultNotAllowed());
         R_TRY(ValidateAccessControl(AccessControlEntry(acid_sac, acid_sac_size), AccessControlEntry(aci_sac, aci_sac_size)));
 
+        /* Get free process. */
+        ProcessInfo *proc = AllocateProcessInfo(process_id);
+        AMS_ABORT_UNLESS(proc != nullptr);
+
         /* Save info. */
         proc->process_id          = process_id;
         proc->program_id          = program_id;
@@ -579,7 +582,7 @@ namespace ams::sm::impl {
         R_UNLESS(proc != nullptr, sm::ResultInvalidClient());
 
         /* Free the process. */
-        *proc = InvalidProcessInfo;
+        FreeProcessInfo(proc);
 
         R_SUCCEED();
     }
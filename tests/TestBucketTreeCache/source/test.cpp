@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        /* These match the node size NCAs use for indirect storages. */
+        constexpr size_t NodeSize                  = 16_KB;
+        constexpr s32 EntrySetCount                = 8;
+        constexpr s64 EntrySpan                    = 0x1000;
+
+        constexpr s32 FillerTreeCount              = 2 * (fssystem::BucketTree::NodeCacheSizeMax / (fssystem::BucketTree::NodeCacheCountMax * NodeSize));
+        constexpr size_t HotLookupCount            = 0x4000;
+
+        constexpr size_t BufferPoolSize            = 1_MB;
+
+        alignas(os::MemoryPageSize) constinit u8 g_buffer_pool[BufferPoolSize];
+
+        struct Entry {
+            s64 virt_offset;
+            s64 value;
+        };
+        static_assert(util::is_pod<Entry>::value);
+
+        constexpr s32 EntryCountPerSet = (NodeSize - sizeof(fssystem::BucketTree::NodeHeader)) / sizeof(Entry);
+        constexpr s32 EntryCount       = EntrySetCount * EntryCountPerSet;
+        constexpr s64 DataSize         = EntryCount * EntrySpan;
+
+        alignas(sizeof(s64)) constinit u8 g_node_storage[NodeSize];
+        alignas(sizeof(s64)) constinit u8 g_entry_storage[EntrySetCount * NodeSize];
+
+        class StandardMemoryResource : public MemoryResource {
+            private:
+                virtual void *AllocateImpl(size_t size, size_t alignment) override {
+                    AMS_UNUSED(alignment);
+                    return std::malloc(size);
+                }
+
+                virtual void DeallocateImpl(void *buffer, size_t size, size_t alignment) override {
+                    AMS_UNUSED(size, alignment);
+                    std::free(buffer);
+                }
+
+                virtual bool IsEqualImpl(const MemoryResource &resource) const override {
+                    return this == std::addressof(resource);
+                }
+        };
+
+        /* A memory storage which counts how often it is read. */
+        class CountingStorage : public fs::MemoryStorage {
+            private:
+                size_t m_read_count;
+            public:
+                CountingStorage(void *b, s64 sz) : MemoryStorage(b, sz), m_read_count(0) { /* ... */ }
+
+                virtual Result Read(s64 offset, void *buffer, size_t size) override {
+                    ++m_read_count;
+                    R_RETURN(MemoryStorage::Read(offset, buffer, size));
+                }
+
+                size_t GetReadCount() const { return m_read_count; }
+                void ClearReadCount() { m_read_count = 0; }
+        };
+
+        /* Lays out a tree with a single level of entry sets, whose entries each cover EntrySpan bytes. */
+        void BuildTree() {
+            auto *l1_header  = reinterpret_cast<fssystem::BucketTree::NodeHeader *>(g_node_storage);
+            auto *l1_offsets = reinterpret_cast<s64 *>(l1_header + 1);
+            *l1_header = { 0, EntrySetCount, DataSize };
+
+            for (s32 i = 0; i < EntrySetCount; ++i) {
+                auto *set_header  = reinterpret_cast<fssystem::BucketTree::NodeHeader *>(g_entry_storage + i * NodeSize);
+                auto *set_entries = reinterpret_cast<Entry *>(set_header + 1);
+
+                l1_offsets[i] = i * EntryCountPerSet * EntrySpan;
+                *set_header   = { i, EntryCountPerSet, (i + 1) * EntryCountPerSet * EntrySpan };
+                for (s32 j = 0; j < EntryCountPerSet; ++j) {
+                    const s32 index = i * EntryCountPerSet + j;
+                    set_entries[j] = { index * EntrySpan, index };
+                }
+            }
+        }
+
+        void InitializeTree(fssystem::BucketTree *tree, MemoryResource *allocator, fs::IStorage *node_storage, fs::IStorage *entry_storage) {
+            R_ABORT_UNLESS(tree->Initialize(allocator, fs::SubStorage(node_storage, 0, sizeof(g_node_storage)), fs::SubStorage(entry_storage, 0, sizeof(g_entry_storage)), NodeSize, sizeof(Entry), EntryCount));
+        }
+
+        void FindAndVerify(fssystem::BucketTree &tree, s64 virtual_address) {
+            fssystem::BucketTree::Visitor visitor;
+            R_ABORT_UNLESS(tree.Find(std::addressof(visitor), virtual_address));
+            AMS_ABORT_UNLESS(visitor.Get<Entry>()->value == virtual_address / EntrySpan);
+        }
+
+        /* Looks up random addresses in a region, as reads of a hot patched asset do. */
+        TimeSpan LookUpRandomly(fssystem::BucketTree &tree, s64 start, s64 size, size_t count) {
+            u64 seed = 0x2545F4914F6CDD1D;
+
+            const auto start_tick = os::GetSystemTick();
+            for (size_t i = 0; i < count; ++i) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+
+                FindAndVerify(tree, start + static_cast<s64>(seed % static_cast<u64>(size)));
+            }
+            return (os::GetSystemTick() - start_tick).ToTimeSpan();
+        }
+
+    }
+
+    void Main() {
+        printf("Doing bucket tree cache tests!\n");
+
+        R_ABORT_UNLESS(fssystem::InitializeBufferPool(reinterpret_cast<char *>(g_buffer_pool), BufferPoolSize));
+        BuildTree();
+
+        StandardMemoryResource allocator;
+        CountingStorage node_storage(g_node_storage, sizeof(g_node_storage));
+        CountingStorage entry_storage(g_entry_storage, sizeof(g_entry_storage));
+
+        /* Open enough trees to spend the shared budget, and touch every entry set of each, as the many trees of a patched NCA do. */
+        fssystem::BucketTree filler_trees[FillerTreeCount];
+        for (auto &tree : filler_trees) {
+            InitializeTree(std::addressof(tree), std::addressof(allocator), std::addressof(node_storage), std::addressof(entry_storage));
+            for (s32 i = 0; i < EntrySetCount; ++i) {
+                FindAndVerify(tree, i * EntryCountPerSet * EntrySpan);
+            }
+        }
+
+        /* Open the tree of a patch, and warm its hot region up. */
+        CountingStorage hot_entry_storage(g_entry_storage, sizeof(g_entry_storage));
+        fssystem::BucketTree hot_tree;
+        InitializeTree(std::addressof(hot_tree), std::addressof(allocator), std::addressof(node_storage), std::addressof(hot_entry_storage));
+
+        constexpr s64 HotStart = 3 * EntryCountPerSet * EntrySpan;
+        constexpr s64 HotSize  = EntryCountPerSet * EntrySpan;
+        FindAndVerify(hot_tree, HotStart);
+
+        /* Once warm, lookups in the hot region must not read storage, even though the shared budget is spent. */
+        hot_entry_storage.ClearReadCount();
+        const auto hot_time = LookUpRandomly(hot_tree, HotStart, HotSize, HotLookupCount);
+        AMS_ABORT_UNLESS(hot_entry_storage.GetReadCount() == 0);
+        printf("Hot region: %zu lookups, %zu entry storage reads, %" PRId64 " ns/lookup\n", HotLookupCount, hot_entry_storage.GetReadCount(), hot_time.GetNanoSeconds() / static_cast<s64>(HotLookupCount));
+
+        /* Lookups across the whole tree must still be correct, though they read storage. */
+        hot_entry_storage.ClearReadCount();
+        const auto cold_time = LookUpRandomly(hot_tree, 0, DataSize, HotLookupCount);
+        printf("Whole tree: %zu lookups, %zu entry storage reads, %" PRId64 " ns/lookup\n", HotLookupCount, hot_entry_storage.GetReadCount(), cold_time.GetNanoSeconds() / static_cast<s64>(HotLookupCount));
+
+        /* Invalidating must drop the cache, so the next lookup reads storage again. */
+        R_ABORT_UNLESS(hot_tree.InvalidateCache());
+        hot_entry_storage.ClearReadCount();
+        FindAndVerify(hot_tree, HotStart);
+        AMS_ABORT_UNLESS(hot_entry_storage.GetReadCount() > 0);
+
+        printf("All tests completed!\n");
+    }
+
+}
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        /* These match the parameters NcaFileSystemDriver uses for compressed storages. */
+        constexpr size_t BlockSizeMax                = 64_KB;
+        constexpr size_t ContinuousReadingSizeMax    = 640_KB;
+        constexpr size_t CacheSize                   = 16_KB;
+        constexpr s32 MaxCacheEntries                = 32;
+        constexpr size_t NodeSize                    = fssystem::CompressedStorage::NodeSize;
+
+        constexpr s32 BlockCount                     = 256;
+        constexpr size_t DataSize                    = BlockCount * BlockSizeMax;
+        constexpr size_t BytesReadPerRun             = 64_MB;
+        constexpr s32 ReadBlockCounts[]              = { 1, 2, 4, 8, 16, 32, 64 };
+        constexpr size_t RandomReadSize              = 4_KB;
+        constexpr size_t RandomReadCount             = 0x4000;
+        constexpr s32 HotBlockCounts[]               = { 2, 4, 16, 64 };
+
+        constexpr size_t WorkerCount                 = 3;
+
+        constexpr size_t BufferPoolSize              = 2_MB;
+        constexpr size_t BufferManagerHeapSize       = 1_MB;
+        constexpr size_t BufferManagerCacheCountMax  = 1024;
+        constexpr size_t BufferManagerBlockSize      = 16_KB;
+
+        alignas(os::MemoryPageSize) constinit u8 g_buffer_pool[BufferPoolSize];
+        alignas(os::MemoryPageSize) constinit u8 g_buffer_manager_heap[BufferManagerHeapSize];
+        constinit util::TypedStorage<fssystem::FileSystemBufferManager> g_buffer_manager = {};
+
+        alignas(os::ThreadStackAlignment) constinit u8 g_worker_stacks[WorkerCount * fssystem::DecompressionWorkerStackSize];
+
+        constinit u8 g_data[DataSize];
+        constinit u8 g_compressed_data[DataSize + BlockSizeMax + BlockCount * fssystem::CompressionBlockAlignment];
+        constinit u8 g_read_buffer[ReadBlockCounts[util::size(ReadBlockCounts) - 1] * BlockSizeMax];
+
+        alignas(sizeof(s64)) constinit u8 g_node_storage[NodeSize];
+        alignas(sizeof(s64)) constinit u8 g_entry_storage[NodeSize];
+
+        class StandardMemoryResource : public MemoryResource {
+            private:
+                virtual void *AllocateImpl(size_t size, size_t alignment) override {
+                    AMS_UNUSED(alignment);
+                    return std::malloc(size);
+                }
+
+                virtual void DeallocateImpl(void *buffer, size_t size, size_t alignment) override {
+                    AMS_UNUSED(size, alignment);
+                    std::free(buffer);
+                }
+
+                virtual bool IsEqualImpl(const MemoryResource &resource) const override {
+                    return this == std::addressof(resource);
+                }
+        };
+
+        Result DecompressLz4(void *dst, size_t dst_size, const void *src, size_t src_size) {
+            R_UNLESS(util::DecompressLZ4(dst, dst_size, src, src_size) == static_cast<int>(dst_size), fs::ResultUnexpectedInCompressedStorageC());
+            R_SUCCEED();
+        }
+
+        fssystem::DecompressorFunction GetDecompressor(fssystem::CompressionType type) {
+            return type == fssystem::CompressionType_Lz4 ? DecompressLz4 : nullptr;
+        }
+
+        /* A greedy LZ4 block compressor, good enough to produce realistic blocks to decompress. */
+        size_t CompressLz4(u8 *dst, const u8 *src, size_t src_size) {
+            constexpr size_t MinMatch       = 4;
+            constexpr size_t LastLiterals   = 5;
+            constexpr size_t MatchFindLimit = 12;
+            constexpr size_t HashBits       = 14;
+
+            s64 table[1 << HashBits];
+            std::fill(std::begin(table), std::end(table), -1);
+
+            auto Load32 = [](const u8 *p) -> u32 { u32 v; std::memcpy(std::addressof(v), p, sizeof(v)); return v; };
+            auto WriteLength = [&](size_t &out, size_t length) {
+                for (/* ... */; length >= 0xFF; length -= 0xFF) {
+                    dst[out++] = 0xFF;
+                }
+                dst[out++] = static_cast<u8>(length);
+            };
+            auto WriteLiterals = [&](size_t &out, size_t token_pos, size_t start, size_t end) {
+                const size_t count = end - start;
+                dst[token_pos] = static_cast<u8>(std::min<size_t>(count, 0xF) << 4);
+                if (count >= 0xF) {
+                    WriteLength(out, count - 0xF);
+                }
+                std::memcpy(dst + out, src + start, count);
+                out += count;
+            };
+
+            size_t out = 0, anchor = 0, ip = 0;
+            while (src_size > MatchFindLimit && ip + MatchFindLimit <= src_size) {
+                const u32 seq  = Load32(src + ip);
+                const size_t h = (seq * UINT32_C(2654435761)) >> (BITSIZEOF(u32) - HashBits);
+                const s64 ref  = table[h];
+                table[h] = ip;
+
+                if (ref < 0 || ip - ref > 0xFFFF || Load32(src + ref) != seq) {
+                    ++ip;
+                    continue;
+                }
+
+                /* Extend the match, leaving the final literals alone. */
+                size_t length = MinMatch;
+                while (ip + length < src_size - LastLiterals && src[ref + length] == src[ip + length]) {
+                    ++length;
+                }
+
+                /* Emit the literals and the match. */
+                const size_t token_pos = out++;
+                WriteLiterals(out, token_pos, anchor, ip);
+                dst[token_pos] |= static_cast<u8>(std::min<size_t>(length - MinMatch, 0xF));
+                dst[out++] = static_cast<u8>((ip - ref) >> 0);
+                dst[out++] = static_cast<u8>((ip - ref) >> 8);
+                if (length - MinMatch >= 0xF) {
+                    WriteLength(out, length - MinMatch - 0xF);
+                }
+
+                ip    += length;
+                anchor = ip;
+            }
+
+            /* Emit the final literals. */
+            const size_t token_pos = out++;
+            WriteLiterals(out, token_pos, anchor, src_size);
+            return out;
+        }
+
+        /* Builds text-like data which compresses about as well as typical game assets. */
+        void GenerateData() {
+            constexpr const char *Words[] = {
+                "texture", "mesh", "bone", "anim", "shader", "vertex", "index", "sound", "bank", "stream",
+                "level", "actor", "script", "param", "table", "font", "glyph", "layout", "effect", "light",
+            };
+
+            u64 seed = 0x9E3779B97F4A7C15;
+            size_t offset = 0;
+            while (offset < DataSize) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+
+                /* Mix words with raw bytes, so that not everything is a long match. */
+                if ((seed & 3) == 0) {
+                    for (size_t i = 0; i < 8 && offset < DataSize; ++i) {
+                        g_data[offset++] = static_cast<u8>(seed >> (8 * i));
+                    }
+                } else {
+                    for (const char *word = Words[(seed >> 8) % util::size(Words)]; *word != '\x00' && offset < DataSize; ++word) {
+                        g_data[offset++] = static_cast<u8>(*word);
+                    }
+                }
+            }
+        }
+
+        /* Compresses each block, and lays out the bucket tree for a single entry set describing them. */
+        size_t BuildCompressedStorage() {
+            using Entry = fssystem::CompressedStorage::Entry;
+
+            auto *l1_header   = reinterpret_cast<fssystem::BucketTree::NodeHeader *>(g_node_storage);
+            auto *l1_offsets  = reinterpret_cast<s64 *>(l1_header + 1);
+            auto *set_header  = reinterpret_cast<fssystem::BucketTree::NodeHeader *>(g_entry_storage);
+            auto *set_entries = reinterpret_cast<Entry *>(set_header + 1);
+
+            *l1_header    = { 0, 1, static_cast<s64>(DataSize) };
+            l1_offsets[0] = 0;
+            *set_header   = { 0, BlockCount, static_cast<s64>(DataSize) };
+
+            size_t compressed_size = 0;
+            for (s32 i = 0; i < BlockCount; ++i) {
+                u8 *dst = g_compressed_data + compressed_size;
+                const size_t size = CompressLz4(dst, g_data + i * BlockSizeMax, BlockSizeMax);
+
+                /* Store blocks which don't shrink as they are, as NCAs do. */
+                const bool is_compressed = size < BlockSizeMax;
+                if (!is_compressed) {
+                    std::memcpy(dst, g_data + i * BlockSizeMax, BlockSizeMax);
+                }
+
+                set_entries[i] = {
+                    .virt_offset      = static_cast<s64>(i * BlockSizeMax),
+                    .phys_offset      = static_cast<s64>(compressed_size),
+                    .compression_type = is_compressed ? fssystem::CompressionType_Lz4 : fssystem::CompressionType_None,
+                    .phys_size        = static_cast<s32>(is_compressed ? size : BlockSizeMax),
+                };
+
+                compressed_size = util::AlignUp(compressed_size + set_entries[i].phys_size, fssystem::CompressionBlockAlignment);
+            }
+
+            return compressed_size;
+        }
+
+        void VerifyReads(fssystem::CompressedStorage &storage) {
+            /* Read the whole storage in a few differently sized and aligned pieces, and check we get back what we compressed. */
+            constexpr size_t ReadSizes[] = { 0x1000, BlockSizeMax, 3 * BlockSizeMax + 0x123, sizeof(g_read_buffer) };
+            for (const size_t read_size : ReadSizes) {
+                for (size_t offset = 0x10; offset < DataSize; offset += read_size) {
+                    const size_t cur_size = std::min(read_size, DataSize - offset);
+                    R_ABORT_UNLESS(storage.Read(offset, g_read_buffer, cur_size));
+                    AMS_ABORT_UNLESS(std::memcmp(g_read_buffer, g_data + offset, cur_size) == 0);
+                }
+            }
+        }
+
+        TimeSpan BenchmarkRandomReads(fssystem::CompressedStorage &storage, s32 hot_block_count) {
+            /* Read small pieces of a few hot blocks, as a game reading from an asset pack does. */
+            u64 seed = 0x2545F4914F6CDD1D;
+            const size_t hot_size = hot_block_count * BlockSizeMax;
+
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < RandomReadCount; ++i) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+
+                const size_t offset = seed % (hot_size - RandomReadSize);
+                R_ABORT_UNLESS(storage.Read(offset, g_read_buffer, RandomReadSize));
+                AMS_ABORT_UNLESS(std::memcmp(g_read_buffer, g_data + offset, RandomReadSize) == 0);
+            }
+            return (os::GetSystemTick() - start).ToTimeSpan();
+        }
+
+        TimeSpan BenchmarkSequentialReads(fssystem::CompressedStorage &storage, s32 read_block_count) {
+            const size_t read_size = read_block_count * BlockSizeMax;
+
+            const auto start = os::GetSystemTick();
+            for (size_t total = 0, offset = 0; total < BytesReadPerRun; total += read_size, offset = (offset + read_size) % DataSize) {
+                R_ABORT_UNLESS(storage.Read(offset, g_read_buffer, std::min(read_size, DataSize - offset)));
+            }
+            return (os::GetSystemTick() - start).ToTimeSpan();
+        }
+
+        s64 GetMegaBytesPerSecond(size_t bytes, TimeSpan elapsed) {
+            return static_cast<s64>((bytes * 1'000'000) / std::max<s64>(elapsed.GetMicroSeconds(), 1)) / 1_MB;
+        }
+
+    }
+
+    void Main() {
+        printf("Doing compressed storage benchmarks!\n");
+
+        /* Set up the buffers compressed storage needs. */
+        R_ABORT_UNLESS(fssystem::InitializeBufferPool(reinterpret_cast<char *>(g_buffer_pool), BufferPoolSize));
+        util::ConstructAt(g_buffer_manager);
+        R_ABORT_UNLESS(GetReference(g_buffer_manager).Initialize(BufferManagerCacheCountMax, reinterpret_cast<uintptr_t>(g_buffer_manager_heap), BufferManagerHeapSize, BufferManagerBlockSize));
+
+        /* Build the compressed data. */
+        GenerateData();
+        const size_t compressed_size = BuildCompressedStorage();
+        printf("%d blocks of %zu KB compress to %zu%%\n", BlockCount, BlockSizeMax / 1_KB, (compressed_size * 100) / DataSize);
+
+        /* Create the storage. */
+        StandardMemoryResource allocator;
+        fs::MemoryStorage data_storage(g_compressed_data, compressed_size);
+        fs::MemoryStorage node_storage(g_node_storage, sizeof(g_node_storage));
+        fs::MemoryStorage entry_storage(g_entry_storage, sizeof(g_entry_storage));
+
+        fssystem::CompressedStorage storage;
+        R_ABORT_UNLESS(storage.Initialize(std::addressof(allocator), GetPointer(g_buffer_manager), fs::SubStorage(std::addressof(data_storage), 0, compressed_size), fs::SubStorage(std::addressof(node_storage), 0, NodeSize), fs::SubStorage(std::addressof(entry_storage), 0, NodeSize), BlockCount, BlockSizeMax, ContinuousReadingSizeMax, GetDecompressor, CacheSize, CacheSize, MaxCacheEntries));
+
+        /* Decompress on the reading thread alone. */
+        TimeSpan serial_times[util::size(ReadBlockCounts)];
+        VerifyReads(storage);
+        for (size_t i = 0; i < util::size(ReadBlockCounts); ++i) {
+            serial_times[i] = BenchmarkSequentialReads(storage, ReadBlockCounts[i]);
+        }
+
+        /* Decompress with the help of the workers. */
+        fssystem::InitializeDecompressionThreadPool(g_worker_stacks, sizeof(g_worker_stacks), os::DefaultThreadPriority);
+        AMS_ABORT_UNLESS(fssystem::IsDecompressionThreadPoolEnabled());
+
+        TimeSpan parallel_times[util::size(ReadBlockCounts)];
+        VerifyReads(storage);
+        for (size_t i = 0; i < util::size(ReadBlockCounts); ++i) {
+            parallel_times[i] = BenchmarkSequentialReads(storage, ReadBlockCounts[i]);
+        }
+
+        printf("blocks/read   serial MB/s   parallel MB/s (%zu workers)\n", WorkerCount);
+        for (size_t i = 0; i < util::size(ReadBlockCounts); ++i) {
+            printf("%11d   %11" PRId64 "   %13" PRId64 "\n", ReadBlockCounts[i], GetMegaBytesPerSecond(BytesReadPerRun, serial_times[i]), GetMegaBytesPerSecond(BytesReadPerRun, parallel_times[i]));
+        }
+
+        /* Read small pieces of hot blocks, which the decompressed block cache should serve once it holds them all. */
+        printf("hot blocks   random %zu KB MB/s   block cache hits   misses\n", RandomReadSize / 1_KB);
+        for (const s32 hot_block_count : HotBlockCounts) {
+            fssystem::ClearCompressedStorageBlockCacheCount();
+            const auto elapsed = BenchmarkRandomReads(storage, hot_block_count);
+            printf("%10d   %16" PRId64 "   %16zu   %6zu\n", hot_block_count, GetMegaBytesPerSecond(RandomReadSize * RandomReadCount, elapsed), fssystem::GetCompressedStorageBlockCacheHitCount(), fssystem::GetCompressedStorageBlockCacheMissCount());
+        }
+
+        printf("All benchmarks completed!\n");
+    }
+
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        constexpr size_t BenchmarkSize       = 4_MB;
+        constexpr size_t BenchmarkIterations = 16;
+        constexpr size_t MacSize             = crypto::Aes128GcmEncryptor::MacSize;
+
+        /* McGrew and Viega, "The Galois/Counter Mode of Operation (GCM)", test cases 2, 3, 4, 6 and 16. */
+        constexpr const u8 TestZeroBlock[0x10] = {};
+
+        constexpr const u8 TestKey128[0x10] = {
+            0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C, 0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08,
+        };
+        constexpr const u8 TestKey256[0x20] = {
+            0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C, 0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08,
+            0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C, 0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08,
+        };
+        constexpr const u8 TestIv96[0x0C] = {
+            0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA, 0xF8, 0x88,
+        };
+        constexpr const u8 TestIv480[0x3C] = {
+            0x93, 0x13, 0x22, 0x5D, 0xF8, 0x84, 0x06, 0xE5, 0x55, 0x90, 0x9C, 0x5A, 0xFF, 0x52, 0x69, 0xAA,
+            0x6A, 0x7A, 0x95, 0x38, 0x53, 0x4F, 0x7D, 0xA1, 0xE4, 0xC3, 0x03, 0xD2, 0xA3, 0x18, 0xA7, 0x28,
+            0xC3, 0xC0, 0xC9, 0x51, 0x56, 0x80, 0x95, 0x39, 0xFC, 0xF0, 0xE2, 0x42, 0x9A, 0x6B, 0x52, 0x54,
+            0x16, 0xAE, 0xDB, 0xF5, 0xA0, 0xDE, 0x6A, 0x57, 0xA6, 0x37, 0xB3, 0x9B,
+        };
+        constexpr const u8 TestAad[0x14] = {
+            0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF,
+            0xAB, 0xAD, 0xDA, 0xD2,
+        };
+        constexpr const u8 TestPlainText[0x40] = {
+            0xD9, 0x31, 0x32, 0x25, 0xF8, 0x84, 0x06, 0xE5, 0xA5, 0x59, 0x09, 0xC5, 0xAF, 0xF5, 0x26, 0x9A,
+            0x86, 0xA7, 0xA9, 0x53, 0x15, 0x34, 0xF7, 0xDA, 0x2E, 0x4C, 0x30, 0x3D, 0x8A, 0x31, 0x8A, 0x72,
+            0x1C, 0x3C, 0x0C, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2F, 0xCF, 0x0E, 0x24, 0x49, 0xA6, 0xB5, 0x25,
+            0xB1, 0x6A, 0xED, 0xF5, 0xAA, 0x0D, 0xE6, 0x57, 0xBA, 0x63, 0x7B, 0x39, 0x1A, 0xAF, 0xD2, 0x55,
+        };
+
+        constexpr const u8 TestCipherText2[0x10] = {
+            0x03, 0x88, 0xDA, 0xCE, 0x60, 0xB6, 0xA3, 0x92, 0xF3, 0x28, 0xC2, 0xB9, 0x71, 0xB2, 0xFE, 0x78,
+        };
+        constexpr const u8 TestCipherText3[0x40] = {
+            0x42, 0x83, 0x1E, 0xC2, 0x21, 0x77, 0x74, 0x24, 0x4B, 0x72, 0x21, 0xB7, 0x84, 0xD0, 0xD4, 0x9C,
+            0xE3, 0xAA, 0x21, 0x2F, 0x2C, 0x02, 0xA4, 0xE0, 0x35, 0xC1, 0x7E, 0x23, 0x29, 0xAC, 0xA1, 0x2E,
+            0x21, 0xD5, 0x14, 0xB2, 0x54, 0x66, 0x93, 0x1C, 0x7D, 0x8F, 0x6A, 0x5A, 0xAC, 0x84, 0xAA, 0x05,
+            0x1B, 0xA3, 0x0B, 0x39, 0x6A, 0x0A, 0xAC, 0x97, 0x3D, 0x58, 0xE0, 0x91, 0x47, 0x3F, 0x59, 0x85,
+        };
+        constexpr const u8 TestCipherText6[0x3C] = {
+            0x8C, 0xE2, 0x49, 0x98, 0x62, 0x56, 0x15, 0xB6, 0x03, 0xA0, 0x33, 0xAC, 0xA1, 0x3F, 0xB8, 0x94,
+            0xBE, 0x91, 0x12, 0xA5, 0xC3, 0xA2, 0x11, 0xA8, 0xBA, 0x26, 0x2A, 0x3C, 0xCA, 0x7E, 0x2C, 0xA7,
+            0x01, 0xE4, 0xA9, 0xA4, 0xFB, 0xA4, 0x3C, 0x90, 0xCC, 0xDC, 0xB2, 0x81, 0xD4, 0x8C, 0x7C, 0x6F,
+            0xD6, 0x28, 0x75, 0xD2, 0xAC, 0xA4, 0x17, 0x03, 0x4C, 0x34, 0xAE, 0xE5,
+        };
+        constexpr const u8 TestCipherText16[0x3C] = {
+            0x52, 0x2D, 0xC1, 0xF0, 0x99, 0x56, 0x7D, 0x07, 0xF4, 0x7F, 0x37, 0xA3, 0x2A, 0x84, 0x42, 0x7D,
+            0x64, 0x3A, 0x8C, 0xDC, 0xBF, 0xE5, 0xC0, 0xC9, 0x75, 0x98, 0xA2, 0xBD, 0x25, 0x55, 0xD1, 0xAA,
+            0x8C, 0xB0, 0x8E, 0x48, 0x59, 0x0D, 0xBB, 0x3D, 0xA7, 0xB0, 0x8B, 0x10, 0x56, 0x82, 0x88, 0x38,
+            0xC5, 0xF6, 0x1E, 0x63, 0x93, 0xBA, 0x7A, 0x0A, 0xBC, 0xC9, 0xF6, 0x62,
+        };
+
+        constexpr const u8 TestMac2[0x10] = {
+            0xAB, 0x6E, 0x47, 0xD4, 0x2C, 0xEC, 0x13, 0xBD, 0xF5, 0x3A, 0x67, 0xB2, 0x12, 0x57, 0xBD, 0xDF,
+        };
+        constexpr const u8 TestMac3[0x10] = {
+            0x4D, 0x5C, 0x2A, 0xF3, 0x27, 0xCD, 0x64, 0xA6, 0x2C, 0xF3, 0x5A, 0xBD, 0x2B, 0xA6, 0xFA, 0xB4,
+        };
+        constexpr const u8 TestMac4[0x10] = {
+            0x5B, 0xC9, 0x4F, 0xBC, 0x32, 0x21, 0xA5, 0xDB, 0x94, 0xFA, 0xE9, 0x5A, 0xE7, 0x12, 0x1A, 0x47,
+        };
+        constexpr const u8 TestMac6[0x10] = {
+            0x61, 0x9C, 0xC5, 0xAE, 0xFF, 0xFE, 0x0B, 0xFA, 0x46, 0x2A, 0xF4, 0x3C, 0x16, 0x99, 0xD0, 0x50,
+        };
+        constexpr const u8 TestMac16[0x10] = {
+            0x76, 0xFC, 0x6E, 0xCE, 0x0F, 0x4E, 0x17, 0x68, 0xCD, 0xDF, 0x88, 0x53, 0xBB, 0x2D, 0x55, 0x1B,
+        };
+        struct TestVector {
+            const u8 *key;
+            size_t key_size;
+            const u8 *iv;
+            size_t iv_size;
+            const u8 *aad;
+            size_t aad_size;
+            const u8 *plain_text;
+            const u8 *cipher_text;
+            size_t msg_size;
+            const u8 *mac;
+        };
+
+        constexpr const TestVector TestVectors128[] = {
+            { TestZeroBlock, sizeof(TestZeroBlock), TestZeroBlock, sizeof(TestIv96), nullptr, 0, TestZeroBlock, TestCipherText2, sizeof(TestCipherText2), TestMac2 },
+            { TestKey128, sizeof(TestKey128), TestIv96, sizeof(TestIv96), nullptr, 0, TestPlainText, TestCipherText3, sizeof(TestCipherText3), TestMac3 },
+            { TestKey128, sizeof(TestKey128), TestIv96, sizeof(TestIv96), TestAad, sizeof(TestAad), TestPlainText, TestCipherText3, 0x3C, TestMac4 },
+            { TestKey128, sizeof(TestKey128), TestIv480, sizeof(TestIv480), TestAad, sizeof(TestAad), TestPlainText, TestCipherText6, sizeof(TestCipherText6), TestMac6 },
+        };
+
+        constexpr const TestVector TestVectors256[] = {
+            { TestKey256, sizeof(TestKey256), TestIv96, sizeof(TestIv96), TestAad, sizeof(TestAad), TestPlainText, TestCipherText16, sizeof(TestCipherText16), TestMac16 },
+        };
+
+        alignas(os::MemoryPageSize) constinit u8 g_src_buffer[BenchmarkSize];
+        alignas(os::MemoryPageSize) constinit u8 g_dst_buffer[BenchmarkSize];
+
+        template<typename BlockCipher, bool IsEncrypt>
+        void Crypt(void *dst, void *mac, const TestVector &vector, const void *src, size_t split) {
+            BlockCipher cipher;
+            cipher.Initialize(vector.key, vector.key_size);
+
+            crypto::impl::GcmModeImpl<BlockCipher> impl;
+            impl.Initialize(std::addressof(cipher));
+            impl.Reset(vector.iv, vector.iv_size);
+
+            /* Process the aad and message in two updates each, so that partial blocks are exercised. */
+            const u8 *aad          = static_cast<const u8 *>(vector.aad);
+            const size_t aad_split = std::min(split, vector.aad_size);
+            impl.UpdateAad(aad, aad_split);
+            impl.UpdateAad(aad + aad_split, vector.aad_size - aad_split);
+
+            u8 *dst_u8       = static_cast<u8 *>(dst);
+            const u8 *src_u8 = static_cast<const u8 *>(src);
+            if constexpr (IsEncrypt) {
+                AMS_ABORT_UNLESS(impl.UpdateEncrypt(dst_u8, vector.msg_size, src_u8, split) == split);
+                AMS_ABORT_UNLESS(impl.UpdateEncrypt(dst_u8 + split, vector.msg_size - split, src_u8 + split, vector.msg_size - split) == vector.msg_size - split);
+            } else {
+                AMS_ABORT_UNLESS(impl.UpdateDecrypt(dst_u8, vector.msg_size, src_u8, split) == split);
+                AMS_ABORT_UNLESS(impl.UpdateDecrypt(dst_u8 + split, vector.msg_size - split, src_u8 + split, vector.msg_size - split) == vector.msg_size - split);
+            }
+
+            impl.GetMac(mac, MacSize);
+        }
+
+        template<typename BlockCipher, size_t N>
+        void TestKnownAnswer(const TestVector (&vectors)[N]) {
+            for (const auto &vector : vectors) {
+                /* Check every split of the message, including those which leave partial blocks. */
+                for (size_t split = 0; split <= vector.msg_size; ++split) {
+                    u8 dst[sizeof(TestPlainText)];
+                    u8 mac[MacSize];
+
+                    Crypt<BlockCipher, true>(dst, mac, vector, vector.plain_text, split);
+                    AMS_ABORT_UNLESS(std::memcmp(dst, vector.cipher_text, vector.msg_size) == 0);
+                    AMS_ABORT_UNLESS(std::memcmp(mac, vector.mac, MacSize) == 0);
+
+                    Crypt<BlockCipher, false>(dst, mac, vector, vector.cipher_text, split);
+                    AMS_ABORT_UNLESS(std::memcmp(dst, vector.plain_text, vector.msg_size) == 0);
+                    AMS_ABORT_UNLESS(std::memcmp(mac, vector.mac, MacSize) == 0);
+                }
+            }
+        }
+
+        void TestEncryptor() {
+            /* Check that the public interface matches the implementation. */
+            const auto &vector = TestVectors128[2];
+
+            crypto::Aes128GcmEncryptor encryptor;
+            encryptor.Initialize(vector.key, vector.key_size, vector.iv, vector.iv_size);
+            encryptor.UpdateAad(vector.aad, vector.aad_size);
+
+            u8 dst[sizeof(TestPlainText)];
+            u8 mac[MacSize];
+            AMS_ABORT_UNLESS(encryptor.Update(dst, sizeof(dst), vector.plain_text, vector.msg_size) == vector.msg_size);
+            encryptor.GetMac(mac, sizeof(mac));
+
+            AMS_ABORT_UNLESS(std::memcmp(dst, vector.cipher_text, vector.msg_size) == 0);
+            AMS_ABORT_UNLESS(std::memcmp(mac, vector.mac, MacSize) == 0);
+        }
+
+        template<bool IsEncrypt>
+        s64 Benchmark() {
+            const TestVector vector = { TestKey128, sizeof(TestKey128), TestIv96, sizeof(TestIv96), nullptr, 0, nullptr, nullptr, BenchmarkSize, nullptr };
+
+            u8 mac[MacSize];
+
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < BenchmarkIterations; ++i) {
+                Crypt<crypto::AesEncryptor128, IsEncrypt>(g_dst_buffer, mac, vector, g_src_buffer, BenchmarkSize / 2);
+            }
+            const auto elapsed_us = std::max<s64>((os::GetSystemTick() - start).ToTimeSpan().GetMicroSeconds(), 1);
+
+            /* Return throughput in MB/s. */
+            return static_cast<s64>(BenchmarkSize * BenchmarkIterations) / elapsed_us;
+        }
+
+        s64 BenchmarkMac() {
+            u8 mac[MacSize];
+
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < BenchmarkIterations; ++i) {
+                crypto::Aes128GcmEncryptor encryptor;
+                encryptor.Initialize(TestKey128, sizeof(TestKey128), TestIv96, sizeof(TestIv96));
+                encryptor.UpdateAad(g_src_buffer, BenchmarkSize);
+                encryptor.GetMac(mac, sizeof(mac));
+            }
+            const auto elapsed_us = std::max<s64>((os::GetSystemTick() - start).ToTimeSpan().GetMicroSeconds(), 1);
+
+            /* Return throughput in MB/s. */
+            return static_cast<s64>(BenchmarkSize * BenchmarkIterations) / elapsed_us;
+        }
+
+    }
+
+    void Main() {
+        printf("Doing GCM tests!\n");
+
+        TestKnownAnswer<crypto::AesEncryptor128>(TestVectors128);
+        TestKnownAnswer<crypto::AesEncryptor256>(TestVectors256);
+        TestEncryptor();
+
+        printf("GCM tests passed!\n");
+
+        printf("Doing GCM benchmarks!\n");
+
+        printf("AES-128-GCM encrypt: %5" PRId64 " MB/s\n", Benchmark<true>());
+        printf("AES-128-GCM decrypt: %5" PRId64 " MB/s\n", Benchmark<false>());
+        printf("AES-128-GMAC:        %5" PRId64 " MB/s\n", BenchmarkMac());
+
+        printf("All benchmarks completed!\n");
+    }
+
+}
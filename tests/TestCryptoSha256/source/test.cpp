@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        constexpr size_t BenchmarkSize       = 4_MB;
+        constexpr size_t BenchmarkIterations = 16;
+
+        constexpr size_t BlockSizes[] = { 0x200, 0x1000, 0x4000 };
+
+        constexpr const char TestVectorMessage[] = "abc";
+        constexpr const u8 TestVectorHash[crypto::Sha256Generator::HashSize] = {
+            0xBA, 0x78, 0x16, 0xBF, 0x8F, 0x01, 0xCF, 0xEA, 0x41, 0x41, 0x40, 0xDE, 0x5D, 0xAE, 0x22, 0x23,
+            0xB0, 0x03, 0x61, 0xA3, 0x96, 0x17, 0x7A, 0x9C, 0xB4, 0x10, 0xFF, 0x61, 0xF2, 0x00, 0x15, 0xAD,
+        };
+
+        alignas(os::MemoryPageSize) constinit u8 g_src_buffer[BenchmarkSize];
+        alignas(os::MemoryPageSize) constinit u8 g_hash_buffer[BenchmarkSize / BlockSizes[0] * crypto::Sha256Generator::HashSize];
+
+        void TestKnownAnswer() {
+            u8 hash[crypto::Sha256Generator::HashSize];
+            crypto::GenerateSha256(hash, sizeof(hash), TestVectorMessage, std::strlen(TestVectorMessage));
+            AMS_ABORT_UNLESS(std::memcmp(hash, TestVectorHash, sizeof(hash)) == 0);
+        }
+
+        void TestChunkedMatchesSingle() {
+            /* Check a range of sizes, so that every padding case is covered, hashing runs of blocks in one update and one small chunk at a time. */
+            for (size_t size = 0; size <= 0x180; ++size) {
+                u8 single[crypto::Sha256Generator::HashSize];
+                crypto::GenerateSha256(single, sizeof(single), g_src_buffer, size);
+
+                constexpr size_t ChunkSize = 7;
+
+                crypto::Sha256Generator gen;
+                gen.Initialize();
+                for (size_t offset = 0; offset < size; offset += ChunkSize) {
+                    gen.Update(g_src_buffer + offset, std::min(ChunkSize, size - offset));
+                }
+
+                u8 chunked[crypto::Sha256Generator::HashSize];
+                gen.GetHash(chunked, sizeof(chunked));
+
+                AMS_ABORT_UNLESS(std::memcmp(single, chunked, sizeof(single)) == 0);
+            }
+        }
+
+        void TestBlocksMatchSingle() {
+            /* Check a range of sizes, so that every padding case is covered, with enough blocks to use multi-buffer hashing and leave a remainder. */
+            for (size_t block_size = 0; block_size <= 0x180; ++block_size) {
+                constexpr size_t BlockCount = 19;
+
+                crypto::GenerateSha256ForBlocks(g_hash_buffer, sizeof(g_hash_buffer), g_src_buffer, block_size, BlockCount);
+
+                for (size_t i = 0; i < BlockCount; ++i) {
+                    u8 hash[crypto::Sha256Generator::HashSize];
+                    crypto::GenerateSha256(hash, sizeof(hash), g_src_buffer + block_size * i, block_size);
+                    AMS_ABORT_UNLESS(std::memcmp(hash, g_hash_buffer + sizeof(hash) * i, sizeof(hash)) == 0);
+                }
+            }
+        }
+
+        template<typename F>
+        s64 Benchmark(F f) {
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < BenchmarkIterations; ++i) {
+                f();
+            }
+            const auto elapsed_us = std::max<s64>((os::GetSystemTick() - start).ToTimeSpan().GetMicroSeconds(), 1);
+
+            /* Return throughput in MB/s. */
+            return static_cast<s64>(BenchmarkSize * BenchmarkIterations) / elapsed_us;
+        }
+
+    }
+
+    void Main() {
+        for (size_t i = 0; i < sizeof(g_src_buffer); ++i) {
+            g_src_buffer[i] = static_cast<u8>(i * 31 + 7);
+        }
+
+        printf("Doing SHA-256 tests!\n");
+
+        TestKnownAnswer();
+        TestChunkedMatchesSingle();
+        TestBlocksMatchSingle();
+
+        printf("SHA-256 tests passed!\n");
+
+        printf("Doing SHA-256 benchmarks!\n");
+
+        printf("single stream:     %5" PRId64 " MB/s\n", Benchmark([] {
+            u8 hash[crypto::Sha256Generator::HashSize];
+            crypto::GenerateSha256(hash, sizeof(hash), g_src_buffer, sizeof(g_src_buffer));
+        }));
+
+        for (const size_t block_size : BlockSizes) {
+            const size_t block_count = sizeof(g_src_buffer) / block_size;
+
+            const s64 single = Benchmark([=] {
+                for (size_t i = 0; i < block_count; ++i) {
+                    crypto::GenerateSha256(g_hash_buffer + crypto::Sha256Generator::HashSize * i, crypto::Sha256Generator::HashSize, g_src_buffer + block_size * i, block_size);
+                }
+            });
+
+            const s64 blocks = Benchmark([=] {
+                crypto::GenerateSha256ForBlocks(g_hash_buffer, sizeof(g_hash_buffer), g_src_buffer, block_size, block_count);
+            });
+
+            printf("0x%05zx byte blocks: one at a time %5" PRId64 " MB/s, GenerateSha256ForBlocks %5" PRId64 " MB/s\n", block_size, single, blocks);
+        }
+
+        printf("All benchmarks completed!\n");
+    }
+
+}
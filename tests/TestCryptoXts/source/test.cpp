@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        constexpr size_t BenchmarkSize       = 4_MB;
+        constexpr size_t BenchmarkIterations = 16;
+        constexpr size_t MaxTestSize         = 0x200;
+
+        /* IEEE 1619-2007, XTS-AES-128 vector 1. */
+        constexpr const u8 TestVectorKey[0x20]        = {};
+        constexpr const u8 TestVectorTweak[0x10]      = {};
+        constexpr const u8 TestVectorPlainText[0x20]  = {};
+        constexpr const u8 TestVectorCipherText[0x20] = {
+            0x91, 0x7C, 0xF6, 0x9E, 0xBD, 0x68, 0xB2, 0xEC, 0x9B, 0x9F, 0xE9, 0xA3, 0xEA, 0xDD, 0xA6, 0x92,
+            0xCD, 0x43, 0xD2, 0xF5, 0x95, 0x98, 0xED, 0x85, 0x8C, 0x02, 0xC2, 0x65, 0x2F, 0xBF, 0x92, 0x2E,
+        };
+
+        alignas(os::MemoryPageSize) constinit u8 g_src_buffer[BenchmarkSize];
+        alignas(os::MemoryPageSize) constinit u8 g_dst_buffer[BenchmarkSize];
+
+        template<typename BlockCipher>
+        struct CipherTraits;
+
+        template<> struct CipherTraits<crypto::AesEncryptor128> { static constexpr bool IsEncrypt = true;  };
+        template<> struct CipherTraits<crypto::AesDecryptor128> { static constexpr bool IsEncrypt = false; };
+
+        template<typename BlockCipher, bool UseGeneric>
+        size_t Crypt(void *dst, const void *src, size_t size, const void *key, const void *tweak, size_t split) {
+            constexpr bool IsEncrypt = CipherTraits<BlockCipher>::IsEncrypt;
+
+            BlockCipher cipher1;
+            crypto::AesEncryptor128 cipher2;
+            cipher1.Initialize(key, crypto::AesEncryptor128::KeySize);
+            cipher2.Initialize(static_cast<const u8 *>(key) + crypto::AesEncryptor128::KeySize, crypto::AesEncryptor128::KeySize);
+
+            crypto::impl::XtsModeImpl impl;
+            if constexpr (IsEncrypt) {
+                impl.InitializeEncryption(std::addressof(cipher1), std::addressof(cipher2), tweak, crypto::impl::XtsModeImpl::IvSize);
+            } else {
+                impl.InitializeDecryption(std::addressof(cipher1), std::addressof(cipher2), tweak, crypto::impl::XtsModeImpl::IvSize);
+            }
+
+            /* Process the data in two updates, so that buffered and partial data are exercised. */
+            u8 *dst_u8 = static_cast<u8 *>(dst);
+            const u8 *src_u8 = static_cast<const u8 *>(src);
+
+            auto update = [&](size_t processed, size_t offset, size_t cur_size) -> size_t {
+                if constexpr (UseGeneric) {
+                    return impl.UpdateGeneric(dst_u8 + processed, size - processed, src_u8 + offset, cur_size);
+                } else {
+                    return impl.template Update<BlockCipher>(dst_u8 + processed, size - processed, src_u8 + offset, cur_size);
+                }
+            };
+
+            size_t processed = 0;
+            processed += update(processed, 0, split);
+            processed += update(processed, split, size - split);
+
+            if constexpr (IsEncrypt) {
+                processed += impl.FinalizeEncryption(dst_u8 + processed, size - processed);
+            } else {
+                processed += impl.FinalizeDecryption(dst_u8 + processed, size - processed);
+            }
+
+            return processed;
+        }
+
+        void TestKnownAnswer() {
+            u8 dst[sizeof(TestVectorCipherText)];
+
+            AMS_ABORT_UNLESS(Crypt<crypto::AesEncryptor128, false>(dst, TestVectorPlainText, sizeof(dst), TestVectorKey, TestVectorTweak, 0) == sizeof(dst));
+            AMS_ABORT_UNLESS(std::memcmp(dst, TestVectorCipherText, sizeof(dst)) == 0);
+
+            AMS_ABORT_UNLESS(Crypt<crypto::AesDecryptor128, false>(dst, TestVectorCipherText, sizeof(dst), TestVectorKey, TestVectorTweak, 0) == sizeof(dst));
+            AMS_ABORT_UNLESS(std::memcmp(dst, TestVectorPlainText, sizeof(dst)) == 0);
+        }
+
+        void TestMatchesGeneric() {
+            u8 key[0x20], tweak[0x10];
+            for (size_t i = 0; i < sizeof(key); ++i) { key[i] = static_cast<u8>(0x11 * i + 3); }
+            for (size_t i = 0; i < sizeof(tweak); ++i) { tweak[i] = static_cast<u8>(0xA0 + i); }
+
+            u8 src[MaxTestSize], generic[MaxTestSize], optimized[MaxTestSize], decrypted[MaxTestSize];
+            for (size_t i = 0; i < sizeof(src); ++i) { src[i] = static_cast<u8>(i * 13 + 7); }
+
+            /* Check every size, including those which need ciphertext stealing. */
+            for (size_t size = crypto::impl::XtsModeImpl::BlockSize; size <= MaxTestSize; ++size) {
+                const size_t split = (size * 5) / 8;
+
+                AMS_ABORT_UNLESS(Crypt<crypto::AesEncryptor128, true>(generic, src, size, key, tweak, split) == size);
+                AMS_ABORT_UNLESS(Crypt<crypto::AesEncryptor128, false>(optimized, src, size, key, tweak, split) == size);
+                AMS_ABORT_UNLESS(std::memcmp(generic, optimized, size) == 0);
+
+                AMS_ABORT_UNLESS(Crypt<crypto::AesDecryptor128, false>(decrypted, optimized, size, key, tweak, split) == size);
+                AMS_ABORT_UNLESS(std::memcmp(decrypted, src, size) == 0);
+            }
+        }
+
+        template<typename BlockCipher, bool UseGeneric>
+        s64 Benchmark() {
+            u8 key[0x20] = {}, tweak[0x10] = {};
+
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < BenchmarkIterations; ++i) {
+                AMS_ABORT_UNLESS(Crypt<BlockCipher, UseGeneric>(g_dst_buffer, g_src_buffer, BenchmarkSize, key, tweak, BenchmarkSize / 2) == BenchmarkSize);
+            }
+            const auto elapsed_us = std::max<s64>((os::GetSystemTick() - start).ToTimeSpan().GetMicroSeconds(), 1);
+
+            /* Return throughput in MB/s. */
+            return static_cast<s64>(BenchmarkSize * BenchmarkIterations) / elapsed_us;
+        }
+
+    }
+
+    void Main() {
+        printf("Doing XTS tests!\n");
+
+        TestKnownAnswer();
+        TestMatchesGeneric();
+
+        printf("XTS tests passed!\n");
+
+        printf("Doing XTS benchmarks!\n");
+
+        printf("AES-128-XTS encrypt: generic %5" PRId64 " MB/s, optimized %5" PRId64 " MB/s\n", Benchmark<crypto::AesEncryptor128, true>(), Benchmark<crypto::AesEncryptor128, false>());
+        printf("AES-128-XTS decrypt: generic %5" PRId64 " MB/s, optimized %5" PRId64 " MB/s\n", Benchmark<crypto::AesDecryptor128, true>(), Benchmark<crypto::AesDecryptor128, false>());
+
+        printf("All benchmarks completed!\n");
+    }
+
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "fssystem_lru_list_cache.hpp"
+#include "fssystem_hashed_lru_list_cache.hpp"
+
+namespace ams {
+
+    namespace {
+
+        constexpr s32 CacheBlockCounts[] = { 2, 16, 128, 1024, 4096 };
+        constexpr size_t AccessCount     = 0x40000;
+        constexpr s32 InvalidateInterval = 0x3000;
+
+        using LinearCache = fssystem::LruListCache<s64, s32>;
+        using HashedCache = fssystem::HashedLruListCache<s64, s32>;
+
+        u64 GetRandom(u64 &seed) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return seed;
+        }
+
+        /* Drives a cache the way ReadOnlyBlockCacheStorage does: look the block up, and on a miss, replace the least recently used block. */
+        template<typename Cache>
+        TimeSpan ReplayAccesses(size_t *out_hits, u64 *out_checksum, s32 block_count) {
+            Cache cache;
+            for (s32 i = 0; i < block_count; ++i) {
+                cache.PushMruNode(std::make_unique<typename Cache::Node>(i), -1);
+            }
+            ON_SCOPE_EXIT { cache.DeleteAllNodes(); };
+
+            /* Most reads go to a working set a little larger than the cache, as an application streaming assets does. */
+            u64 seed = 0x9E3779B97F4A7C15;
+            const s64 hot_block_count  = block_count + block_count / 4;
+            const s64 cold_block_count = 0x10000;
+
+            size_t hits = 0;
+            u64 checksum = 0;
+
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < AccessCount; ++i) {
+                const u64 random = GetRandom(seed);
+                const s64 block  = (random & 7) != 0 ? static_cast<s64>((random >> 8) % hot_block_count) : static_cast<s64>((random >> 8) % cold_block_count);
+
+                s32 value;
+                if (cache.FindValueAndUpdateMru(std::addressof(value), block)) {
+                    ++hits;
+                } else {
+                    auto lru = cache.PopLruNode();
+                    value = lru->m_value;
+                    cache.PushMruNode(std::move(lru), block);
+                }
+                checksum = checksum * 31 + static_cast<u64>(value);
+
+                /* Now and then, invalidate everything, as OperateRange does. */
+                if ((i % InvalidateInterval) == InvalidateInterval - 1) {
+                    for (size_t j = 0; j < cache.GetSize(); ++j) {
+                        auto lru = cache.PopLruNode();
+                        cache.PushMruNode(std::move(lru), -1);
+                    }
+                }
+            }
+            const auto elapsed = (os::GetSystemTick() - start).ToTimeSpan();
+
+            AMS_ABORT_UNLESS(cache.GetSize() == static_cast<size_t>(block_count));
+
+            *out_hits     = hits;
+            *out_checksum = checksum;
+            return elapsed;
+        }
+
+    }
+
+    void Main() {
+        printf("Doing block cache benchmarks!\n");
+        printf("blocks   hit rate   linear ns/lookup   hashed ns/lookup\n");
+
+        for (const s32 block_count : CacheBlockCounts) {
+            size_t linear_hits, hashed_hits;
+            u64 linear_checksum, hashed_checksum;
+            const auto linear_time = ReplayAccesses<LinearCache>(std::addressof(linear_hits), std::addressof(linear_checksum), block_count);
+            const auto hashed_time = ReplayAccesses<HashedCache>(std::addressof(hashed_hits), std::addressof(hashed_checksum), block_count);
+
+            /* Both caches must hit and evict exactly the same blocks. */
+            AMS_ABORT_UNLESS(linear_hits == hashed_hits);
+            AMS_ABORT_UNLESS(linear_checksum == hashed_checksum);
+
+            printf("%6d   %7zu%%   %16" PRId64 "   %16" PRId64 "\n", block_count, (hashed_hits * 100) / AccessCount, linear_time.GetNanoSeconds() / static_cast<s64>(AccessCount), hashed_time.GetNanoSeconds() / static_cast<s64>(AccessCount));
+        }
+
+        printf("All benchmarks completed!\n");
+    }
+
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <haze/common.hpp>
+#include <haze/ptp.hpp>
+
+namespace haze {
+
+    /* Stands in for haze's USB server, looping transfers back to a simulated host over a link of fixed bandwidth. */
+    /* Transfers run on a separate thread, as they would on the USB controller. */
+    class AsyncUsbServer final {
+        NON_COPYABLE(AsyncUsbServer);
+        NON_MOVEABLE(AsyncUsbServer);
+        private:
+            static constexpr size_t ThreadStackSize = 16_KB;
+        public:
+            static constexpr u8 GetDataByte(u64 offset) {
+                return static_cast<u8>((offset * 0x9D) ^ (offset >> 11));
+            }
+        private:
+            struct Transfer {
+                bool read;
+                u8 *page;
+                u32 size;
+                u32 urb_id;
+                u32 size_transferred;
+                bool pending;
+                bool done;
+            };
+        private:
+            alignas(os::ThreadStackAlignment) u8 m_thread_stack[ThreadStackSize];
+            os::ThreadType m_thread;
+            mutable os::SdkMutex m_mutex;
+            mutable os::SdkConditionVariable m_cv;
+            mutable Transfer m_transfer;
+            mutable u32 m_next_urb_id;
+            u64 m_bytes_per_second;
+            bool m_exit;
+
+            /* The container the host is sending us. */
+            PtpUsbBulkContainer m_send_header;
+            u64 m_send_size;
+            u64 m_send_offset;
+
+            /* The containers the host has received from us. */
+            PtpUsbBulkContainer m_receive_header;
+            u64 m_receive_size;
+            size_t m_receive_zlp_count;
+            bool m_receive_valid;
+        private:
+            static void ThreadFunction(void *arg) {
+                static_cast<AsyncUsbServer *>(arg)->ThreadFunctionImpl();
+            }
+
+            void ThreadFunctionImpl() {
+                while (true) {
+                    /* Wait for a transfer. */
+                    Transfer transfer;
+                    {
+                        std::scoped_lock lk(m_mutex);
+                        while (!m_exit && !(m_transfer.pending && !m_transfer.done)) {
+                            m_cv.Wait(m_mutex);
+                        }
+
+                        if (m_exit) {
+                            return;
+                        }
+
+                        transfer = m_transfer;
+                    }
+
+                    /* Spend as long on the transfer as the link would. */
+                    os::SleepThread(TimeSpan::FromNanoSeconds(static_cast<s64>((static_cast<u64>(transfer.size) * 1'000'000'000) / m_bytes_per_second)));
+
+                    const u32 size_transferred = transfer.read ? this->HostSend(transfer.page, transfer.size) : this->HostReceive(transfer.page, transfer.size);
+
+                    /* Complete the transfer. */
+                    {
+                        std::scoped_lock lk(m_mutex);
+                        m_transfer.size_transferred = size_transferred;
+                        m_transfer.done             = true;
+                        m_cv.Broadcast();
+                    }
+                }
+            }
+
+            u32 HostSend(u8 *dst, u32 size) {
+                /* Send the header first. */
+                u32 sent = 0;
+                while (sent < size && m_send_offset < sizeof(m_send_header)) {
+                    dst[sent++] = reinterpret_cast<const u8 *>(std::addressof(m_send_header))[m_send_offset++];
+                }
+
+                /* Then the data. Once everything is sent, further transfers receive zero length packets. */
+                while (sent < size && m_send_offset < sizeof(m_send_header) + m_send_size) {
+                    dst[sent++] = GetDataByte(m_send_offset++ - sizeof(m_send_header));
+                }
+
+                return sent;
+            }
+
+            u32 HostReceive(const u8 *src, u32 size) {
+                if (size == 0) {
+                    ++m_receive_zlp_count;
+                    return 0;
+                }
+
+                for (u32 i = 0; i < size; ++i, ++m_receive_size) {
+                    if (m_receive_size < sizeof(m_receive_header)) {
+                        reinterpret_cast<u8 *>(std::addressof(m_receive_header))[m_receive_size] = src[i];
+                    } else if (src[i] != GetDataByte(m_receive_size - sizeof(m_receive_header))) {
+                        m_receive_valid = false;
+                    }
+                }
+
+                return size;
+            }
+        public:
+            explicit AsyncUsbServer(u64 bytes_per_second) : m_thread_stack(), m_thread(), m_mutex(), m_cv(), m_transfer(), m_next_urb_id(), m_bytes_per_second(bytes_per_second), m_exit(), m_send_header(), m_send_size(), m_send_offset(), m_receive_header(), m_receive_size(), m_receive_zlp_count(), m_receive_valid(true) {
+                R_ABORT_UNLESS(os::CreateThread(std::addressof(m_thread), ThreadFunction, this, m_thread_stack, sizeof(m_thread_stack), os::DefaultThreadPriority));
+                os::StartThread(std::addressof(m_thread));
+            }
+
+            ~AsyncUsbServer() {
+                {
+                    std::scoped_lock lk(m_mutex);
+                    m_exit = true;
+                    m_cv.Broadcast();
+                }
+
+                os::WaitThread(std::addressof(m_thread));
+                os::DestroyThread(std::addressof(m_thread));
+            }
+
+            /* Makes the host send a data container with data_size bytes of data. */
+            void SetHostSendData(const PtpUsbBulkContainer &header, u64 data_size) {
+                m_send_header = header;
+                m_send_size   = data_size;
+                m_send_offset = 0;
+            }
+
+            void ResetHostReceiveData() {
+                m_receive_header    = {};
+                m_receive_size      = 0;
+                m_receive_zlp_count = 0;
+                m_receive_valid     = true;
+            }
+
+            const PtpUsbBulkContainer &GetHostReceivedHeader() const { return m_receive_header; }
+            u64 GetHostReceivedSize() const { return m_receive_size; }
+            size_t GetHostReceivedZeroLengthPacketCount() const { return m_receive_zlp_count; }
+            bool IsHostReceivedDataValid() const { return m_receive_valid; }
+        public:
+            Result BeginTransferPacket(bool read, void *page, u32 size, u32 *out_urb_id) const {
+                std::scoped_lock lk(m_mutex);
+                AMS_ABORT_UNLESS(!m_transfer.pending);
+
+                m_transfer = { read, static_cast<u8 *>(page), size, ++m_next_urb_id, 0, true, false };
+                m_cv.Broadcast();
+
+                *out_urb_id = m_transfer.urb_id;
+                R_SUCCEED();
+            }
+
+            Result EndTransferPacket(bool read, u32 urb_id, u32 *out_size_transferred) const {
+                std::scoped_lock lk(m_mutex);
+                AMS_ABORT_UNLESS(m_transfer.pending && m_transfer.read == read && m_transfer.urb_id == urb_id);
+
+                while (!m_transfer.done) {
+                    m_cv.Wait(m_mutex);
+                }
+
+                *out_size_transferred = m_transfer.size_transferred;
+                m_transfer.pending = false;
+                R_SUCCEED();
+            }
+
+            Result ReadPacket(void *page, u32 size, u32 *out_size_transferred) const {
+                u32 urb_id;
+                R_TRY(this->BeginTransferPacket(true, page, size, std::addressof(urb_id)));
+                R_RETURN(this->EndTransferPacket(true, urb_id, out_size_transferred));
+            }
+
+            Result WritePacket(void *page, u32 size) const {
+                u32 urb_id, size_transferred;
+                R_TRY(this->BeginTransferPacket(false, page, size, std::addressof(urb_id)));
+                R_RETURN(this->EndTransferPacket(false, urb_id, std::addressof(size_transferred)));
+            }
+    };
+
+}
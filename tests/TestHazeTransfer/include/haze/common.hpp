@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/* Stands in for haze's common header, which requires libnx. */
+#include <stratosphere.hpp>
+#include <haze/results.hpp>
+
+#define HAZE_ASSERT(expr) AMS_ABORT_UNLESS(expr)
+#define HAZE_R_ABORT_UNLESS(res_expr) R_ABORT_UNLESS(res_expr)
+#define HAZE_UNREACHABLE_DEFAULT_CASE() AMS_UNREACHABLE_DEFAULT_CASE()
+
+namespace haze {
+
+    using namespace ::ams::literals;
+    using namespace ::ams;
+
+    using Result = ::ams::Result;
+
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include <haze/ptp_data_builder.hpp>
+#include <haze/ptp_data_parser.hpp>
+#include <haze/ptp_data_pipeline.hpp>
+
+namespace ams {
+
+    namespace {
+
+        /* This matches haze's transfer buffer size. */
+        constexpr u32 BufferSize = 1_MB;
+
+        /* Rough rates for USB 2.0 MTP transfers and SD card accesses. */
+        constexpr u64 UsbBytesPerSecond     = 40_MB;
+        constexpr u64 SdReadBytesPerSecond  = 60_MB;
+        constexpr u64 SdWriteBytesPerSecond = 30_MB;
+
+        /* One transfer ending on a buffer boundary (which needs a zero length packet), and one not. */
+        constexpr u64 TransferSizes[] = { 16_MB - haze::PtpUsbBulkHeaderLength, 16_MB + 0x1234 };
+
+        alignas(os::MemoryPageSize) constinit u8 g_usb_buffer[BufferSize];
+        alignas(os::MemoryPageSize) constinit u8 g_file_system_buffer[BufferSize];
+
+        /* Stands in for a file on the SD card, holding the same data the host sends and expects. */
+        class SimulatedFile {
+            private:
+                u64 m_size;
+                u64 m_written_size;
+                bool m_valid;
+            private:
+                static void Wait(u64 size, u64 bytes_per_second) {
+                    os::SleepThread(TimeSpan::FromNanoSeconds(static_cast<s64>((size * 1'000'000'000) / bytes_per_second)));
+                }
+            public:
+                explicit SimulatedFile(u64 size) : m_size(size), m_written_size(0), m_valid(true) { /* ... */ }
+
+                u64 Read(u64 offset, void *dst, u64 size) {
+                    const u64 read_size = offset < m_size ? std::min(size, m_size - offset) : 0;
+                    Wait(read_size, SdReadBytesPerSecond);
+
+                    for (u64 i = 0; i < read_size; ++i) {
+                        static_cast<u8 *>(dst)[i] = haze::AsyncUsbServer::GetDataByte(offset + i);
+                    }
+                    return read_size;
+                }
+
+                void Write(u64 offset, const void *src, u64 size) {
+                    Wait(size, SdWriteBytesPerSecond);
+
+                    m_valid &= offset == m_written_size;
+                    for (u64 i = 0; i < size; ++i) {
+                        m_valid &= static_cast<const u8 *>(src)[i] == haze::AsyncUsbServer::GetDataByte(offset + i);
+                    }
+                    m_written_size += size;
+                }
+
+                bool IsWrittenDataValid() const { return m_valid && m_written_size == m_size; }
+        };
+
+        struct SendResult {
+            TimeSpan elapsed;
+            size_t zlp_count;
+        };
+
+        constexpr haze::PtpUsbBulkContainer Request = { haze::PtpUsbBulkHeaderLength, haze::PtpUsbBulkContainerType_Command, 0x1009, 0x1234 };
+
+        void CheckHostReceivedData(haze::AsyncUsbServer &server, u64 size) {
+            const auto &header = server.GetHostReceivedHeader();
+            AMS_ABORT_UNLESS(header.length == haze::PtpUsbBulkHeaderLength + size);
+            AMS_ABORT_UNLESS(header.type == haze::PtpUsbBulkContainerType_Data);
+            AMS_ABORT_UNLESS(header.code == Request.code);
+            AMS_ABORT_UNLESS(header.trans_id == Request.trans_id);
+            AMS_ABORT_UNLESS(server.GetHostReceivedSize() == haze::PtpUsbBulkHeaderLength + size);
+            AMS_ABORT_UNLESS(server.IsHostReceivedDataValid());
+        }
+
+        /* Sends a file as haze did before pipelining: read a batch, then send it. */
+        SendResult SendSynchronously(haze::AsyncUsbServer &server, u64 size) {
+            SimulatedFile file(size);
+            haze::PtpUsbBulkContainer request = Request;
+            server.ResetHostReceiveData();
+
+            const auto start = os::GetSystemTick();
+            {
+                haze::PtpDataBuilder db(g_usb_buffer, std::addressof(server));
+                R_ABORT_UNLESS(db.AddDataHeader(request, size));
+
+                u64 offset = 0;
+                while (true) {
+                    const u64 bytes_read = file.Read(offset, g_file_system_buffer, BufferSize);
+                    offset += bytes_read;
+
+                    R_ABORT_UNLESS(db.AddBuffer(g_file_system_buffer, bytes_read));
+                    if (bytes_read < BufferSize) {
+                        break;
+                    }
+                }
+
+                R_ABORT_UNLESS(db.Commit());
+            }
+            const auto elapsed = (os::GetSystemTick() - start).ToTimeSpan();
+
+            CheckHostReceivedData(server, size);
+            return { elapsed, server.GetHostReceivedZeroLengthPacketCount() };
+        }
+
+        SendResult SendPipelined(haze::AsyncUsbServer &server, u64 size) {
+            SimulatedFile file(size);
+            haze::PtpUsbBulkContainer request = Request;
+            server.ResetHostReceiveData();
+
+            const auto start = os::GetSystemTick();
+            {
+                haze::PtpDataPipeline pipeline(std::addressof(server), g_usb_buffer, g_file_system_buffer, BufferSize);
+
+                u64 offset = 0;
+                R_ABORT_UNLESS(pipeline.SendData(request, size, [&](void *dst, u32 read_size, u32 *out_size_read) -> Result {
+                    const u64 bytes_read = file.Read(offset, dst, read_size);
+                    offset += bytes_read;
+
+                    *out_size_read = bytes_read;
+                    R_SUCCEED();
+                }));
+            }
+            const auto elapsed = (os::GetSystemTick() - start).ToTimeSpan();
+
+            CheckHostReceivedData(server, size);
+            return { elapsed, server.GetHostReceivedZeroLengthPacketCount() };
+        }
+
+        void ReadDataHeader(haze::PtpDataParser &dp) {
+            haze::PtpUsbBulkContainer data_header;
+            R_ABORT_UNLESS(dp.Read(std::addressof(data_header)));
+            AMS_ABORT_UNLESS(data_header.type == haze::PtpUsbBulkContainerType_Data);
+        }
+
+        /* Receives a file as haze did before pipelining: receive a batch, then write it. */
+        TimeSpan ReceiveSynchronously(haze::AsyncUsbServer &server, u64 size) {
+            SimulatedFile file(size);
+            server.SetHostSendData({ static_cast<u32>(haze::PtpUsbBulkHeaderLength + size), haze::PtpUsbBulkContainerType_Data, Request.code, Request.trans_id }, size);
+
+            const auto start = os::GetSystemTick();
+            {
+                haze::PtpDataParser dp(g_usb_buffer, std::addressof(server));
+                ReadDataHeader(dp);
+
+                u64 offset = 0;
+                while (true) {
+                    u32 bytes_received;
+                    const Result read_res = dp.ReadBuffer(g_file_system_buffer, BufferSize, std::addressof(bytes_received));
+
+                    file.Write(offset, g_file_system_buffer, bytes_received);
+                    offset += bytes_received;
+
+                    if (haze::ResultEndOfTransmission::Includes(read_res)) {
+                        break;
+                    }
+                    R_ABORT_UNLESS(read_res);
+                }
+            }
+            const auto elapsed = (os::GetSystemTick() - start).ToTimeSpan();
+
+            AMS_ABORT_UNLESS(file.IsWrittenDataValid());
+            return elapsed;
+        }
+
+        TimeSpan ReceivePipelined(haze::AsyncUsbServer &server, u64 size) {
+            SimulatedFile file(size);
+            server.SetHostSendData({ static_cast<u32>(haze::PtpUsbBulkHeaderLength + size), haze::PtpUsbBulkContainerType_Data, Request.code, Request.trans_id }, size);
+
+            const auto start = os::GetSystemTick();
+            {
+                haze::PtpDataParser dp(g_usb_buffer, std::addressof(server));
+                ReadDataHeader(dp);
+
+                haze::PtpDataPipeline pipeline(std::addressof(server), g_usb_buffer, g_file_system_buffer, BufferSize);
+
+                u64 offset = 0;
+                R_ABORT_UNLESS(pipeline.ReceiveData(dp, std::numeric_limits<u64>::max(), [&](const void *src, u32 write_size) -> Result {
+                    file.Write(offset, src, write_size);
+                    offset += write_size;
+                    R_SUCCEED();
+                }));
+            }
+            const auto elapsed = (os::GetSystemTick() - start).ToTimeSpan();
+
+            AMS_ABORT_UNLESS(file.IsWrittenDataValid());
+            return elapsed;
+        }
+
+        s64 GetMegaBytesPerSecondTimes10(u64 size, TimeSpan elapsed) {
+            return static_cast<s64>((size * 10 * 1'000'000) / (static_cast<u64>(std::max<s64>(elapsed.GetMicroSeconds(), 1)) * 1_MB));
+        }
+
+    }
+
+    void Main() {
+        printf("Doing haze transfer benchmarks!\n");
+
+        haze::AsyncUsbServer server(UsbBytesPerSecond);
+
+        for (const u64 size : TransferSizes) {
+            /* Both ways of sending must put the same packets on the wire. */
+            const auto sync_send = SendSynchronously(server, size);
+            const auto pipe_send = SendPipelined(server, size);
+            AMS_ABORT_UNLESS(sync_send.zlp_count == pipe_send.zlp_count);
+
+            const auto sync_receive = ReceiveSynchronously(server, size);
+            const auto pipe_receive = ReceivePipelined(server, size);
+
+            const s64 sync_send_rate    = GetMegaBytesPerSecondTimes10(size, sync_send.elapsed);
+            const s64 pipe_send_rate    = GetMegaBytesPerSecondTimes10(size, pipe_send.elapsed);
+            const s64 sync_receive_rate = GetMegaBytesPerSecondTimes10(size, sync_receive);
+            const s64 pipe_receive_rate = GetMegaBytesPerSecondTimes10(size, pipe_receive);
+
+            printf("%9" PRIu64 " bytes: send %3" PRId64 ".%" PRId64 " -> %3" PRId64 ".%" PRId64 " MB/s, receive %3" PRId64 ".%" PRId64 " -> %3" PRId64 ".%" PRId64 " MB/s\n", size,
+                   sync_send_rate / 10, sync_send_rate % 10, pipe_send_rate / 10, pipe_send_rate % 10,
+                   sync_receive_rate / 10, sync_receive_rate % 10, pipe_receive_rate / 10, pipe_receive_rate % 10);
+        }
+
+        printf("All benchmarks completed!\n");
+    }
+
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace fssrv::impl {
+
+        const char *GetExecutionDirectoryPath();
+
+    }
+
+    namespace {
+
+        struct TestKey {
+            u64 id;
+
+            constexpr bool operator<(const TestKey &rhs) const { return this->id < rhs.id; }
+            constexpr bool operator==(const TestKey &rhs) const { return this->id == rhs.id; }
+        };
+
+        using TestStore = kvdb::MemoryKeyValueStore<TestKey>;
+
+        constexpr size_t StoreCapacity = 0x40;
+        constexpr u64 KeyCount         = 8;
+
+        alignas(os::MemoryPageSize) constinit u8 g_heap[1_MB];
+        mem::StandardAllocator g_allocator;
+        sf::StandardAllocatorMemoryResource g_memory_resource(std::addressof(g_allocator));
+
+        u8 g_file_buffer[64_KB];
+
+        void GetPath(char *dst, size_t dst_size, const char *src) {
+            util::SNPrintf(dst, dst_size, "%s%s", fssrv::impl::GetExecutionDirectoryPath(), src);
+        }
+
+        void ResetDirectory(const char *dir) {
+            fs::DeleteDirectoryRecursively(dir);
+            R_ABORT_UNLESS(fs::CreateDirectory(dir));
+        }
+
+        size_t ReadWholeFile(const char *path) {
+            fs::FileHandle file;
+            R_ABORT_UNLESS(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Read));
+            ON_SCOPE_EXIT { fs::CloseFile(file); };
+
+            s64 size;
+            R_ABORT_UNLESS(fs::GetFileSize(std::addressof(size), file));
+            AMS_ABORT_UNLESS(static_cast<size_t>(size) <= sizeof(g_file_buffer));
+
+            R_ABORT_UNLESS(fs::ReadFile(file, 0, g_file_buffer, static_cast<size_t>(size)));
+            return static_cast<size_t>(size);
+        }
+
+        void WriteWholeFile(const char *path, size_t size) {
+            fs::DeleteFile(path);
+            R_ABORT_UNLESS(fs::CreateFile(path, size));
+
+            fs::FileHandle file;
+            R_ABORT_UNLESS(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Write));
+            ON_SCOPE_EXIT { fs::CloseFile(file); };
+
+            R_ABORT_UNLESS(fs::WriteFile(file, 0, g_file_buffer, size, fs::WriteOption::Flush));
+        }
+
+        TestStore *OpenStore(const char *dir) {
+            auto *store = new TestStore;
+            R_ABORT_UNLESS(store->InitializeWithJournal(dir, StoreCapacity, std::addressof(g_memory_resource)));
+            R_ABORT_UNLESS(store->Load());
+            return store;
+        }
+
+        /* Checks that the store holds exactly the keys in the mask, each with the value version given. */
+        void CheckStore(TestStore *store, u32 key_mask, u64 version) {
+            AMS_ABORT_UNLESS(store->GetCount() == static_cast<size_t>(__builtin_popcount(key_mask)));
+
+            for (u64 i = 0; i < KeyCount; ++i) {
+                u64 value;
+                const Result result = store->GetValue(std::addressof(value), TestKey{i});
+                if ((key_mask & (1u << i)) != 0) {
+                    R_ABORT_UNLESS(result);
+                    AMS_ABORT_UNLESS(value == (i << 32) + version);
+                } else {
+                    AMS_ABORT_UNLESS(kvdb::ResultKeyNotFound::Includes(result));
+                }
+            }
+        }
+
+        void SetKeys(TestStore *store, u32 key_mask, u64 version) {
+            for (u64 i = 0; i < KeyCount; ++i) {
+                if ((key_mask & (1u << i)) != 0) {
+                    R_ABORT_UNLESS(store->Set(TestKey{i}, (i << 32) + version));
+                }
+            }
+        }
+
+        void TestTornBatch(const char *dir) {
+            char log_path[fs::EntryNameLengthMax + 1];
+            util::SNPrintf(log_path, sizeof(log_path), "%s/imkvdb.log", dir);
+            ResetDirectory(dir);
+
+            /* Journal two batches. */
+            {
+                auto *store = OpenStore(dir);
+                ON_SCOPE_EXIT { delete store; };
+
+                SetKeys(store, 0x0F, 1);
+                R_ABORT_UNLESS(store->Save());
+                SetKeys(store, 0x30, 1);
+                R_ABORT_UNLESS(store->Save());
+            }
+
+            /* Tear the last byte off of the second batch, as if the save had been interrupted. */
+            WriteWholeFile(log_path, ReadWholeFile(log_path) - 1);
+
+            /* Only the first batch may be replayed, and the next save must replace the torn batch. */
+            {
+                auto *store = OpenStore(dir);
+                ON_SCOPE_EXIT { delete store; };
+                CheckStore(store, 0x0F, 1);
+
+                SetKeys(store, 0x40, 1);
+                R_ABORT_UNLESS(store->Remove(TestKey{0}));
+                R_ABORT_UNLESS(store->Save());
+            }
+            {
+                auto *store = OpenStore(dir);
+                ON_SCOPE_EXIT { delete store; };
+                CheckStore(store, 0x4E, 1);
+            }
+        }
+
+        void TestInterruptedCompaction(const char *dir) {
+            char arc_path[fs::EntryNameLengthMax + 1];
+            char tmp_path[fs::EntryNameLengthMax + 1];
+            util::SNPrintf(arc_path, sizeof(arc_path), "%s/imkvdb.arc", dir);
+            util::SNPrintf(tmp_path, sizeof(tmp_path), "%s/imkvdb.tmp", dir);
+            ResetDirectory(dir);
+
+            /* Journal some changes, then compact them with something in the way of the archive. */
+            /* The compaction writes the new archive and records it, but fails to rename it into place; this is where a crash after deleting the old archive would leave us. */
+            {
+                auto *store = OpenStore(dir);
+                ON_SCOPE_EXIT { delete store; };
+
+                SetKeys(store, 0x07, 1);
+                R_ABORT_UNLESS(store->Save());
+                SetKeys(store, 0x18, 1);
+
+                R_ABORT_UNLESS(fs::CreateDirectory(arc_path));
+                AMS_ABORT_UNLESS(R_FAILED(store->Save(true)));
+                R_ABORT_UNLESS(fs::DeleteDirectory(arc_path));
+            }
+
+            /* Load must finish the compaction from the recorded temporary archive. */
+            {
+                auto *store = OpenStore(dir);
+                ON_SCOPE_EXIT { delete store; };
+                CheckStore(store, 0x1F, 1);
+
+                fs::DirectoryEntryType entry_type;
+                R_ABORT_UNLESS(fs::GetEntryType(std::addressof(entry_type), arc_path));
+                AMS_ABORT_UNLESS(fs::ResultPathNotFound::Includes(fs::GetEntryType(std::addressof(entry_type), tmp_path)));
+            }
+
+            /* A temporary archive which the journal doesn't record must never be trusted. */
+            {
+                auto *store = OpenStore(dir);
+                ON_SCOPE_EXIT { delete store; };
+
+                SetKeys(store, 0xFF, 3);
+                R_ABORT_UNLESS(store->Save(true));
+            }
+            R_ABORT_UNLESS(fs::RenameFile(arc_path, tmp_path));
+            {
+                auto *store = OpenStore(dir);
+                ON_SCOPE_EXIT { delete store; };
+                CheckStore(store, 0x00, 0);
+            }
+        }
+
+        void TestForeignJournal(const char *dir_a, const char *dir_b) {
+            char log_path_a[fs::EntryNameLengthMax + 1];
+            char log_path_b[fs::EntryNameLengthMax + 1];
+            util::SNPrintf(log_path_a, sizeof(log_path_a), "%s/imkvdb.log", dir_a);
+            util::SNPrintf(log_path_b, sizeof(log_path_b), "%s/imkvdb.log", dir_b);
+            ResetDirectory(dir_a);
+            ResetDirectory(dir_b);
+
+            /* A journal from another store names another archive, so it must be ignored. */
+            {
+                auto *store_a = OpenStore(dir_a);
+                ON_SCOPE_EXIT { delete store_a; };
+                auto *store_b = OpenStore(dir_b);
+                ON_SCOPE_EXIT { delete store_b; };
+
+                SetKeys(store_a, 0xF0, 1);
+                R_ABORT_UNLESS(store_a->Save());
+
+                SetKeys(store_b, 0x0F, 2);
+                R_ABORT_UNLESS(store_b->Save(true));
+            }
+
+            WriteWholeFile(log_path_b, ReadWholeFile(log_path_a));
+            {
+                auto *store = OpenStore(dir_b);
+                ON_SCOPE_EXIT { delete store; };
+                CheckStore(store, 0x0F, 2);
+            }
+
+            /* A stale journal must be ignored even when a compaction leaves the archive's entries as they were. */
+            ResetDirectory(dir_a);
+            size_t stale_log_size;
+            {
+                auto *store = OpenStore(dir_a);
+                ON_SCOPE_EXIT { delete store; };
+
+                SetKeys(store, 0x01, 1);
+                R_ABORT_UNLESS(store->Save(true));
+
+                SetKeys(store, 0x02, 1);
+                R_ABORT_UNLESS(store->Save());
+                stale_log_size = ReadWholeFile(log_path_a);
+
+                R_ABORT_UNLESS(store->Remove(TestKey{1}));
+                R_ABORT_UNLESS(store->Save(true));
+            }
+
+            WriteWholeFile(log_path_a, stale_log_size);
+            {
+                auto *store = OpenStore(dir_a);
+                ON_SCOPE_EXIT { delete store; };
+                CheckStore(store, 0x01, 1);
+            }
+        }
+
+    }
+
+    void Main() {
+        fs::SetEnabledAutoAbort(false);
+        g_allocator.Initialize(g_heap, sizeof(g_heap));
+
+        char root[fs::EntryNameLengthMax + 1];
+        char dir_a[fs::EntryNameLengthMax + 1];
+        char dir_b[fs::EntryNameLengthMax + 1];
+        GetPath(root, sizeof(root), "./kvdb_test");
+        GetPath(dir_a, sizeof(dir_a), "./kvdb_test/a");
+        GetPath(dir_b, sizeof(dir_b), "./kvdb_test/b");
+        ResetDirectory(root);
+
+        printf("Doing kvdb journal tests!\n");
+
+        TestTornBatch(dir_a);
+        printf("Torn batch: ok\n");
+
+        TestInterruptedCompaction(dir_a);
+        printf("Interrupted compaction: ok\n");
+
+        TestForeignJournal(dir_a, dir_b);
+        printf("Foreign journal: ok\n");
+
+        R_ABORT_UNLESS(fs::DeleteDirectoryRecursively(root));
+        printf("All tests completed!\n");
+    }
+
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "lm/srv/lm_log_buffer.hpp"
+
+namespace ams {
+
+    namespace {
+
+        constexpr size_t ProducerCounts[] = { 1, 2, 4, 8 };
+        constexpr size_t ProducerCountMax = ProducerCounts[util::size(ProducerCounts) - 1];
+
+        constexpr size_t MessageCount = 100000;
+        constexpr size_t MessageSize  = 0x80;
+        constexpr size_t BufferSize   = 64_KB;
+
+        constexpr size_t ThreadStackSize = 16_KB;
+
+        struct Message {
+            u32 producer_id;
+            u32 sequence;
+            u8 payload[MessageSize - 2 * sizeof(u32)];
+        };
+        static_assert(sizeof(Message) == MessageSize);
+
+        struct ProducerState {
+            lm::srv::LogBuffer *buffer;
+            u32 producer_id;
+            s64 total_push_ns;
+            s64 max_push_ns;
+        };
+
+        alignas(os::MemoryPageSize) constinit u8 g_log_buffer_storage[BufferSize * 2];
+        alignas(os::MemoryPageSize) constinit u8 g_producer_thread_stacks[ProducerCountMax][ThreadStackSize];
+
+        constinit ProducerState g_producer_states[ProducerCountMax];
+        constinit u32 g_next_sequences[ProducerCountMax];
+        constinit size_t g_flushed_message_count = 0;
+
+        bool CheckAndCountMessages(const u8 *data, size_t size) {
+            /* Pushes are atomic and the flusher sees them in order, so every producer's messages must arrive in sequence. */
+            AMS_ABORT_UNLESS(size % sizeof(Message) == 0);
+
+            for (size_t i = 0; i < size; i += sizeof(Message)) {
+                Message msg;
+                std::memcpy(std::addressof(msg), data + i, sizeof(msg));
+
+                AMS_ABORT_UNLESS(msg.producer_id < ProducerCountMax);
+                AMS_ABORT_UNLESS(msg.sequence == g_next_sequences[msg.producer_id]++);
+                AMS_ABORT_UNLESS(msg.payload[0] == static_cast<u8>(msg.sequence));
+            }
+
+            g_flushed_message_count += size / sizeof(Message);
+            return true;
+        }
+
+        void ProducerThread(void *arg) {
+            auto *state = static_cast<ProducerState *>(arg);
+
+            Message msg = {};
+            msg.producer_id = state->producer_id;
+
+            for (size_t i = 0; i < MessageCount; ++i) {
+                msg.sequence   = i;
+                msg.payload[0] = static_cast<u8>(i);
+
+                const auto start = os::GetSystemTick();
+                AMS_ABORT_UNLESS(state->buffer->Push(std::addressof(msg), sizeof(msg)));
+                const s64 push_ns = (os::GetSystemTick() - start).ToTimeSpan().GetNanoSeconds();
+
+                state->total_push_ns += push_ns;
+                state->max_push_ns    = std::max(state->max_push_ns, push_ns);
+            }
+        }
+
+        void RunBenchmark(size_t producer_count) {
+            /* Reset our state. */
+            std::memset(g_next_sequences, 0, sizeof(g_next_sequences));
+            g_flushed_message_count = 0;
+
+            lm::srv::LogBuffer buffer(g_log_buffer_storage, sizeof(g_log_buffer_storage), CheckAndCountMessages);
+
+            /* Create the producers. */
+            os::ThreadType threads[ProducerCountMax];
+            for (size_t i = 0; i < producer_count; ++i) {
+                g_producer_states[i] = { std::addressof(buffer), static_cast<u32>(i), 0, 0 };
+                R_ABORT_UNLESS(os::CreateThread(threads + i, ProducerThread, g_producer_states + i, g_producer_thread_stacks[i], ThreadStackSize, os::DefaultThreadPriority));
+            }
+
+            /* Run the producers, flushing from this thread. */
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < producer_count; ++i) {
+                os::StartThread(threads + i);
+            }
+
+            const size_t total_message_count = producer_count * MessageCount;
+            while (g_flushed_message_count < total_message_count) {
+                AMS_ABORT_UNLESS(buffer.Flush());
+            }
+
+            const auto elapsed = (os::GetSystemTick() - start).ToTimeSpan();
+
+            /* Clean up the producers, and gather their latencies. */
+            s64 total_push_ns = 0, max_push_ns = 0;
+            for (size_t i = 0; i < producer_count; ++i) {
+                os::WaitThread(threads + i);
+                os::DestroyThread(threads + i);
+
+                total_push_ns += g_producer_states[i].total_push_ns;
+                max_push_ns    = std::max(max_push_ns, g_producer_states[i].max_push_ns);
+            }
+
+            /* Check that nothing was left behind. */
+            AMS_ABORT_UNLESS(!buffer.TryFlush());
+
+            const s64 elapsed_us = std::max<s64>(elapsed.GetMicroSeconds(), 1);
+            printf("%zu producers: %8" PRId64 " messages/ms, push avg %6" PRId64 " ns, push max %8" PRId64 " ns\n", producer_count, static_cast<s64>(total_message_count * 1000) / elapsed_us, total_push_ns / static_cast<s64>(total_message_count), max_push_ns);
+        }
+
+    }
+
+    void Main() {
+        printf("Doing LogBuffer contention benchmarks!\n");
+
+        for (const size_t count : ProducerCounts) {
+            RunBenchmark(count);
+        }
+
+        printf("All benchmarks completed!\n");
+    }
+
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+#if defined(ATMOSPHERE_OS_LINUX)
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#endif
+
+namespace ams {
+
+    #if defined(ATMOSPHERE_OS_LINUX)
+    namespace {
+
+        constexpr size_t HolderCounts[] = { 16, 256, 4096 };
+        constexpr size_t IterationCount = 10000;
+
+        struct BenchmarkState {
+            os::NativeHandle *events;
+            size_t count;
+        };
+
+        void SignalEvent(os::NativeHandle handle) {
+            const u64 value = 1;
+            AMS_ABORT_UNLESS(::write(handle, std::addressof(value), sizeof(value)) == sizeof(value));
+        }
+
+        void ClearEvent(os::NativeHandle handle) {
+            u64 value;
+            AMS_ABORT_UNLESS(::read(handle, std::addressof(value), sizeof(value)) == sizeof(value));
+        }
+
+        /* Chooses the event to signal for an iteration, spreading signals across the whole set. */
+        size_t GetSignaledIndex(size_t iteration, size_t count) {
+            return (iteration * 0x9E3779B1) % count;
+        }
+
+        /* The previous linux multi wait target, which builds a pollfd array for every wait. */
+        TimeSpan BenchmarkPoll(const BenchmarkState &state) {
+            struct pollfd *pfds = new struct pollfd[state.count + 1];
+            ON_SCOPE_EXIT { delete[] pfds; };
+
+            os::NativeHandle cancel_event = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            AMS_ABORT_UNLESS(cancel_event >= 0);
+            ON_SCOPE_EXIT { ::close(cancel_event); };
+
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < IterationCount; ++i) {
+                const size_t signaled = GetSignaledIndex(i, state.count);
+                SignalEvent(state.events[signaled]);
+
+                for (size_t j = 0; j < state.count; ++j) {
+                    pfds[j].fd      = state.events[j];
+                    pfds[j].events  = POLLIN;
+                    pfds[j].revents = 0;
+                }
+                pfds[state.count].fd      = cancel_event;
+                pfds[state.count].events  = POLLIN;
+                pfds[state.count].revents = 0;
+
+                AMS_ABORT_UNLESS(::ppoll(pfds, state.count + 1, nullptr, nullptr) == 1);
+
+                size_t index = 0;
+                while (pfds[index].revents == 0) {
+                    ++index;
+                }
+                AMS_ABORT_UNLESS(index == signaled);
+
+                ClearEvent(state.events[index]);
+            }
+
+            return (os::GetSystemTick() - start).ToTimeSpan();
+        }
+
+        TimeSpan BenchmarkMultiWait(const BenchmarkState &state) {
+            os::MultiWaitType multi_wait;
+            os::InitializeMultiWait(std::addressof(multi_wait));
+            ON_SCOPE_EXIT { os::FinalizeMultiWait(std::addressof(multi_wait)); };
+
+            os::MultiWaitHolderType *holders = new os::MultiWaitHolderType[state.count];
+            ON_SCOPE_EXIT { delete[] holders; };
+
+            for (size_t i = 0; i < state.count; ++i) {
+                os::InitializeMultiWaitHolder(holders + i, state.events[i]);
+                os::SetMultiWaitHolderUserData(holders + i, i);
+                os::LinkMultiWaitHolder(std::addressof(multi_wait), holders + i);
+            }
+            ON_SCOPE_EXIT {
+                os::UnlinkAllMultiWaitHolder(std::addressof(multi_wait));
+                for (size_t i = 0; i < state.count; ++i) {
+                    os::FinalizeMultiWaitHolder(holders + i);
+                }
+            };
+
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < IterationCount; ++i) {
+                const size_t signaled = GetSignaledIndex(i, state.count);
+                SignalEvent(state.events[signaled]);
+
+                auto *holder = os::WaitAny(std::addressof(multi_wait));
+                AMS_ABORT_UNLESS(os::GetMultiWaitHolderUserData(holder) == signaled);
+
+                ClearEvent(state.events[signaled]);
+            }
+
+            return (os::GetSystemTick() - start).ToTimeSpan();
+        }
+
+        /* Two holders for the same handle must both be linkable, and each must stay waitable while the other is unlinked. */
+        void TestSharedHandle() {
+            os::NativeHandle event = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            AMS_ABORT_UNLESS(event >= 0);
+            ON_SCOPE_EXIT { ::close(event); };
+
+            os::MultiWaitType multi_wait;
+            os::InitializeMultiWait(std::addressof(multi_wait));
+            ON_SCOPE_EXIT { os::FinalizeMultiWait(std::addressof(multi_wait)); };
+
+            os::MultiWaitHolderType holders[2];
+            for (size_t i = 0; i < util::size(holders); ++i) {
+                os::InitializeMultiWaitHolder(holders + i, event);
+                os::SetMultiWaitHolderUserData(holders + i, i);
+                os::LinkMultiWaitHolder(std::addressof(multi_wait), holders + i);
+            }
+
+            SignalEvent(event);
+
+            /* Unlink whichever holder is reported first; the other must still be reported. */
+            auto *first = os::WaitAny(std::addressof(multi_wait));
+            os::UnlinkMultiWaitHolder(first);
+
+            auto *second = os::WaitAny(std::addressof(multi_wait));
+            AMS_ABORT_UNLESS(os::GetMultiWaitHolderUserData(first) != os::GetMultiWaitHolderUserData(second));
+            os::UnlinkMultiWaitHolder(second);
+
+            ClearEvent(event);
+
+            for (size_t i = 0; i < util::size(holders); ++i) {
+                os::FinalizeMultiWaitHolder(holders + i);
+            }
+
+            printf("Shared handle: ok\n");
+        }
+
+        /* Once a holder sharing a handle is unlinked and freed, signaling the handle must only ever report the holder which remains. */
+        void TestUnlinkedSharedHandle() {
+            os::NativeHandle event = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            AMS_ABORT_UNLESS(event >= 0);
+            ON_SCOPE_EXIT { ::close(event); };
+
+            os::MultiWaitType multi_wait;
+            os::InitializeMultiWait(std::addressof(multi_wait));
+            ON_SCOPE_EXIT { os::FinalizeMultiWait(std::addressof(multi_wait)); };
+
+            os::MultiWaitHolderType holder;
+            os::InitializeMultiWaitHolder(std::addressof(holder), event);
+            os::LinkMultiWaitHolder(std::addressof(multi_wait), std::addressof(holder));
+            ON_SCOPE_EXIT {
+                os::UnlinkMultiWaitHolder(std::addressof(holder));
+                os::FinalizeMultiWaitHolder(std::addressof(holder));
+            };
+
+            /* The second holder is registered with a duplicate of the handle. */
+            os::MultiWaitHolderType *freed = new os::MultiWaitHolderType;
+            os::InitializeMultiWaitHolder(freed, event);
+            os::LinkMultiWaitHolder(std::addressof(multi_wait), freed);
+            os::UnlinkMultiWaitHolder(freed);
+            os::FinalizeMultiWaitHolder(freed);
+            delete freed;
+
+            SignalEvent(event);
+
+            /* The handle stays signaled, so every wait must report it, and only through the holder which remains. */
+            for (size_t i = 0; i < 4; ++i) {
+                AMS_ABORT_UNLESS(os::WaitAny(std::addressof(multi_wait)) == std::addressof(holder));
+            }
+
+            ClearEvent(event);
+
+            printf("Unlinked shared handle: ok\n");
+        }
+
+        /* Timed waits must not return before their timeout, even when it isn't a whole number of milliseconds. */
+        void TestSubMillisecondTimeout() {
+            os::NativeHandle event = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            AMS_ABORT_UNLESS(event >= 0);
+            ON_SCOPE_EXIT { ::close(event); };
+
+            os::MultiWaitType multi_wait;
+            os::InitializeMultiWait(std::addressof(multi_wait));
+            ON_SCOPE_EXIT { os::FinalizeMultiWait(std::addressof(multi_wait)); };
+
+            os::MultiWaitHolderType holder;
+            os::InitializeMultiWaitHolder(std::addressof(holder), event);
+            os::LinkMultiWaitHolder(std::addressof(multi_wait), std::addressof(holder));
+            ON_SCOPE_EXIT {
+                os::UnlinkMultiWaitHolder(std::addressof(holder));
+                os::FinalizeMultiWaitHolder(std::addressof(holder));
+            };
+
+            constexpr TimeSpan Timeouts[] = { TimeSpan::FromMicroSeconds(100), TimeSpan::FromMicroSeconds(1500), TimeSpan::FromMilliSeconds(2) };
+            for (const auto timeout : Timeouts) {
+                const auto start = os::GetSystemTick();
+                AMS_ABORT_UNLESS(os::TimedWaitAny(std::addressof(multi_wait), timeout) == nullptr);
+                const auto elapsed = (os::GetSystemTick() - start).ToTimeSpan();
+
+                AMS_ABORT_UNLESS(elapsed >= timeout);
+                printf("Timed wait of %6" PRId64 " ns: waited %8" PRId64 " ns\n", timeout.GetNanoSeconds(), elapsed.GetNanoSeconds());
+            }
+        }
+
+        void RaiseFileDescriptorLimit(size_t count) {
+            struct rlimit limit;
+            AMS_ABORT_UNLESS(::getrlimit(RLIMIT_NOFILE, std::addressof(limit)) == 0);
+
+            /* We need one descriptor per holder, plus some slack for the multi wait and standard streams. */
+            const rlim_t needed = count + 0x40;
+            if (limit.rlim_cur < needed) {
+                limit.rlim_cur = std::min(needed, limit.rlim_max);
+                AMS_ABORT_UNLESS(::setrlimit(RLIMIT_NOFILE, std::addressof(limit)) == 0);
+            }
+        }
+
+    }
+    #endif
+
+    void Main() {
+        #if defined(ATMOSPHERE_OS_LINUX)
+        TestSharedHandle();
+        TestUnlinkedSharedHandle();
+        TestSubMillisecondTimeout();
+
+        printf("Doing OS MultiWait benchmarks!\n");
+
+        RaiseFileDescriptorLimit(HolderCounts[util::size(HolderCounts) - 1]);
+
+        for (const size_t count : HolderCounts) {
+            /* Create the events. */
+            os::NativeHandle *events = new os::NativeHandle[count];
+            ON_SCOPE_EXIT { delete[] events; };
+
+            for (size_t i = 0; i < count; ++i) {
+                events[i] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                AMS_ABORT_UNLESS(events[i] >= 0);
+            }
+            ON_SCOPE_EXIT {
+                for (size_t i = 0; i < count; ++i) {
+                    ::close(events[i]);
+                }
+            };
+
+            const BenchmarkState state = { events, count };
+
+            const auto poll_time       = BenchmarkPoll(state);
+            const auto multi_wait_time = BenchmarkMultiWait(state);
+
+            printf("%5zu holders: poll %8" PRId64 " ns/wait, multi wait %8" PRId64 " ns/wait\n", count, poll_time.GetNanoSeconds() / static_cast<s64>(IterationCount), multi_wait_time.GetNanoSeconds() / static_cast<s64>(IterationCount));
+        }
+
+        printf("All benchmarks completed!\n");
+        #else
+        printf("OS MultiWait benchmarks are only supported on linux.\n");
+        #endif
+    }
+
+}
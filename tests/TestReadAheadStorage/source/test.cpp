@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        constexpr size_t DataSize            = 8_MB;
+        constexpr size_t ReadSize            = 16_KB;
+        constexpr size_t RandomReadCount     = 0x400;
+        constexpr s32 FinalizeRunCount       = 0x20;
+
+        /* Roughly the latency and bandwidth of a game card. */
+        constexpr auto ReadLatency           = TimeSpan::FromMicroSeconds(200);
+        constexpr size_t BytesPerMicroSecond = 100;
+
+        /* The time an application spends on the data between reads. */
+        constexpr auto ProcessingTime        = TimeSpan::FromMicroSeconds(150);
+
+        alignas(os::ThreadStackAlignment) constinit u8 g_worker_stack[fssystem::ReadAheadWorkerStackSize];
+        alignas(os::MemoryPageSize) constinit u8 g_worker_buffer[fssystem::ReadAheadBufferSize];
+
+        constinit u8 g_data[DataSize];
+        constinit u8 g_expected[DataSize];
+        constinit u8 g_read_buffer[DataSize];
+
+        /* A memory storage which is as slow as real media, and which tracks who reads from it. */
+        class SlowStorage : public fs::MemoryStorage {
+            private:
+                os::ThreadType *m_main_thread;
+                std::atomic<s32> m_reading_count;
+                std::atomic<size_t> m_worker_read_count;
+            public:
+                SlowStorage(void *b, s64 sz) : MemoryStorage(b, sz), m_main_thread(os::GetCurrentThread()), m_reading_count(0), m_worker_read_count(0) { /* ... */ }
+
+                virtual Result Read(s64 offset, void *buffer, size_t size) override {
+                    ++m_reading_count;
+                    ON_SCOPE_EXIT { --m_reading_count; };
+
+                    if (os::GetCurrentThread() != m_main_thread) {
+                        ++m_worker_read_count;
+                    }
+
+                    os::SleepThread(ReadLatency + TimeSpan::FromMicroSeconds(static_cast<s64>(size / BytesPerMicroSecond)));
+                    R_RETURN(MemoryStorage::Read(offset, buffer, size));
+                }
+
+                s32 GetReadingCount() const { return m_reading_count; }
+
+                size_t GetWorkerReadCount() const { return m_worker_read_count; }
+                void ClearWorkerReadCount() { m_worker_read_count = 0; }
+        };
+
+        u64 GetRandom(u64 &seed) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return seed;
+        }
+
+        void GenerateData() {
+            u64 seed = 0x9E3779B97F4A7C15;
+            for (size_t i = 0; i < DataSize; i += sizeof(u64)) {
+                const u64 value = GetRandom(seed);
+                std::memcpy(g_data + i, std::addressof(value), sizeof(value));
+            }
+            std::memcpy(g_expected, g_data, DataSize);
+        }
+
+        void ReadAndVerify(fs::IStorage &storage, s64 offset, size_t size) {
+            R_ABORT_UNLESS(storage.Read(offset, g_read_buffer, size));
+            AMS_ABORT_UNLESS(std::memcmp(g_read_buffer, g_expected + offset, size) == 0);
+        }
+
+        TimeSpan ReadSequentially(fs::IStorage &storage) {
+            const auto start = os::GetSystemTick();
+            for (size_t offset = 0; offset < DataSize; offset += ReadSize) {
+                ReadAndVerify(storage, offset, ReadSize);
+                os::SleepThread(ProcessingTime);
+            }
+            return (os::GetSystemTick() - start).ToTimeSpan();
+        }
+
+        s64 GetMegaBytesPerSecond(size_t bytes, TimeSpan elapsed) {
+            return static_cast<s64>((bytes * 1'000'000) / std::max<s64>(elapsed.GetMicroSeconds(), 1)) / 1_MB;
+        }
+
+        void TestSequential(std::shared_ptr<SlowStorage> base) {
+            /* Read straight from the base, then through the read-ahead storage. */
+            const auto direct_time = ReadSequentially(*base);
+
+            fssystem::ReadAheadStorage storage;
+            R_ABORT_UNLESS(storage.Initialize(base));
+
+            base->ClearWorkerReadCount();
+            const auto read_ahead_time = ReadSequentially(storage);
+
+            /* The worker must have done the reading. */
+            AMS_ABORT_UNLESS(base->GetWorkerReadCount() > 0);
+
+            printf("Sequential %zu KB reads: direct %" PRId64 " MB/s, read-ahead %" PRId64 " MB/s\n", ReadSize / 1_KB, GetMegaBytesPerSecond(DataSize, direct_time), GetMegaBytesPerSecond(DataSize, read_ahead_time));
+        }
+
+        void TestRandom(std::shared_ptr<SlowStorage> base) {
+            fssystem::ReadAheadStorage storage;
+            R_ABORT_UNLESS(storage.Initialize(base));
+
+            /* Random reads of random sizes must be served correctly, whether or not they happen to continue a stream. */
+            u64 seed = 0x2545F4914F6CDD1D;
+            for (size_t i = 0; i < RandomReadCount; ++i) {
+                const size_t size = 1 + GetRandom(seed) % (2 * ReadSize);
+                const s64 offset  = GetRandom(seed) % (DataSize - size);
+                ReadAndVerify(storage, offset, size);
+
+                /* Now and then, continue the read for a while so that reading ahead starts. */
+                if ((i % 0x10) == 0) {
+                    for (s64 cur = offset + size; cur + static_cast<s64>(ReadSize) <= static_cast<s64>(DataSize) && cur < offset + static_cast<s64>(8 * ReadSize); cur += ReadSize) {
+                        ReadAndVerify(storage, cur, ReadSize);
+                    }
+                }
+            }
+        }
+
+        void TestCancel(std::shared_ptr<SlowStorage> base) {
+            fssystem::ReadAheadStorage storage;
+            R_ABORT_UNLESS(storage.Initialize(base));
+
+            /* Alternate between two sets of as many streams as the storage tracks, so that streams which are reading ahead are replaced and their requests cancelled. */
+            constexpr s32 StreamCount   = 2 * fssystem::ReadAheadStorage::StreamCountMax;
+            constexpr size_t StreamSize = DataSize / StreamCount;
+            constexpr size_t BurstSize  = 4 * ReadSize;
+            for (size_t round = 0; (round + 1) * BurstSize <= StreamSize; ++round) {
+                const s32 first = (round % 2) * fssystem::ReadAheadStorage::StreamCountMax;
+                for (s32 i = first; i < first + fssystem::ReadAheadStorage::StreamCountMax; ++i) {
+                    for (size_t cur = 0; cur < BurstSize; cur += ReadSize) {
+                        ReadAndVerify(storage, i * StreamSize + round * BurstSize + cur, ReadSize);
+                    }
+                }
+            }
+
+            /* Read a stream until it reads ahead, then change the data it has read ahead. */
+            for (size_t offset = 0; offset < 8 * ReadSize; offset += ReadSize) {
+                ReadAndVerify(storage, offset, ReadSize);
+            }
+            for (size_t i = 0; i < 16 * ReadSize; ++i) {
+                g_expected[8 * ReadSize + i] ^= 0xFF;
+            }
+            R_ABORT_UNLESS(storage.Write(8 * ReadSize, g_expected + 8 * ReadSize, 16 * ReadSize));
+
+            /* The stream must see the new data, not what it read ahead. */
+            for (size_t offset = 8 * ReadSize; offset < 32 * ReadSize; offset += ReadSize) {
+                ReadAndVerify(storage, offset, ReadSize);
+            }
+        }
+
+        void TestAbandon(std::shared_ptr<SlowStorage> base) {
+            /* Start streams on many storages and leave them without ever reading what they've read ahead, as an application which stops reading does. */
+            constexpr s32 AbandonedCount = 8;
+            std::unique_ptr<fssystem::ReadAheadStorage> abandoned[AbandonedCount];
+            for (s32 i = 0; i < AbandonedCount; ++i) {
+                abandoned[i] = std::make_unique<fssystem::ReadAheadStorage>();
+                R_ABORT_UNLESS(abandoned[i]->Initialize(base));
+
+                for (size_t offset = 0; offset < 16 * ReadSize; offset += ReadSize) {
+                    ReadAndVerify(*abandoned[i], i * (DataSize / AbandonedCount) + offset, ReadSize);
+                }
+            }
+
+            /* Let the worker finish reading for them, so that their data holds the buffer. */
+            os::SleepThread(TimeSpan::FromMilliSeconds(100));
+            base->ClearWorkerReadCount();
+
+            /* A new stream must still be read ahead for, by reclaiming the abandoned data. */
+            fssystem::ReadAheadStorage storage;
+            R_ABORT_UNLESS(storage.Initialize(base));
+
+            for (size_t offset = 0; offset < 64 * ReadSize; offset += ReadSize) {
+                ReadAndVerify(storage, offset, ReadSize);
+            }
+            AMS_ABORT_UNLESS(base->GetWorkerReadCount() > 0);
+
+            /* The abandoned streams must read correctly whether or not their data was reclaimed. */
+            for (s32 i = 0; i < AbandonedCount; ++i) {
+                for (size_t offset = 16 * ReadSize; offset < 32 * ReadSize; offset += ReadSize) {
+                    ReadAndVerify(*abandoned[i], i * (DataSize / AbandonedCount) + offset, ReadSize);
+                }
+            }
+        }
+
+        void TestFinalize(std::shared_ptr<SlowStorage> base) {
+            /* Finalize at different points in a stream, so that requests are queued, being read, and ready. */
+            for (s32 i = 0; i < FinalizeRunCount; ++i) {
+                fssystem::ReadAheadStorage storage;
+                R_ABORT_UNLESS(storage.Initialize(base));
+
+                for (s32 j = 0; j < 2 + (i % 8); ++j) {
+                    ReadAndVerify(storage, j * ReadSize, ReadSize);
+                }
+                if ((i % 2) != 0) {
+                    os::SleepThread(TimeSpan::FromMicroSeconds(ReadLatency.GetMicroSeconds() * (i % 4)));
+                }
+
+                storage.Finalize();
+
+                /* Once finalized, the worker must be done with our base. */
+                AMS_ABORT_UNLESS(base->GetReadingCount() == 0);
+                AMS_ABORT_UNLESS(base.use_count() == 2);
+            }
+
+            /* Everything the finalized storages read ahead must have been freed, so a new storage can still read ahead. */
+            base->ClearWorkerReadCount();
+            {
+                fssystem::ReadAheadStorage storage;
+                R_ABORT_UNLESS(storage.Initialize(base));
+
+                for (size_t offset = 0; offset < 64 * ReadSize; offset += ReadSize) {
+                    ReadAndVerify(storage, offset, ReadSize);
+                }
+            }
+            AMS_ABORT_UNLESS(base->GetWorkerReadCount() > 0);
+        }
+
+    }
+
+    void Main() {
+        printf("Doing read-ahead storage tests!\n");
+
+        GenerateData();
+        auto base = std::make_shared<SlowStorage>(g_data, DataSize);
+
+        /* Without the worker, reads must pass straight through. */
+        {
+            fssystem::ReadAheadStorage storage;
+            R_ABORT_UNLESS(storage.Initialize(base));
+            AMS_ABORT_UNLESS(!fssystem::IsReadAheadWorkerEnabled());
+
+            for (size_t offset = 0; offset < 16 * ReadSize; offset += ReadSize) {
+                ReadAndVerify(storage, offset, ReadSize);
+            }
+            AMS_ABORT_UNLESS(base->GetWorkerReadCount() == 0);
+        }
+
+        fssystem::InitializeReadAheadWorker(g_worker_stack, sizeof(g_worker_stack), g_worker_buffer, sizeof(g_worker_buffer), os::DefaultThreadPriority);
+        AMS_ABORT_UNLESS(fssystem::IsReadAheadWorkerEnabled());
+
+        TestSequential(base);
+        printf("Sequential: ok\n");
+
+        TestRandom(base);
+        printf("Random: ok\n");
+
+        TestCancel(base);
+        printf("Cancel: ok\n");
+
+        TestAbandon(base);
+        printf("Abandon: ok\n");
+
+        TestFinalize(base);
+        printf("Finalize: ok\n");
+
+        printf("All tests completed!\n");
+    }
+
+}
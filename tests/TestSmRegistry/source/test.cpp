@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "impl/sm_index_table.hpp"
+
+namespace ams {
+
+    namespace {
+
+        /* These match the limits in sm_service_manager.cpp. */
+        constexpr size_t ProcessCountMax = 0x50;
+        constexpr size_t ServiceCountMax = 0x180;
+        constexpr size_t MitmCountMax    = 0x20;
+
+        constexpr size_t ProcessCount       = 0x40;
+        constexpr size_t ServiceCount       = 0x150;
+        constexpr size_t LookupsPerProcess  = 0x20;
+        constexpr size_t ReplayCount        = 1000;
+        constexpr u64 ProcessIdBase         = 0x50;
+
+        /* Services which most processes connect to during boot. */
+        constexpr const char *CommonServiceNames[] = {
+            "fsp-srv", "set:sys", "set", "lm", "time:s", "pm:info", "psc:m", "apm", "hid", "ldr:ro",
+            "spl:", "ncm", "lr", "fatal:u", "erpt:c", "bsd:s", "nifm:s", "pcv", "i2c", "gpio",
+        };
+
+        enum RequestType {
+            RequestType_RegisterProcess,
+            RequestType_RegisterService,
+            RequestType_GetServiceHandle,
+        };
+
+        struct Request {
+            RequestType type;
+            os::ProcessId process_id;
+            sm::ServiceName service;
+        };
+
+        constexpr size_t RequestCountMax = ProcessCount * (1 + LookupsPerProcess) + ServiceCount;
+
+        constinit Request g_requests[RequestCountMax];
+        constinit size_t g_request_count = 0;
+
+        sm::ServiceName GetServiceName(size_t index) {
+            if (index < util::size(CommonServiceNames)) {
+                return sm::ServiceName::Encode(CommonServiceNames[index]);
+            } else {
+                char name[sm::ServiceName::MaxLength + 1];
+                util::SNPrintf(name, sizeof(name), "svc:%03zx", index);
+                return sm::ServiceName::Encode(name);
+            }
+        }
+
+        /* Builds a trace shaped like boot: each process is registered, registers its own services, then connects to a burst of others. */
+        void BuildBootTrace() {
+            u64 seed = 0x9E3779B97F4A7C15;
+            auto next_random = [&]() -> u64 {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                return seed;
+            };
+
+            size_t registered = 0;
+            for (size_t i = 0; i < ProcessCount; ++i) {
+                const os::ProcessId process_id = { ProcessIdBase + i };
+                g_requests[g_request_count++] = { RequestType_RegisterProcess, process_id, sm::InvalidServiceName };
+
+                const size_t end = ((i + 1) * ServiceCount) / ProcessCount;
+                for (/* ... */; registered < end; ++registered) {
+                    g_requests[g_request_count++] = { RequestType_RegisterService, process_id, GetServiceName(registered) };
+                }
+
+                /* Half of the lookups go to the common services, the rest to anything registered so far. */
+                for (size_t j = 0; j < LookupsPerProcess; ++j) {
+                    const size_t index = (j % 2) == 0 ? next_random() % std::min(registered, util::size(CommonServiceNames)) : next_random() % registered;
+                    g_requests[g_request_count++] = { RequestType_GetServiceHandle, process_id, GetServiceName(index) };
+                }
+            }
+        }
+
+        /* The previous registry, which scans fixed arrays for every lookup. */
+        class LinearRegistry {
+            private:
+                os::ProcessId m_processes[ProcessCountMax];
+                sm::ServiceName m_services[ServiceCountMax];
+                sm::ServiceName m_future_mitms[MitmCountMax];
+            private:
+                template<typename T, size_t N>
+                static T *Find(T (&list)[N], const T &key) {
+                    for (auto &entry : list) {
+                        if (entry == key) {
+                            return std::addressof(entry);
+                        }
+                    }
+                    return nullptr;
+                }
+            public:
+                LinearRegistry() {
+                    std::fill(std::begin(m_processes), std::end(m_processes), os::InvalidProcessId);
+                    std::fill(std::begin(m_services), std::end(m_services), sm::InvalidServiceName);
+                    std::fill(std::begin(m_future_mitms), std::end(m_future_mitms), sm::InvalidServiceName);
+                }
+
+                bool RegisterProcess(os::ProcessId process_id) {
+                    auto *entry = Find(m_processes, os::InvalidProcessId);
+                    if (entry == nullptr) {
+                        return false;
+                    }
+                    *entry = process_id;
+                    return true;
+                }
+
+                bool RegisterService(os::ProcessId process_id, sm::ServiceName service) {
+                    if (Find(m_processes, process_id) == nullptr || Find(m_services, service) != nullptr) {
+                        return false;
+                    }
+
+                    auto *entry = Find(m_services, sm::InvalidServiceName);
+                    if (entry == nullptr) {
+                        return false;
+                    }
+                    *entry = service;
+                    return true;
+                }
+
+                bool GetServiceHandle(os::ProcessId process_id, sm::ServiceName service) {
+                    return Find(m_processes, process_id) != nullptr && Find(m_services, service) != nullptr && Find(m_future_mitms, service) == nullptr;
+                }
+        };
+
+        /* The current registry, which indexes by key. */
+        class HashedRegistry {
+            private:
+                sm::impl::IndexTable<os::ProcessId, ProcessCountMax> m_processes;
+                sm::impl::IndexTable<sm::ServiceName, ServiceCountMax> m_services;
+                sm::impl::IndexTable<sm::ServiceName, MitmCountMax> m_future_mitms;
+            public:
+                bool RegisterProcess(os::ProcessId process_id) {
+                    return m_processes.Insert(process_id) != m_processes.InvalidIndex;
+                }
+
+                bool RegisterService(os::ProcessId process_id, sm::ServiceName service) {
+                    if (!m_processes.Contains(process_id) || m_services.Contains(service)) {
+                        return false;
+                    }
+                    return m_services.Insert(service) != m_services.InvalidIndex;
+                }
+
+                bool GetServiceHandle(os::ProcessId process_id, sm::ServiceName service) {
+                    return m_processes.Contains(process_id) && m_services.Contains(service) && !m_future_mitms.Contains(service);
+                }
+        };
+
+        template<typename Registry>
+        TimeSpan ReplayBootTrace(size_t *out_successes) {
+            size_t successes = 0;
+
+            const auto start = os::GetSystemTick();
+            for (size_t i = 0; i < ReplayCount; ++i) {
+                auto *registry = new Registry;
+                ON_SCOPE_EXIT { delete registry; };
+
+                for (size_t j = 0; j < g_request_count; ++j) {
+                    const auto &request = g_requests[j];
+                    switch (request.type) {
+                        case RequestType_RegisterProcess:  successes += registry->RegisterProcess(request.process_id);                    break;
+                        case RequestType_RegisterService:  successes += registry->RegisterService(request.process_id, request.service);   break;
+                        case RequestType_GetServiceHandle: successes += registry->GetServiceHandle(request.process_id, request.service);  break;
+                    }
+                }
+            }
+            const auto elapsed = (os::GetSystemTick() - start).ToTimeSpan();
+
+            *out_successes = successes;
+            return elapsed;
+        }
+
+        void TestIndexTableRemove() {
+            /* Fill the table, then remove every other key, and check that the rest can still be found. */
+            auto *table = new sm::impl::IndexTable<sm::ServiceName, ServiceCountMax>;
+            ON_SCOPE_EXIT { delete table; };
+
+            u16 indices[ServiceCountMax];
+            for (size_t i = 0; i < ServiceCountMax; ++i) {
+                indices[i] = table->Insert(GetServiceName(i));
+                AMS_ABORT_UNLESS(indices[i] != table->InvalidIndex);
+            }
+            AMS_ABORT_UNLESS(table->IsFull());
+            AMS_ABORT_UNLESS(table->Insert(GetServiceName(ServiceCountMax)) == table->InvalidIndex);
+
+            for (size_t i = 0; i < ServiceCountMax; i += 2) {
+                table->Remove(GetServiceName(i));
+            }
+            for (size_t i = 0; i < ServiceCountMax; ++i) {
+                AMS_ABORT_UNLESS(table->Find(GetServiceName(i)) == ((i % 2) == 0 ? table->InvalidIndex : indices[i]));
+            }
+
+            /* Keys which are present must not be inserted twice. */
+            AMS_ABORT_UNLESS(table->Insert(GetServiceName(1)) == table->InvalidIndex);
+
+            /* Freed indices must be handed out again. */
+            for (size_t i = 0; i < ServiceCountMax; i += 2) {
+                AMS_ABORT_UNLESS(table->Insert(GetServiceName(i)) != table->InvalidIndex);
+            }
+            AMS_ABORT_UNLESS(table->IsFull());
+        }
+
+    }
+
+    void Main() {
+        printf("Doing sm registry benchmarks!\n");
+
+        TestIndexTableRemove();
+
+        BuildBootTrace();
+
+        size_t linear_successes, hashed_successes;
+        const auto linear_time = ReplayBootTrace<LinearRegistry>(std::addressof(linear_successes));
+        const auto hashed_time = ReplayBootTrace<HashedRegistry>(std::addressof(hashed_successes));
+
+        /* Both registries must make the same decisions. */
+        AMS_ABORT_UNLESS(linear_successes == hashed_successes);
+        AMS_ABORT_UNLESS(linear_successes == ReplayCount * g_request_count);
+
+        const s64 total_requests = static_cast<s64>(ReplayCount * g_request_count);
+        printf("%zu requests per boot: linear %5" PRId64 " ns/request, hashed %5" PRId64 " ns/request\n", g_request_count, linear_time.GetNanoSeconds() / total_requests, hashed_time.GetNanoSeconds() / total_requests);
+
+        printf("All benchmarks completed!\n");
+    }
+
+}
@@ -31,6 +31,11 @@ namespace haze {
         private:
             Result TransferPacketImpl(bool read, void *page, u32 size, u32 *out_size_transferred) const;
         public:
+            /* Begins a transfer, which may run while we do other work until it is ended. */
+            /* Only one transfer may be in progress at a time. */
+            Result BeginTransferPacket(bool read, void *page, u32 size, u32 *out_urb_id) const;
+            Result EndTransferPacket(bool read, u32 urb_id, u32 *out_size_transferred) const;
+
             Result ReadPacket(void *page, u32 size, u32 *out_size_transferred) const {
                 R_RETURN(this->TransferPacketImpl(true, page, size, out_size_transferred));
             }
@@ -56,6 +56,15 @@ namespace haze {
                 }
             }
 
+            /* Hands the data we've received but not yet read to the caller, who takes over reading the transmission. */
+            void TakeReceivedData(const u8 **out_data, u32 *out_size, bool *out_eot) {
+                *out_data = m_data + m_offset;
+                *out_size = m_received_size - m_offset;
+                *out_eot  = m_eot;
+
+                m_offset = m_received_size;
+            }
+
             Result ReadBuffer(u8 *buffer, u32 count, u32 *out_read_count) {
                 *out_read_count = 0;
 
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <haze/async_usb_server.hpp>
+#include <haze/common.hpp>
+#include <haze/ptp.hpp>
+#include <haze/ptp_data_parser.hpp>
+
+namespace haze {
+
+    /* Streams a data phase between the filesystem and USB, alternating between two buffers */
+    /* so that filesystem I/O on one buffer overlaps with the USB transfer of the other. */
+    class PtpDataPipeline final {
+        private:
+            static constexpr size_t BufferCount = 2;
+        private:
+            AsyncUsbServer *m_server;
+            u8 *m_buffers[BufferCount];
+            u32 m_buffer_size;
+            u32 m_urb_id;
+            bool m_pending;
+            bool m_pending_read;
+        private:
+            Result BeginTransfer(bool read, void *buffer, u32 size) {
+                HAZE_ASSERT(!m_pending);
+
+                R_TRY(m_server->BeginTransferPacket(read, buffer, size, std::addressof(m_urb_id)));
+
+                m_pending      = true;
+                m_pending_read = read;
+                R_SUCCEED();
+            }
+
+            Result EndTransfer(u32 *out_size_transferred) {
+                HAZE_ASSERT(m_pending);
+
+                m_pending = false;
+                R_RETURN(m_server->EndTransferPacket(m_pending_read, m_urb_id, out_size_transferred));
+            }
+
+            void EndPendingTransfer() {
+                /* A buffer can't be reused until the transfer using it has ended, so on failure, end it regardless. */
+                if (m_pending) {
+                    u32 size_transferred;
+                    this->EndTransfer(std::addressof(size_transferred));
+                }
+            }
+        public:
+            constexpr explicit PtpDataPipeline(AsyncUsbServer *server, void *buffer0, void *buffer1, u32 buffer_size) : m_server(server), m_buffers{static_cast<u8 *>(buffer0), static_cast<u8 *>(buffer1)}, m_buffer_size(buffer_size), m_urb_id(), m_pending(), m_pending_read() { /* ... */ }
+
+            /* Sends a data container declaring data_size bytes of data, as produced by read_func(dst, size, out_read_size). */
+            /* The data ends when read_func produces fewer bytes than were asked for. */
+            template <typename F>
+            Result SendData(PtpUsbBulkContainer &request, u32 data_size, F &&read_func) {
+                ON_RESULT_FAILURE { this->EndPendingTransfer(); };
+
+                /* The first packet begins with the container header. */
+                const PtpUsbBulkContainer header = {
+                    .length   = PtpUsbBulkHeaderLength + data_size,
+                    .type     = PtpUsbBulkContainerType_Data,
+                    .code     = request.code,
+                    .trans_id = request.trans_id,
+                };
+                std::memcpy(m_buffers[0], std::addressof(header), sizeof(header));
+
+                size_t index = 0;
+                u32 offset = sizeof(header);
+                u32 transmitted_size = 0;
+                bool done = false;
+                while (true) {
+                    /* Fill the current buffer, while the previous one is sent. */
+                    u8 * const buffer = m_buffers[index];
+                    if (!done) {
+                        const u32 read_size = m_buffer_size - offset;
+
+                        u32 size_read;
+                        R_TRY(read_func(buffer + offset, read_size, std::addressof(size_read)));
+
+                        offset += size_read;
+                        done    = size_read < read_size;
+                    }
+
+                    /* Wait for the previous buffer to be sent, then send this one. */
+                    if (offset > 0) {
+                        if (m_pending) {
+                            u32 size_transferred;
+                            R_TRY(this->EndTransfer(std::addressof(size_transferred)));
+                        }
+
+                        R_TRY(this->BeginTransfer(false, buffer, offset));
+
+                        transmitted_size += offset;
+                        offset = 0;
+                        index  = (index + 1) % BufferCount;
+                    }
+
+                    if (done) {
+                        break;
+                    }
+                }
+
+                /* Wait for the last buffer to be sent. */
+                if (m_pending) {
+                    u32 size_transferred;
+                    R_TRY(this->EndTransfer(std::addressof(size_transferred)));
+                }
+
+                /* If the transmission size was a multiple of wMaxPacketSize, send a zero length packet. */
+                if (util::IsAligned(transmitted_size, PtpUsbBulkHighSpeedMaxPacketLength)) {
+                    u32 size_transferred;
+                    R_TRY(this->BeginTransfer(false, m_buffers[index], 0));
+                    R_TRY(this->EndTransfer(std::addressof(size_transferred)));
+                }
+
+                R_SUCCEED();
+            }
+
+            /* Receives the rest of a data container whose start has been read through dp, which must use the first buffer. */
+            /* At most max_size bytes are passed to write_func(src, size); the rest of the transmission is left unread. */
+            template <typename F>
+            Result ReceiveData(PtpDataParser &dp, u64 max_size, F &&write_func) {
+                ON_RESULT_FAILURE { this->EndPendingTransfer(); };
+
+                /* Take over whatever the parser has already received. */
+                const u8 *data;
+                u32 size;
+                bool eot;
+                dp.TakeReceivedData(std::addressof(data), std::addressof(size), std::addressof(eot));
+
+                size_t index = 0;
+                u64 size_remaining = max_size;
+                while (true) {
+                    const u32 write_size = std::min<u64>(size, size_remaining);
+                    size_remaining -= write_size;
+
+                    /* If there's more to receive, start receiving it into the other buffer while we write this one. */
+                    const bool more = !eot && size_remaining > 0;
+                    if (more) {
+                        index = (index + 1) % BufferCount;
+                        R_TRY(this->BeginTransfer(true, m_buffers[index], m_buffer_size));
+                    }
+
+                    if (write_size > 0) {
+                        R_TRY(write_func(data, write_size));
+                    }
+
+                    if (!more) {
+                        break;
+                    }
+
+                    /* End of transmission occurs when receiving a bulk transfer less than the buffer size. */
+                    u32 size_received;
+                    R_TRY(this->EndTransfer(std::addressof(size_received)));
+
+                    data = m_buffers[index];
+                    size = size_received;
+                    eot  = size_received < m_buffer_size;
+                }
+
+                R_SUCCEED();
+            }
+    };
+
+}
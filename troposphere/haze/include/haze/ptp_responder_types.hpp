@@ -174,7 +174,7 @@ namespace haze {
         char keywords_string_buffer[PtpStringMaxLength + 1];
 
         FsDirectoryEntry file_system_entry_buffer[DirectoryReadSize];
-        u8 file_system_data_buffer[FsBufferSize];
+        alignas(4_KB) u8 file_system_data_buffer[FsBufferSize];
 
         alignas(4_KB) u8 usb_bulk_write_buffer[UsbBulkPacketBufferSize];
         alignas(4_KB) u8 usb_bulk_read_buffer[UsbBulkPacketBufferSize];
@@ -36,12 +36,10 @@ namespace haze {
         g_usb_session.Finalize();
     }
 
-    Result AsyncUsbServer::TransferPacketImpl(bool read, void *page, u32 size, u32 *out_size_transferred) const {
-        u32 urb_id;
-        s32 waiter_idx;
-
+    Result AsyncUsbServer::BeginTransferPacket(bool read, void *page, u32 size, u32 *out_urb_id) const {
         /* If we're not configured yet, wait to become configured first. */
         if (!g_usb_session.GetConfigured()) {
+            s32 waiter_idx;
             R_TRY(m_reactor->WaitFor(std::addressof(waiter_idx), waiterForEvent(usbDsGetStateChangeEvent())));
             R_TRY(eventClear(usbDsGetStateChangeEvent()));
 
@@ -50,13 +48,24 @@ namespace haze {
 
         /* Select the appropriate endpoint and begin a transfer. */
         UsbSessionEndpoint ep = read ? UsbSessionEndpoint_Read : UsbSessionEndpoint_Write;
-        R_TRY(g_usb_session.TransferAsync(ep, page, size, std::addressof(urb_id)));
+        R_RETURN(g_usb_session.TransferAsync(ep, page, size, out_urb_id));
+    }
+
+    Result AsyncUsbServer::EndTransferPacket(bool read, u32 urb_id, u32 *out_size_transferred) const {
+        UsbSessionEndpoint ep = read ? UsbSessionEndpoint_Read : UsbSessionEndpoint_Write;
 
         /* Try to wait for the event. */
+        s32 waiter_idx;
         R_TRY(m_reactor->WaitFor(std::addressof(waiter_idx), waiterForEvent(g_usb_session.GetCompletionEvent(ep))));
 
         /* Return what we transferred. */
         R_RETURN(g_usb_session.GetTransferResult(ep, urb_id, out_size_transferred));
     }
 
+    Result AsyncUsbServer::TransferPacketImpl(bool read, void *page, u32 size, u32 *out_size_transferred) const {
+        u32 urb_id;
+        R_TRY(this->BeginTransferPacket(read, page, size, std::addressof(urb_id)));
+        R_RETURN(this->EndTransferPacket(read, urb_id, out_size_transferred));
+    }
+
 }
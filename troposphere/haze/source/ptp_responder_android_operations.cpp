@@ -14,14 +14,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <haze.hpp>
-#include <haze/ptp_data_builder.hpp>
 #include <haze/ptp_data_parser.hpp>
+#include <haze/ptp_data_pipeline.hpp>
 #include <haze/ptp_responder_types.hpp>
 
 namespace haze {
 
     Result PtpResponder::GetPartialObject64(PtpDataParser &dp) {
-        PtpDataBuilder db(m_buffers->usb_bulk_write_buffer, std::addressof(m_usb_server));
+        PtpDataPipeline pipeline(std::addressof(m_usb_server), m_buffers->usb_bulk_write_buffer, m_buffers->file_system_data_buffer, UsbBulkPacketBufferSize);
 
         /* Get the object ID, offset, and size for the file we want to read. */
         u32 object_id, size;
@@ -50,32 +50,22 @@ namespace haze {
         R_UNLESS(offset + size > offset, haze::ResultInvalidArgument());
         R_UNLESS(static_cast<u64>(file_size) <= offset + size, haze::ResultInvalidArgument());
 
-        /* Send the header and data size. */
-        R_TRY(db.AddDataHeader(m_request_header, size));
-
-        /* Begin reading the file, writing data to the builder as we progress. */
+        /* Send the requested data, reading the next batch while the previous one is being sent. */
         s64 size_remaining = size;
-        while (true) {
-            /* Get the next batch. */
-            u64 bytes_to_read = std::min<s64>(FsBufferSize, size_remaining);
-            u64 bytes_read;
+        R_TRY(pipeline.SendData(m_request_header, size, [&](void *dst, u32 read_size, u32 *out_size_read) -> Result {
+            /* If we've read enough data, we're done. */
+            const u64 bytes_to_read = std::min<s64>(read_size, size_remaining);
 
-            R_TRY(m_fs.ReadFile(std::addressof(file), offset, m_buffers->file_system_data_buffer, bytes_to_read, FsReadOption_None, std::addressof(bytes_read)));
+            u64 bytes_read = 0;
+            if (bytes_to_read > 0) {
+                R_TRY(m_fs.ReadFile(std::addressof(file), offset, dst, bytes_to_read, FsReadOption_None, std::addressof(bytes_read)));
+            }
 
             size_remaining -= bytes_read;
             offset += bytes_read;
-
-            /* Write to output. */
-            R_TRY(db.AddBuffer(m_buffers->file_system_data_buffer, bytes_read));
-
-            /* If we read fewer bytes than the batch size, or have read enough data, we're done. */
-            if (bytes_read < FsBufferSize || size_remaining == 0) {
-                break;
-            }
-        }
-
-        /* Flush the data response. */
-        R_TRY(db.Commit());
+            *out_size_read = bytes_read;
+            R_SUCCEED();
+        }));
 
         /* Write the success response. */
         R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
@@ -119,27 +109,14 @@ namespace haze {
         R_UNLESS(data_header.code == m_request_header.code,         haze::ResultOperationNotSupported());
         R_UNLESS(data_header.trans_id == m_request_header.trans_id, haze::ResultOperationNotSupported());
 
-        /* Begin writing to the filesystem. */
-        s64 size_remaining = size;
-        while (true) {
-            /* Read as many bytes as we can. */
-            u32 bytes_received;
-            const Result read_res = dp.ReadBuffer(m_buffers->file_system_data_buffer, FsBufferSize, std::addressof(bytes_received));
-
-            /* Write to the file. */
-            u32 bytes_to_write = std::min<s64>(size_remaining, bytes_received);
-            R_TRY(m_fs.WriteFile(std::addressof(file), offset, m_buffers->file_system_data_buffer, bytes_to_write, 0));
-
-            size_remaining -= bytes_to_write;
-            offset += bytes_to_write;
-
-            /* If we received fewer bytes than the batch size, or have written enough data, we're done. */
-            if (haze::ResultEndOfTransmission::Includes(read_res) || size_remaining == 0) {
-                break;
-            }
+        /* Write to the filesystem, receiving the next batch while the previous one is being written. */
+        PtpDataPipeline pipeline(std::addressof(m_usb_server), m_buffers->usb_bulk_read_buffer, m_buffers->file_system_data_buffer, UsbBulkPacketBufferSize);
+        R_TRY(pipeline.ReceiveData(dp, size, [&](const void *src, u32 write_size) -> Result {
+            R_TRY(m_fs.WriteFile(std::addressof(file), offset, src, write_size, 0));
 
-            R_TRY(read_res);
-        }
+            offset += write_size;
+            R_SUCCEED();
+        }));
 
         /* Write the success response. */
         R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
@@ -16,6 +16,7 @@
 #include <haze.hpp>
 #include <haze/ptp_data_builder.hpp>
 #include <haze/ptp_data_parser.hpp>
+#include <haze/ptp_data_pipeline.hpp>
 #include <haze/ptp_responder_types.hpp>
 
 namespace haze {
@@ -285,7 +286,7 @@ namespace haze {
     }
 
     Result PtpResponder::GetObject(PtpDataParser &dp) {
-        PtpDataBuilder db(m_buffers->usb_bulk_write_buffer, std::addressof(m_usb_server));
+        PtpDataPipeline pipeline(std::addressof(m_usb_server), m_buffers->usb_bulk_write_buffer, m_buffers->file_system_data_buffer, UsbBulkPacketBufferSize);
 
         /* Get the object ID the client requested. */
         u32 object_id;
@@ -307,29 +308,16 @@ namespace haze {
         s64 size = 0;
         R_TRY(m_fs.GetFileSize(std::addressof(file), std::addressof(size)));
 
-        /* Send the header and file size. */
-        R_TRY(db.AddDataHeader(m_request_header, size));
-
-        /* Begin reading the file, writing data to the builder as we progress. */
+        /* Send the file, reading the next batch while the previous one is being sent. */
         s64 offset = 0;
-        while (true) {
-            /* Get the next batch. */
+        R_TRY(pipeline.SendData(m_request_header, size, [&](void *dst, u32 read_size, u32 *out_size_read) -> Result {
             u64 bytes_read;
-            R_TRY(m_fs.ReadFile(std::addressof(file), offset, m_buffers->file_system_data_buffer, FsBufferSize, FsReadOption_None, std::addressof(bytes_read)));
+            R_TRY(m_fs.ReadFile(std::addressof(file), offset, dst, read_size, FsReadOption_None, std::addressof(bytes_read)));
 
             offset += bytes_read;
-
-            /* Write to output. */
-            R_TRY(db.AddBuffer(m_buffers->file_system_data_buffer, bytes_read));
-
-            /* If we read fewer bytes than the batch size, we're done. */
-            if (bytes_read < FsBufferSize) {
-                break;
-            }
-        }
-
-        /* Flush the data response. */
-        R_TRY(db.Commit());
+            *out_size_read = bytes_read;
+            R_SUCCEED();
+        }));
 
         /* Write the success response. */
         R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
@@ -447,24 +435,14 @@ namespace haze {
             R_TRY(m_fs.SetFileSize(std::addressof(file), data_header.length - sizeof(PtpUsbBulkContainer)));
         }
 
-        /* Begin writing to the filesystem. */
-        while (true) {
-            /* Read as many bytes as we can. */
-            u32 bytes_received;
-            const Result read_res = dp.ReadBuffer(m_buffers->file_system_data_buffer, FsBufferSize, std::addressof(bytes_received));
-
-            /* Write to the file. */
-            R_TRY(m_fs.WriteFile(std::addressof(file), offset, m_buffers->file_system_data_buffer, bytes_received, 0));
-
-            offset += bytes_received;
+        /* Write to the filesystem, receiving the next batch while the previous one is being written. */
+        PtpDataPipeline pipeline(std::addressof(m_usb_server), m_buffers->usb_bulk_read_buffer, m_buffers->file_system_data_buffer, UsbBulkPacketBufferSize);
+        R_TRY(pipeline.ReceiveData(dp, std::numeric_limits<u64>::max(), [&](const void *src, u32 write_size) -> Result {
+            R_TRY(m_fs.WriteFile(std::addressof(file), offset, src, write_size, 0));
 
-            /* If we received fewer bytes than the batch size, we're done. */
-            if (haze::ResultEndOfTransmission::Includes(read_res)) {
-                break;
-            }
-
-            R_TRY(read_res);
-        }
+            offset += write_size;
+            R_SUCCEED();
+        }));
 
         /* Truncate the file to the received size. */
         R_TRY(m_fs.SetFileSize(std::addressof(file), offset));
@@ -0,0 +1,172 @@
+#
+# Copyright (c) Atmosphère-NX
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms and conditions of the GNU General Public License,
+# version 2, as published by the Free Software Foundation.
+#
+# This program is distributed in the hope it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# ktrace.py: Decodes mesosphere kernel trace records into Chrome trace event JSON (viewable in Perfetto).
+#
+# The input is either a dump of the whole kernel trace buffer (beginning with the KTR1 header),
+# or a stream of raw records, as drained by diag::KernelTraceReader.
+
+import sys, json, argparse
+from struct import unpack as up
+
+BUFFER_MAGIC      = b'KTR1'
+BUFFER_HEADER_FMT = '<4sIIIII Q'
+RING_HEADER_FMT   = '<QQQI'
+RECORD_FMT        = '<BBHIQ6Q'
+RECORD_SIZE       = 0x40
+
+DEFAULT_TICK_FREQUENCY = 19200000
+
+TYPE_THREAD_SWITCH   = 1
+TYPE_SVC_ENTRY0      = 3
+TYPE_SVC_ENTRY1      = 4
+TYPE_SVC_EXIT0       = 5
+TYPE_SVC_EXIT1       = 6
+TYPE_INTERRUPT       = 7
+TYPE_SCHEDULE_UPDATE = 11
+TYPE_CORE_MIGRATION  = 14
+
+KERNEL_PROCESS_ID = 0xFFFF
+CORES_PID         = 0x10000
+
+MIGRATION_REASONS = {
+    1 : 'idle core (suggested)',
+    2 : 'idle core (top thread)',
+    3 : 'yield with core migration',
+    4 : 'yield to any thread (leave)',
+    5 : 'yield to any thread (take)',
+}
+
+class Record(object):
+    def __init__(self, data):
+        self.core_id, self.type, self.process_id, self.thread_id, self.tick, d0, d1, d2, d3, d4, d5 = up(RECORD_FMT, data)
+        self.data = [d0, d1, d2, d3, d4, d5]
+
+def parse_records(data):
+    return [Record(data[i:i+RECORD_SIZE]) for i in range(0, len(data) - RECORD_SIZE + 1, RECORD_SIZE)]
+
+def parse_buffer(data):
+    magic, num_rings, ring_offset, ring_size, record_count, _, tick_frequency = up(BUFFER_HEADER_FMT, data[:0x20])
+    assert magic == BUFFER_MAGIC
+    records = []
+    for i in range(num_rings):
+        ring = data[ring_offset + i * ring_size:ring_offset + (i + 1) * ring_size]
+        write_count, read_count, drop_count, flags = up(RING_HEADER_FMT, ring[:0x1C])
+        if drop_count != 0:
+            sys.stderr.write('core %d: %d records dropped\n' % (i, drop_count))
+        for index in range(max(0, write_count - record_count), write_count):
+            ofs = RECORD_SIZE + (index % record_count) * RECORD_SIZE
+            records.append(Record(ring[ofs:ofs+RECORD_SIZE]))
+    return records, tick_frequency
+
+class Decoder(object):
+    def __init__(self, tick_frequency):
+        self.tick_frequency = tick_frequency
+        self.events         = []
+        self.running        = {}
+        self.svcs           = {}
+        self.svc_latencies  = {}
+        self.names          = set()
+
+    def ts(self, tick):
+        return tick * 1000000.0 / self.tick_frequency
+
+    def pid(self, record):
+        return record.process_id if record.process_id != KERNEL_PROCESS_ID else -1
+
+    def name_thread(self, pid, tid, name):
+        if (pid, tid) not in self.names:
+            self.names.add((pid, tid))
+            self.events.append({'ph' : 'M', 'name' : 'thread_name', 'pid' : pid, 'tid' : tid, 'args' : {'name' : name}})
+
+    def instant(self, record, name, args):
+        self.name_thread(CORES_PID, record.core_id, 'core %d' % record.core_id)
+        self.events.append({'ph' : 'i', 's' : 't', 'name' : name, 'pid' : CORES_PID, 'tid' : record.core_id, 'ts' : self.ts(record.tick), 'args' : args})
+
+    def end_running(self, core_id, tick):
+        if core_id in self.running:
+            start, pid, tid = self.running.pop(core_id)
+            self.events.append({'ph' : 'X', 'name' : 'thread %d' % tid, 'cat' : 'sched', 'pid' : CORES_PID, 'tid' : core_id, 'ts' : self.ts(start), 'dur' : self.ts(tick) - self.ts(start), 'args' : {'process_id' : pid}})
+
+    def decode(self, record):
+        if record.type == TYPE_THREAD_SWITCH:
+            self.name_thread(CORES_PID, record.core_id, 'core %d' % record.core_id)
+            self.end_running(record.core_id, record.tick)
+            self.running[record.core_id] = (record.tick, self.pid(record), record.data[0])
+        elif record.type == TYPE_SVC_ENTRY0:
+            pid = self.pid(record)
+            self.name_thread(pid, record.thread_id, 'thread %d' % record.thread_id)
+            self.svcs[record.thread_id] = (record.data[0], record.tick)
+            self.events.append({'ph' : 'B', 'name' : 'svc 0x%02X' % record.data[0], 'cat' : 'svc', 'pid' : pid, 'tid' : record.thread_id, 'ts' : self.ts(record.tick), 'args' : {'x%d' % i : '0x%X' % v for i, v in enumerate(record.data[1:])}})
+        elif record.type == TYPE_SVC_EXIT0:
+            # Exits whose entry predates the trace would unbalance the B/E pairs, so they are skipped.
+            if record.thread_id in self.svcs:
+                svc_id, start = self.svcs.pop(record.thread_id)
+                self.svc_latencies.setdefault(svc_id, []).append(record.tick - start)
+                self.events.append({'ph' : 'E', 'pid' : self.pid(record), 'tid' : record.thread_id, 'ts' : self.ts(record.tick), 'args' : {'w%d' % i : '0x%X' % v for i, v in enumerate(record.data[1:])}})
+        elif record.type == TYPE_INTERRUPT:
+            self.instant(record, 'interrupt %d' % record.data[0], {})
+        elif record.type == TYPE_SCHEDULE_UPDATE:
+            self.instant(record, 'schedule update', {'core' : record.data[0], 'prev' : record.data[1], 'next' : record.data[2]})
+        elif record.type == TYPE_CORE_MIGRATION:
+            self.instant(record, 'core migration', {'thread' : record.data[0], 'from' : record.data[1] - (1 << 64) if record.data[1] >= (1 << 63) else record.data[1], 'to' : record.data[2] - (1 << 64) if record.data[2] >= (1 << 63) else record.data[2], 'reason' : MIGRATION_REASONS.get(record.data[3], str(record.data[3]))})
+
+    def finish(self):
+        end = max([r[0] for r in self.running.values()] + [0])
+        for core_id in list(self.running.keys()):
+            self.end_running(core_id, end)
+
+    def print_svc_statistics(self):
+        print('%-6s %8s %12s %12s %12s %12s' % ('svc', 'count', 'mean (us)', 'p50 (us)', 'p99 (us)', 'max (us)'))
+        for svc_id in sorted(self.svc_latencies.keys()):
+            latencies = sorted(self.svc_latencies[svc_id])
+            us = lambda t: t * 1000000.0 / self.tick_frequency
+            print('0x%02X   %8d %12.3f %12.3f %12.3f %12.3f' % (svc_id, len(latencies), us(sum(latencies) / float(len(latencies))), us(latencies[len(latencies) // 2]), us(latencies[min(len(latencies) - 1, (len(latencies) * 99) // 100)]), us(latencies[-1])))
+
+def main(argc, argv):
+    parser = argparse.ArgumentParser(description='Decode mesosphere kernel trace records.')
+    parser.add_argument('input', help='kernel trace buffer dump, or drained record stream')
+    parser.add_argument('output', help='output Chrome trace event JSON')
+    parser.add_argument('--tick-frequency', type=int, default=None, help='tick frequency of a raw record stream (default: %d)' % DEFAULT_TICK_FREQUENCY)
+    parser.add_argument('--svc-stats', action='store_true', help='print per-svc latency statistics')
+    args = parser.parse_args(argv[1:])
+
+    with open(args.input, 'rb') as f:
+        data = f.read()
+
+    if data[:4] == BUFFER_MAGIC:
+        records, tick_frequency = parse_buffer(data)
+    else:
+        records, tick_frequency = parse_records(data), DEFAULT_TICK_FREQUENCY
+    if args.tick_frequency is not None:
+        tick_frequency = args.tick_frequency
+
+    # Records from each core are in order, but the cores' rings must be merged by time.
+    records = sorted([r for r in records if r.type != 0], key=lambda r: r.tick)
+
+    decoder = Decoder(tick_frequency)
+    for record in records:
+        decoder.decode(record)
+    decoder.finish()
+
+    with open(args.output, 'w') as f:
+        json.dump({'traceEvents' : decoder.events, 'displayTimeUnit' : 'ns'}, f)
+
+    if args.svc_stats:
+        decoder.print_svc_statistics()
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(len(sys.argv), sys.argv))